@@ -0,0 +1,109 @@
+#include "BufferAllocator.h"
+#include "Memory/LinearRingAllocator.h"
+
+BufferAllocator::BufferAllocator(DXContext* context)
+	: context(context), pageAllocator(BUFFER_HEAP_PAGE_SIZE)
+{
+	if (FAILED(context->getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+		throw std::runtime_error("Could not create buffer allocator fence");
+	}
+}
+
+ComPointer<ID3D12Heap> BufferAllocator::createHeap(UINT64 size) {
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = size;
+	heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+	ComPointer<ID3D12Heap> heap;
+	if (FAILED(context->getDevice()->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)))) {
+		throw std::runtime_error("Failed to create buffer heap.");
+	}
+	return heap;
+}
+
+ComPointer<ID3D12Resource1> BufferAllocator::createPlacedBuffer(ID3D12Heap* heap, UINT64 offset, UINT64 size, D3D12_RESOURCE_STATES initialState) {
+	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+
+	ComPointer<ID3D12Resource1> buffer;
+	HRESULT hr = context->getDevice()->CreatePlacedResource(
+		heap,
+		offset,
+		&bufferDesc,
+		initialState,
+		nullptr,
+		IID_PPV_ARGS(&buffer)
+	);
+	if (FAILED(hr)) {
+		throw std::runtime_error("Failed to create placed buffer.");
+	}
+	return buffer;
+}
+
+ComPointer<ID3D12Resource1> BufferAllocator::createBuffer(UINT64 size, D3D12_RESOURCE_STATES initialState, HeapAllocation& allocation) {
+	pageAllocator.releaseCompleted(fence->GetCompletedValue());
+
+	// Buffers placed in a heap always occupy whole 64KB blocks
+	allocation = pageAllocator.allocate(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	while (pages.size() < pageAllocator.getPageCount()) {
+		pages.push_back(createHeap(pageAllocator.getPageSize((uint32_t)pages.size())));
+	}
+
+	return createPlacedBuffer(pages[allocation.page].Get(), allocation.offset, size, initialState);
+}
+
+void BufferAllocator::freeBuffer(const HeapAllocation& allocation) {
+	// Anything recorded this frame may still read the range, so wait for the next frame fence
+	pageAllocator.free(allocation, fenceValue + 1);
+}
+
+void BufferAllocator::finishFrame() {
+	context->getCommandQueue()->Signal(fence, ++fenceValue);
+	pageAllocator.releaseCompleted(fence->GetCompletedValue());
+}
+
+unsigned int BufferAllocator::addTransientBuffer(UINT64 size, unsigned int firstPass, unsigned int lastPass) {
+	if (transientHeap.Get()) {
+		throw std::runtime_error("Transient buffers have already been created.");
+	}
+
+	transientSizes.push_back(size);
+	return transientPlacer.addBuffer(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, firstPass, lastPass);
+}
+
+void BufferAllocator::createTransientBuffers(D3D12_RESOURCE_STATES initialState) {
+	if (transientHeap.Get() || transientSizes.empty()) {
+		return;
+	}
+
+	UINT64 heapSize = transientPlacer.place();
+	transientHeap = createHeap(LinearRingAllocator::alignUp(heapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+
+	transientBuffers.resize(transientSizes.size());
+	for (unsigned int i = 0; i < transientSizes.size(); i++) {
+		transientBuffers[i] = createPlacedBuffer(transientHeap.Get(), transientPlacer.getOffset(i), transientSizes[i], initialState);
+	}
+}
+
+ComPointer<ID3D12Resource1>& BufferAllocator::getTransientBuffer(unsigned int index) {
+	if (index >= transientBuffers.size()) {
+		throw std::runtime_error("Transient buffers have not been created yet.");
+	}
+	return transientBuffers[index];
+}
+
+void BufferAllocator::releaseResources() {
+	for (auto& buffer : transientBuffers) {
+		buffer.Release();
+	}
+	transientBuffers.clear();
+	transientHeap.Release();
+
+	for (auto& page : pages) {
+		page.Release();
+	}
+	pages.clear();
+	fence.Release();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include "Support/WinInclude.h"
+#include "Support/ComPointer.h"
+#include "D3D/DXContext.h"
+#include "Memory/BufferPlacer.h"
+#include "Memory/HeapPageAllocator.h"
+
+// Size of each default heap that persistent buffers are placed into
+#define BUFFER_HEAP_PAGE_SIZE (64ull * 1024 * 1024)
+
+// Places GPU buffers in a few large default heaps instead of one committed resource each.
+// Persistent buffers are sub-allocated from heap pages. Transient buffers are registered up front
+// with the pass range they are alive in, then placed together into one heap where buffers with
+// disjoint lifetimes alias each other. Users of an aliased buffer must issue an aliasing barrier
+// and fully rewrite it before reading, since its contents are undefined when it becomes active.
+class BufferAllocator {
+public:
+	BufferAllocator(DXContext* context);
+
+	ComPointer<ID3D12Resource1> createBuffer(UINT64 size, D3D12_RESOURCE_STATES initialState, HeapAllocation& allocation);
+	// The range is only reused after the GPU has finished the current frame
+	void freeBuffer(const HeapAllocation& allocation);
+
+	// Call once per frame after all command lists have been submitted
+	void finishFrame();
+
+	// Reserves a new pass index for transient lifetimes
+	unsigned int beginTransientPass() { return transientPassCount++; }
+	unsigned int addTransientBuffer(UINT64 size, unsigned int firstPass, unsigned int lastPass);
+
+	// Places all registered transient buffers and creates them, call once after every scene is constructed
+	void createTransientBuffers(D3D12_RESOURCE_STATES initialState);
+	ComPointer<ID3D12Resource1>& getTransientBuffer(unsigned int index);
+
+	UINT64 getTransientHeapSize() const { return transientPlacer.getHeapSize(); }
+	UINT64 getUnaliasedTransientSize() const { return transientPlacer.getUnaliasedSize(); }
+
+	void releaseResources();
+
+private:
+	ComPointer<ID3D12Heap> createHeap(UINT64 size);
+	ComPointer<ID3D12Resource1> createPlacedBuffer(ID3D12Heap* heap, UINT64 offset, UINT64 size, D3D12_RESOURCE_STATES initialState);
+
+	DXContext* context;
+
+	HeapPageAllocator pageAllocator;
+	std::vector<ComPointer<ID3D12Heap>> pages;
+
+	ComPointer<ID3D12Fence> fence;
+	UINT64 fenceValue = 0;
+
+	unsigned int transientPassCount = 0;
+	BufferPlacer transientPlacer;
+	std::vector<UINT64> transientSizes;
+	ComPointer<ID3D12Heap> transientHeap;
+	std::vector<ComPointer<ID3D12Resource1>> transientBuffers;
+};
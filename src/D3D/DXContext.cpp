@@ -1,4 +1,7 @@
 #include "DXContext.h"
+#include "DescriptorHeap.h"
+#include "BufferAllocator.h"
+#include "UploadBatcher.h"
 
 DXContext::DXContext() {
 
@@ -42,11 +45,20 @@ DXContext::DXContext() {
 		cmdAllocators[i] = cmdAllocator;
 	}
 
+    globalDescriptorHeap = std::make_unique<DescriptorHeap>(*this, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+        GLOBAL_PERSISTENT_DESCRIPTORS, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, GLOBAL_TRANSIENT_DESCRIPTORS);
+
+    bufferAllocator = std::make_unique<BufferAllocator>(this);
+    uploadBatcher = std::make_unique<UploadBatcher>(this);
+
     initTimingResources();
 
 }
 
 DXContext::~DXContext() {
+    uploadBatcher->releaseResources();
+    uploadBatcher.reset();
+
     for (auto& cmdList : cmdLists) {
         cmdList.Release();
     }
@@ -59,6 +71,10 @@ DXContext::~DXContext() {
     {
         CloseHandle(fenceEvent);
     }
+    bufferAllocator->releaseResources();
+    bufferAllocator.reset();
+    globalDescriptorHeap->releaseResources();
+    globalDescriptorHeap.reset();
     fence.Release();
     cmdQueue.Release();
     device.Release();
@@ -84,9 +100,18 @@ void DXContext::resetCommandList(CommandListID id)
     cmdAllocators[id]->Reset();
     
 	cmdLists[id]->Reset(cmdAllocators[id], nullptr);
+
+    // Bind the global heap once per recording so passes never have to switch heaps
+    ID3D12DescriptorHeap* descriptorHeaps[] = { globalDescriptorHeap->GetAddress() };
+    cmdLists[id]->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 }
 
 void DXContext::executeCommandList(CommandListID id) {
+    // Buffers queued for initialisation must be ready before any list that could read them runs
+    if (id != CommandListID::UPLOAD_BATCH_ID && uploadBatcher && uploadBatcher->hasPendingUploads()) {
+        uploadBatcher->flush();
+    }
+
 	if (SUCCEEDED(cmdLists[id]->Close())) {
 		ID3D12CommandList* lists[] = { cmdLists[id] };
 		cmdQueue->ExecuteCommandLists(1, lists);
@@ -3,8 +3,17 @@
 #include "../Support/ComPointer.h"
 #include <stdexcept>
 #include <array>
+#include <memory>
 
-#define NUM_CMDLISTS 60
+class DescriptorHeap;
+class BufferAllocator;
+class UploadBatcher;
+
+#define NUM_CMDLISTS 33
+
+// Every shader visible CBV/SRV/UAV descriptor lives in one global heap
+#define GLOBAL_PERSISTENT_DESCRIPTORS 2048
+#define GLOBAL_TRANSIENT_DESCRIPTORS 1024
 enum CommandListID {
     OBJECT_RENDER_WIRE_ID,
     OBJECT_RENDER_SOLID_ID,
@@ -17,61 +26,37 @@ enum CommandListID {
     PBMPM_BUFFERCLEAR_COMPUTE_ID,
     PBMPM_EMISSION_COMPUTE_ID,
     PBMPM_SET_INDIRECT_ARGS_COMPUTE_ID,
+    PBMPM_BUKKITSLEEP_COMPUTE_ID,
+    PBMPM_SLEEPINGGRID_COMPUTE_ID,
+
+    // Surface construction, shared by every material
+    MATERIAL_BIN_COUNT_COMPUTE_ID,
+    MATERIAL_BIN_SCATTER_COMPUTE_ID,
+    BILEVEL_UNIFORM_GRID_COMPUTE_ID,
+    CELL_PARTICLE_OFFSETS_COMPUTE_ID,
+    CELL_PARTICLE_SCATTER_COMPUTE_ID,
+    SURFACE_BLOCK_DETECTION_COMPUTE_ID,
+    SURFACE_CELL_DETECTION_COMPUTE_ID,
+    SURFACE_VERTEX_COMPACTION_COMPUTE_ID,
+    SURFACE_VERTEX_DENSITY_COMPUTE_ID,
+    SURFACE_BUFFER_CLEAR_COMPUTE_ID,
 
     FLUID_RENDER_ID,
-    FLUID_BILEVEL_UNIFORM_GRID_COMPUTE_ID,
-    FLUID_SURFACE_BLOCK_DETECTION_COMPUTE_ID,
-    FLUID_SURFACE_CELL_DETECTION_COMPUTE_ID,
-    FLUID_SURFACE_VERTEX_COMPACTION_COMPUTE_ID,
-    FLUID_SURFACE_VERTEX_DENSITY_COMPUTE_ID,
-    FLUID_SURFACE_VERTEX_NORMAL_COMPUTE_ID,
-    FLUID_BUFFER_CLEAR_COMPUTE_ID,
-    FLUID_DISPATCH_ARG_DIVIDE_COMPUTE_ID,
     FLUID_MESH_ID,
 
     ELASTIC_RENDER_ID,
-    ELASTIC_BILEVEL_UNIFORM_GRID_COMPUTE_ID,
-    ELASTIC_SURFACE_BLOCK_DETECTION_COMPUTE_ID,
-    ELASTIC_SURFACE_CELL_DETECTION_COMPUTE_ID,
-    ELASTIC_SURFACE_VERTEX_COMPACTION_COMPUTE_ID,
-    ELASTIC_SURFACE_VERTEX_DENSITY_COMPUTE_ID,
-    ELASTIC_SURFACE_VERTEX_NORMAL_COMPUTE_ID,
-    ELASTIC_BUFFER_CLEAR_COMPUTE_ID,
-    ELASTIC_DISPATCH_ARG_DIVIDE_COMPUTE_ID,
     ELASTIC_MESH_ID,
 
     VISCO_RENDER_ID,
-    VISCO_BILEVEL_UNIFORM_GRID_COMPUTE_ID,
-    VISCO_SURFACE_BLOCK_DETECTION_COMPUTE_ID,
-    VISCO_SURFACE_CELL_DETECTION_COMPUTE_ID,
-    VISCO_SURFACE_VERTEX_COMPACTION_COMPUTE_ID,
-    VISCO_SURFACE_VERTEX_DENSITY_COMPUTE_ID,
-    VISCO_SURFACE_VERTEX_NORMAL_COMPUTE_ID,
-    VISCO_BUFFER_CLEAR_COMPUTE_ID,
-    VISCO_DISPATCH_ARG_DIVIDE_COMPUTE_ID,
     VISCO_MESH_ID,
 
     SAND_RENDER_ID,
-    SAND_BILEVEL_UNIFORM_GRID_COMPUTE_ID,
-    SAND_SURFACE_BLOCK_DETECTION_COMPUTE_ID,
-    SAND_SURFACE_CELL_DETECTION_COMPUTE_ID,
-    SAND_SURFACE_VERTEX_COMPACTION_COMPUTE_ID,
-    SAND_SURFACE_VERTEX_DENSITY_COMPUTE_ID,
-    SAND_SURFACE_VERTEX_NORMAL_COMPUTE_ID,
-    SAND_BUFFER_CLEAR_COMPUTE_ID,
-    SAND_DISPATCH_ARG_DIVIDE_COMPUTE_ID,
     SAND_MESH_ID,
 
     SNOW_RENDER_ID,
-    SNOW_BILEVEL_UNIFORM_GRID_COMPUTE_ID,
-    SNOW_SURFACE_BLOCK_DETECTION_COMPUTE_ID,
-    SNOW_SURFACE_CELL_DETECTION_COMPUTE_ID,
-    SNOW_SURFACE_VERTEX_COMPACTION_COMPUTE_ID,
-    SNOW_SURFACE_VERTEX_DENSITY_COMPUTE_ID,
-    SNOW_SURFACE_VERTEX_NORMAL_COMPUTE_ID,
-    SNOW_BUFFER_CLEAR_COMPUTE_ID,
-    SNOW_DISPATCH_ARG_DIVIDE_COMPUTE_ID,
-    SNOW_MESH_ID
+    SNOW_MESH_ID,
+
+    UPLOAD_BATCH_ID
 };
 
 class DXContext
@@ -92,6 +77,9 @@ public:
     ComPointer<ID3D12CommandQueue>& getCommandQueue();
     ComPointer<ID3D12CommandAllocator>& getCommandAllocator(CommandListID id) { return cmdAllocators[id]; };
     ID3D12GraphicsCommandList6* createCommandList(CommandListID id);
+    DescriptorHeap* getGlobalDescriptorHeap() { return globalDescriptorHeap.get(); }
+    BufferAllocator* getBufferAllocator() { return bufferAllocator.get(); }
+    UploadBatcher* getUploadBatcher() { return uploadBatcher.get(); }
     double readTimingQueryData();
     void startTimingQuery(ID3D12GraphicsCommandList6* cmdList);
     void endTimingQuery(ID3D12GraphicsCommandList6* cmdList);
@@ -114,6 +102,10 @@ private:
     UINT64 fenceValue = 0;
     HANDLE fenceEvent = nullptr;
 
+    std::unique_ptr<DescriptorHeap> globalDescriptorHeap;
+    std::unique_ptr<BufferAllocator> bufferAllocator;
+    std::unique_ptr<UploadBatcher> uploadBatcher;
+
 };
 
 // Support functions used in main.h and MeshShadingScene.cpp
@@ -3,12 +3,14 @@
 #include <cassert>
 #include <stdexcept>
 
-DescriptorHeap::DescriptorHeap(DXContext &context, D3D12_DESCRIPTOR_HEAP_TYPE type, unsigned int numberOfDescriptors, D3D12_DESCRIPTOR_HEAP_FLAGS flags)
-	: descriptorCount(numberOfDescriptors)
+DescriptorHeap::DescriptorHeap(DXContext &context, D3D12_DESCRIPTOR_HEAP_TYPE type, unsigned int numberOfDescriptors, D3D12_DESCRIPTOR_HEAP_FLAGS flags,
+	unsigned int numberOfTransientDescriptors)
+	: cmdQueue(context.getCommandQueue()), descriptorCount(numberOfDescriptors + numberOfTransientDescriptors),
+	allocator(numberOfDescriptors, numberOfTransientDescriptors)
 {
 	ComPointer<ID3D12Device6> device = context.getDevice();
 	D3D12_DESCRIPTOR_HEAP_DESC description = {};
-	description.NumDescriptors = numberOfDescriptors;
+	description.NumDescriptors = descriptorCount;
 	description.Type = type;
 	description.Flags = flags;
 
@@ -16,6 +18,10 @@ DescriptorHeap::DescriptorHeap(DXContext &context, D3D12_DESCRIPTOR_HEAP_TYPE ty
 		throw std::runtime_error("Could not create descriptor heap");
 	};
 	descriptorSize = device->GetDescriptorHandleIncrementSize(type);
+
+	if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+		throw std::runtime_error("Could not create descriptor heap fence");
+	}
 }
 
 ComPointer<ID3D12DescriptorHeap>& DescriptorHeap::Get()
@@ -40,19 +46,76 @@ CD3DX12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GetGPUHandleAt(unsigned int index)
 
 unsigned int DescriptorHeap::GetNextAvailableIndex()
 {
-	if (currentDescriptorIndex >= descriptorCount)
+	return AllocateRange(1);
+}
+
+unsigned int DescriptorHeap::GetDescriptorSize()
+{
+	return descriptorSize;
+}
+
+unsigned int DescriptorHeap::AllocateRange(unsigned int count)
+{
+	allocator.releaseCompleted(fence->GetCompletedValue());
+
+	unsigned int index = allocator.allocate(count);
+	if (index == DescriptorAllocator::InvalidIndex)
 	{
 		assert(false && "Descriptor count within heap has been exceeded!");
 		return 0;
 	}
 
-	unsigned int index = currentDescriptorIndex;
-	currentDescriptorIndex++;
 	return index;
 }
 
-unsigned int DescriptorHeap::GetDescriptorSize()
+void DescriptorHeap::FreeRange(unsigned int index, unsigned int count)
 {
-	return 0;
+	// Anything recorded this frame may still reference the range, so wait for the next frame fence
+	allocator.free(index, count, fenceValue + 1);
 }
 
+unsigned int DescriptorHeap::AllocateTransient(unsigned int count)
+{
+	allocator.releaseCompleted(fence->GetCompletedValue());
+
+	unsigned int index = allocator.allocateTransient(count);
+	// The ring is full, wait until the oldest frame has retired
+	while (index == DescriptorAllocator::InvalidIndex && allocator.getOldestTransientFenceValue() != 0)
+	{
+		waitForFenceValue(allocator.getOldestTransientFenceValue());
+		allocator.releaseCompleted(fence->GetCompletedValue());
+		index = allocator.allocateTransient(count);
+	}
+
+	if (index == DescriptorAllocator::InvalidIndex)
+	{
+		throw std::runtime_error("Transient descriptor ring is too small");
+	}
+
+	return index;
+}
+
+void DescriptorHeap::FinishFrame()
+{
+	cmdQueue->Signal(fence, ++fenceValue);
+	allocator.finishFrame(fenceValue);
+	allocator.releaseCompleted(fence->GetCompletedValue());
+}
+
+void DescriptorHeap::waitForFenceValue(UINT64 value)
+{
+	if (fence->GetCompletedValue() >= value)
+	{
+		return;
+	}
+
+	HANDLE eventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (eventHandle == nullptr)
+	{
+		throw std::runtime_error("Failed to create event handle.");
+	}
+
+	fence->SetEventOnCompletion(value, eventHandle);
+	WaitForSingleObject(eventHandle, INFINITE);
+	CloseHandle(eventHandle);
+}
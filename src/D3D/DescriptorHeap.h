@@ -3,14 +3,16 @@
 #include "./includes/d3dx12.h"
 #include <wrl.h>
 #include "DXContext.h"
+#include "Memory/DescriptorAllocator.h"
 
 // Sourced from https://github.com/stefanpgd/Compute-DirectX12-Tutorial/
+// Extended with a free list for persistent descriptors and a per-frame ring for transient ones
 
 class DescriptorHeap
 {
 public:
 	DescriptorHeap(DXContext &context, D3D12_DESCRIPTOR_HEAP_TYPE type, unsigned int numberOfDescriptors,
-		D3D12_DESCRIPTOR_HEAP_FLAGS flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE);
+		D3D12_DESCRIPTOR_HEAP_FLAGS flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE, unsigned int numberOfTransientDescriptors = 0);
 
 	ComPointer<ID3D12DescriptorHeap>& Get();
 	ID3D12DescriptorHeap* GetAddress();
@@ -20,12 +22,29 @@ public:
 	unsigned int GetNextAvailableIndex();
 	unsigned int GetDescriptorSize();
 
-	void releaseResources() { descriptorHeap.Release(); }
+	// Contiguous range, use this when a root descriptor table spans several views
+	unsigned int AllocateRange(unsigned int count);
+	// The range is only recycled after the GPU has finished the current frame
+	void FreeRange(unsigned int index, unsigned int count);
+
+	// Descriptors that are only valid until the end of the current frame
+	unsigned int AllocateTransient(unsigned int count);
+
+	// Call once per frame after all command lists have been submitted
+	void FinishFrame();
+
+	void releaseResources() { descriptorHeap.Release(); fence.Release(); }
 
 private:
+	void waitForFenceValue(UINT64 value);
+
 	ComPointer<ID3D12DescriptorHeap> descriptorHeap;
+	ComPointer<ID3D12CommandQueue> cmdQueue;
+	ComPointer<ID3D12Fence> fence;
+	UINT64 fenceValue = 0;
 
 	unsigned int descriptorSize;
 	unsigned int descriptorCount;
-	unsigned int currentDescriptorIndex = 0;
-};
\ No newline at end of file
+
+	DescriptorAllocator allocator;
+};
@@ -2,9 +2,17 @@
 
 Pipeline::Pipeline(std::string rootSignatureShaderName, DXContext& context, CommandListID cmdID,
 	D3D12_DESCRIPTOR_HEAP_TYPE type, unsigned int numberOfDescriptors, D3D12_DESCRIPTOR_HEAP_FLAGS flags)
-	: rootSignatureShader(rootSignatureShaderName), descriptorHeap(context, type, numberOfDescriptors, flags), cmdID(cmdID),
+	: rootSignatureShader(rootSignatureShaderName), descriptorHeap(nullptr), cmdID(cmdID),
 	cmdList(context.createCommandList(cmdID))
 {
+	if (type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV && (flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)) {
+		descriptorHeap = context.getGlobalDescriptorHeap();
+	}
+	else {
+		ownedDescriptorHeap = std::make_unique<DescriptorHeap>(context, type, numberOfDescriptors, flags);
+		descriptorHeap = ownedDescriptorHeap.get();
+	}
+
 	context.resetCommandList(cmdID);
 	context.getDevice()->CreateRootSignature(0, rootSignatureShader.getBuffer(), rootSignatureShader.getSize(), IID_PPV_ARGS(&rootSignature));
 }
@@ -16,11 +24,14 @@ ComPointer<ID3D12RootSignature>& Pipeline::getRootSignature()
 
 DescriptorHeap* Pipeline::getDescriptorHeap()
 {
-	return &descriptorHeap;
+	return descriptorHeap;
 }
 
 void Pipeline::releaseResources()
 {
 	rootSignature.Release();
-	descriptorHeap.releaseResources();
+	// The global heap is released by the context
+	if (ownedDescriptorHeap) {
+		ownedDescriptorHeap->releaseResources();
+	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "../../Support/ComPointer.h"
 #include "../../Support/Window.h"
 #include "../DescriptorHeap.h"
+#include <memory>
 
 class Pipeline {
 public:
@@ -28,7 +29,9 @@ protected:
 	Shader rootSignatureShader;
 
 	ComPointer<ID3D12RootSignature> rootSignature;
-	DescriptorHeap descriptorHeap;
+	// Points at the context's global heap for shader visible CBV/SRV/UAV pipelines, otherwise at ownedDescriptorHeap
+	DescriptorHeap* descriptorHeap;
+	std::unique_ptr<DescriptorHeap> ownedDescriptorHeap;
 	ComPointer<ID3D12PipelineState> pso;
 	CommandListID cmdID;
 
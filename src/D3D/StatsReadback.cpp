@@ -0,0 +1,80 @@
+#include "StatsReadback.h"
+
+StatsReadback::StatsReadback(DXContext* context)
+	: context(context), ring(STATS_READBACK_SLOTS)
+{
+	slotSize = (sizeof(SimulationStats) + 255) & ~255ull;
+
+	D3D12_HEAP_PROPERTIES heapProps = {};
+	heapProps.Type = D3D12_HEAP_TYPE_READBACK;
+
+	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(slotSize * STATS_READBACK_SLOTS);
+
+	HRESULT hr = context->getDevice()->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&buffer)
+	);
+	if (FAILED(hr)) {
+		throw std::runtime_error("Failed to create stats readback buffer.");
+	}
+
+	// Readback heaps can stay mapped, each slot is only read after its fence has passed
+	if (FAILED(buffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData)))) {
+		throw std::runtime_error("Failed to map stats readback buffer.");
+	}
+
+	if (FAILED(context->getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+		throw std::runtime_error("Failed to create stats readback fence.");
+	}
+}
+
+void StatsReadback::beginFrame() {
+	uint32_t completedSlot = ring.poll(fence->GetCompletedValue());
+	if (completedSlot != ReadbackRing::InvalidSlot) {
+		memcpy(&stats, mappedData + completedSlot * slotSize, sizeof(SimulationStats));
+	}
+
+	currentSlot = ring.beginFrame();
+	if (currentSlot != ReadbackRing::InvalidSlot) {
+		// Stats of passes that don't run this frame read back as zero
+		memset(mappedData + currentSlot * slotSize, 0, sizeof(SimulationStats));
+	}
+}
+
+void StatsReadback::copyValue(ID3D12GraphicsCommandList6* cmdList, ID3D12Resource* source, D3D12_RESOURCE_STATES sourceState, UINT64 sourceOffset, size_t statOffset) {
+	// Every slot is still in flight, drop this frame rather than wait
+	if (currentSlot == ReadbackRing::InvalidSlot) {
+		return;
+	}
+
+	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(source, sourceState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	cmdList->ResourceBarrier(1, &barrier);
+
+	cmdList->CopyBufferRegion(buffer.Get(), currentSlot * slotSize + statOffset, source, sourceOffset, sizeof(UINT));
+
+	barrier = CD3DX12_RESOURCE_BARRIER::Transition(source, D3D12_RESOURCE_STATE_COPY_SOURCE, sourceState);
+	cmdList->ResourceBarrier(1, &barrier);
+}
+
+void StatsReadback::finishFrame() {
+	if (currentSlot == ReadbackRing::InvalidSlot) {
+		return;
+	}
+
+	context->getCommandQueue()->Signal(fence, ++fenceValue);
+	ring.submit(currentSlot, fenceValue);
+	currentSlot = ReadbackRing::InvalidSlot;
+}
+
+void StatsReadback::releaseResources() {
+	if (buffer.Get() && mappedData) {
+		buffer->Unmap(0, nullptr);
+		mappedData = nullptr;
+	}
+	buffer.Release();
+	fence.Release();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include "Support/WinInclude.h"
+#include "Support/ComPointer.h"
+#include "D3D/DXContext.h"
+#include "Memory/ReadbackRing.h"
+
+// Frames a value may stay in flight before its slot is reused
+#define STATS_READBACK_SLOTS 3
+#define MAX_STATS_MATERIALS 4
+
+// Simulation counters copied back from the GPU, a few frames old by the time they are read
+struct SimulationStats {
+	UINT particleCount = 0;
+	UINT freeListSize = 0;
+	// Non-empty bukkits that were simulated, the ones left out as asleep, and the ones partway through a multi-rate step
+	UINT activeBukkits = 0;
+	UINT sleepingBukkits = 0;
+	UINT waitingBukkits = 0;
+	UINT surfaceBlockCount[MAX_STATS_MATERIALS] = {};
+	UINT surfaceVertexCount[MAX_STATS_MATERIALS] = {};
+};
+
+// Persistently mapped readback buffer with one SimulationStats slot per frame in flight.
+// Scenes record small copies from their counter buffers into the current slot, and the newest
+// completed slot is picked up by polling a fence, so reading the stats never blocks.
+class StatsReadback {
+public:
+	StatsReadback() = default;
+	StatsReadback(DXContext* context);
+
+	// Polls for completed slots and opens a slot for this frame's copies
+	void beginFrame();
+
+	// Copies one 32 bit value at sourceOffset into the stat at statOffset (use offsetof on SimulationStats).
+	// The source is transitioned from sourceState to COPY_SOURCE and back around the copy
+	void copyValue(ID3D12GraphicsCommandList6* cmdList, ID3D12Resource* source, D3D12_RESOURCE_STATES sourceState, UINT64 sourceOffset, size_t statOffset);
+
+	// Call once every command list recording into this frame's slot has been submitted
+	void finishFrame();
+
+	const SimulationStats& getStats() const { return stats; }
+
+	void releaseResources();
+
+private:
+	DXContext* context = nullptr;
+
+	ComPointer<ID3D12Resource1> buffer;
+	UINT8* mappedData = nullptr;
+	UINT64 slotSize = 0;
+
+	ComPointer<ID3D12Fence> fence;
+	UINT64 fenceValue = 0;
+
+	ReadbackRing ring;
+	uint32_t currentSlot = ReadbackRing::InvalidSlot;
+
+	SimulationStats stats;
+};
@@ -6,9 +6,17 @@ StructuredBuffer::StructuredBuffer(const void* inputData, unsigned int numEle, U
 {
 }
 
-void StructuredBuffer::findFreeHandle(DescriptorHeap* dh, CD3DX12_CPU_DESCRIPTOR_HANDLE& cpuHandle, CD3DX12_GPU_DESCRIPTOR_HANDLE& gpuHandle) {
-	unsigned int index = dh->GetNextAvailableIndex();
-    cpuHandle = dh->GetCPUHandleAt(index);
+void StructuredBuffer::findFreeHandle(DescriptorHeap* dh, unsigned int& index, CD3DX12_CPU_DESCRIPTOR_HANDLE& cpuHandle, CD3DX12_GPU_DESCRIPTOR_HANDLE& gpuHandle) {
+	assignHandle(dh, dh->GetNextAvailableIndex(), index, cpuHandle, gpuHandle);
+}
+
+void StructuredBuffer::assignHandle(DescriptorHeap* dh, unsigned int heapIndex, unsigned int& index, CD3DX12_CPU_DESCRIPTOR_HANDLE& cpuHandle, CD3DX12_GPU_DESCRIPTOR_HANDLE& gpuHandle) {
+	if (descriptorHeap && descriptorHeap != dh) {
+		throw std::runtime_error("All views of a buffer must live in the same descriptor heap.");
+	}
+	descriptorHeap = dh;
+	index = heapIndex;
+	cpuHandle = dh->GetCPUHandleAt(index);
 	gpuHandle = dh->GetGPUHandleAt(index);
 }
 
@@ -56,7 +64,7 @@ void StructuredBuffer::passCBVDataToGPU(DXContext& context, DescriptorHeap* dh)
 		throw std::runtime_error("Cannot create CBV after creating UAV or SRV.");
 	}
 
-    findFreeHandle(dh, CBVcpuHandle, CBVgpuHandle);
+    findFreeHandle(dh, CBVIndex, CBVcpuHandle, CBVgpuHandle);
     isCBV = true;
 
     // Calculate the aligned buffer size (256-byte alignment required for CBV)
@@ -102,9 +110,7 @@ void StructuredBuffer::passCBVDataToGPU(DXContext& context, DescriptorHeap* dh)
     context.getDevice()->CreateConstantBufferView(&cbvDesc, CBVcpuHandle);
 }
 
-void StructuredBuffer::passDataToGPU(DXContext& context, ID3D12GraphicsCommandList6* cmdList, CommandListID cmdId) {
-	// THIS FUNCTION WILL RESET THE COMMAND LIST AT THE END OF THE CALL
-
+void StructuredBuffer::passDataToGPU(DXContext& context) {
 	if (isCBV) {
 		throw std::runtime_error("Cannot create UAV or SRV after creating CBV.");
 	}
@@ -113,99 +119,33 @@ void StructuredBuffer::passDataToGPU(DXContext& context, ID3D12GraphicsCommandLi
 	}
 
     // Calculate the total buffer size
-    UINT bufferSize = numElements * elementSize;
-
-    // Step 1: Create a default heap resource for the SRV (GPU-only)
-    D3D12_HEAP_PROPERTIES defaultHeapProps = {};
-    defaultHeapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-
-    D3D12_RESOURCE_DESC bufferDesc = {};
-    bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    bufferDesc.Width = bufferSize;
-    bufferDesc.Height = 1;
-    bufferDesc.DepthOrArraySize = 1;
-    bufferDesc.MipLevels = 1;
-    bufferDesc.SampleDesc.Count = 1;
-    bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    bufferDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;  // No unordered access flag
-
-    HRESULT hr = context.getDevice()->CreateCommittedResource(
-        &defaultHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(&buffer)
-    );
-    if (FAILED(hr)) {
-        throw std::runtime_error("Failed to create SRV buffer.");
-    }
-
-    // Step 2: Create an upload buffer to copy `data` to the GPU buffer
-    D3D12_HEAP_PROPERTIES uploadHeapProps = {};
-    uploadHeapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+    UINT64 bufferSize = (UINT64)numElements * elementSize;
 
-    D3D12_RESOURCE_DESC uploadDesc = bufferDesc;
-    uploadDesc.Flags = D3D12_RESOURCE_FLAG_NONE; // Upload buffer has no flags
-
-    ComPointer<ID3D12Resource> uploadBuffer;
-    hr = context.getDevice()->CreateCommittedResource(
-        &uploadHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &uploadDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&uploadBuffer)
-    );
-    if (FAILED(hr)) {
-        throw std::runtime_error("Failed to create SRV upload buffer.");
-    }
+    // Step 1: Place the GPU-only buffer in one of the shared default heaps
+    bufferAllocator = context.getBufferAllocator();
+    buffer = bufferAllocator->createBuffer(bufferSize, D3D12_RESOURCE_STATE_COPY_DEST, allocation);
 
-    // Step 3: Copy data into the upload buffer
-    void* mappedData = nullptr;
-    uploadBuffer->Map(0, nullptr, &mappedData);
-    memcpy(mappedData, data, bufferSize); // Assume `data` is correctly sized
-    uploadBuffer->Unmap(0, nullptr);
-
-    // Step 4: Copy data from the upload buffer to the GPU buffer
-    cmdList->CopyResource(buffer.Get(), uploadBuffer.Get());
-
-    // Step 5: Transition the buffer to the SHADER_RESOURCE state
-    D3D12_RESOURCE_BARRIER barrier = {};
-    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    barrier.Transition.pResource = buffer.Get();
-    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-    barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE;
-    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    cmdList->ResourceBarrier(1, &barrier);
-
-    // Create a fence to wait for the GPU to finish copying data
-    ComPointer<ID3D12Fence> fence;
-    UINT64 fenceValue = 1;
-    hr = context.getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Failed to create fence.");
-    }
-
-    context.executeCommandList(cmdId);
-    context.getCommandQueue()->Signal(fence.Get(), fenceValue);
+    // Step 2: Queue the initial contents. A null or all-zero `data` is cleared on the GPU instead of uploaded.
+    // The batch is submitted before the next command list executes and leaves the buffer readable by all shaders
+    context.getUploadBatcher()->queueBufferUpload(buffer.Get(), data, bufferSize, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+}
 
-    // Wait for the fence to reach the signaled value
-    if (fence->GetCompletedValue() < fenceValue) {
-        HANDLE eventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-        if (eventHandle == nullptr) {
-            throw std::runtime_error("Failed to create event handle.");
-        }
+void StructuredBuffer::requestTransient(DXContext& context, unsigned int firstPass, unsigned int lastPass) {
+	if (isCBV || isUAV || isSRV || buffer.Get()) {
+		throw std::runtime_error("Transient buffers must be requested before any resource is created.");
+	}
 
-        // Set the event to be triggered when the GPU reaches the fence value
-        fence->SetEventOnCompletion(fenceValue, eventHandle);
+	bufferAllocator = context.getBufferAllocator();
+	transientIndex = bufferAllocator->addTransientBuffer(numElements * elementSize, firstPass, lastPass);
+	isTransient = true;
+}
 
-        // Wait until the event is triggered, meaning the GPU has finished
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+void StructuredBuffer::acquireTransient() {
+	if (!isTransient) {
+		throw std::runtime_error("Buffer was not requested as transient.");
+	}
 
-    context.resetCommandList(cmdId);
+	buffer = bufferAllocator->getTransientBuffer(transientIndex);
 }
 
 void StructuredBuffer::createUAV(DXContext& context, DescriptorHeap* dh) {
@@ -217,8 +157,11 @@ void StructuredBuffer::createUAV(DXContext& context, DescriptorHeap* dh) {
 		throw std::runtime_error("UAV already created.");
 	}
 
-	findFreeHandle(dh, UAVcpuHandle, UAVgpuHandle);
+	findFreeHandle(dh, UAVIndex, UAVcpuHandle, UAVgpuHandle);
+	writeUAV(context);
+}
 
+void StructuredBuffer::writeUAV(DXContext& context) {
     // Create the UAV in the descriptor heap
     D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
     uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
@@ -240,8 +183,11 @@ void StructuredBuffer::createSRV(DXContext& context, DescriptorHeap* dh) {
 		throw std::runtime_error("SRV already created.");
 	}
 
-	findFreeHandle(dh, SRVcpuHandle, SRVgpuHandle);
+	findFreeHandle(dh, SRVIndex, SRVcpuHandle, SRVgpuHandle);
+	writeSRV(context);
+}
 
+void StructuredBuffer::writeSRV(DXContext& context) {
 	// Create the SRV in the descriptor heap
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
@@ -256,6 +202,41 @@ void StructuredBuffer::createSRV(DXContext& context, DescriptorHeap* dh) {
 	isSRV = true;
 }
 
+void StructuredBuffer::createUAVTable(DXContext& context, DescriptorHeap* dh, std::initializer_list<StructuredBuffer*> buffers) {
+	for (StructuredBuffer* buffer : buffers) {
+		if (buffer->isCBV) {
+			throw std::runtime_error("Cannot create UAV after creating CBV.");
+		}
+		else if (buffer->isUAV) {
+			throw std::runtime_error("UAV already created.");
+		}
+	}
+
+	// Each view still owns its own slot, freeing them one by one merges the range back together
+	unsigned int index = dh->AllocateRange((unsigned int)buffers.size());
+	for (StructuredBuffer* buffer : buffers) {
+		buffer->assignHandle(dh, index++, buffer->UAVIndex, buffer->UAVcpuHandle, buffer->UAVgpuHandle);
+		buffer->writeUAV(context);
+	}
+}
+
+void StructuredBuffer::createSRVTable(DXContext& context, DescriptorHeap* dh, std::initializer_list<StructuredBuffer*> buffers) {
+	for (StructuredBuffer* buffer : buffers) {
+		if (buffer->isCBV) {
+			throw std::runtime_error("Cannot create SRV after creating CBV.");
+		}
+		else if (buffer->isSRV) {
+			throw std::runtime_error("SRV already created.");
+		}
+	}
+
+	unsigned int index = dh->AllocateRange((unsigned int)buffers.size());
+	for (StructuredBuffer* buffer : buffers) {
+		buffer->assignHandle(dh, index++, buffer->SRVIndex, buffer->SRVcpuHandle, buffer->SRVgpuHandle);
+		buffer->writeSRV(context);
+	}
+}
+
 void StructuredBuffer::copyDataFromGPU(DXContext& context, void* outputData, ID3D12GraphicsCommandList6* cmdList, D3D12_RESOURCE_STATES state, CommandListID cmdId) {
 	// THIS FUNCTION WILL RESET THE COMMAND LIST AT THE END OF THE CALL
 
@@ -360,5 +341,20 @@ ComPointer<ID3D12Resource1>& StructuredBuffer::getBuffer()
 
 void StructuredBuffer::releaseResources()
 {
+	if (descriptorHeap) {
+		if (isCBV) descriptorHeap->FreeRange(CBVIndex, 1);
+		if (isUAV) descriptorHeap->FreeRange(UAVIndex, 1);
+		if (isSRV) descriptorHeap->FreeRange(SRVIndex, 1);
+		descriptorHeap = nullptr;
+	}
+	isCBV = isUAV = isSRV = false;
+
+	// Transient memory belongs to the allocator's aliased heap, only persistent placements are returned
+	if (bufferAllocator && allocation.isValid()) {
+		bufferAllocator->freeBuffer(allocation);
+		allocation = HeapAllocation();
+	}
+	isTransient = false;
+
 	this->buffer.Release();
 }
\ No newline at end of file
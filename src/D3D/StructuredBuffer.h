@@ -1,9 +1,12 @@
 #pragma once
 
 #include <vector>
+#include <initializer_list>
 #include "Support/WinInclude.h"
 #include "Support/ComPointer.h"
 #include "D3D/DXContext.h"
+#include "D3D/BufferAllocator.h"
+#include "D3D/UploadBatcher.h"
 #include "D3D/Pipeline/Pipeline.h"
 #include "DirectXMath.h"
 
@@ -41,14 +44,29 @@ public:
 	size_t getElementSize() { return elementSize; }
 
 	void passCBVDataToGPU(DXContext& context, DescriptorHeap* dh);
-	void passDataToGPU(DXContext& context, ID3D12GraphicsCommandList6* cmdList, CommandListID id);
+	// Batched with every other pending upload, `data` only has to stay valid for the duration of the call
+	void passDataToGPU(DXContext& context);
+	// Transient buffers share memory with other transient buffers whose pass ranges don't overlap.
+	// Request before BufferAllocator::createTransientBuffers, acquire afterwards, then create views as usual
+	void requestTransient(DXContext& context, unsigned int firstPass, unsigned int lastPass);
+	void acquireTransient();
+	bool getIsTransient() { return isTransient; }
+
 	void createUAV(DXContext& context, DescriptorHeap* dh);
 	void createSRV(DXContext& context, DescriptorHeap* dh);
 
+	// A descriptor table spanning several views reads them from adjacent slots, so create them as one range.
+	// The first buffer's handle is the one to bind
+	static void createUAVTable(DXContext& context, DescriptorHeap* dh, std::initializer_list<StructuredBuffer*> buffers);
+	static void createSRVTable(DXContext& context, DescriptorHeap* dh, std::initializer_list<StructuredBuffer*> buffers);
+
 	void releaseResources();
 
 private:
-	void findFreeHandle(DescriptorHeap* dh, CD3DX12_CPU_DESCRIPTOR_HANDLE& cpuHandle, CD3DX12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+	void findFreeHandle(DescriptorHeap* dh, unsigned int& index, CD3DX12_CPU_DESCRIPTOR_HANDLE& cpuHandle, CD3DX12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+	void assignHandle(DescriptorHeap* dh, unsigned int heapIndex, unsigned int& index, CD3DX12_CPU_DESCRIPTOR_HANDLE& cpuHandle, CD3DX12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+	void writeUAV(DXContext& context);
+	void writeSRV(DXContext& context);
 
 private:
 	ComPointer<ID3D12Resource1> buffer;
@@ -61,6 +79,18 @@ private:
 	CD3DX12_GPU_DESCRIPTOR_HANDLE SRVgpuHandle;
 	CD3DX12_GPU_DESCRIPTOR_HANDLE CBVgpuHandle;
 
+	// Heap the views were allocated from, so they can be returned in releaseResources
+	DescriptorHeap* descriptorHeap = nullptr;
+	unsigned int UAVIndex = 0;
+	unsigned int SRVIndex = 0;
+	unsigned int CBVIndex = 0;
+
+	// Where the buffer memory lives, persistent buffers own a heap range while transient ones are aliased
+	BufferAllocator* bufferAllocator = nullptr;
+	HeapAllocation allocation;
+	unsigned int transientIndex = 0;
+	bool isTransient = false;
+
 	bool isCBV = false;
 	bool isUAV = false;
 	bool isSRV = false;
@@ -0,0 +1,166 @@
+#include "UploadBatcher.h"
+#include "DescriptorHeap.h"
+
+#include <algorithm>
+
+UploadBatcher::UploadBatcher(DXContext* context)
+	: context(context), cmdList(context->createCommandList(CommandListID::UPLOAD_BATCH_ID)), queue(UPLOAD_STAGING_PAGE_SIZE)
+{
+}
+
+void UploadBatcher::queueBufferUpload(ID3D12Resource1* destination, const void* data, UINT64 size, D3D12_RESOURCE_STATES finalState) {
+	const UploadRequest& request = queue.queue((uint32_t)destinations.size(), data, size);
+	destinations.push_back(destination);
+	finalStates.push_back(finalState);
+
+	if (request.clear) {
+		return;
+	}
+
+	// Open staging pages as the queue asks for them, they stay mapped until the flush
+	while (stagingPages.size() < queue.getStagingPageCount()) {
+		D3D12_HEAP_PROPERTIES heapProps = {};
+		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+		D3D12_RESOURCE_DESC pageDesc = CD3DX12_RESOURCE_DESC::Buffer(queue.getStagingPageSize((uint32_t)stagingPages.size()));
+
+		ComPointer<ID3D12Resource> page;
+		HRESULT hr = context->getDevice()->CreateCommittedResource(
+			&heapProps,
+			D3D12_HEAP_FLAG_NONE,
+			&pageDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&page)
+		);
+		if (FAILED(hr)) {
+			throw std::runtime_error("Failed to create upload staging page.");
+		}
+
+		UINT8* mappedData = nullptr;
+		D3D12_RANGE readRange{ 0, 0 };
+		if (FAILED(page->Map(0, &readRange, reinterpret_cast<void**>(&mappedData)))) {
+			throw std::runtime_error("Failed to map upload staging page.");
+		}
+
+		stagingPages.push_back(page);
+		mappedPages.push_back(mappedData);
+	}
+
+	UINT8* stagingData = mappedPages[request.staging.page] + request.staging.offset;
+	if (data) {
+		memcpy(stagingData, data, size);
+	}
+	else {
+		memset(stagingData, 0, size);
+	}
+}
+
+void UploadBatcher::recordClears() {
+	const auto& requests = queue.getRequests();
+
+	// A single buffer view can't address more than 2^27 elements, so large buffers are cleared in slices
+	const UINT64 maxSliceElements = 1ull << D3D12_REQ_BUFFER_RESOURCE_TEXEL_COUNT_2_TO_EXP;
+	unsigned int sliceCount = 0;
+	for (const UploadRequest& request : requests) {
+		if (request.clear) {
+			sliceCount += (unsigned int)((request.size / 4 + maxSliceElements - 1) / maxSliceElements);
+		}
+	}
+
+	// ClearUnorderedAccessViewUint needs the view both in a CPU only heap and in the bound shader visible heap
+	DescriptorHeap cpuHeap(*context, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, sliceCount);
+	unsigned int cpuIndex = cpuHeap.AllocateRange(sliceCount);
+	DescriptorHeap* gpuHeap = context->getGlobalDescriptorHeap();
+	unsigned int gpuIndex = gpuHeap->AllocateTransient(sliceCount);
+
+	const UINT zeros[4] = { 0, 0, 0, 0 };
+
+	for (const UploadRequest& request : requests) {
+		if (!request.clear) {
+			continue;
+		}
+
+		ID3D12Resource1* destination = destinations[request.destination].Get();
+		UINT64 numElements = request.size / 4;
+
+		for (UINT64 firstElement = 0; firstElement < numElements; firstElement += maxSliceElements) {
+			D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+			uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+			uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+			uavDesc.Buffer.FirstElement = firstElement;
+			uavDesc.Buffer.NumElements = (UINT)std::min(maxSliceElements, numElements - firstElement);
+			uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+
+			context->getDevice()->CreateUnorderedAccessView(destination, nullptr, &uavDesc, cpuHeap.GetCPUHandleAt(cpuIndex));
+			context->getDevice()->CreateUnorderedAccessView(destination, nullptr, &uavDesc, gpuHeap->GetCPUHandleAt(gpuIndex));
+
+			cmdList->ClearUnorderedAccessViewUint(gpuHeap->GetGPUHandleAt(gpuIndex), cpuHeap.GetCPUHandleAt(cpuIndex), destination, zeros, 0, nullptr);
+
+			cpuIndex++;
+			gpuIndex++;
+		}
+	}
+
+	// The CPU handles are consumed while recording, so the heap can go away right away
+	cpuHeap.releaseResources();
+}
+
+void UploadBatcher::flush() {
+	if (queue.empty()) {
+		return;
+	}
+
+	context->resetCommandList(CommandListID::UPLOAD_BATCH_ID);
+
+	const auto& requests = queue.getRequests();
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+	// Clears are written through a UAV, copies stay in COPY_DEST
+	for (const UploadRequest& request : requests) {
+		if (request.clear) {
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(destinations[request.destination].Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		}
+	}
+	if (!barriers.empty()) {
+		cmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+		recordClears();
+	}
+
+	for (const UploadRequest& request : requests) {
+		if (!request.clear) {
+			cmdList->CopyBufferRegion(destinations[request.destination].Get(), 0,
+				stagingPages[request.staging.page].Get(), request.staging.offset, request.size);
+		}
+	}
+
+	barriers.clear();
+	for (const UploadRequest& request : requests) {
+		D3D12_RESOURCE_STATES currentState = request.clear ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_COPY_DEST;
+		if (currentState != finalStates[request.destination]) {
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(destinations[request.destination].Get(),
+				currentState, finalStates[request.destination]));
+		}
+	}
+	if (!barriers.empty()) {
+		cmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+	}
+
+	// Waits for the GPU, so the staging pages can be released straight after
+	context->executeCommandList(CommandListID::UPLOAD_BATCH_ID);
+
+	releaseResources();
+}
+
+void UploadBatcher::releaseResources() {
+	for (auto& page : stagingPages) {
+		page->Unmap(0, nullptr);
+		page.Release();
+	}
+	stagingPages.clear();
+	mappedPages.clear();
+
+	destinations.clear();
+	finalStates.clear();
+	queue.reset();
+}
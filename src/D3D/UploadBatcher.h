@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include "Support/WinInclude.h"
+#include "Support/ComPointer.h"
+#include "D3D/DXContext.h"
+#include "Memory/UploadQueue.h"
+
+// Size of each upload heap page used to stage initial buffer data
+#define UPLOAD_STAGING_PAGE_SIZE (64ull * 1024 * 1024)
+
+// Collects the initial contents of GPU buffers and submits them together.
+// Data is copied into mapped staging pages when queued, buffers that only hold zeros are cleared on
+// the device instead. DXContext flushes pending uploads before executing any other command list,
+// so queued buffers are always initialised before their first use.
+class UploadBatcher {
+public:
+	UploadBatcher(DXContext* context);
+
+	// destination must be in COPY_DEST, it ends up in finalState. A null data pointer means zero initialised
+	void queueBufferUpload(ID3D12Resource1* destination, const void* data, UINT64 size, D3D12_RESOURCE_STATES finalState);
+
+	bool hasPendingUploads() { return !queue.empty(); }
+
+	// Records every queued upload into one command list, submits it and waits for completion
+	void flush();
+
+	void releaseResources();
+
+private:
+	void recordClears();
+
+	DXContext* context;
+	ID3D12GraphicsCommandList6* cmdList;
+
+	UploadQueue queue;
+	std::vector<ComPointer<ID3D12Resource1>> destinations;
+	std::vector<D3D12_RESOURCE_STATES> finalStates;
+
+	std::vector<ComPointer<ID3D12Resource>> stagingPages;
+	std::vector<UINT8*> mappedPages;
+};
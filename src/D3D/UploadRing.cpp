@@ -0,0 +1,85 @@
+#include "UploadRing.h"
+
+UploadRing::UploadRing(DXContext* context, UINT64 size)
+	: context(context), allocator(size)
+{
+	D3D12_HEAP_PROPERTIES heapProps = {};
+	heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	HRESULT hr = context->getDevice()->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&buffer)
+	);
+	if (FAILED(hr)) {
+		throw std::runtime_error("Failed to create upload ring buffer.");
+	}
+
+	// Upload heaps can stay mapped for the lifetime of the resource
+	D3D12_RANGE readRange{ 0, 0 };
+	if (FAILED(buffer->Map(0, &readRange, reinterpret_cast<void**>(&mappedData)))) {
+		throw std::runtime_error("Failed to map upload ring buffer.");
+	}
+	baseAddress = buffer->GetGPUVirtualAddress();
+
+	if (FAILED(context->getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+		throw std::runtime_error("Failed to create upload ring fence.");
+	}
+}
+
+UploadAllocation UploadRing::allocate(UINT64 size, UINT64 alignment) {
+	allocator.releaseCompleted(fence->GetCompletedValue());
+
+	UINT64 offset = allocator.allocate(size, alignment);
+
+	// Out of space, wait for the oldest frame still in flight and try again
+	while (offset == LinearRingAllocator::InvalidOffset && allocator.hasFramesInFlight()) {
+		UINT64 oldestFenceValue = allocator.getOldestFenceValue();
+		if (fence->GetCompletedValue() < oldestFenceValue) {
+			HANDLE eventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+			if (eventHandle == nullptr) {
+				throw std::runtime_error("Failed to create event handle.");
+			}
+			fence->SetEventOnCompletion(oldestFenceValue, eventHandle);
+			WaitForSingleObject(eventHandle, INFINITE);
+			CloseHandle(eventHandle);
+		}
+		allocator.releaseCompleted(fence->GetCompletedValue());
+		offset = allocator.allocate(size, alignment);
+	}
+
+	if (offset == LinearRingAllocator::InvalidOffset) {
+		throw std::runtime_error("Upload ring is too small for the requested allocation.");
+	}
+
+	UploadAllocation allocation;
+	allocation.cpuAddress = mappedData + offset;
+	allocation.gpuAddress = baseAddress + offset;
+	allocation.offset = offset;
+	return allocation;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS UploadRing::push(const void* data, UINT64 size, UINT64 alignment) {
+	UploadAllocation allocation = allocate(size, alignment);
+	memcpy(allocation.cpuAddress, data, size);
+	return allocation.gpuAddress;
+}
+
+void UploadRing::finishFrame() {
+	context->getCommandQueue()->Signal(fence, ++fenceValue);
+	allocator.finishFrame(fenceValue);
+}
+
+void UploadRing::releaseResources() {
+	if (buffer.Get() && mappedData) {
+		buffer->Unmap(0, nullptr);
+		mappedData = nullptr;
+	}
+	buffer.Release();
+	fence.Release();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Support/WinInclude.h"
+#include "Support/ComPointer.h"
+#include "D3D/DXContext.h"
+#include "Memory/LinearRingAllocator.h"
+
+struct UploadAllocation {
+	void* cpuAddress = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+	UINT64 offset = 0;
+};
+
+// Persistently mapped upload heap buffer for data that only lives for a frame (root CBVs, shapes, etc.)
+// Memory is reclaimed once the GPU has passed the fence signalled in finishFrame
+class UploadRing {
+public:
+	UploadRing() = default;
+	UploadRing(DXContext* context, UINT64 size);
+
+	UploadAllocation allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	// Copies data into the ring and returns the address to bind as a root CBV/SRV
+	D3D12_GPU_VIRTUAL_ADDRESS push(const void* data, UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	template<typename T>
+	D3D12_GPU_VIRTUAL_ADDRESS push(const T& data) { return push(&data, sizeof(T)); }
+
+	// Call once all command lists using this frame's allocations have been submitted
+	void finishFrame();
+
+	ID3D12Resource1* getBuffer() { return buffer.Get(); }
+
+	void releaseResources();
+
+private:
+	DXContext* context = nullptr;
+
+	ComPointer<ID3D12Resource1> buffer;
+	UINT8* mappedData = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS baseAddress = 0;
+
+	ComPointer<ID3D12Fence> fence;
+	UINT64 fenceValue = 0;
+
+	LinearRingAllocator allocator;
+};
@@ -0,0 +1,76 @@
+#include "BufferPlacer.h"
+#include "LinearRingAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+uint32_t BufferPlacer::addBuffer(uint64_t size, uint64_t alignment, uint32_t firstPass, uint32_t lastPass) {
+	if (size == 0) {
+		throw std::runtime_error("Cannot place an empty buffer.");
+	}
+	if (firstPass > lastPass) {
+		throw std::runtime_error("Buffer lifetime ends before it starts.");
+	}
+
+	buffers.push_back({ size, alignment == 0 ? 1 : alignment, firstPass, lastPass, 0 });
+	return (uint32_t)buffers.size() - 1;
+}
+
+uint64_t BufferPlacer::place() {
+	// Largest first, ties broken by lifetime then insertion order so the result is deterministic
+	std::vector<uint32_t> order(buffers.size());
+	for (uint32_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		if (buffers[a].size != buffers[b].size) return buffers[a].size > buffers[b].size;
+		if (buffers[a].firstPass != buffers[b].firstPass) return buffers[a].firstPass < buffers[b].firstPass;
+		return a < b;
+	});
+
+	heapSize = 0;
+	std::vector<uint32_t> placed;
+	std::vector<std::pair<uint64_t, uint64_t>> occupied;
+
+	for (uint32_t index : order) {
+		Buffer& buffer = buffers[index];
+
+		// Memory ranges of placed buffers that are alive at the same time as this one
+		occupied.clear();
+		for (uint32_t other : placed) {
+			const Buffer& o = buffers[other];
+			if (lifetimesOverlap(buffer.firstPass, buffer.lastPass, o.firstPass, o.lastPass)) {
+				occupied.emplace_back(o.offset, o.offset + o.size);
+			}
+		}
+		std::sort(occupied.begin(), occupied.end());
+
+		// Lowest gap that fits
+		uint64_t offset = 0;
+		for (const auto& range : occupied) {
+			if (LinearRingAllocator::alignUp(offset, buffer.alignment) + buffer.size <= range.first) {
+				break;
+			}
+			offset = std::max(offset, range.second);
+		}
+		buffer.offset = LinearRingAllocator::alignUp(offset, buffer.alignment);
+
+		heapSize = std::max(heapSize, buffer.offset + buffer.size);
+		placed.push_back(index);
+	}
+
+	return heapSize;
+}
+
+uint64_t BufferPlacer::getUnaliasedSize() const {
+	uint64_t size = 0;
+	for (const Buffer& buffer : buffers) {
+		size = LinearRingAllocator::alignUp(size, buffer.alignment) + buffer.size;
+	}
+	return size;
+}
+
+void BufferPlacer::clear() {
+	buffers.clear();
+	heapSize = 0;
+}
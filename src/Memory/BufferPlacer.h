@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Platform independent placement of buffers inside a single heap.
+// Every buffer has an inclusive lifetime [firstPass, lastPass]; buffers whose lifetimes don't overlap
+// are allowed to share memory, so transient scratch from different passes ends up aliased.
+// Placement is greedy: largest buffers first, each at the lowest aligned offset that doesn't
+// collide with an already placed buffer that is alive at the same time.
+
+class BufferPlacer {
+public:
+	static constexpr uint32_t LastPass = ~0u;
+
+	// Returns the buffer index used with getOffset
+	uint32_t addBuffer(uint64_t size, uint64_t alignment, uint32_t firstPass, uint32_t lastPass);
+
+	// Places every buffer added so far and returns the required heap size
+	uint64_t place();
+
+	uint64_t getOffset(uint32_t index) const { return buffers[index].offset; }
+	uint64_t getHeapSize() const { return heapSize; }
+	// Heap size if nothing were aliased, useful to report how much aliasing saves
+	uint64_t getUnaliasedSize() const;
+	uint32_t getBufferCount() const { return (uint32_t)buffers.size(); }
+
+	void clear();
+
+	static bool lifetimesOverlap(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB) {
+		return firstA <= lastB && firstB <= lastA;
+	}
+
+private:
+	struct Buffer {
+		uint64_t size;
+		uint64_t alignment;
+		uint32_t firstPass;
+		uint32_t lastPass;
+		uint64_t offset;
+	};
+
+	std::vector<Buffer> buffers;
+	uint64_t heapSize = 0;
+};
@@ -0,0 +1,118 @@
+#include "DescriptorAllocator.h"
+
+#include <iterator>
+#include <stdexcept>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount)
+	: persistentCount(persistentCount), transientCount(transientCount)
+{
+	if (persistentCount > 0) {
+		insertFreeRange(0, persistentCount);
+	}
+	if (transientCount > 0) {
+		transientRing = LinearRingAllocator(transientCount);
+	}
+}
+
+uint32_t DescriptorAllocator::allocate(uint32_t count) {
+	if (count == 0) {
+		return InvalidIndex;
+	}
+
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		if (it->second < count) {
+			continue;
+		}
+
+		uint32_t index = it->first;
+		uint32_t remaining = it->second - count;
+		freeRanges.erase(it);
+		if (remaining > 0) {
+			freeRanges.emplace(index + count, remaining);
+		}
+
+		freePersistentCount -= count;
+		return index;
+	}
+
+	return InvalidIndex;
+}
+
+void DescriptorAllocator::free(uint32_t index, uint32_t count, uint64_t fenceValue) {
+	if (count == 0) {
+		return;
+	}
+	if (index >= persistentCount || count > persistentCount - index) {
+		throw std::runtime_error("Freed descriptor range is outside of the persistent section.");
+	}
+
+	pendingFrees.push_back({ index, count, fenceValue });
+}
+
+uint32_t DescriptorAllocator::allocateTransient(uint32_t count) {
+	if (transientCount == 0) {
+		return InvalidIndex;
+	}
+
+	uint64_t offset = transientRing.allocate(count, 1);
+	if (offset == LinearRingAllocator::InvalidOffset) {
+		return InvalidIndex;
+	}
+	return persistentCount + (uint32_t)offset;
+}
+
+void DescriptorAllocator::finishFrame(uint64_t fenceValue) {
+	if (transientCount > 0) {
+		transientRing.finishFrame(fenceValue);
+	}
+}
+
+void DescriptorAllocator::releaseCompleted(uint64_t completedFenceValue) {
+	// Frees are not necessarily queued in fence order, so walk the whole list
+	for (auto it = pendingFrees.begin(); it != pendingFrees.end();) {
+		if (it->fenceValue <= completedFenceValue) {
+			insertFreeRange(it->index, it->count);
+			it = pendingFrees.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	if (transientCount > 0) {
+		transientRing.releaseCompleted(completedFenceValue);
+	}
+}
+
+void DescriptorAllocator::insertFreeRange(uint32_t index, uint32_t count) {
+	auto next = freeRanges.lower_bound(index);
+
+	if (next != freeRanges.end() && next->first < index + count) {
+		throw std::runtime_error("Descriptor range freed twice.");
+	}
+	if (next != freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second > index) {
+			throw std::runtime_error("Descriptor range freed twice.");
+		}
+	}
+
+	freePersistentCount += count;
+
+	// Merge with the following range
+	if (next != freeRanges.end() && next->first == index + count) {
+		count += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	// Merge with the preceding range
+	if (next != freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == index) {
+			prev->second += count;
+			return;
+		}
+	}
+
+	freeRanges.emplace(index, count);
+}
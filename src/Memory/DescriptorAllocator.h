@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include "LinearRingAllocator.h"
+
+// Platform independent index allocator for a single descriptor heap.
+// The front of the heap holds persistent descriptors managed by a free list of ranges,
+// the back holds a ring of transient descriptors that only live for a frame.
+// Both persistent frees and transient frames are only recycled once their fence value has been reached.
+
+class DescriptorAllocator {
+public:
+	static constexpr uint32_t InvalidIndex = ~0u;
+
+	DescriptorAllocator() = default;
+	DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount);
+
+	// First-fit allocation of a contiguous range, returns InvalidIndex if no range is large enough
+	uint32_t allocate(uint32_t count = 1);
+
+	// The range becomes available again once completedFenceValue in releaseCompleted reaches fenceValue
+	void free(uint32_t index, uint32_t count, uint64_t fenceValue);
+
+	// Contiguous range in the transient section, returns InvalidIndex if the ring is full
+	uint32_t allocateTransient(uint32_t count);
+
+	void finishFrame(uint64_t fenceValue);
+	void releaseCompleted(uint64_t completedFenceValue);
+
+	uint32_t getPersistentCount() const { return persistentCount; }
+	uint32_t getTransientCount() const { return transientCount; }
+	uint32_t getFreePersistentCount() const { return freePersistentCount; }
+	uint64_t getOldestTransientFenceValue() const { return transientRing.getOldestFenceValue(); }
+
+private:
+	void insertFreeRange(uint32_t index, uint32_t count);
+
+	struct PendingFree {
+		uint32_t index;
+		uint32_t count;
+		uint64_t fenceValue;
+	};
+
+	uint32_t persistentCount = 0;
+	uint32_t transientCount = 0;
+	uint32_t freePersistentCount = 0;
+
+	// Start index -> range length, adjacent ranges are always merged
+	std::map<uint32_t, uint32_t> freeRanges;
+	std::deque<PendingFree> pendingFrees;
+
+	LinearRingAllocator transientRing;
+};
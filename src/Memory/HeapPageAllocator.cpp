@@ -0,0 +1,127 @@
+#include "HeapPageAllocator.h"
+#include "LinearRingAllocator.h"
+
+#include <iterator>
+#include <stdexcept>
+
+HeapPageAllocator::HeapPageAllocator(uint64_t pageSize)
+	: pageSize(pageSize)
+{
+	if (pageSize == 0) {
+		throw std::runtime_error("Heap page size must be greater than zero.");
+	}
+}
+
+HeapAllocation HeapPageAllocator::allocate(uint64_t size, uint64_t alignment) {
+	HeapAllocation allocation;
+	if (size == 0) {
+		return allocation;
+	}
+
+	for (uint32_t page = 0; page < pages.size(); page++) {
+		if (allocateFromPage(page, size, alignment, allocation)) {
+			return allocation;
+		}
+	}
+
+	// Nothing fits, open a new page. Oversized requests get a page that fits them exactly
+	uint64_t newPageSize = size > pageSize ? LinearRingAllocator::alignUp(size, alignment) : pageSize;
+	pages.push_back({ newPageSize, {} });
+	insertFreeRange((uint32_t)pages.size() - 1, 0, newPageSize);
+
+	if (!allocateFromPage((uint32_t)pages.size() - 1, size, alignment, allocation)) {
+		throw std::runtime_error("Failed to allocate from a fresh heap page.");
+	}
+	return allocation;
+}
+
+bool HeapPageAllocator::allocateFromPage(uint32_t page, uint64_t size, uint64_t alignment, HeapAllocation& allocation) {
+	auto& freeRanges = pages[page].freeRanges;
+
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		uint64_t start = it->first;
+		uint64_t end = it->first + it->second;
+		uint64_t offset = LinearRingAllocator::alignUp(start, alignment);
+		if (offset + size > end) {
+			continue;
+		}
+
+		freeRanges.erase(it);
+		if (offset > start) {
+			freeRanges.emplace(start, offset - start);
+		}
+		if (offset + size < end) {
+			freeRanges.emplace(offset + size, end - offset - size);
+		}
+
+		allocation.page = page;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocatedSize += size;
+		return true;
+	}
+
+	return false;
+}
+
+void HeapPageAllocator::free(const HeapAllocation& allocation, uint64_t fenceValue) {
+	if (!allocation.isValid()) {
+		return;
+	}
+	if (allocation.page >= pages.size() || allocation.offset + allocation.size > pages[allocation.page].size) {
+		throw std::runtime_error("Freed allocation does not belong to this allocator.");
+	}
+
+	pendingFrees.push_back({ allocation, fenceValue });
+}
+
+void HeapPageAllocator::releaseCompleted(uint64_t completedFenceValue) {
+	// Frees are not necessarily queued in fence order, so walk the whole list
+	for (auto it = pendingFrees.begin(); it != pendingFrees.end();) {
+		if (it->fenceValue <= completedFenceValue) {
+			insertFreeRange(it->allocation.page, it->allocation.offset, it->allocation.size);
+			allocatedSize -= it->allocation.size;
+			it = pendingFrees.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void HeapPageAllocator::insertFreeRange(uint32_t page, uint64_t offset, uint64_t size) {
+	auto& freeRanges = pages[page].freeRanges;
+	auto next = freeRanges.lower_bound(offset);
+
+	if (next != freeRanges.end() && next->first < offset + size) {
+		throw std::runtime_error("Heap range freed twice.");
+	}
+	if (next != freeRanges.begin() && std::prev(next)->first + std::prev(next)->second > offset) {
+		throw std::runtime_error("Heap range freed twice.");
+	}
+
+	// Merge with the following range
+	if (next != freeRanges.end() && next->first == offset + size) {
+		size += next->second;
+		next = freeRanges.erase(next);
+	}
+
+	// Merge with the preceding range
+	if (next != freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+
+	freeRanges.emplace(offset, size);
+}
+
+uint64_t HeapPageAllocator::getReservedSize() const {
+	uint64_t size = 0;
+	for (const Page& page : pages) {
+		size += page.size;
+	}
+	return size;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+struct HeapAllocation {
+	static constexpr uint32_t InvalidPage = ~0u;
+
+	uint32_t page = InvalidPage;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+
+	bool isValid() const { return page != InvalidPage; }
+};
+
+// Platform independent sub-allocator for persistent resources placed in large heaps ("pages").
+// Each page keeps a coalescing first-fit free list. Requests larger than the page size get a
+// dedicated page of their own. The caller creates the backing heap whenever a new page appears.
+// Frees are only recycled once their fence value has been reached, so new resources never alias
+// memory the GPU may still be using.
+
+class HeapPageAllocator {
+public:
+	HeapPageAllocator() = default;
+	explicit HeapPageAllocator(uint64_t pageSize);
+
+	HeapAllocation allocate(uint64_t size, uint64_t alignment);
+	// The range becomes available again once completedFenceValue in releaseCompleted reaches fenceValue
+	void free(const HeapAllocation& allocation, uint64_t fenceValue);
+	void releaseCompleted(uint64_t completedFenceValue);
+
+	uint32_t getPageCount() const { return (uint32_t)pages.size(); }
+	uint64_t getPageSize(uint32_t page) const { return pages[page].size; }
+	// Ranges waiting for their fence still count as allocated
+	uint64_t getAllocatedSize() const { return allocatedSize; }
+	uint64_t getReservedSize() const;
+
+private:
+	bool allocateFromPage(uint32_t page, uint64_t size, uint64_t alignment, HeapAllocation& allocation);
+	void insertFreeRange(uint32_t page, uint64_t offset, uint64_t size);
+
+	struct PendingFree {
+		HeapAllocation allocation;
+		uint64_t fenceValue;
+	};
+
+	struct Page {
+		uint64_t size;
+		// Offset -> range length, adjacent ranges are always merged
+		std::map<uint64_t, uint64_t> freeRanges;
+	};
+
+	uint64_t pageSize = 0;
+	uint64_t allocatedSize = 0;
+	std::vector<Page> pages;
+	std::deque<PendingFree> pendingFrees;
+};
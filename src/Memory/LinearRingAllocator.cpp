@@ -0,0 +1,71 @@
+#include "LinearRingAllocator.h"
+
+#include <stdexcept>
+
+LinearRingAllocator::LinearRingAllocator(uint64_t capacity)
+	: capacity(capacity)
+{
+	if (capacity == 0) {
+		throw std::runtime_error("Ring allocator capacity must be greater than zero.");
+	}
+}
+
+uint64_t LinearRingAllocator::alignUp(uint64_t value, uint64_t alignment) {
+	if (alignment <= 1) {
+		return value;
+	}
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+uint64_t LinearRingAllocator::allocate(uint64_t size, uint64_t alignment) {
+	if (size == 0 || size > capacity) {
+		return InvalidOffset;
+	}
+
+	uint64_t offset = alignUp(head, alignment);
+	uint64_t padding = offset - head;
+
+	// Allocations never straddle the end of the ring, the leftover tail is wasted until the frame retires
+	if (offset + size > capacity) {
+		padding = capacity - head;
+		offset = 0;
+	}
+
+	if (usedSize + padding + size > capacity) {
+		return InvalidOffset;
+	}
+
+	head = offset + size;
+	if (head == capacity) {
+		head = 0;
+	}
+
+	usedSize += padding + size;
+	currentFrameSize += padding + size;
+	return offset;
+}
+
+void LinearRingAllocator::finishFrame(uint64_t fenceValue) {
+	if (currentFrameSize == 0) {
+		return;
+	}
+
+	framesInFlight.push_back({ fenceValue, currentFrameSize });
+	currentFrameSize = 0;
+}
+
+void LinearRingAllocator::releaseCompleted(uint64_t completedFenceValue) {
+	while (!framesInFlight.empty() && framesInFlight.front().fenceValue <= completedFenceValue) {
+		usedSize -= framesInFlight.front().size;
+		framesInFlight.pop_front();
+	}
+
+	// Once everything has retired we can restart at the beginning and avoid wasting the tail
+	if (usedSize == 0) {
+		head = 0;
+	}
+}
+
+uint64_t LinearRingAllocator::getOldestFenceValue() const {
+	return framesInFlight.empty() ? 0 : framesInFlight.front().fenceValue;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Platform independent bookkeeping for a ring of transient memory.
+// Allocations are handed out linearly and retired in bulk once the fence value
+// their frame was tagged with has been reached, so nothing is freed individually.
+
+class LinearRingAllocator {
+public:
+	static constexpr uint64_t InvalidOffset = ~0ull;
+
+	LinearRingAllocator() = default;
+	explicit LinearRingAllocator(uint64_t capacity);
+
+	// Returns the offset of the allocation in the ring, or InvalidOffset if there is not enough free space
+	uint64_t allocate(uint64_t size, uint64_t alignment = 256);
+
+	// Tags everything allocated since the previous call with the given fence value
+	void finishFrame(uint64_t fenceValue);
+
+	// Releases every frame whose fence value is less than or equal to completedFenceValue
+	void releaseCompleted(uint64_t completedFenceValue);
+
+	// Fence value of the oldest frame still holding memory, or 0 if nothing is in flight
+	uint64_t getOldestFenceValue() const;
+
+	uint64_t getCapacity() const { return capacity; }
+	uint64_t getUsedSize() const { return usedSize; }
+	uint64_t getFrameSize() const { return currentFrameSize; }
+	bool hasFramesInFlight() const { return !framesInFlight.empty(); }
+
+	static uint64_t alignUp(uint64_t value, uint64_t alignment);
+
+private:
+	struct FrameMarker {
+		uint64_t fenceValue;
+		uint64_t size;
+	};
+
+	uint64_t capacity = 0;
+	uint64_t head = 0;
+	uint64_t usedSize = 0;
+	uint64_t currentFrameSize = 0;
+
+	std::deque<FrameMarker> framesInFlight;
+};
@@ -0,0 +1,45 @@
+#include "ReadbackRing.h"
+
+#include <stdexcept>
+
+ReadbackRing::ReadbackRing(uint32_t slotCount)
+	: slotBusy(slotCount, false)
+{
+	if (slotCount == 0) {
+		throw std::runtime_error("Readback ring needs at least one slot.");
+	}
+}
+
+uint32_t ReadbackRing::beginFrame() {
+	// Slots complete in submission order, so the next one round robin is the oldest
+	uint32_t slot = nextSlot;
+	if (slotBusy.empty() || slotBusy[slot]) {
+		skippedFrames++;
+		return InvalidSlot;
+	}
+
+	slotBusy[slot] = true;
+	nextSlot = (nextSlot + 1) % (uint32_t)slotBusy.size();
+	return slot;
+}
+
+void ReadbackRing::submit(uint32_t slot, uint64_t fenceValue) {
+	if (slot >= slotBusy.size() || !slotBusy[slot]) {
+		throw std::runtime_error("Readback slot submitted without beginFrame.");
+	}
+	if (!inFlight.empty() && fenceValue < inFlight.back().fenceValue) {
+		throw std::runtime_error("Readback fence values must increase.");
+	}
+
+	inFlight.push_back({ slot, fenceValue });
+}
+
+uint32_t ReadbackRing::poll(uint64_t completedFenceValue) {
+	uint32_t newest = InvalidSlot;
+	while (!inFlight.empty() && inFlight.front().fenceValue <= completedFenceValue) {
+		newest = inFlight.front().slot;
+		slotBusy[newest] = false;
+		inFlight.pop_front();
+	}
+	return newest;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Platform independent bookkeeping for a ring of readback slots.
+// Each frame copies its values into a free slot and tags it with a fence value. Slots are polled
+// against the completed fence value, so results show up a few frames late but the CPU never waits.
+// When every slot is still in flight the frame is simply not recorded.
+
+class ReadbackRing {
+public:
+	static constexpr uint32_t InvalidSlot = ~0u;
+
+	ReadbackRing() = default;
+	explicit ReadbackRing(uint32_t slotCount);
+
+	// Slot to record this frame's copies into, or InvalidSlot if none is free
+	uint32_t beginFrame();
+
+	// Tags the slot returned by beginFrame with the fence value signalled after its copies
+	void submit(uint32_t slot, uint64_t fenceValue);
+
+	// Returns the newest slot whose fence value has been reached, or InvalidSlot if nothing new completed.
+	// Every completed slot is released, the returned one must be read before the next beginFrame
+	uint32_t poll(uint64_t completedFenceValue);
+
+	uint32_t getSlotCount() const { return (uint32_t)slotBusy.size(); }
+	uint32_t getInFlightCount() const { return (uint32_t)inFlight.size(); }
+	uint32_t getSkippedFrameCount() const { return skippedFrames; }
+
+private:
+	struct PendingSlot {
+		uint32_t slot;
+		uint64_t fenceValue;
+	};
+
+	std::vector<bool> slotBusy;
+	std::deque<PendingSlot> inFlight;
+	uint32_t nextSlot = 0;
+	uint32_t skippedFrames = 0;
+};
@@ -0,0 +1,50 @@
+#include "UploadQueue.h"
+
+#include <cstring>
+
+UploadQueue::UploadQueue(uint64_t stagingPageSize)
+	: stagingPageSize(stagingPageSize), staging(stagingPageSize)
+{
+}
+
+const UploadRequest& UploadQueue::queue(uint32_t destination, const void* data, uint64_t size, uint64_t clearGranularity) {
+	UploadRequest request = { destination, size, false, {} };
+
+	bool clearable = clearGranularity == 0 || size % clearGranularity == 0;
+	if (clearable && (data == nullptr || isZero(data, size))) {
+		request.clear = true;
+		clearCount++;
+	}
+	else {
+		request.staging = staging.allocate(size, StagingAlignment);
+	}
+
+	requests.push_back(request);
+	return requests.back();
+}
+
+void UploadQueue::reset() {
+	requests.clear();
+	clearCount = 0;
+	staging = HeapPageAllocator(stagingPageSize);
+}
+
+bool UploadQueue::isZero(const void* data, uint64_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	// Compare in words where possible, the leftover bytes are checked one at a time
+	uint64_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(uint64_t));
+		if (word != 0) {
+			return false;
+		}
+	}
+	for (; i < size; i++) {
+		if (bytes[i] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "HeapPageAllocator.h"
+
+// One pending initialisation of a GPU buffer
+struct UploadRequest {
+	// Backend handle of the destination buffer
+	uint32_t destination;
+	uint64_t size;
+	// Zero fill on the device, no staging memory is used
+	bool clear;
+	HeapAllocation staging;
+};
+
+// Platform independent bookkeeping for batched buffer initialisation.
+// Requests whose data is missing or entirely zero become device clears, everything else is packed
+// into a staging arena made of large pages. The backend owns the page memory, copies the data into it
+// at the returned offset and later records all requests into a single submission.
+
+class UploadQueue {
+public:
+	static constexpr uint64_t StagingAlignment = 16;
+
+	UploadQueue() = default;
+	explicit UploadQueue(uint64_t stagingPageSize);
+
+	// Clears are only used when size is a multiple of clearGranularity, since devices clear whole words
+	const UploadRequest& queue(uint32_t destination, const void* data, uint64_t size, uint64_t clearGranularity = 4);
+
+	const std::vector<UploadRequest>& getRequests() const { return requests; }
+	bool empty() const { return requests.empty(); }
+
+	uint32_t getStagingPageCount() const { return staging.getPageCount(); }
+	uint64_t getStagingPageSize(uint32_t page) const { return staging.getPageSize(page); }
+	uint64_t getStagingSize() const { return staging.getAllocatedSize(); }
+	uint32_t getClearCount() const { return clearCount; }
+
+	// Forget every request and the staging layout, call once the submission has completed
+	void reset();
+
+	static bool isZero(const void* data, uint64_t size);
+
+private:
+	uint64_t stagingPageSize = 0;
+	HeapPageAllocator staging;
+	std::vector<UploadRequest> requests;
+	uint32_t clearCount = 0;
+};
@@ -0,0 +1,134 @@
+#include "MaterialBins.h"
+#include "SceneConstants.h"
+
+MaterialBins::MaterialBins(DXContext* context, ComputePipeline* materialBinCountCP, ComputePipeline* materialBinScatterCP, ComputePipeline* bufferClearCP)
+    : context(context),
+      materialBinCountCP(materialBinCountCP),
+      materialBinScatterCP(materialBinScatterCP),
+      bufferClearCP(bufferClearCP)
+{
+    XMUINT3 emptyDispatch[MAX_SURFACE_MATERIALS];
+    for (int i = 0; i < MAX_SURFACE_MATERIALS; i++) {
+        emptyDispatch[i] = { 0, 1, 1 };
+    }
+
+    binCountsBuffer = StructuredBuffer(nullptr, 2 * MAX_SURFACE_MATERIALS, sizeof(int));
+    binCountsBuffer.passDataToGPU(*context);
+    binCountsBuffer.createUAV(*context, materialBinCountCP->getDescriptorHeap());
+
+    particleIndicesBuffer = StructuredBuffer(nullptr, maxParticles, sizeof(int));
+    particleIndicesBuffer.passDataToGPU(*context);
+    particleIndicesBuffer.createUAV(*context, materialBinCountCP->getDescriptorHeap());
+
+    dispatchBuffer = StructuredBuffer(emptyDispatch, MAX_SURFACE_MATERIALS, sizeof(XMUINT3));
+    dispatchBuffer.passDataToGPU(*context);
+    dispatchBuffer.createUAV(*context, materialBinCountCP->getDescriptorHeap());
+
+    D3D12_INDIRECT_ARGUMENT_DESC argumentDesc = {};
+    argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+
+    D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {};
+    commandSignatureDesc.ByteStride = sizeof(XMUINT3);
+    commandSignatureDesc.NumArgumentDescs = 1;
+    commandSignatureDesc.pArgumentDescs = &argumentDesc;
+
+    context->getDevice()->CreateCommandSignature(&commandSignatureDesc, nullptr, IID_PPV_ARGS(&commandSignature));
+    context->getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
+
+    // passDataToGPU leaves the buffers readable by all shaders, start them out in the states compute() expects
+    auto cmdList = materialBinCountCP->getCommandList();
+    D3D12_RESOURCE_BARRIER barriers[3] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(binCountsBuffer.getBuffer(), D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(particleIndicesBuffer.getBuffer(), D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(dispatchBuffer.getBuffer(), D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT)
+    };
+    cmdList->ResourceBarrier(3, barriers);
+
+    context->executeCommandList(materialBinCountCP->getCommandListID());
+    context->signalAndWaitForFence(fence, fenceValue);
+    context->resetCommandList(materialBinCountCP->getCommandListID());
+}
+
+void MaterialBins::compute(StructuredBuffer* positionsBuffer, StructuredBuffer* particleCountBuffer, StructuredBuffer* particleDispatchBuffer) {
+    // Clear the counts and cursors
+    constexpr UINT THREAD_GROUP_SIZE = 256;
+    int numCounters = 2 * MAX_SURFACE_MATERIALS;
+
+    auto cmdList = bufferClearCP->getCommandList();
+    transitionBuffers(cmdList, true);
+
+    cmdList->SetPipelineState(bufferClearCP->getPSO());
+    cmdList->SetComputeRootSignature(bufferClearCP->getRootSignature());
+    cmdList->SetComputeRoot32BitConstants(0, 1, &numCounters, 0);
+    cmdList->SetComputeRootDescriptorTable(1, binCountsBuffer.getUAVGPUDescriptorHandle());
+    cmdList->Dispatch((numCounters + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
+
+    context->executeCommandList(bufferClearCP->getCommandListID());
+    context->signalAndWaitForFence(fence, fenceValue);
+    context->resetCommandList(bufferClearCP->getCommandListID());
+
+    // The simulation leaves its count and dispatch arguments as UAVs
+    D3D12_RESOURCE_BARRIER particleBarriers[2] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(particleCountBuffer->getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(particleDispatchBuffer->getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT)
+    };
+    D3D12_RESOURCE_BARRIER particleBarriersEnd[2] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(particleCountBuffer->getBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        CD3DX12_RESOURCE_BARRIER::Transition(particleDispatchBuffer->getBuffer(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+    };
+
+    // Count particles per material
+    cmdList = materialBinCountCP->getCommandList();
+    cmdList->SetPipelineState(materialBinCountCP->getPSO());
+    cmdList->SetComputeRootSignature(materialBinCountCP->getRootSignature());
+    cmdList->SetComputeRootDescriptorTable(0, positionsBuffer->getSRVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(1, binCountsBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRootShaderResourceView(2, particleCountBuffer->getGPUVirtualAddress());
+
+    cmdList->ResourceBarrier(2, particleBarriers);
+    cmdList->ExecuteIndirect(commandSignature, 1, particleDispatchBuffer->getBuffer(), 0, nullptr, 0);
+    cmdList->ResourceBarrier(2, particleBarriersEnd);
+
+    context->executeCommandList(materialBinCountCP->getCommandListID());
+    context->signalAndWaitForFence(fence, fenceValue);
+    context->resetCommandList(materialBinCountCP->getCommandListID());
+
+    // Place every particle in its material's bin and size each bin's dispatch
+    cmdList = materialBinScatterCP->getCommandList();
+    cmdList->SetPipelineState(materialBinScatterCP->getPSO());
+    cmdList->SetComputeRootSignature(materialBinScatterCP->getRootSignature());
+    cmdList->SetComputeRootDescriptorTable(0, positionsBuffer->getSRVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(1, binCountsBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(2, particleIndicesBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(3, dispatchBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRootShaderResourceView(4, particleCountBuffer->getGPUVirtualAddress());
+
+    cmdList->ResourceBarrier(2, particleBarriers);
+    cmdList->ExecuteIndirect(commandSignature, 1, particleDispatchBuffer->getBuffer(), 0, nullptr, 0);
+    cmdList->ResourceBarrier(2, particleBarriersEnd);
+
+    transitionBuffers(cmdList, false);
+
+    context->executeCommandList(materialBinScatterCP->getCommandListID());
+    context->signalAndWaitForFence(fence, fenceValue);
+    context->resetCommandList(materialBinScatterCP->getCommandListID());
+}
+
+void MaterialBins::transitionBuffers(ID3D12GraphicsCommandList6* cmdList, bool toUAV) {
+    D3D12_RESOURCE_STATES uav = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    D3D12_RESOURCE_STATES srv = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    D3D12_RESOURCE_STATES indirect = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+
+    D3D12_RESOURCE_BARRIER barriers[3] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(binCountsBuffer.getBuffer(), toUAV ? srv : uav, toUAV ? uav : srv),
+        CD3DX12_RESOURCE_BARRIER::Transition(particleIndicesBuffer.getBuffer(), toUAV ? srv : uav, toUAV ? uav : srv),
+        CD3DX12_RESOURCE_BARRIER::Transition(dispatchBuffer.getBuffer(), toUAV ? indirect : uav, toUAV ? uav : indirect)
+    };
+    cmdList->ResourceBarrier(3, barriers);
+}
+
+void MaterialBins::releaseResources() {
+    binCountsBuffer.releaseResources();
+    particleIndicesBuffer.releaseResources();
+    dispatchBuffer.releaseResources();
+}
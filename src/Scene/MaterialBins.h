@@ -0,0 +1,39 @@
+#pragma once
+#include "../D3D/Pipeline/ComputePipeline.h"
+#include "../D3D/StructuredBuffer.h"
+#include "../Shaders/constants.h"
+
+// Sorts the live particles by material once per frame, so every material's surface passes read only their own particles
+// instead of each scanning the whole particle buffer. Bins are laid out in material order in one index buffer.
+// Between compute() calls the counts and indices are SRVs and the dispatch arguments are indirect arguments.
+class MaterialBins {
+public:
+    MaterialBins() = delete;
+    MaterialBins(DXContext* context, ComputePipeline* materialBinCountCP, ComputePipeline* materialBinScatterCP, ComputePipeline* bufferClearCP);
+
+    void compute(StructuredBuffer* positionsBuffer, StructuredBuffer* particleCountBuffer, StructuredBuffer* particleDispatchBuffer);
+    void releaseResources();
+
+    // Particles per material, followed by the fill cursors used while binning
+    StructuredBuffer* getBinCountsBuffer() { return &binCountsBuffer; }
+    StructuredBuffer* getParticleIndicesBuffer() { return &particleIndicesBuffer; }
+    // One dispatch per material covering its bin with BILEVEL_UNIFORM_GRID_THREADS_X threads per group
+    StructuredBuffer* getDispatchBuffer() { return &dispatchBuffer; }
+    UINT64 getDispatchOffset(int material) const { return material * sizeof(XMUINT3); }
+
+private:
+    void transitionBuffers(ID3D12GraphicsCommandList6* cmdList, bool toUAV);
+
+    DXContext* context;
+    ComputePipeline* materialBinCountCP;
+    ComputePipeline* materialBinScatterCP;
+    ComputePipeline* bufferClearCP;
+
+    UINT64 fenceValue = 1;
+    ComPointer<ID3D12Fence> fence;
+    ID3D12CommandSignature* commandSignature = nullptr;
+
+    StructuredBuffer binCountsBuffer;
+    StructuredBuffer particleIndicesBuffer;
+    StructuredBuffer dispatchBuffer;
+};
@@ -4,26 +4,26 @@
 MeshShadingScene::MeshShadingScene(DXContext* context, 
                        RenderPipeline* pipeline, 
                        ComputePipeline* bilevelUniformGridCP, 
+                       ComputePipeline* cellParticleOffsetsCP,
+                       ComputePipeline* cellParticleScatterCP,
                        ComputePipeline* surfaceBlockDetectionCP,
                        ComputePipeline* surfaceCellDetectionCP,
                        ComputePipeline* surfaceVertexCompactionCP,
                        ComputePipeline* surfaceVertexDensityCP,
-                       ComputePipeline* surfaceVertexNormalCP,
                        ComputePipeline* bufferClearCP,
-                       ComputePipeline* dispatchArgDivideCP,
                        MeshPipeline* fluidMeshPipeline,
                        int materialIndex,
 	                   float isovalue, float kernelScale, float kernelRadius
     )
     : Drawable(context, pipeline), 
       bilevelUniformGridCP(bilevelUniformGridCP), 
+      cellParticleOffsetsCP(cellParticleOffsetsCP),
+      cellParticleScatterCP(cellParticleScatterCP),
       surfaceBlockDetectionCP(surfaceBlockDetectionCP),
       surfaceCellDetectionCP(surfaceCellDetectionCP),
       surfaceVertexCompactionCP(surfaceVertexCompactionCP),
       surfaceVertexDensityCP(surfaceVertexDensityCP),
-      surfaceVertexNormalCP(surfaceVertexNormalCP),
       bufferClearCP(bufferClearCP),
-      dispatchArgDivideCP(dispatchArgDivideCP),
       fluidMeshPipeline(fluidMeshPipeline),
 	  material(materialIndex),
 	  isovalue(isovalue),
@@ -47,10 +47,6 @@ void MeshShadingScene::draw(Camera* camera, unsigned int renderMeshlets, unsigne
     cmdList->SetPipelineState(fluidMeshPipeline->getPSO());
     cmdList->SetGraphicsRootSignature(fluidMeshPipeline->getRootSignature());
 
-    // Set descriptor heap
-    ID3D12DescriptorHeap* descriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
     // Transition surfaceHalfBlockDispatch to an SRV
     D3D12_RESOURCE_BARRIER surfaceHalfBlockDispatchBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
         surfaceHalfBlockDispatch.getBuffer(),
@@ -96,7 +92,14 @@ void MeshShadingScene::draw(Camera* camera, unsigned int renderMeshlets, unsigne
     // Draws
     cmdList->ExecuteIndirect(meshCommandSignature, 1, surfaceHalfBlockDispatch.getBuffer(), 0, nullptr, 0);
 
-    // TODO Temporary: just so these two buffers can be transitioned along with everything else
+    // TODO Temporary: just so these buffers can be transitioned along with everything else
+    // surfaceBlockDispatch was left as an indirect argument by surface cell detection
+    D3D12_RESOURCE_BARRIER surfaceBlockDispatchBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
+        surfaceBlockDispatch.getBuffer(),
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE|D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
+    );
+
     D3D12_RESOURCE_BARRIER surfaceHalfBlockDispatchBarrier3 = CD3DX12_RESOURCE_BARRIER::Transition(
         surfaceHalfBlockDispatch.getBuffer(),
         D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
@@ -109,8 +112,8 @@ void MeshShadingScene::draw(Camera* camera, unsigned int renderMeshlets, unsigne
         D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE|D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
     );
 
-    D3D12_RESOURCE_BARRIER barriers2[2] = { surfaceHalfBlockDispatchBarrier3, surfaceVertDensityDispatchBarrier2 };
-    cmdList->ResourceBarrier(2, barriers2);
+    D3D12_RESOURCE_BARRIER barriers2[3] = { surfaceBlockDispatchBarrier, surfaceHalfBlockDispatchBarrier3, surfaceVertDensityDispatchBarrier2 };
+    cmdList->ResourceBarrier(3, barriers2);
     // End temporary
 
     transitionBuffers(cmdList, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE|D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -143,75 +146,83 @@ void MeshShadingScene::constructScene() {
     int numBlocks = numCells / (CELLS_PER_BLOCK_EDGE * CELLS_PER_BLOCK_EDGE * CELLS_PER_BLOCK_EDGE);
     int numVerts = (gridConstants.gridDim.x + 1) * (gridConstants.gridDim.y + 1) * (gridConstants.gridDim.z + 1);
     
-    std::vector<int> cellParticleCounts(numCells, 0);
-    std::vector<int> cellParticleIndices(numCells * MAX_PARTICLES_PER_CELL, -1);
-    std::vector<Block> blocks(numBlocks);
-    std::vector<int> surfaceBlockIndices(numBlocks, 0);
     XMUINT3 dipatchCPU = { 0, 1, 1 };
-    std::vector<int> surfaceVertices(numVerts, 0);
-    std::vector<int> surfaceVertexIndices(numVerts, 0);
-    std::vector<float> surfaceVertexDensities(numVerts, 0.f);
-    std::vector<XMFLOAT3> surfaceVertexNormals(numVerts, { 0.f, 0.f, 0.f });
-    std::vector<XMFLOAT4> surfaceVertexColors(numVerts, { 0.f, 0.f, 0.f, 0.f });
+
+    // Scratch that is rebuilt from scratch every compute() and never read by the draw.
+    // All of it is alive only during this scene's compute pass, so it aliases the scratch of the other materials
+    transientPass = context->getBufferAllocator()->beginTransientPass();
+
+    blocksBuffer = StructuredBuffer(nullptr, numBlocks, sizeof(Block));
+    blocksBuffer.requestTransient(*context, transientPass, transientPass);
+
+    cellParticleCountBuffer = StructuredBuffer(nullptr, numCells, sizeof(int));
+    cellParticleCountBuffer.requestTransient(*context, transientPass, transientPass);
+
+    // One extra element past the last cell for the allocation cursor of CellParticleOffsets
+    cellParticleOffsetsBuffer = StructuredBuffer(nullptr, numCells + 1, sizeof(int));
+    cellParticleOffsetsBuffer.requestTransient(*context, transientPass, transientPass);
+
+    // Cell lists are packed, so they can't hold more than every particle once
+    cellParticleIndicesBuffer = StructuredBuffer(nullptr, maxParticles, sizeof(int));
+    cellParticleIndicesBuffer.requestTransient(*context, transientPass, transientPass);
+
+    surfaceVerticesBuffer = StructuredBuffer(nullptr, numVerts, sizeof(unsigned int));
+    surfaceVerticesBuffer.requestTransient(*context, transientPass, transientPass);
+
+    // Partition counter and one state per thread group for each prefix scan, see ParallelScan.hlsl
+    int numCellPartitions = (numCells + CELL_PARTICLE_OFFSETS_THREADS_X - 1) / CELL_PARTICLE_OFFSETS_THREADS_X;
+    cellOffsetsScanState = StructuredBuffer(nullptr, numCellPartitions + 1, sizeof(unsigned int));
+    cellOffsetsScanState.requestTransient(*context, transientPass, transientPass);
+
+    int numBlockPartitions = (numBlocks + SURFACE_BLOCK_DETECTION_THREADS_X - 1) / SURFACE_BLOCK_DETECTION_THREADS_X;
+    surfaceBlockScanState = StructuredBuffer(nullptr, numBlockPartitions + 1, sizeof(unsigned int));
+    surfaceBlockScanState.requestTransient(*context, transientPass, transientPass);
+
+    int numVertPartitions = (numVerts + SURFACE_VERTEX_COMPACTION_THREADS_X - 1) / SURFACE_VERTEX_COMPACTION_THREADS_X;
+    surfaceVertexScanState = StructuredBuffer(nullptr, numVertPartitions + 1, sizeof(unsigned int));
+    surfaceVertexScanState.requestTransient(*context, transientPass, transientPass);
 
     // Use the descriptor heap for the bilevelUniformGridCP for pretty much everything. Simplifies sharing resources
-    blocksBuffer = StructuredBuffer(blocks.data(), numBlocks, sizeof(Block));
-    blocksBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
-    blocksBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
-    blocksBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
-
-    cellParticleCountBuffer = StructuredBuffer(cellParticleCounts.data(), numCells, sizeof(int));
-    cellParticleCountBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
-    cellParticleCountBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
-    cellParticleCountBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
-
-    cellParticleIndicesBuffer = StructuredBuffer(cellParticleIndices.data(), MAX_PARTICLES_PER_CELL * numCells, sizeof(int));
-    cellParticleIndicesBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
-    cellParticleIndicesBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
-    cellParticleIndicesBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
-
-    surfaceBlockIndicesBuffer = StructuredBuffer(surfaceBlockIndices.data(), numBlocks, sizeof(unsigned int));
-    surfaceBlockIndicesBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+    // Buffers without data start zeroed, that is done on the GPU as part of the batched upload
+    surfaceBlockIndicesBuffer = StructuredBuffer(nullptr, numBlocks, sizeof(unsigned int));
+    surfaceBlockIndicesBuffer.passDataToGPU(*context);
     surfaceBlockIndicesBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
     surfaceBlockIndicesBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
     surfaceBlockDispatch = StructuredBuffer(&dipatchCPU, 1, sizeof(XMUINT3));
-    surfaceBlockDispatch.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+    surfaceBlockDispatch.passDataToGPU(*context);
     surfaceBlockDispatch.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
     surfaceBlockDispatch.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
     surfaceHalfBlockDispatch = StructuredBuffer(&dipatchCPU, 1, sizeof(XMUINT3));
-    surfaceHalfBlockDispatch.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+    surfaceHalfBlockDispatch.passDataToGPU(*context);
     surfaceHalfBlockDispatch.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
     surfaceHalfBlockDispatch.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
-    surfaceVerticesBuffer = StructuredBuffer(surfaceVertices.data(), numVerts, sizeof(unsigned int));
-    surfaceVerticesBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
-    surfaceVerticesBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
-    surfaceVerticesBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
-
-    surfaceVertexIndicesBuffer = StructuredBuffer(surfaceVertexIndices.data(), numVerts, sizeof(unsigned int));
-    surfaceVertexIndicesBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+    surfaceVertexIndicesBuffer = StructuredBuffer(nullptr, numVerts, sizeof(unsigned int));
+    surfaceVertexIndicesBuffer.passDataToGPU(*context);
     surfaceVertexIndicesBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
     surfaceVertexIndicesBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
-    surfaceVertDensityDispatch = StructuredBuffer(&dipatchCPU, 1, sizeof(XMUINT3));
-    surfaceVertDensityDispatch.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+    // The dispatch, then the exact vertex count in x for the passes to bounds check against
+    XMUINT3 vertDensityDispatchCPU[2] = { dipatchCPU, dipatchCPU };
+    surfaceVertDensityDispatch = StructuredBuffer(vertDensityDispatchCPU, 2, sizeof(XMUINT3));
+    surfaceVertDensityDispatch.passDataToGPU(*context);
     surfaceVertDensityDispatch.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
     surfaceVertDensityDispatch.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
-    surfaceVertDensityBuffer = StructuredBuffer(surfaceVertexDensities.data(), numVerts, sizeof(float));
-    surfaceVertDensityBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+    surfaceVertDensityBuffer = StructuredBuffer(nullptr, numVerts, sizeof(float));
+    surfaceVertDensityBuffer.passDataToGPU(*context);
     surfaceVertDensityBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
     surfaceVertDensityBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
-    surfaceVertexNormalBuffer = StructuredBuffer(surfaceVertexNormals.data(), numVerts, sizeof(XMFLOAT3));
-    surfaceVertexNormalBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+    surfaceVertexNormalBuffer = StructuredBuffer(nullptr, numVerts, sizeof(XMFLOAT3));
+    surfaceVertexNormalBuffer.passDataToGPU(*context);
     surfaceVertexNormalBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap()); 
     surfaceVertexNormalBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
-	surfaceVertexColorBuffer = StructuredBuffer(surfaceVertexColors.data(), numVerts, sizeof(XMFLOAT4));
-	surfaceVertexColorBuffer.passDataToGPU(*context, bilevelUniformGridCP->getCommandList(), bilevelUniformGridCP->getCommandListID());
+	surfaceVertexColorBuffer = StructuredBuffer(nullptr, numVerts, sizeof(XMFLOAT4));
+	surfaceVertexColorBuffer.passDataToGPU(*context);
 	surfaceVertexColorBuffer.createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
 	surfaceVertexColorBuffer.createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
 
@@ -242,9 +253,32 @@ void MeshShadingScene::constructScene() {
 
     // Create fence
     context->getDevice()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
+}
 
-    // Transition all resources to UAVs to start
-    transitionBuffers(bilevelUniformGridCP->getCommandList(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+void MeshShadingScene::createTransientViews() {
+    StructuredBuffer* transientBuffers[5] = { &blocksBuffer, &cellParticleCountBuffer, &cellParticleOffsetsBuffer, &cellParticleIndicesBuffer, &surfaceVerticesBuffer };
+    for (StructuredBuffer* buffer : transientBuffers) {
+        buffer->acquireTransient();
+        buffer->createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
+        buffer->createSRV(*context, bilevelUniformGridCP->getDescriptorHeap());
+    }
+
+    // Scan states are only ever used as UAVs
+    StructuredBuffer* scanStates[3] = { &cellOffsetsScanState, &surfaceBlockScanState, &surfaceVertexScanState };
+    D3D12_RESOURCE_BARRIER scanStateBarriers[3];
+    for (int i = 0; i < 3; i++) {
+        scanStates[i]->acquireTransient();
+        scanStates[i]->createUAV(*context, bilevelUniformGridCP->getDescriptorHeap());
+        scanStateBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(
+            scanStates[i]->getBuffer(),
+            D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS
+        );
+    }
+    bilevelUniformGridCP->getCommandList()->ResourceBarrier(3, scanStateBarriers);
+
+    // Transition all resources to UAVs to start (passDataToGPU leaves buffers readable by all shaders, transient ones are created that way too)
+    transitionBuffers(bilevelUniformGridCP->getCommandList(), D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     context->executeCommandList(bilevelUniformGridCP->getCommandListID());
     context->signalAndWaitForFence(fence, fenceValue);
     context->resetCommandList(bilevelUniformGridCP->getCommandListID());
@@ -252,17 +286,24 @@ void MeshShadingScene::constructScene() {
 
 void MeshShadingScene::compute(
     StructuredBuffer* pbmpmPositionsBuffer,
-    int numParticles
+    MaterialBins* bins,
+    Camera* camera,
+    float minScreenSize,
+    StatsReadback* statsReadback
 ) {
-    gridConstants.numParticles = numParticles;
     positionBuffer = pbmpmPositionsBuffer;
+    materialBins = bins;
+    cullingCamera = camera;
+    minBlockScreenSize = minScreenSize;
+    stats = statsReadback;
 
+    resetTransientBuffers();
     computeBilevelUniformGrid();
+    computeCellParticleLists();
     computeSurfaceBlockDetection();
     computeSurfaceCellDetection();
     compactSurfaceVertices();
     computeSurfaceVertexDensity();
-    computeSurfaceVertexNormal();
 }
 
 void MeshShadingScene::computeBilevelUniformGrid() {
@@ -271,20 +312,16 @@ void MeshShadingScene::computeBilevelUniformGrid() {
     cmdList->SetPipelineState(bilevelUniformGridCP->getPSO());
     cmdList->SetComputeRootSignature(bilevelUniformGridCP->getRootSignature());
 
-    // Set descriptor heap
-    ID3D12DescriptorHeap* computeDescriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
-
     // Set compute root descriptor table
     cmdList->SetComputeRootDescriptorTable(0, positionBuffer->getSRVGPUDescriptorHandle());
     cmdList->SetComputeRootDescriptorTable(1, cellParticleCountBuffer.getUAVGPUDescriptorHandle());
-    cmdList->SetComputeRootDescriptorTable(2, cellParticleIndicesBuffer.getUAVGPUDescriptorHandle());
-    cmdList->SetComputeRootDescriptorTable(3, blocksBuffer.getUAVGPUDescriptorHandle());
-    cmdList->SetComputeRoot32BitConstants(4, 11, &gridConstants, 0);
+    cmdList->SetComputeRootDescriptorTable(2, blocksBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRoot32BitConstants(3, 11, &gridConstants, 0);
+    cmdList->SetComputeRootShaderResourceView(4, materialBins->getBinCountsBuffer()->getGPUVirtualAddress());
+    cmdList->SetComputeRootShaderResourceView(5, materialBins->getParticleIndicesBuffer()->getGPUVirtualAddress());
 
-    // Dispatch
-    int numWorkGroups = (gridConstants.numParticles + BILEVEL_UNIFORM_GRID_THREADS_X - 1) / BILEVEL_UNIFORM_GRID_THREADS_X;
-    cmdList->Dispatch(numWorkGroups, 1, 1);
+    // Dispatch one thread per particle of this material without reading the bin size back
+    cmdList->ExecuteIndirect(commandSignature, 1, materialBins->getDispatchBuffer()->getBuffer(), materialBins->getDispatchOffset(material), nullptr, 0);
 
     // Transition blocksBuffer from UAV to SRV for the next pass
     D3D12_RESOURCE_BARRIER blocksBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
@@ -303,24 +340,81 @@ void MeshShadingScene::computeBilevelUniformGrid() {
     context->resetCommandList(bilevelUniformGridCP->getCommandListID());
 }
 
+void MeshShadingScene::computeCellParticleLists() {
+    // Counting sort, second and third step: give every cell a range sized by its count, then drop each particle into its cell's range
+    auto cmdList = cellParticleOffsetsCP->getCommandList();
+
+    cmdList->SetPipelineState(cellParticleOffsetsCP->getPSO());
+    cmdList->SetComputeRootSignature(cellParticleOffsetsCP->getRootSignature());
+
+    // Counts are final after the bilevel grid pass, and only read from here on
+    D3D12_RESOURCE_BARRIER cellParticleCountBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
+        cellParticleCountBuffer.getBuffer(),
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+    );
+
+    cmdList->ResourceBarrier(1, &cellParticleCountBufferBarrier);
+
+    cmdList->SetComputeRootDescriptorTable(0, cellParticleCountBuffer.getSRVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(1, cellParticleOffsetsBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRoot32BitConstants(2, 11, &gridConstants, 0);
+    cmdList->SetComputeRootDescriptorTable(3, cellOffsetsScanState.getUAVGPUDescriptorHandle());
+
+    int numCells = gridConstants.gridDim.x * gridConstants.gridDim.y * gridConstants.gridDim.z;
+    cmdList->Dispatch((numCells + CELL_PARTICLE_OFFSETS_THREADS_X - 1) / CELL_PARTICLE_OFFSETS_THREADS_X, 1, 1);
+
+    context->executeCommandList(cellParticleOffsetsCP->getCommandListID());
+    context->signalAndWaitForFence(fence, fenceValue);
+
+    context->resetCommandList(cellParticleOffsetsCP->getCommandListID());
+
+    cmdList = cellParticleScatterCP->getCommandList();
+
+    cmdList->SetPipelineState(cellParticleScatterCP->getPSO());
+    cmdList->SetComputeRootSignature(cellParticleScatterCP->getRootSignature());
+
+    cmdList->SetComputeRootDescriptorTable(0, positionBuffer->getSRVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(1, cellParticleOffsetsBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(2, cellParticleIndicesBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRoot32BitConstants(3, 11, &gridConstants, 0);
+    cmdList->SetComputeRootShaderResourceView(4, materialBins->getBinCountsBuffer()->getGPUVirtualAddress());
+    cmdList->SetComputeRootShaderResourceView(5, materialBins->getParticleIndicesBuffer()->getGPUVirtualAddress());
+
+    // Same bin and dispatch as the bilevel grid pass
+    cmdList->ExecuteIndirect(commandSignature, 1, materialBins->getDispatchBuffer()->getBuffer(), materialBins->getDispatchOffset(material), nullptr, 0);
+
+    context->executeCommandList(cellParticleScatterCP->getCommandListID());
+    context->signalAndWaitForFence(fence, fenceValue);
+
+    context->resetCommandList(cellParticleScatterCP->getCommandListID());
+}
+
 void MeshShadingScene::computeSurfaceBlockDetection() {
     auto cmdList = surfaceBlockDetectionCP->getCommandList();
 
     cmdList->SetPipelineState(surfaceBlockDetectionCP->getPSO());
     cmdList->SetComputeRootSignature(surfaceBlockDetectionCP->getRootSignature());
 
-    // Set descriptor heap
-    ID3D12DescriptorHeap* computeDescriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
-
     int numCells = gridConstants.gridDim.x * gridConstants.gridDim.y * gridConstants.gridDim.z;
     int numBlocks = numCells / (CELLS_PER_BLOCK_EDGE * CELLS_PER_BLOCK_EDGE * CELLS_PER_BLOCK_EDGE);
 
+    SurfaceBlockDetectionConstants detectionConstants = {
+        cullingCamera ? cullingCamera->getViewProjMat() : XMMatrixIdentity(),
+        XMINT3(gridConstants.gridDim.x / CELLS_PER_BLOCK_EDGE, gridConstants.gridDim.y / CELLS_PER_BLOCK_EDGE, gridConstants.gridDim.z / CELLS_PER_BLOCK_EDGE),
+        numBlocks,
+        gridConstants.minBounds,
+        gridConstants.resolution * CELLS_PER_BLOCK_EDGE,
+        minBlockScreenSize,
+        cullingCamera != nullptr
+    };
+
     // Set compute root descriptor table
     cmdList->SetComputeRootDescriptorTable(0, blocksBuffer.getSRVGPUDescriptorHandle());
     cmdList->SetComputeRootDescriptorTable(1, surfaceBlockIndicesBuffer.getUAVGPUDescriptorHandle());
     cmdList->SetComputeRootUnorderedAccessView(2, surfaceBlockDispatch.getGPUVirtualAddress());
-    cmdList->SetComputeRoot32BitConstants(3, 1, &numBlocks, 0);
+    cmdList->SetComputeRoot32BitConstants(3, 26, &detectionConstants, 0);
+    cmdList->SetComputeRootDescriptorTable(4, surfaceBlockScanState.getUAVGPUDescriptorHandle());
 
     // Dispatch
     int numWorkGroups = (numBlocks + SURFACE_BLOCK_DETECTION_THREADS_X - 1) / SURFACE_BLOCK_DETECTION_THREADS_X;
@@ -338,10 +432,6 @@ void MeshShadingScene::computeSurfaceCellDetection() {
     cmdList->SetPipelineState(surfaceCellDetectionCP->getPSO());
     cmdList->SetComputeRootSignature(surfaceCellDetectionCP->getRootSignature());
 
-    // Set descriptor heap
-    ID3D12DescriptorHeap* computeDescriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
-
     // Transition surfaceBlockIndicesBuffer to SRV 
     D3D12_RESOURCE_BARRIER surfaceBlockIndicesBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
         surfaceBlockIndicesBuffer.getBuffer(),
@@ -356,15 +446,9 @@ void MeshShadingScene::computeSurfaceCellDetection() {
         D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
     );
 
-    // Transition cellsBuffer to SRV 
-    D3D12_RESOURCE_BARRIER cellParticleCountBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-        cellParticleCountBuffer.getBuffer(),
-        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
-    );
-
-    D3D12_RESOURCE_BARRIER barriers[3] = { surfaceBlockIndicesBufferBarrier, surfaceBlockDispatchBarrier, cellParticleCountBufferBarrier };
-    cmdList->ResourceBarrier(3, barriers);
+    // cellParticleCountBuffer is already an SRV, since computeCellParticleLists
+    D3D12_RESOURCE_BARRIER barriers[2] = { surfaceBlockIndicesBufferBarrier, surfaceBlockDispatchBarrier };
+    cmdList->ResourceBarrier(2, barriers);
 
     // Set compute root descriptor table
     cmdList->SetComputeRootDescriptorTable(0, surfaceBlockIndicesBuffer.getSRVGPUDescriptorHandle());
@@ -398,10 +482,6 @@ void MeshShadingScene::compactSurfaceVertices() {
     cmdList->SetPipelineState(surfaceVertexCompactionCP->getPSO());
     cmdList->SetComputeRootSignature(surfaceVertexCompactionCP->getRootSignature());
 
-    // Set descriptor heap
-    ID3D12DescriptorHeap* computeDescriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
-
     // Transition surfaceVerticesBuffer back to SRV 
     D3D12_RESOURCE_BARRIER surfaceVerticesBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
         surfaceVerticesBuffer.getBuffer(),
@@ -416,18 +496,28 @@ void MeshShadingScene::compactSurfaceVertices() {
     cmdList->SetComputeRootDescriptorTable(1, surfaceVertexIndicesBuffer.getUAVGPUDescriptorHandle());
     cmdList->SetComputeRootUnorderedAccessView(2, surfaceVertDensityDispatch.getGPUVirtualAddress());
     cmdList->SetComputeRoot32BitConstants(3, 10, &gridConstants, 0);
+    cmdList->SetComputeRootDescriptorTable(4, surfaceVertexScanState.getUAVGPUDescriptorHandle());
 
     // Dispatch
     int numVertices = (gridConstants.gridDim.x + 1) * (gridConstants.gridDim.y + 1) * (gridConstants.gridDim.z + 1);
     int numWorkGroups = (numVertices + SURFACE_VERTEX_COMPACTION_THREADS_X - 1) / SURFACE_VERTEX_COMPACTION_THREADS_X;
-        cmdList->Dispatch(numWorkGroups, 1, 1);
+    cmdList->Dispatch(numWorkGroups, 1, 1);
+
+    // The first entry holds the group count, the exact vertex count is in the second
+    if (stats && material < MAX_STATS_MATERIALS) {
+        D3D12_RESOURCE_BARRIER surfaceVertDensityDispatchUAVBarrier = CD3DX12_RESOURCE_BARRIER::UAV(surfaceVertDensityDispatch.getBuffer());
+        cmdList->ResourceBarrier(1, &surfaceVertDensityDispatchUAVBarrier);
+
+        stats->copyValue(cmdList, surfaceVertDensityDispatch.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, sizeof(XMUINT3),
+            offsetof(SimulationStats, surfaceVertexCount) + material * sizeof(UINT));
+        stats->copyValue(cmdList, surfaceBlockDispatch.getBuffer(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, 0,
+            offsetof(SimulationStats, surfaceBlockCount) + material * sizeof(UINT));
+    }
 
     context->executeCommandList(surfaceVertexCompactionCP->getCommandListID());
     context->signalAndWaitForFence(fence, fenceValue);
 
     context->resetCommandList(surfaceVertexCompactionCP->getCommandListID());
-
-    divNumThreadsByGroupSize(&surfaceVertDensityDispatch, SURFACE_VERTEX_DENSITY_THREADS_X);
 }
 
 void MeshShadingScene::computeSurfaceVertexDensity() {
@@ -436,10 +526,6 @@ void MeshShadingScene::computeSurfaceVertexDensity() {
     cmdList->SetPipelineState(surfaceVertexDensityCP->getPSO());
     cmdList->SetComputeRootSignature(surfaceVertexDensityCP->getRootSignature());
 
-    // Set descriptor heap
-    ID3D12DescriptorHeap* computeDescriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
-
     // Transition surfaceVertexIndicesBuffer to SRV
     D3D12_RESOURCE_BARRIER surfaceVertexIndicesBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
         surfaceVertexIndicesBuffer.getBuffer(),
@@ -454,15 +540,22 @@ void MeshShadingScene::computeSurfaceVertexDensity() {
         D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
     );
 
-    // Transition surfaceBlockDispatch to a UAV
-    D3D12_RESOURCE_BARRIER surfaceBlockDispatchBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-        surfaceBlockDispatch.getBuffer(),
-        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
-        D3D12_RESOURCE_STATE_UNORDERED_ACCESS
+    // Transition the cell lists to SRVs, the scatter left them as UAVs
+    D3D12_RESOURCE_BARRIER cellParticleOffsetsBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
+        cellParticleOffsetsBuffer.getBuffer(),
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
     );
 
-    D3D12_RESOURCE_BARRIER barriers[3] = { surfaceVertexIndicesBufferBarrier, surfaceVertDensityDispatchBarrier, surfaceBlockDispatchBarrier };
-    cmdList->ResourceBarrier(3, barriers);
+    D3D12_RESOURCE_BARRIER cellParticleIndicesBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
+        cellParticleIndicesBuffer.getBuffer(),
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+    );
+
+    D3D12_RESOURCE_BARRIER barriers[4] = { surfaceVertexIndicesBufferBarrier, surfaceVertDensityDispatchBarrier,
+        cellParticleOffsetsBufferBarrier, cellParticleIndicesBufferBarrier };
+    cmdList->ResourceBarrier(4, barriers);
 
     // Set compute root descriptor table
     cmdList->SetComputeRootDescriptorTable(0, positionBuffer->getSRVGPUDescriptorHandle());
@@ -470,10 +563,11 @@ void MeshShadingScene::computeSurfaceVertexDensity() {
     cmdList->SetComputeRootDescriptorTable(2, cellParticleIndicesBuffer.getSRVGPUDescriptorHandle());
     cmdList->SetComputeRootDescriptorTable(3, surfaceVertexIndicesBuffer.getSRVGPUDescriptorHandle());
     cmdList->SetComputeRootShaderResourceView(4, surfaceVertDensityDispatch.getGPUVirtualAddress());
-    cmdList->SetComputeRootUnorderedAccessView(5, surfaceBlockDispatch.getGPUVirtualAddress());
-    cmdList->SetComputeRootDescriptorTable(6, surfaceVertDensityBuffer.getUAVGPUDescriptorHandle());
-    cmdList->SetComputeRootDescriptorTable(7, surfaceVertexColorBuffer.getUAVGPUDescriptorHandle());
-    cmdList->SetComputeRoot32BitConstants(8, 11, &gridConstants, 0);
+    cmdList->SetComputeRootDescriptorTable(5, surfaceVertDensityBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(6, surfaceVertexColorBuffer.getUAVGPUDescriptorHandle());
+    cmdList->SetComputeRoot32BitConstants(7, 11, &gridConstants, 0);
+    cmdList->SetComputeRootDescriptorTable(8, cellParticleOffsetsBuffer.getSRVGPUDescriptorHandle());
+    cmdList->SetComputeRootDescriptorTable(9, surfaceVertexNormalBuffer.getUAVGPUDescriptorHandle());
 
     // Transition surfaceVertDensityDispatch to indirect argument buffer
     D3D12_RESOURCE_BARRIER surfaceVertDensityDispatchBarrier2 = CD3DX12_RESOURCE_BARRIER::Transition(
@@ -487,81 +581,43 @@ void MeshShadingScene::computeSurfaceVertexDensity() {
     // Dispatch
     cmdList->ExecuteIndirect(commandSignature, 1, surfaceVertDensityDispatch.getBuffer(), 0, nullptr, 0);
 
-    context->executeCommandList(surfaceVertexDensityCP->getCommandListID());
-    context->signalAndWaitForFence(fence, fenceValue);
-
-    context->resetCommandList(surfaceVertexDensityCP->getCommandListID());
-}
-
-void MeshShadingScene::computeSurfaceVertexNormal() {
-    auto cmdList = surfaceVertexNormalCP->getCommandList();
-
-    cmdList->SetPipelineState(surfaceVertexNormalCP->getPSO());
-    cmdList->SetComputeRootSignature(surfaceVertexNormalCP->getRootSignature());
-
-    // Set descriptor heap
-    ID3D12DescriptorHeap* computeDescriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
-
-    // Transition surfaceVertDensityBuffer to SRV
+    // The mesh shader reads the densities and the dispatch as SRVs
     D3D12_RESOURCE_BARRIER surfaceVertDensityBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
         surfaceVertDensityBuffer.getBuffer(),
         D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
         D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
     );
 
-    // Transition surfaceVertDensityDispatch to an SRV
-    D3D12_RESOURCE_BARRIER surfaceVertDensityDispatchBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
+    D3D12_RESOURCE_BARRIER surfaceVertDensityDispatchBarrier3 = CD3DX12_RESOURCE_BARRIER::Transition(
         surfaceVertDensityDispatch.getBuffer(),
-        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
         D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
     );
 
-    D3D12_RESOURCE_BARRIER barriers[2] = { surfaceVertDensityBufferBarrier, surfaceVertDensityDispatchBarrier };
-    cmdList->ResourceBarrier(2, barriers);
-
-    // Set compute root descriptor table
-    cmdList->SetComputeRootDescriptorTable(0, surfaceVertDensityBuffer.getSRVGPUDescriptorHandle());
-    cmdList->SetComputeRootDescriptorTable(1, surfaceVertexIndicesBuffer.getSRVGPUDescriptorHandle());
-    cmdList->SetComputeRootShaderResourceView(2, surfaceVertDensityDispatch.getGPUVirtualAddress());
-    cmdList->SetComputeRootDescriptorTable(3, surfaceVertexNormalBuffer.getUAVGPUDescriptorHandle());
-    cmdList->SetComputeRoot32BitConstants(4, 10, &gridConstants, 0);
-
-    // Transition surfaceVertDensityDispatch to indirect argument buffer
-    D3D12_RESOURCE_BARRIER surfaceVertDensityDispatchBarrier2 = CD3DX12_RESOURCE_BARRIER::Transition(
-        surfaceVertDensityDispatch.getBuffer(),
-        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
-        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT
-    );
-
-    cmdList->ResourceBarrier(1, &surfaceVertDensityDispatchBarrier2);
-
-    // Dispatch
-    cmdList->ExecuteIndirect(commandSignature, 1, surfaceVertDensityDispatch.getBuffer(), 0, nullptr, 0);
+    D3D12_RESOURCE_BARRIER barriers2[2] = { surfaceVertDensityBufferBarrier, surfaceVertDensityDispatchBarrier3 };
+    cmdList->ResourceBarrier(2, barriers2);
 
-    context->executeCommandList(surfaceVertexNormalCP->getCommandListID());
+    context->executeCommandList(surfaceVertexDensityCP->getCommandListID());
     context->signalAndWaitForFence(fence, fenceValue);
 
-    context->resetCommandList(surfaceVertexNormalCP->getCommandListID());
+    context->resetCommandList(surfaceVertexDensityCP->getCommandListID());
 }
 
 void MeshShadingScene::releaseResources() {
+    // The compute pipelines are shared by every material, Scene releases them
     renderPipeline->releaseResources();
-    bilevelUniformGridCP->releaseResources();
-    surfaceBlockDetectionCP->releaseResources();
-    surfaceCellDetectionCP->releaseResources();
-	surfaceVertexCompactionCP->releaseResources();
-	surfaceVertexDensityCP->releaseResources();
-	surfaceVertexNormalCP->releaseResources();
-	bufferClearCP->releaseResources();
 	fluidMeshPipeline->releaseResources();
     cellParticleCountBuffer.releaseResources();
+    cellParticleOffsetsBuffer.releaseResources();
     cellParticleIndicesBuffer.releaseResources();
     blocksBuffer.releaseResources();
     surfaceBlockIndicesBuffer.releaseResources();
     surfaceBlockDispatch.releaseResources();
     surfaceHalfBlockDispatch.releaseResources();
     surfaceVerticesBuffer.releaseResources();
+    cellOffsetsScanState.releaseResources();
+    surfaceBlockScanState.releaseResources();
+    surfaceVertexScanState.releaseResources();
     surfaceVertexIndicesBuffer.releaseResources();
     surfaceVertDensityDispatch.releaseResources();
     surfaceVertDensityBuffer.releaseResources();
@@ -580,6 +636,12 @@ void MeshShadingScene::transitionBuffers(ID3D12GraphicsCommandList6* cmdList, D3
         afterState
     );
 
+    D3D12_RESOURCE_BARRIER cellParticleOffsetsBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
+        cellParticleOffsetsBuffer.getBuffer(),
+        beforeState,
+        afterState
+    );
+
     D3D12_RESOURCE_BARRIER cellParticleIndicesBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
         cellParticleIndicesBuffer.getBuffer(),
         beforeState,
@@ -648,8 +710,9 @@ void MeshShadingScene::transitionBuffers(ID3D12GraphicsCommandList6* cmdList, D3
 
 
 
-    D3D12_RESOURCE_BARRIER barriers[12] = { 
+    D3D12_RESOURCE_BARRIER barriers[13] = { 
         cellParticleCountsBufferBarrier,
+        cellParticleOffsetsBufferBarrier,
         cellParticleIndicesBufferBarrier,
         blocksBufferBarrier,
         surfaceBlockIndicesBufferBarrier,
@@ -663,32 +726,43 @@ void MeshShadingScene::transitionBuffers(ID3D12GraphicsCommandList6* cmdList, D3
         surfaceVertexColorBufferBarrier
     };
 
-    cmdList->ResourceBarrier(12, barriers);
+    cmdList->ResourceBarrier(13, barriers);
 }
 
-void MeshShadingScene::resetBuffers() {
+void MeshShadingScene::resetTransientBuffers() {
 	constexpr UINT THREAD_GROUP_SIZE = 256;
     int numCells = gridConstants.gridDim.x * gridConstants.gridDim.y * gridConstants.gridDim.z;
-    int numCellIndices = numCells * MAX_PARTICLES_PER_CELL;
+    int numCellOffsets = numCells + 1;
     int numBlocks = numCells / (CELLS_PER_BLOCK_EDGE * CELLS_PER_BLOCK_EDGE * CELLS_PER_BLOCK_EDGE);
     int numVerts = (gridConstants.gridDim.x + 1) * (gridConstants.gridDim.y + 1) * (gridConstants.gridDim.z + 1);
 
-	// Bind the PSO and Root Signature
     auto cmdList = bufferClearCP->getCommandList();
+
+    // Another material may have used this memory since our last compute, so activate our buffers before clearing them
+    D3D12_RESOURCE_BARRIER aliasingBarriers[8] = {
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, cellParticleCountBuffer.getBuffer()),
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, cellParticleOffsetsBuffer.getBuffer()),
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, cellParticleIndicesBuffer.getBuffer()),
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, blocksBuffer.getBuffer()),
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, surfaceVerticesBuffer.getBuffer()),
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, cellOffsetsScanState.getBuffer()),
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, surfaceBlockScanState.getBuffer()),
+        CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, surfaceVertexScanState.getBuffer())
+    };
+    cmdList->ResourceBarrier(8, aliasingBarriers);
+
+	// Bind the PSO and Root Signature
     cmdList->SetPipelineState(bufferClearCP->getPSO());
     cmdList->SetComputeRootSignature(bufferClearCP->getRootSignature());
 
-    // Bind the descriptor heap
-	ID3D12DescriptorHeap* descriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
     cmdList->SetComputeRoot32BitConstants(0, 1, &numCells, 0);
 	cmdList->SetComputeRootDescriptorTable(1, cellParticleCountBuffer.getUAVGPUDescriptorHandle());
 	cmdList->Dispatch((numCells + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
 
-    cmdList->SetComputeRoot32BitConstants(0, 1, &numCellIndices, 0);
-    cmdList->SetComputeRootDescriptorTable(1, cellParticleIndicesBuffer.getUAVGPUDescriptorHandle());
-    cmdList->Dispatch((numCellIndices + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
+    // The cell lists themselves need no clear, the scatter writes every entry that gets read
+    cmdList->SetComputeRoot32BitConstants(0, 1, &numCellOffsets, 0);
+    cmdList->SetComputeRootDescriptorTable(1, cellParticleOffsetsBuffer.getUAVGPUDescriptorHandle());
+    cmdList->Dispatch((numCellOffsets + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
 
     cmdList->SetComputeRoot32BitConstants(0, 1, &numBlocks, 0);
     cmdList->SetComputeRootDescriptorTable(1, blocksBuffer.getUAVGPUDescriptorHandle());
@@ -698,6 +772,29 @@ void MeshShadingScene::resetBuffers() {
     cmdList->SetComputeRootDescriptorTable(1, surfaceVerticesBuffer.getUAVGPUDescriptorHandle());
     cmdList->Dispatch((numVerts + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
 
+    // Every scan starts with no partitions claimed or published
+    StructuredBuffer* scanStates[3] = { &cellOffsetsScanState, &surfaceBlockScanState, &surfaceVertexScanState };
+    for (StructuredBuffer* scanState : scanStates) {
+        int numStates = (int)scanState->getNumElements();
+        cmdList->SetComputeRoot32BitConstants(0, 1, &numStates, 0);
+        cmdList->SetComputeRootDescriptorTable(1, scanState->getUAVGPUDescriptorHandle());
+        cmdList->Dispatch((numStates + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
+    }
+
+    context->executeCommandList(bufferClearCP->getCommandListID());
+    context->signalAndWaitForFence(fence, fenceValue);
+    context->resetCommandList(bufferClearCP->getCommandListID());
+}
+
+void MeshShadingScene::resetBuffers() {
+	constexpr UINT THREAD_GROUP_SIZE = 256;
+    int numVerts = (gridConstants.gridDim.x + 1) * (gridConstants.gridDim.y + 1) * (gridConstants.gridDim.z + 1);
+
+	// Bind the PSO and Root Signature
+    auto cmdList = bufferClearCP->getCommandList();
+    cmdList->SetPipelineState(bufferClearCP->getPSO());
+    cmdList->SetComputeRootSignature(bufferClearCP->getRootSignature());
+
     cmdList->SetComputeRoot32BitConstants(0, 1, &numVerts, 0);
     cmdList->SetComputeRootDescriptorTable(1, surfaceVertexIndicesBuffer.getUAVGPUDescriptorHandle());
     cmdList->Dispatch((numVerts + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
@@ -710,27 +807,3 @@ void MeshShadingScene::resetBuffers() {
     context->signalAndWaitForFence(fence, fenceValue);
     context->resetCommandList(bufferClearCP->getCommandListID());
 }
-
-/**
- * In one stream compaction step (detecting surface vertices), we end up with a total number (vertices),
- * which equals the number of the threads needed in subsequent compute steps (via indirect dispatch).
- * 
- * What we *need*, however, is the total number of thread groups, not threads. To avoid the latency of shuttling this data back and forth between the CPU and GPU,
- * we use a simple, one-thread compute pass to do the division, thus keeping the data on the GPU. To generalize this function for potential reuse, it accepts any dispatch buffer and any groupSize divisor.
- * 
- * This method assumes the dispatchArgs buffer is already a UAV.
- */
-void MeshShadingScene::divNumThreadsByGroupSize(StructuredBuffer* dispatchArgs, int groupSize) {
-    auto cmdList = dispatchArgDivideCP->getCommandList();
-    cmdList->SetPipelineState(dispatchArgDivideCP->getPSO());
-    cmdList->SetComputeRootSignature(dispatchArgDivideCP->getRootSignature());
-    // Set descriptor heap
-    ID3D12DescriptorHeap* computeDescriptorHeaps[] = { bilevelUniformGridCP->getDescriptorHeap()->Get() };
-    cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
-    cmdList->SetComputeRootUnorderedAccessView(0, dispatchArgs->getGPUVirtualAddress());
-    cmdList->SetComputeRoot32BitConstants(1, 1, &groupSize, 0);
-    cmdList->Dispatch(1, 1, 1);
-    context->executeCommandList(dispatchArgDivideCP->getCommandListID());
-    context->signalAndWaitForFence(fence, fenceValue);
-    context->resetCommandList(dispatchArgDivideCP->getCommandListID());
-}
\ No newline at end of file
@@ -1,13 +1,15 @@
 #pragma once
 #include <vector>
 #include "Drawable.h"
+#include "MaterialBins.h"
 #include "../D3D/Pipeline/ComputePipeline.h"
 #include "../D3D/Pipeline/MeshPipeline.h"
 #include "../D3D/StructuredBuffer.h"
+#include "../D3D/StatsReadback.h"
 #include "../Shaders/constants.h"
 
 struct GridConstants {
-    int numParticles;
+    int numParticles; // Unused, the bilevel grid pass reads the count from its material bin
     XMINT3 gridDim;
     XMFLOAT3 minBounds;
     float resolution;
@@ -16,6 +18,16 @@ struct GridConstants {
     int material;
 };
 
+struct SurfaceBlockDetectionConstants {
+    XMMATRIX viewProj;
+    XMINT3 blockDimensions;
+    int numBlocks;
+    XMFLOAT3 minBounds;
+    float blockWidth;
+    float minScreenSize;
+    unsigned int cullBlocks;
+};
+
 // TODO: can just combine this with grid constants
 struct MeshShadingConstants {
     XMMATRIX viewProj;
@@ -29,11 +41,6 @@ struct MeshShadingConstants {
     float isovalue;
 };
 
-struct Cell {
-    int particleCount;
-    int particleIndices[MAX_PARTICLES_PER_CELL];
-};
-
 struct Block {
     int nonEmptyCellCount;
 };
@@ -44,28 +51,37 @@ public:
     MeshShadingScene(DXContext* context, 
                RenderPipeline *pipeline, 
                ComputePipeline* bilevelUniformGridCP, 
+               ComputePipeline* cellParticleOffsetsCP,
+               ComputePipeline* cellParticleScatterCP,
                ComputePipeline* surfaceBlockDetectionCP,
                ComputePipeline* surfaceCellDetectionCP,
                ComputePipeline* surfaceVertexCompactionCP,
                ComputePipeline* surfaceVertexDensityCP,
-               ComputePipeline* surfaceVertexNormalCP,
                ComputePipeline* bufferClearCP,
-               ComputePipeline* dispatchArgDivideCP,
                MeshPipeline* fluidMeshPipeline,
 		int material, float isovalue, float kernelScale, float kernelRadius);
 
+    // Reads this material's bin from bins, which must already be computed for the frame. Surface counts go to stats when given.
+    // Surface blocks outside cullingCamera's view, or covering less than minBlockScreenSize of its height, aren't meshed.
+    // Without a camera every surface block is meshed
     void compute(
         StructuredBuffer* positionsBuffer,
-        int numParticles
+        MaterialBins* bins,
+        Camera* cullingCamera = nullptr,
+        float minBlockScreenSize = 0.0f,
+        StatsReadback* stats = nullptr
     );
     void draw(Camera* camera, unsigned int renderMeshlets, unsigned int renderOptions);
     void constructScene();
+    // Call after BufferAllocator::createTransientBuffers, once every scene has requested its scratch
+    void createTransientViews();
     void computeBilevelUniformGrid();
+    void computeCellParticleLists();
     void computeSurfaceBlockDetection();
     void computeSurfaceCellDetection();
     void compactSurfaceVertices();
+    // Densities, colors and normals in one pass
     void computeSurfaceVertexDensity();
-    void computeSurfaceVertexNormal();
     void releaseResources();
 
     float* getIsovalue() { return &isovalue; }
@@ -75,16 +91,17 @@ public:
 private:
     void transitionBuffers(ID3D12GraphicsCommandList6* cmdList, D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState);
     void resetBuffers();
-    void divNumThreadsByGroupSize(StructuredBuffer* divNumThreadsByGroupSize, int groupSize);
+    void resetTransientBuffers();
 
     GridConstants gridConstants;
     
     ComputePipeline* bilevelUniformGridCP;
+    ComputePipeline* cellParticleOffsetsCP;
+    ComputePipeline* cellParticleScatterCP;
     ComputePipeline* surfaceBlockDetectionCP;
     ComputePipeline* surfaceCellDetectionCP;
     ComputePipeline* surfaceVertexCompactionCP;
     ComputePipeline* surfaceVertexDensityCP;
-    ComputePipeline* surfaceVertexNormalCP;
     ComputePipeline* bufferClearCP;
 
     MeshPipeline* fluidMeshPipeline;
@@ -96,19 +113,29 @@ private:
     ID3D12CommandSignature* meshCommandSignature = nullptr;
 
     StructuredBuffer* positionBuffer;
+    MaterialBins* materialBins = nullptr;
+    StatsReadback* stats = nullptr;
+    Camera* cullingCamera = nullptr;
+    float minBlockScreenSize = 0.0f;
     StructuredBuffer cellParticleCountBuffer;
+    StructuredBuffer cellParticleOffsetsBuffer;
     StructuredBuffer cellParticleIndicesBuffer;
     StructuredBuffer blocksBuffer;
     StructuredBuffer surfaceBlockIndicesBuffer;
     StructuredBuffer surfaceBlockDispatch;
     StructuredBuffer surfaceHalfBlockDispatch; // This is just 2x surfaceBlockDispatch, but saves us a round trip to the GPU to multiply by 2
     StructuredBuffer surfaceVerticesBuffer;
+    // Scratch of the prefix scans in CellParticleOffsets, SurfaceBlockDetection and SurfaceVertexCompaction
+    StructuredBuffer cellOffsetsScanState;
+    StructuredBuffer surfaceBlockScanState;
+    StructuredBuffer surfaceVertexScanState;
     StructuredBuffer surfaceVertexIndicesBuffer;
     StructuredBuffer surfaceVertDensityDispatch;
     StructuredBuffer surfaceVertDensityBuffer;
     StructuredBuffer surfaceVertexNormalBuffer;
     StructuredBuffer surfaceVertexColorBuffer;
-    ComputePipeline* dispatchArgDivideCP;
+
+    unsigned int transientPass = 0;
 
     int material;
     float isovalue;
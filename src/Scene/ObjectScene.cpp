@@ -156,10 +156,6 @@ void ObjectScene::draw(Camera* camera) {
         cmdList->SetGraphicsRootSignature(renderPipeline->getRootSignature());
         
         // == ROOT ==
-        ID3D12DescriptorHeap* descriptorHeaps[] = { renderPipeline->getDescriptorHeap()->GetAddress() };
-        if (instanced) {
-            cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-        }
 
         auto viewMat = camera->getViewMat();
         auto projMat = camera->getProjMat();
@@ -1,5 +1,7 @@
 #include "PBMPMScene.h"
 #include "SceneConstants.h"
+#include <algorithm>
+#include <chrono>
 
 PBMPMScene::PBMPMScene(DXContext* context, RenderPipeline* pipeline, bool* renderTogglesRef)
 	: Drawable(context, pipeline), context(context), renderPipeline(pipeline), renderToggles(renderTogglesRef),
@@ -17,6 +19,10 @@ PBMPMScene::PBMPMScene(DXContext* context, RenderPipeline* pipeline, bool* rende
 	emissionPipeline("particleEmitRootSignature.cso", "particleEmitComputeShader.cso", *context, CommandListID::PBMPM_EMISSION_COMPUTE_ID,
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE),
 	setIndirectArgsPipeline("setIndirectArgsRootSignature.cso", "setIndirectArgsComputeShader.cso", *context, CommandListID::PBMPM_SET_INDIRECT_ARGS_COMPUTE_ID,
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE),
+	bukkitSleepPipeline("bukkitSleepRootSignature.cso", "bukkitSleepComputeShader.cso", *context, CommandListID::PBMPM_BUKKITSLEEP_COMPUTE_ID,
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE),
+	sleepingGridPipeline("sleepingGridRootSignature.cso", "sleepingGridComputeShader.cso", *context, CommandListID::PBMPM_SLEEPINGGRID_COMPUTE_ID,
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
 {
 	g2p2gPipeline.getCommandList()->Close();
@@ -33,6 +39,10 @@ PBMPMScene::PBMPMScene(DXContext* context, RenderPipeline* pipeline, bool* rende
 	context->resetCommandList(CommandListID::PBMPM_EMISSION_COMPUTE_ID);
 	setIndirectArgsPipeline.getCommandList()->Close();
 	context->resetCommandList(CommandListID::PBMPM_SET_INDIRECT_ARGS_COMPUTE_ID);
+	bukkitSleepPipeline.getCommandList()->Close();
+	context->resetCommandList(CommandListID::PBMPM_BUKKITSLEEP_COMPUTE_ID);
+	sleepingGridPipeline.getCommandList()->Close();
+	context->resetCommandList(CommandListID::PBMPM_SLEEPINGGRID_COMPUTE_ID);
 	constructScene();
 }
 
@@ -41,28 +51,19 @@ void PBMPMScene::createBukkitSystem() {
 	int bukkitCountY = (int)std::ceil(constants.gridSize.y / BukkitSize);
 	int bukkitCountZ = (int)std::ceil(constants.gridSize.z / BukkitSize);
 
-	std::vector<int> count;
-	count.resize(bukkitCountX * bukkitCountY * bukkitCountZ);
-	bukkitSystem.countBuffer = StructuredBuffer(count.data(), (unsigned int)count.size(), sizeof(int));
-
-	std::vector<int> count2;
-	count2.resize(bukkitCountX * bukkitCountY * bukkitCountZ);
-	bukkitSystem.countBuffer2 = StructuredBuffer(count2.data(), (unsigned int)count2.size(), sizeof(int));
+	unsigned int bukkitCount = bukkitCountX * bukkitCountY * bukkitCountZ;
 
-	std::vector<int> particleData;
-	particleData.resize(maxParticles);
-	bukkitSystem.particleData = StructuredBuffer(particleData.data(), (unsigned int)particleData.size(), sizeof(int));
-
-	std::vector<BukkitThreadData> threadData;
-	threadData.resize(5 * 10 * bukkitCountX * bukkitCountY * bukkitCountZ); //ik why this is 50
-	bukkitSystem.threadData = StructuredBuffer(threadData.data(), (unsigned int)threadData.size(), sizeof(BukkitThreadData));
+	// Zero initialised buffers pass no data, they are cleared on the GPU
+	bukkitSystem.countBuffer = StructuredBuffer(nullptr, bukkitCount, sizeof(int));
+	bukkitSystem.countBuffer2 = StructuredBuffer(nullptr, bukkitCount, sizeof(int));
+	bukkitSystem.particleData = StructuredBuffer(nullptr, maxParticles, sizeof(int));
+	bukkitSystem.threadData = StructuredBuffer(nullptr, 5 * 10 * bukkitCount, sizeof(BukkitThreadData)); //ik why this is 50
 
 	XMUINT4 allocator = { 0, 0, 0, 0 };
 	bukkitSystem.particleAllocator = StructuredBuffer(&allocator, 1, sizeof(XMUINT4));
 
-	std::vector<int> indexStart;
-	indexStart.resize(bukkitCountX * bukkitCountY * bukkitCountZ);
-	bukkitSystem.indexStart = StructuredBuffer(indexStart.data(), (unsigned int)indexStart.size(), sizeof(int));
+	bukkitSystem.indexStart = StructuredBuffer(nullptr, bukkitCount, sizeof(int));
+	bukkitSystem.sleep = StructuredBuffer(nullptr, bukkitCount * BukkitSleepStride, sizeof(UINT));
 
 	XMUINT4 dispatch = { 0, 1, 1, 0 };
 	bukkitSystem.dispatch = StructuredBuffer(&dispatch, 1, sizeof(XMUINT4));
@@ -74,13 +75,14 @@ void PBMPMScene::createBukkitSystem() {
 	bukkitSystem.countY = bukkitCountY;
 	bukkitSystem.countZ = bukkitCountZ;
 	bukkitSystem.count = bukkitCountX * bukkitCountY * bukkitCountZ;
-	bukkitSystem.countBuffer.passDataToGPU(*context, bukkitCountPipeline.getCommandList(), bukkitCountPipeline.getCommandListID());
-	bukkitSystem.countBuffer2.passDataToGPU(*context, bukkitInsertPipeline.getCommandList(), bukkitInsertPipeline.getCommandListID());
-	bukkitSystem.particleData.passDataToGPU(*context, bukkitInsertPipeline.getCommandList(), bukkitInsertPipeline.getCommandListID());
-	bukkitSystem.threadData.passDataToGPU(*context, bukkitAllocatePipeline.getCommandList(), bukkitAllocatePipeline.getCommandListID());
-	bukkitSystem.particleAllocator.passDataToGPU(*context, bukkitAllocatePipeline.getCommandList(), bukkitAllocatePipeline.getCommandListID());
-	bukkitSystem.indexStart.passDataToGPU(*context, bukkitAllocatePipeline.getCommandList(), bukkitAllocatePipeline.getCommandListID());
-	bukkitSystem.dispatch.passDataToGPU(*context, bukkitAllocatePipeline.getCommandList(), bukkitAllocatePipeline.getCommandListID());
+	bukkitSystem.countBuffer.passDataToGPU(*context);
+	bukkitSystem.countBuffer2.passDataToGPU(*context);
+	bukkitSystem.particleData.passDataToGPU(*context);
+	bukkitSystem.threadData.passDataToGPU(*context);
+	bukkitSystem.particleAllocator.passDataToGPU(*context);
+	bukkitSystem.indexStart.passDataToGPU(*context);
+	bukkitSystem.dispatch.passDataToGPU(*context);
+	bukkitSystem.sleep.passDataToGPU(*context);
 
 	// Create UAV's for each buffer
 	bukkitSystem.countBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
@@ -90,15 +92,16 @@ void PBMPMScene::createBukkitSystem() {
 	bukkitSystem.particleAllocator.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 	bukkitSystem.indexStart.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 	bukkitSystem.dispatch.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
+	bukkitSystem.sleep.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 
 	// Create SRV's for each buffer
 	bukkitSystem.countBuffer.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 	bukkitSystem.countBuffer2.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
-	bukkitSystem.particleData.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
-	bukkitSystem.threadData.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
+	StructuredBuffer::createSRVTable(*context, g2p2gPipeline.getDescriptorHeap(), { &bukkitSystem.particleData, &bukkitSystem.threadData });
 	bukkitSystem.particleAllocator.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 	bukkitSystem.indexStart.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 	bukkitSystem.dispatch.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
+	bukkitSystem.sleep.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 
 	bukkitSystem.blankDispatch.passCBVDataToGPU(*context, bukkitCountPipeline.getDescriptorHeap());
 }
@@ -113,6 +116,66 @@ void PBMPMScene::updateSimUniforms(unsigned int iteration) {
 	constants.iteration = iteration;
 }
 
+void PBMPMScene::createResidualReadback() {
+	D3D12_HEAP_PROPERTIES heapProps = {};
+	heapProps.Type = D3D12_HEAP_TYPE_READBACK;
+
+	D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(2 * sizeof(float));
+
+	HRESULT hr = context->getDevice()->CreateCommittedResource(
+		&heapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&residualReadback)
+	);
+	if (FAILED(hr)) {
+		throw std::runtime_error("Failed to create iteration residual readback buffer.");
+	}
+
+	// Stays mapped, the value is only read after the fence that follows the copy
+	if (FAILED(residualReadback->Map(0, nullptr, reinterpret_cast<void**>(&residualReadbackData)))) {
+		throw std::runtime_error("Failed to map iteration residual readback buffer.");
+	}
+}
+
+void PBMPMScene::chooseSubsteps() {
+	float frameTime = substepCount * BaseDeltaTime;
+	unsigned int count = substepCount;
+
+	if (adaptiveSubsteps.enabled && substepStats.substepCount > 0) {
+		unsigned int maxCount = std::max(adaptiveSubsteps.maxSubstepCount, 1u);
+		if (adaptiveSubsteps.frameBudget > 0.0f && computeTime > 0.0f) {
+			float fitting = adaptiveSubsteps.frameBudget * substepStats.substepCount / computeTime;
+			maxCount = (unsigned int)std::min((float)maxCount, std::max(1.0f, fitting));
+		}
+
+		// Displacements scale with the deltaTime they were taken over, this is the fastest particle's speed in cells per second
+		float speed = substepStats.maxDisplacement / substepStats.deltaTime;
+		float needed = std::ceil(frameTime * speed / std::max(adaptiveSubsteps.targetCfl, 1e-3f));
+		unsigned int required = (unsigned int)std::min((float)maxCount, std::max(1.0f, needed));
+
+		count = substepStats.substepCount;
+		if (required >= count) {
+			count = required;
+			framesBelowSubstepCount = 0;
+		}
+		else if (++framesBelowSubstepCount >= adaptiveSubsteps.hysteresisFrames) {
+			count--;
+			framesBelowSubstepCount = 0;
+		}
+		count = std::min(count, maxCount);
+	}
+
+	float deltaTime = frameTime / count;
+	// Applied to the carried displacements on the first substep
+	constants.displacementScale = deltaTime / constants.deltaTime;
+	constants.deltaTime = deltaTime;
+	substepStats.substepCount = count;
+	substepStats.deltaTime = deltaTime;
+}
+
 void PBMPMScene::resetBuffers(bool resetGrids) {
 	//clear buffers (Make sure each one is a UAV)
 	constexpr UINT THREAD_GROUP_SIZE = 256;
@@ -121,10 +184,6 @@ void PBMPMScene::resetBuffers(bool resetGrids) {
 	bufferClearPipeline.getCommandList()->SetPipelineState(bufferClearPipeline.getPSO());
 	bufferClearPipeline.getCommandList()->SetComputeRootSignature(bufferClearPipeline.getRootSignature());
 
-	// Bind the descriptor heap
-	ID3D12DescriptorHeap* descriptorHeaps[] = { g2p2gPipeline.getDescriptorHeap()->Get() };
-	bufferClearPipeline.getCommandList()->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
 	// Reset CountBuffer:
 	UINT countSize = bukkitSystem.count; // The total number of elements in the buffer
 	bufferClearPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 1, &countSize, 0);
@@ -154,6 +213,12 @@ void PBMPMScene::resetBuffers(bool resetGrids) {
 	bufferClearPipeline.getCommandList()->SetComputeRootDescriptorTable(1, bukkitSystem.particleAllocator.getUAVGPUDescriptorHandle());
 	bufferClearPipeline.getCommandList()->Dispatch((particleAllocatorSize + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
 
+	// Reset the iteration residuals, this runs before every substep
+	UINT residualSize = MaxIterationCount;
+	bufferClearPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 1, &residualSize, 0);
+	bufferClearPipeline.getCommandList()->SetComputeRootDescriptorTable(1, iterationResidualBuffer.getUAVGPUDescriptorHandle());
+	bufferClearPipeline.getCommandList()->Dispatch((residualSize + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
+
 	// Transition dispatch buffer to a copy destination
 	D3D12_RESOURCE_BARRIER dispatchBarrier = CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.dispatch.getBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
 	bufferClearPipeline.getCommandList()->ResourceBarrier(1, &dispatchBarrier);
@@ -174,6 +239,20 @@ void PBMPMScene::resetBuffers(bool resetGrids) {
 			bufferClearPipeline.getCommandList()->Dispatch((numGridInts + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
 		}
 
+		if (wakeAllBukkits) {
+			UINT sleepSize = bukkitSystem.count * BukkitSleepStride;
+			bufferClearPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 1, &sleepSize, 0);
+			bufferClearPipeline.getCommandList()->SetComputeRootDescriptorTable(1, bukkitSystem.sleep.getUAVGPUDescriptorHandle());
+			bufferClearPipeline.getCommandList()->Dispatch((sleepSize + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
+
+			// Nothing is asleep any more
+			UINT numSleepingGridInts = constants.gridSize.x * constants.gridSize.y * constants.gridSize.z * 5;
+			bufferClearPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 1, &numSleepingGridInts, 0);
+			bufferClearPipeline.getCommandList()->SetComputeRootDescriptorTable(1, sleepingGrid.getUAVGPUDescriptorHandle());
+			bufferClearPipeline.getCommandList()->Dispatch((numSleepingGridInts + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
+			wakeAllBukkits = false;
+		}
+
 		// Also reset IndexStart at the beginning of each substep
 		bufferClearPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 1, &countSize, 0);
 		bufferClearPipeline.getCommandList()->SetComputeRootDescriptorTable(1, bukkitSystem.indexStart.getUAVGPUDescriptorHandle());
@@ -192,7 +271,23 @@ void PBMPMScene::resetBuffers(bool resetGrids) {
 	context->resetCommandList(bukkitInsertPipeline.getCommandListID());
 }
 
-void PBMPMScene::doEmission(StructuredBuffer* gridBuffer, MouseConstants& mc) {
+D3D12_GPU_VIRTUAL_ADDRESS PBMPMScene::uploadShapes() {
+	// Shapes are re-uploaded every frame so they can be edited without rebuilding the scene
+	constants.shapeCount = (unsigned int)std::min(shapes.size(), (size_t)MaxSimShapes);
+
+	UploadAllocation shapeAllocation = uploadRing.allocate(MaxSimShapes * sizeof(SimShape));
+	memset(shapeAllocation.cpuAddress, 0, MaxSimShapes * sizeof(SimShape));
+	memcpy(shapeAllocation.cpuAddress, shapes.data(), constants.shapeCount * sizeof(SimShape));
+
+	// A moved or changed collider can push on particles at rest, so everything wakes up
+	if (uploadedShapes.size() != shapes.size() || memcmp(uploadedShapes.data(), shapes.data(), shapes.size() * sizeof(SimShape)) != 0) {
+		uploadedShapes = shapes;
+		wakeAllBukkits = true;
+	}
+	return shapeAllocation.gpuAddress;
+}
+
+void PBMPMScene::doEmission(StructuredBuffer* gridBuffer, D3D12_GPU_VIRTUAL_ADDRESS mouseConstantsAddress, D3D12_GPU_VIRTUAL_ADDRESS shapesAddress) {
 	unsigned int threadGroupCountX = (unsigned int)std::floor((constants.gridSize.x + GridDispatchSize - 1) / GridDispatchSize);
 	unsigned int threadGroupCountY = (unsigned int)std::floor((constants.gridSize.y + GridDispatchSize - 1) / GridDispatchSize);
 	unsigned int threadGroupCountZ = (unsigned int)std::floor((constants.gridSize.z + GridDispatchSize - 1) / GridDispatchSize);
@@ -204,9 +299,6 @@ void PBMPMScene::doEmission(StructuredBuffer* gridBuffer, MouseConstants& mc) {
 	emissionCmd->SetPipelineState(emissionPipeline.getPSO());
 	emissionCmd->SetComputeRootSignature(emissionPipeline.getRootSignature());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { g2p2gPipeline.getDescriptorHeap()->Get() };
-	emissionCmd->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
 	// Transition current grid to SRV
 	D3D12_RESOURCE_BARRIER gridBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(gridBuffer->getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	emissionCmd->ResourceBarrier(1, &gridBufferBarrier);
@@ -216,9 +308,9 @@ void PBMPMScene::doEmission(StructuredBuffer* gridBuffer, MouseConstants& mc) {
 	emissionCmd->ResourceBarrier(1, &massVolumeBufferBarrier);
 
 	// Set Root Descriptors
-	emissionCmd->SetComputeRoot32BitConstants(0, 22, &constants, 0);
-	emissionCmd->SetComputeRoot32BitConstants(1, 12, &mc, 0);
-	emissionCmd->SetComputeRootConstantBufferView(2, shapeBuffer.getGPUVirtualAddress());
+	emissionCmd->SetComputeRootConstantBufferView(0, uploadRing.push(constants));
+	emissionCmd->SetComputeRootConstantBufferView(1, mouseConstantsAddress);
+	emissionCmd->SetComputeRootConstantBufferView(2, shapesAddress);
 	emissionCmd->SetComputeRootDescriptorTable(3, particleBuffer.getUAVGPUDescriptorHandle());
 	emissionCmd->SetComputeRootDescriptorTable(4, gridBuffer->getSRVGPUDescriptorHandle());
 	emissionCmd->SetComputeRootDescriptorTable(5, positionBuffer.getUAVGPUDescriptorHandle());
@@ -239,8 +331,6 @@ void PBMPMScene::doEmission(StructuredBuffer* gridBuffer, MouseConstants& mc) {
 	indirectCmd->SetPipelineState(setIndirectArgsPipeline.getPSO());
 	indirectCmd->SetComputeRootSignature(setIndirectArgsPipeline.getRootSignature());
 
-	indirectCmd->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
 	// Transition Particle Count to SRV
 	D3D12_RESOURCE_BARRIER particleCountBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(particleCount.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	indirectCmd->ResourceBarrier(1, &particleCountBufferBarrier);
@@ -260,7 +350,93 @@ void PBMPMScene::doEmission(StructuredBuffer* gridBuffer, MouseConstants& mc) {
 	context->resetCommandList(setIndirectArgsPipeline.getCommandListID());
 }
 
-void PBMPMScene::bukkitizeParticles() {
+void PBMPMScene::updateBukkitSleep(D3D12_GPU_VIRTUAL_ADDRESS mouseConstantsAddress) {
+	auto cmdList = bukkitSleepPipeline.getCommandList();
+
+	// Runs while sleeping is off as well, which holds every bukkit's rest count at 0
+	cmdList->SetPipelineState(bukkitSleepPipeline.getPSO());
+	cmdList->SetComputeRootSignature(bukkitSleepPipeline.getRootSignature());
+
+	D3D12_RESOURCE_BARRIER bukkitCountBarrier = CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.countBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	cmdList->ResourceBarrier(1, &bukkitCountBarrier);
+
+	cmdList->SetComputeRoot32BitConstants(0, 36, &constants, 0);
+	cmdList->SetComputeRootConstantBufferView(1, mouseConstantsAddress);
+	cmdList->SetComputeRootDescriptorTable(2, bukkitSystem.countBuffer.getSRVGPUDescriptorHandle());
+	cmdList->SetComputeRootDescriptorTable(3, bukkitSystem.sleep.getUAVGPUDescriptorHandle());
+
+	cmdList->Dispatch((bukkitSystem.countX + GridDispatchSize - 1) / GridDispatchSize,
+		(bukkitSystem.countY + GridDispatchSize - 1) / GridDispatchSize,
+		(bukkitSystem.countZ + GridDispatchSize - 1) / GridDispatchSize);
+
+	bukkitCountBarrier = CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.countBuffer.getBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	cmdList->ResourceBarrier(1, &bukkitCountBarrier);
+
+	context->executeCommandList(bukkitSleepPipeline.getCommandListID());
+	context->signalAndWaitForFence(fence, fenceValue);
+	context->resetCommandList(bukkitSleepPipeline.getCommandListID());
+}
+
+void PBMPMScene::buildSleepingGrid() {
+	constexpr UINT THREAD_GROUP_SIZE = 256;
+
+	// Cleared once more after sleeping and multi-rate stepping are turned off, then left alone
+	bool freezing = constants.sleepSubstepCount > 0 || constants.rateLevelCount > 1;
+	if (!freezing && !sleepingGridInUse) {
+		return;
+	}
+	sleepingGridInUse = freezing;
+
+	auto cmdList = sleepingGridPipeline.getCommandList();
+
+	UINT numGridInts = constants.gridSize.x * constants.gridSize.y * constants.gridSize.z * 5;
+	cmdList->SetPipelineState(bufferClearPipeline.getPSO());
+	cmdList->SetComputeRootSignature(bufferClearPipeline.getRootSignature());
+	cmdList->SetComputeRoot32BitConstants(0, 1, &numGridInts, 0);
+	cmdList->SetComputeRootDescriptorTable(1, sleepingGrid.getUAVGPUDescriptorHandle());
+	cmdList->Dispatch((numGridInts + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1);
+
+	if (freezing) {
+		auto clearBarrier = CD3DX12_RESOURCE_BARRIER::UAV(sleepingGrid.getBuffer());
+		cmdList->ResourceBarrier(1, &clearBarrier);
+
+		cmdList->SetPipelineState(sleepingGridPipeline.getPSO());
+		cmdList->SetComputeRootSignature(sleepingGridPipeline.getRootSignature());
+
+		D3D12_RESOURCE_BARRIER barriers[] = {
+			CD3DX12_RESOURCE_BARRIER::Transition(particleBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(particleCount.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(positionBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(massVolumeBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.sleep.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(displacementBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(particleSimDispatch.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT)
+		};
+		cmdList->ResourceBarrier(_countof(barriers), barriers);
+
+		cmdList->SetComputeRoot32BitConstants(0, 36, &constants, 0);
+		cmdList->SetComputeRootDescriptorTable(1, particleBuffer.getSRVGPUDescriptorHandle());
+		cmdList->SetComputeRootDescriptorTable(2, positionBuffer.getSRVGPUDescriptorHandle());
+		cmdList->SetComputeRootDescriptorTable(3, massVolumeBuffer.getSRVGPUDescriptorHandle());
+		cmdList->SetComputeRootDescriptorTable(4, bukkitSystem.sleep.getSRVGPUDescriptorHandle());
+		cmdList->SetComputeRootDescriptorTable(5, sleepingGrid.getUAVGPUDescriptorHandle());
+		cmdList->SetComputeRootDescriptorTable(6, displacementBuffer.getSRVGPUDescriptorHandle());
+
+		// One thread per live particle, most return straight away
+		cmdList->ExecuteIndirect(commandSignature, 1, particleSimDispatch.getBuffer(), 0, nullptr, 0);
+
+		for (D3D12_RESOURCE_BARRIER& barrier : barriers) {
+			std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+		}
+		cmdList->ResourceBarrier(_countof(barriers), barriers);
+	}
+
+	context->executeCommandList(sleepingGridPipeline.getCommandListID());
+	context->signalAndWaitForFence(fence, fenceValue);
+	context->resetCommandList(sleepingGridPipeline.getCommandListID());
+}
+
+void PBMPMScene::bukkitizeParticles(D3D12_GPU_VIRTUAL_ADDRESS mouseConstantsAddress, StatsReadback* stats) {
 	
 	// Reset Buffers, but not the grid
 	resetBuffers(false);
@@ -269,10 +445,6 @@ void PBMPMScene::bukkitizeParticles() {
 	bukkitCountPipeline.getCommandList()->SetPipelineState(bukkitCountPipeline.getPSO());
 	bukkitCountPipeline.getCommandList()->SetComputeRootSignature(bukkitCountPipeline.getRootSignature());
 
-	// Bind the descriptor heap
-	ID3D12DescriptorHeap* descriptorHeaps[] = { g2p2gPipeline.getDescriptorHeap()->Get() };
-	bukkitCountPipeline.getCommandList()->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
 	// Transition particle buffer to srv
 	D3D12_RESOURCE_BARRIER particleBufferBarrier = CD3DX12_RESOURCE_BARRIER::Transition(particleBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	bukkitCountPipeline.getCommandList()->ResourceBarrier(1, &particleBufferBarrier);
@@ -303,6 +475,8 @@ void PBMPMScene::bukkitizeParticles() {
 
 	// Reset the command lists
 	context->resetCommandList(bukkitCountPipeline.getCommandListID());
+
+	updateBukkitSleep(mouseConstantsAddress);
 	
 	auto bukkitDispatchSizeX = std::floor((bukkitSystem.countX + GridDispatchSize - 1) / GridDispatchSize);
 	auto bukkitDispatchSizeY = std::floor((bukkitSystem.countY + GridDispatchSize - 1) / GridDispatchSize);
@@ -312,17 +486,15 @@ void PBMPMScene::bukkitizeParticles() {
 	bukkitAllocatePipeline.getCommandList()->SetPipelineState(bukkitAllocatePipeline.getPSO());
 	bukkitAllocatePipeline.getCommandList()->SetComputeRootSignature(bukkitAllocatePipeline.getRootSignature());
 
-	// Bind the descriptor heap
-	bukkitAllocatePipeline.getCommandList()->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
 	// Transition bukkitCount to srv
 	D3D12_RESOURCE_BARRIER bukkitCountBarrier = CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.countBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	bukkitAllocatePipeline.getCommandList()->ResourceBarrier(1, &bukkitCountBarrier);
 
 	// Properly set the Descriptors & Resource Transitions
-	bukkitAllocatePipeline.getCommandList()->SetComputeRoot32BitConstants(0, 34, &constants, 0);
+	bukkitAllocatePipeline.getCommandList()->SetComputeRoot32BitConstants(0, 36, &constants, 0);
 	bukkitAllocatePipeline.getCommandList()->SetComputeRootDescriptorTable(1, bukkitSystem.countBuffer.getSRVGPUDescriptorHandle());
 	bukkitAllocatePipeline.getCommandList()->SetComputeRootDescriptorTable(2, bukkitSystem.threadData.getUAVGPUDescriptorHandle());
+	bukkitAllocatePipeline.getCommandList()->SetComputeRootDescriptorTable(3, bukkitSystem.sleep.getUAVGPUDescriptorHandle());
 
 	//dispatch directly
 	bukkitAllocatePipeline.getCommandList()->Dispatch((UINT)bukkitDispatchSizeX, (UINT)bukkitDispatchSizeY, (UINT)bukkitDispatchSizeZ);
@@ -344,9 +516,6 @@ void PBMPMScene::bukkitizeParticles() {
 	bukkitInsertPipeline.getCommandList()->SetPipelineState(bukkitInsertPipeline.getPSO());
 	bukkitInsertPipeline.getCommandList()->SetComputeRootSignature(bukkitInsertPipeline.getRootSignature());
 
-	// Bind the descriptor heap
-	bukkitInsertPipeline.getCommandList()->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
 	// Transition particleCount, and indexStart to SRV
 	D3D12_RESOURCE_BARRIER particleCountBarrier = CD3DX12_RESOURCE_BARRIER::Transition(particleCount.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	D3D12_RESOURCE_BARRIER indexStartBarrier = CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.indexStart.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
@@ -358,11 +527,12 @@ void PBMPMScene::bukkitizeParticles() {
 	bukkitInsertPipeline.getCommandList()->ResourceBarrier(2, barriers);
 
 	// Properly set the Descriptors
-	bukkitInsertPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 34, &constants, 0);
+	bukkitInsertPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 36, &constants, 0);
 	bukkitInsertPipeline.getCommandList()->SetComputeRootDescriptorTable(1, particleBuffer.getSRVGPUDescriptorHandle());
 	bukkitInsertPipeline.getCommandList()->SetComputeRootDescriptorTable(2, bukkitSystem.countBuffer2.getUAVGPUDescriptorHandle());
 	bukkitInsertPipeline.getCommandList()->SetComputeRootDescriptorTable(3, bukkitSystem.indexStart.getSRVGPUDescriptorHandle());
 	bukkitInsertPipeline.getCommandList()->SetComputeRootDescriptorTable(4, positionBuffer.getSRVGPUDescriptorHandle());
+	bukkitInsertPipeline.getCommandList()->SetComputeRootDescriptorTable(5, bukkitSystem.sleep.getUAVGPUDescriptorHandle());
 
 	// Dispatch indirectly again
 	bukkitInsertPipeline.getCommandList()->ExecuteIndirect(commandSignature, 1, particleSimDispatch.getBuffer(), 0, nullptr, 0);
@@ -381,6 +551,10 @@ void PBMPMScene::bukkitizeParticles() {
 	// Transition the resources
 	bukkitInsertPipeline.getCommandList()->ResourceBarrier(5, barriersEnd);
 
+	if (stats) {
+		recordStats(bukkitInsertPipeline.getCommandList(), stats);
+	}
+
 	// execute
 	context->executeCommandList(bukkitInsertPipeline.getCommandListID());
 
@@ -449,47 +623,41 @@ void PBMPMScene::createShapes() {
 }
 
 void PBMPMScene::constructScene() {
-	auto computeId = g2p2gPipeline.getCommandListID();
-	
-	constants = { {GRID_WIDTH, GRID_HEIGHT, GRID_DEPTH}, 0.01f, 2.5f, 0.2f, 0.01f,
+	constants = { {GRID_WIDTH, GRID_HEIGHT, GRID_DEPTH}, BaseDeltaTime, 2.5f, 0.2f, 0.01f,
 		(unsigned int)std::ceil(std::pow(10, 7)),
-		1, 3, 30, 5, 0, 0, 0, 0, 0, 0, 5, 0.25f, 2.3f, 1.2f, 1.5f, 0.5f,
+		1, 3, 30, 5, 0, 0, 0, 0, 0, 0, 5, 0.25f, 2.3f, 1.2f, 1.5f, 0.5f, 1.0f,
+		// Sleep Defaults
+		0, 0.5f,
+		// Rate Defaults
+		1, 0.25f,
 		// Mouse Defaults
 		{0, 0, 0, 0}, {0, 0, 0, 0}, 0, 4, 0, 10, 
+		// Convergence Defaults
+		1e-4f, 3,
 	};
 	
 	// Create Vertex & Index Buffer
 	auto sphereData = generateSphere(PARTICLE_RADIUS, 4, 4);
 	indexCount = (unsigned int)sphereData.second.size();
 
-	std::vector<XMFLOAT4> positions;
-	positions.resize(maxParticles);
+	// Particle buffers start out empty, passing no data makes them get cleared on the GPU instead of uploaded
 	// Create a buffer for the position and liquid density stored in the fourth component for alignment
-	positionBuffer = StructuredBuffer(positions.data(), (unsigned int)positions.size(), sizeof(XMFLOAT4));
+	positionBuffer = StructuredBuffer(nullptr, maxParticles, sizeof(XMFLOAT4));
 
-	std::vector<XMINT4> materials;
-	materials.resize(maxParticles);
 	// Create a buffer for the color in the first three components and material enum stored in the fourth component.
-	materialBuffer = StructuredBuffer(materials.data(), (unsigned int)materials.size(), sizeof(XMINT4));
+	materialBuffer = StructuredBuffer(nullptr, maxParticles, sizeof(XMINT4));
 
 	// Create a buffer for the displacement and nothing (for now) stored in the fourth component for alignment
-	displacementBuffer = StructuredBuffer(positions.data(), (unsigned int)positions.size(), sizeof(XMFLOAT4));
+	displacementBuffer = StructuredBuffer(nullptr, maxParticles, sizeof(XMFLOAT4));
 
-	std::vector<XMFLOAT2> massVol;
-	massVol.resize(maxParticles);
-	massVolumeBuffer = StructuredBuffer(massVol.data(), (unsigned int)massVol.size(), sizeof(XMFLOAT2));
+	massVolumeBuffer = StructuredBuffer(nullptr, maxParticles, sizeof(XMFLOAT2));
 
-	std::vector<PBMPMParticle> particles;
-	particles.resize(maxParticles);
-	particleBuffer = StructuredBuffer(particles.data(), (unsigned int)particles.size(), sizeof(PBMPMParticle));
-	
-	std::vector<int> freeIndices;
-	freeIndices.resize(1 + maxParticles); //maybe four maybe one idk
+	particleBuffer = StructuredBuffer(nullptr, maxParticles, sizeof(PBMPMParticle));
 
 	XMUINT4 count = { 0, 0, 0, 0 };
 
 	particleCount = StructuredBuffer(&count, 1, sizeof(XMUINT4));
-	particleFreeIndicesBuffer = StructuredBuffer(freeIndices.data(), (unsigned int)freeIndices.size(), sizeof(int));
+	particleFreeIndicesBuffer = StructuredBuffer(nullptr, 1 + maxParticles, sizeof(int)); //maybe four maybe one idk
 	
 	// Set it based on instance size
 	XMUINT4 simDispatch = {0, 1, 1, 0};
@@ -507,41 +675,38 @@ void PBMPMScene::constructScene() {
 	// Create Shapes
 	createShapes();
 
-	shapeBuffer = StructuredBuffer(shapes.data(), (unsigned int)shapes.size(), sizeof(SimShape));
+	uploadRing = UploadRing(context, uploadRingSize);
 
 	//Temp tile data buffer
-	std::vector<int> tempTileData;
-	tempTileData.resize(1000000000);
-	tempTileDataBuffer = StructuredBuffer(tempTileData.data(), (unsigned int)tempTileData.size(), sizeof(int));
+	tempTileDataBuffer = StructuredBuffer(nullptr, 1000000000, sizeof(int));
 
-	// Pass Structured Buffers to Compute Pipeline
-	positionBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	materialBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	displacementBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	massVolumeBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	particleBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	particleFreeIndicesBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	particleCount.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	particleSimDispatch.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	renderDispatchBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
-	shapeBuffer.passCBVDataToGPU(*context, g2p2gPipeline.getDescriptorHeap());
-	tempTileDataBuffer.passDataToGPU(*context, g2p2gPipeline.getCommandList(), computeId);
+	iterationResidualBuffer = StructuredBuffer(nullptr, MaxIterationCount, sizeof(UINT));
+	createResidualReadback();
 
-	// Create UAV's for each buffer
-	positionBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
-	materialBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
-	displacementBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
+	// Pass Structured Buffers to Compute Pipeline
+	positionBuffer.passDataToGPU(*context);
+	materialBuffer.passDataToGPU(*context);
+	displacementBuffer.passDataToGPU(*context);
+	massVolumeBuffer.passDataToGPU(*context);
+	particleBuffer.passDataToGPU(*context);
+	particleFreeIndicesBuffer.passDataToGPU(*context);
+	particleCount.passDataToGPU(*context);
+	particleSimDispatch.passDataToGPU(*context);
+	renderDispatchBuffer.passDataToGPU(*context);
+	tempTileDataBuffer.passDataToGPU(*context);
+	iterationResidualBuffer.passDataToGPU(*context);
+
+	// Create UAV's for each buffer, g2p2g and emission bind the first two groups as descriptor tables
+	StructuredBuffer::createUAVTable(*context, g2p2gPipeline.getDescriptorHeap(), { &positionBuffer, &materialBuffer, &displacementBuffer });
+	StructuredBuffer::createUAVTable(*context, g2p2gPipeline.getDescriptorHeap(), { &particleBuffer, &particleFreeIndicesBuffer, &particleCount });
 	massVolumeBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
-	particleBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
-	particleFreeIndicesBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
-	particleCount.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 	particleSimDispatch.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 	renderDispatchBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 	tempTileDataBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
+	iterationResidualBuffer.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 
 	// Create SRV's for particleBuffer & particleCount
-	positionBuffer.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
-	materialBuffer.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
+	StructuredBuffer::createSRVTable(*context, g2p2gPipeline.getDescriptorHeap(), { &positionBuffer, &materialBuffer });
 	displacementBuffer.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 	massVolumeBuffer.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 	particleBuffer.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
@@ -551,19 +716,22 @@ void PBMPMScene::constructScene() {
 	bukkitSystem = BukkitSystem{};
 	createBukkitSystem();
 
-	std::vector<int> gridBufferData;
-	gridBufferData.resize(constants.gridSize.x * constants.gridSize.y * constants.gridSize.z * 5); //LOOK : 4 or 5?
+	unsigned int gridBufferSize = constants.gridSize.x * constants.gridSize.y * constants.gridSize.z * 5; //LOOK : 4 or 5?
 
 	for (int i = 0; i < 3; i++) {
-		gridBuffers[i] = StructuredBuffer(gridBufferData.data(), (unsigned int)gridBufferData.size(), sizeof(int));
-		gridBuffers[i].passDataToGPU(*context, g2p2gPipeline.getCommandList(), g2p2gPipeline.getCommandListID());
+		gridBuffers[i] = StructuredBuffer(nullptr, gridBufferSize, sizeof(int));
+		gridBuffers[i].passDataToGPU(*context);
 		gridBuffers[i].createUAV(*context, g2p2gPipeline.getDescriptorHeap());
 	}
-	// Separate UAV and SRV creation on the descriptor heap to allow contigious access
 	gridBuffers[0].createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 	gridBuffers[1].createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 	gridBuffers[2].createSRV(*context, g2p2gPipeline.getDescriptorHeap());
 
+	sleepingGrid = StructuredBuffer(nullptr, gridBufferSize, sizeof(int));
+	sleepingGrid.passDataToGPU(*context);
+	sleepingGrid.createUAV(*context, g2p2gPipeline.getDescriptorHeap());
+	sleepingGrid.createSRV(*context, g2p2gPipeline.getDescriptorHeap());
+
 	// Create Vertex & Index Buffer
 	vertexBuffer = VertexBuffer(sphereData.first, (UINT)(sphereData.first.size() * sizeof(XMFLOAT3)), (UINT)sizeof(XMFLOAT3));
 	vbv = vertexBuffer.passVertexDataToGPU(*context, renderPipeline->getCommandList());
@@ -627,7 +795,7 @@ void PBMPMScene::constructScene() {
 	context->getDevice()->CreateCommandSignature(&renderCmdSigDesc, nullptr, IID_PPV_ARGS(&renderCommandSignature));
 }
 
-void PBMPMScene::compute() {
+void PBMPMScene::compute(StatsReadback* stats) {
 	/*auto now = std::chrono::system_clock::now();
 	auto duration = now.time_since_epoch();
 	startTime += (unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();*/
@@ -636,25 +804,45 @@ void PBMPMScene::compute() {
 	MouseConstants mouseConstants = { constants.mousePosition, constants.mouseRayDirection,
 		constants.mouseActivation, constants.mouseRadius, constants.mouseFunction, constants.mouseStrength };
 
-	int bufferIdx = 0;
-	
+	D3D12_GPU_VIRTUAL_ADDRESS mouseConstantsAddress = uploadRing.push(mouseConstants);
+	D3D12_GPU_VIRTUAL_ADDRESS shapesAddress = uploadShapes();
+
 	resetBuffers(true);
 
-	for (unsigned int substepIdx = 0; substepIdx < substepCount; substepIdx++) {
+	chooseSubsteps();
+	auto computeStart = std::chrono::steady_clock::now();
+	float maxDisplacement = 0.0f;
+
+	// The rotation carries over between substeps so every iteration accumulates into the grid the one before cleared,
+	// whatever number of iterations ran
+	StructuredBuffer* currentGrid = &gridBuffers[0];
+	StructuredBuffer* nextGrid = &gridBuffers[1];
+	StructuredBuffer* nextNextGrid = &gridBuffers[2];
+
+	unsigned int totalIterations = 0;
+	for (unsigned int substepIdx = 0; substepIdx < substepStats.substepCount; substepIdx++) {
 
 		// Update simulation uniforms
 		constants.iteration = 0;
 		updateSimUniforms(0);
-		
-		StructuredBuffer* currentGrid = &gridBuffers[0];
-		StructuredBuffer* nextGrid = &gridBuffers[1];
-		StructuredBuffer* nextNextGrid = &gridBuffers[2];
 
-		for (unsigned int iterationIdx = 0; iterationIdx < constants.iterationCount; iterationIdx++) {
+		// Lowered once the particles settle. The shader integrates on the last iteration, so it is told the count in effect
+		unsigned int iterationCount = std::min(constants.iterationCount, MaxIterationCount);
+
+		for (unsigned int iterationIdx = 0; iterationIdx < iterationCount; iterationIdx++) {
 			constants.iteration = iterationIdx;
 
 			updateSimUniforms(iterationIdx);
 
+			PBMPMConstants iterationConstants = constants;
+			iterationConstants.iterationCount = iterationCount;
+
+			// Iteration 0 has no residual, it doesn't gather from the grid. Stopping after this one still leaves an
+			// iteration to integrate, and the residual is only worth reading when that ends the substep sooner
+			bool mayConverge = constants.convergenceTolerance > 0.0f && iterationIdx > 0 &&
+				iterationIdx + 2 < iterationCount && iterationIdx + 2 >= constants.minIterationCount;
+			bool integrates = iterationIdx == iterationCount - 1;
+
 			std::swap(currentGrid, nextGrid);
 			std::swap(nextGrid, nextNextGrid);
 
@@ -663,7 +851,8 @@ void PBMPMScene::compute() {
 			D3D12_RESOURCE_BARRIER barriers[] = {
 			CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.particleData.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
 			CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.threadData.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
-			CD3DX12_RESOURCE_BARRIER::Transition(massVolumeBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
+			CD3DX12_RESOURCE_BARRIER::Transition(massVolumeBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+			CD3DX12_RESOURCE_BARRIER::Transition(sleepingGrid.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
 			};
 			cmdList->ResourceBarrier(_countof(barriers), barriers);
 
@@ -674,12 +863,9 @@ void PBMPMScene::compute() {
 			cmdList->SetPipelineState(g2p2gPipeline.getPSO());
 			cmdList->SetComputeRootSignature(g2p2gPipeline.getRootSignature());
 
-			g2p2gPipeline.getCommandList()->SetComputeRoot32BitConstants(0, 24, &constants, 0);
-			g2p2gPipeline.getCommandList()->SetComputeRoot32BitConstants(1, 12, &mouseConstants, 0);
-			g2p2gPipeline.getCommandList()->SetComputeRootConstantBufferView(2, shapeBuffer.getGPUVirtualAddress());
-
-			ID3D12DescriptorHeap* computeDescriptorHeaps[] = { g2p2gPipeline.getDescriptorHeap()->Get() };
-			cmdList->SetDescriptorHeaps(_countof(computeDescriptorHeaps), computeDescriptorHeaps);
+			cmdList->SetComputeRootConstantBufferView(0, uploadRing.push(iterationConstants));
+			cmdList->SetComputeRootConstantBufferView(1, mouseConstantsAddress);
+			cmdList->SetComputeRootConstantBufferView(2, shapesAddress);
 
 			cmdList->SetComputeRootDescriptorTable(3, particleBuffer.getUAVGPUDescriptorHandle());
 			cmdList->SetComputeRootDescriptorTable(4, bukkitSystem.particleData.getSRVGPUDescriptorHandle());
@@ -689,6 +875,9 @@ void PBMPMScene::compute() {
 			cmdList->SetComputeRootDescriptorTable(8, tempTileDataBuffer.getUAVGPUDescriptorHandle());
 			cmdList->SetComputeRootDescriptorTable(9, positionBuffer.getUAVGPUDescriptorHandle());
 			cmdList->SetComputeRootDescriptorTable(10, massVolumeBuffer.getSRVGPUDescriptorHandle());
+			cmdList->SetComputeRootDescriptorTable(11, iterationResidualBuffer.getUAVGPUDescriptorHandle());
+			cmdList->SetComputeRootDescriptorTable(12, sleepingGrid.getSRVGPUDescriptorHandle());
+			cmdList->SetComputeRootDescriptorTable(13, bukkitSystem.sleep.getUAVGPUDescriptorHandle());
 
 			// Transition dispatch buffer to an indirect argument
 			auto dispatchBarrier = CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.dispatch.getBuffer(),
@@ -711,22 +900,59 @@ void PBMPMScene::compute() {
 			// Transition particleData and threadData to UAV
 			D3D12_RESOURCE_BARRIER endBarriers[] = {
 				CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.particleData.getBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
-				CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.threadData.getBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+				CD3DX12_RESOURCE_BARRIER::Transition(bukkitSystem.threadData.getBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+				CD3DX12_RESOURCE_BARRIER::Transition(sleepingGrid.getBuffer(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
 			};
 			cmdList->ResourceBarrier(_countof(endBarriers), endBarriers);
 
+			if (mayConverge || integrates) {
+				auto residualBarrier = CD3DX12_RESOURCE_BARRIER::Transition(iterationResidualBuffer.getBuffer(),
+					D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+				cmdList->ResourceBarrier(1, &residualBarrier);
+
+				if (mayConverge) {
+					cmdList->CopyBufferRegion(residualReadback.Get(), 0, iterationResidualBuffer.getBuffer(), iterationIdx * sizeof(UINT), sizeof(UINT));
+				}
+				else {
+					cmdList->CopyBufferRegion(residualReadback.Get(), sizeof(float), iterationResidualBuffer.getBuffer(), 0, sizeof(UINT));
+				}
+
+				residualBarrier = CD3DX12_RESOURCE_BARRIER::Transition(iterationResidualBuffer.getBuffer(),
+					D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+				cmdList->ResourceBarrier(1, &residualBarrier);
+			}
+
 			// Execute command list
 			context->executeCommandList(g2p2gPipeline.getCommandListID());
 			context->signalAndWaitForFence(fence, fenceValue);
 
 			// Reinitialize command list
 			context->resetCommandList(g2p2gPipeline.getCommandListID());
+
+			// The wait above was already there, reading the residual doesn't add a stall
+			if (mayConverge && residualReadbackData[0] < constants.convergenceTolerance) {
+				iterationCount = iterationIdx + 2;
+			}
+			if (integrates) {
+				maxDisplacement = std::max(maxDisplacement, residualReadbackData[1]);
+			}
 		}
-		doEmission(currentGrid, mouseConstants);
-		bukkitizeParticles();
+		totalIterations += iterationCount;
+
+		// Only the first substep carries displacements from the old deltaTime
+		constants.displacementScale = 1.0f;
+
+		doEmission(currentGrid, mouseConstantsAddress, shapesAddress);
+		bukkitizeParticles(mouseConstantsAddress, substepIdx == substepStats.substepCount - 1 ? stats : nullptr);
+		buildSleepingGrid();
 
 		substepIndex++;
 	}
+	substepStats.iterationsPerSubstep = (float)totalIterations / substepStats.substepCount;
+	substepStats.maxDisplacement = maxDisplacement;
+	computeTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - computeStart).count();
+
+	uploadRing.finishFrame();
 
 	//now = std::chrono::system_clock::now();
 	//duration = now.time_since_epoch();
@@ -763,8 +989,6 @@ void PBMPMScene::draw(Camera* cam) {
 	};
 	cmdList->ResourceBarrier(3, srvBarriers);
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { g2p2gPipeline.getDescriptorHeap()->Get()};
-	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 	auto viewMat = cam->getViewMat();
 	auto projMat = cam->getProjMat();
 	cmdList->SetGraphicsRoot32BitConstants(0, 16, &viewMat, 0);
@@ -800,6 +1024,8 @@ void PBMPMScene::releaseResources() {
 	bufferClearPipeline.releaseResources();
 	emissionPipeline.releaseResources();
 	setIndirectArgsPipeline.releaseResources();
+	bukkitSleepPipeline.releaseResources();
+	sleepingGridPipeline.releaseResources();
 
 	positionBuffer.releaseResources();
 	materialBuffer.releaseResources();
@@ -811,11 +1037,18 @@ void PBMPMScene::releaseResources() {
 	particleCount.releaseResources();
 	particleSimDispatch.releaseResources();
 	renderDispatchBuffer.releaseResources();
-	shapeBuffer.releaseResources();
+	uploadRing.releaseResources();
 	for (int i = 0; i < 3; i++) {
 		gridBuffers[i].releaseResources();
 	}
 	tempTileDataBuffer.releaseResources();
+	sleepingGrid.releaseResources();
+	iterationResidualBuffer.releaseResources();
+	if (residualReadback.Get() && residualReadbackData) {
+		residualReadback->Unmap(0, nullptr);
+		residualReadbackData = nullptr;
+	}
+	residualReadback.Release();
 
 	bukkitSystem.countBuffer.releaseResources();
 	bukkitSystem.countBuffer2.releaseResources();
@@ -825,6 +1058,7 @@ void PBMPMScene::releaseResources() {
 	bukkitSystem.blankDispatch.releaseResources();
 	bukkitSystem.particleAllocator.releaseResources();
 	bukkitSystem.indexStart.releaseResources();
+	bukkitSystem.sleep.releaseResources();
 
 	/*commandSignature->Release();
 	renderCommandSignature->Release();
@@ -843,7 +1077,13 @@ void PBMPMScene::updateConstants(PBMPMConstants& newConstants) {
 	constants.elasticRelaxation = newConstants.elasticRelaxation;
 	constants.elasticityRatio = newConstants.elasticityRatio;
 	constants.iterationCount = newConstants.iterationCount;
+	constants.minIterationCount = newConstants.minIterationCount;
+	constants.convergenceTolerance = newConstants.convergenceTolerance;
 	constants.sandRatio = newConstants.sandRatio;
+	constants.sleepSubstepCount = newConstants.sleepSubstepCount;
+	constants.sleepSpeed = newConstants.sleepSpeed;
+	constants.rateLevelCount = newConstants.rateLevelCount;
+	constants.rateDisplacement = newConstants.rateDisplacement;
 	constants.sandRelaxation = newConstants.sandRelaxation;
 
 	constants.mousePosition = newConstants.mousePosition;
@@ -868,21 +1108,24 @@ bool PBMPMScene::constantsEqual(PBMPMConstants& one, PBMPMConstants& two) {
 		one.sandRelaxation == two.sandRelaxation &&
 		one.sandRatio == two.sandRatio &&
 		one.iterationCount == two.iterationCount &&
+		one.minIterationCount == two.minIterationCount &&
+		one.convergenceTolerance == two.convergenceTolerance &&
+		one.sleepSubstepCount == two.sleepSubstepCount &&
+		one.sleepSpeed == two.sleepSpeed &&
+		one.rateLevelCount == two.rateLevelCount &&
+		one.rateDisplacement == two.rateDisplacement &&
 		one.mouseActivation == two.mouseActivation &&
 		one.mouseRadius == two.mouseRadius &&
 		one.mouseStrength == two.mouseStrength;
 }
 
-int PBMPMScene::transferAndGetNumParticles() {
-	XMINT4 count;
-	particleCount.copyDataFromGPU(
-		*context, 
-		&count,
-		g2p2gPipeline.getCommandList(),
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		g2p2gPipeline.getCommandListID()
-	);
-
-	numParticles = count.x;
-	return numParticles;
-}
\ No newline at end of file
+void PBMPMScene::recordStats(ID3D12GraphicsCommandList6* cmdList, StatsReadback* stats) {
+	// Everything is a UAV again at the end of bukkitizeParticles
+	stats->copyValue(cmdList, particleCount.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0, offsetof(SimulationStats, particleCount));
+	stats->copyValue(cmdList, particleFreeIndicesBuffer.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0, offsetof(SimulationStats, freeListSize));
+	// bukkitAllocate counts the non-empty bukkits in the otherwise unused w component
+	stats->copyValue(cmdList, bukkitSystem.dispatch.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 3 * sizeof(UINT), offsetof(SimulationStats, activeBukkits));
+	// and the asleep and waiting ones in the particle allocator's y and z
+	stats->copyValue(cmdList, bukkitSystem.particleAllocator.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, sizeof(UINT), offsetof(SimulationStats, sleepingBukkits));
+	stats->copyValue(cmdList, bukkitSystem.particleAllocator.getBuffer(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 2 * sizeof(UINT), offsetof(SimulationStats, waitingBukkits));
+}
@@ -5,8 +5,11 @@
 #include "../D3D/StructuredBuffer.h"
 #include "../D3D/VertexBuffer.h"
 #include "../D3D/IndexBuffer.h"
+#include "../D3D/UploadRing.h"
+#include "../D3D/StatsReadback.h"
 #include "../D3D/Pipeline/ComputePipeline.h"
 #include "Geometry.h"
+#include "SceneConstants.h"
 #include <iostream>
 #include <math.h>
 
@@ -15,11 +18,22 @@
 const unsigned int GridDispatchSize = 8;
 const unsigned int BukkitSize = 2;
 const unsigned int BukkitHaloSize = 1;
+// uints of sleep and rate state per bukkit
+const unsigned int BukkitSleepStride = 6;
+// Slowest rate level steps 2^(MaxRateLevelCount - 1) substeps at a time
+const unsigned int MaxRateLevelCount = 4;
 
 const float PARTICLE_RADIUS = 0.2f;
 
-const unsigned int maxParticles = 500000;
 const unsigned int maxTimestampCount = 2048;
+const unsigned int MaxSimShapes = 8;
+// Most iterations a substep can run, one residual slot each
+const unsigned int MaxIterationCount = 10;
+// Substep length at the default substep count, a frame always advances substepCount of these
+const float BaseDeltaTime = 0.01f;
+
+// Per-frame constants, mouse data and shapes are sub-allocated from here
+const unsigned int uploadRingSize = 1024 * 1024;
 
 struct PBMPMConstants {
 	// Actually 22 floats
@@ -50,6 +64,19 @@ struct PBMPMConstants {
 
 	float sandRelaxation;
 	float sandRatio;
+	// deltaTime over the last one, 1 except after it changes. Only for particles that haven't stepped yet, the others
+	// keep the time step of their displacement with it
+	float displacementScale;
+	// A bukkit sleeps once it and its neighbours have moved slower than sleepSpeed grid cells per second for
+	// sleepSubstepCount substeps in a row. Asleep bukkits aren't simulated, their particles' grid contribution is frozen.
+	// 0 keeps every bukkit awake
+	unsigned int sleepSubstepCount;
+	float sleepSpeed;
+	// Multi-rate stepping. A bukkit at rate level l takes one step of deltaTime * 2^l every 2^l substeps, and picks the
+	// slowest of rateLevelCount levels at which its particles move at most rateDisplacement grid cells a step.
+	// Neighbouring levels differ by at most one and meet through the grid. 1 steps every bukkit every substep
+	unsigned int rateLevelCount;
+	float rateDisplacement;
 
 	// Not passed to GPU as part of this struct
 	XMFLOAT4 mousePosition;
@@ -58,6 +85,34 @@ struct PBMPMConstants {
 	float mouseRadius;
 	unsigned int mouseFunction;
 	float mouseStrength;
+
+	// Also CPU only. A substep stops iterating once no particle's displacement changed by more than
+	// convergenceTolerance grid cells in an iteration, but never before minIterationCount iterations.
+	// iterationCount is the most it runs, a tolerance of 0 always runs all of them. An early stop leaves at least 3,
+	// iteration 0 only scatters and the iteration after the one that converged integrates
+	float convergenceTolerance;
+	unsigned int minIterationCount;
+};
+
+// Picks the substep count each frame so the fastest particle moves about targetCfl grid cells per substep.
+// The frame still advances substepCount * BaseDeltaTime, split into more or fewer, shorter or longer substeps
+struct AdaptiveSubsteps {
+	bool enabled = false;
+	float targetCfl = 0.5f;
+	unsigned int maxSubstepCount = 12;
+	// Milliseconds the simulation may take per frame, the count isn't raised past what fit in the last frame. 0 has no budget
+	float frameBudget = 0.0f;
+	// Frames in a row that fewer substeps would do before one is dropped. More are added straight away
+	unsigned int hysteresisFrames = 30;
+};
+
+// What the last compute ran
+struct SubstepStats {
+	unsigned int substepCount = 0;
+	float deltaTime = 0.0f;
+	float iterationsPerSubstep = 0.0f;
+	// Largest distance any particle moved in one substep, in grid cells
+	float maxDisplacement = 0.0f;
 };
 
 struct MouseConstants {
@@ -105,6 +160,8 @@ struct BukkitSystem {
 	StructuredBuffer blankDispatch;
 	StructuredBuffer particleAllocator;
 	StructuredBuffer indexStart;
+	// BukkitSleepStride uints per bukkit, laid out as in PBMPMCommon.hlsl
+	StructuredBuffer sleep;
 };
 
 struct BukkitThreadData {
@@ -121,7 +178,8 @@ public:
 
 	void constructScene();
 
-	void compute();
+	// Counters are copied into stats on the last substep when it is given
+	void compute(StatsReadback* stats = nullptr);
 
 	void draw(Camera* camera);
 
@@ -132,9 +190,10 @@ public:
 	static bool constantsEqual(PBMPMConstants& one, PBMPMConstants& two);
 
 	StructuredBuffer* getPositionBuffer() { return &positionBuffer; }
-
-	int transferAndGetNumParticles();
-	unsigned int getNumParticles() { return numParticles; }
+	// Live particle count in x, stays on the GPU
+	StructuredBuffer* getParticleCountBuffer() { return &particleCount; }
+	// Indirect dispatch covering every live particle with ParticleDispatchSize threads per group
+	StructuredBuffer* getParticleSimDispatch() { return &particleSimDispatch; }
 
 	PBMPMConstants getConstants() { return constants; }
 
@@ -142,6 +201,9 @@ public:
 
 	unsigned int* getSubstepCount() { return &substepCount; }
 
+	AdaptiveSubsteps* getAdaptiveSubsteps() { return &adaptiveSubsteps; }
+	const SubstepStats& getSubstepStats() { return substepStats; }
+
 private:
 	DXContext* context;
 	RenderPipeline* renderPipeline;
@@ -153,6 +215,8 @@ private:
 	ComputePipeline bufferClearPipeline;
 	ComputePipeline emissionPipeline;
 	ComputePipeline setIndirectArgsPipeline;
+	ComputePipeline bukkitSleepPipeline;
+	ComputePipeline sleepingGridPipeline;
 
 	PBMPMConstants constants;
 	BukkitSystem bukkitSystem;
@@ -182,22 +246,51 @@ private:
 	StructuredBuffer particleCount;
 	StructuredBuffer particleSimDispatch;
 	StructuredBuffer renderDispatchBuffer;
-	StructuredBuffer shapeBuffer;
 	StructuredBuffer tempTileDataBuffer;
 
+	// Largest change in particle displacement of each iteration of the current substep, as float bits.
+	// Iteration 0 has no residual, its slot holds the largest displacement of the substep instead
+	StructuredBuffer iterationResidualBuffer;
+	// A residual and the substep's largest displacement, read once the fence of the iteration that copied them has passed
+	ComPointer<ID3D12Resource1> residualReadback;
+	float* residualReadbackData = nullptr;
+
+	UploadRing uploadRing;
+
 	std::array<StructuredBuffer, 3> gridBuffers;
+	// What the particles of asleep and waiting bukkits scatter, rebuilt every substep while either is possible
+	StructuredBuffer sleepingGrid;
+	// Zeroes the sleep state, which wakes every bukkit. Set when shapes change and on the first frame
+	bool wakeAllBukkits = true;
+	// Sleeping or multi-rate stepping was on in the last substep, so the sleeping grid holds something
+	bool sleepingGridInUse = false;
 
 	std::vector<SimShape> shapes;
+	// As of the last upload, to notice when they change
+	std::vector<SimShape> uploadedShapes;
 
 	void createBukkitSystem();
 
 	void updateSimUniforms(unsigned int iteration);
 
+	void createResidualReadback();
+
+	// Sets the substep count and deltaTime of the next compute from the last one's displacements
+	void chooseSubsteps();
+
 	void resetBuffers(bool resetGrids = false);
 
-	void bukkitizeParticles();
+	void bukkitizeParticles(D3D12_GPU_VIRTUAL_ADDRESS mouseConstantsAddress, StatsReadback* stats);
+
+	void updateBukkitSleep(D3D12_GPU_VIRTUAL_ADDRESS mouseConstantsAddress);
+
+	void buildSleepingGrid();
+
+	void recordStats(ID3D12GraphicsCommandList6* cmdList, StatsReadback* stats);
+
+	void doEmission(StructuredBuffer* gridBuffer, D3D12_GPU_VIRTUAL_ADDRESS mouseConstantsAddress, D3D12_GPU_VIRTUAL_ADDRESS shapesAddress);
 
-	void doEmission(StructuredBuffer* gridBuffer, MouseConstants& mc);
+	D3D12_GPU_VIRTUAL_ADDRESS uploadShapes();
 
 	void createShapes();
 
@@ -206,7 +299,12 @@ private:
 	unsigned int endTime{ 0 };
 
 	unsigned int substepCount{ 3 };
-	unsigned int numParticles{ 0 };
+	AdaptiveSubsteps adaptiveSubsteps;
+	SubstepStats substepStats;
+	// Frames in a row that fewer substeps would have done
+	unsigned int framesBelowSubstepCount{ 0 };
+	// Wall time of the last compute in milliseconds, it waits on the GPU after every iteration
+	float computeTime{ 0.0f };
 
 	bool* renderToggles;
 };
\ No newline at end of file
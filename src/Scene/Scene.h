@@ -3,6 +3,7 @@
 #include "ObjectScene.h"
 #include "PBMPMScene.h"
 #include "MeshShadingScene.h"
+#include "MaterialBins.h"
 #include "../D3D/Pipeline/RenderPipeline.h"
 #include "../D3D/Pipeline/ComputePipeline.h"
 #include "../D3D/Pipeline/MeshPipeline.h"
@@ -58,14 +59,23 @@ public:
 	float* getSnowKernelRadius() { return snowScene.getKernelRadius(); }*/
 
 	unsigned int* getPBMPMSubstepCount() { return pbmpmScene.getSubstepCount(); }
+	AdaptiveSubsteps* getPBMPMAdaptiveSubsteps() { return pbmpmScene.getAdaptiveSubsteps(); }
+	const SubstepStats& getPBMPMSubstepStats() { return pbmpmScene.getSubstepStats(); }
 
-	int getNumParticles() { return pbmpmScene.getNumParticles(); }
+	// Counters from a few frames ago, reading them never waits on the GPU
+	const SimulationStats& getStats() { return statsReadback.getStats(); }
 
 	bool renderToggles[5] = { 1, 1, 1, 1, 1 };
+	// Surface blocks outside the camera's view are left out of the meshing, and so are blocks covering less than
+	// this fraction of the screen height
+	bool cullSurfaceBlocks = true;
+	float minSurfaceBlockScreenSize = 0.0f;
 
 private:
 	Camera* camera;
 
+	StatsReadback statsReadback;
+
 	RenderPipeline pbmpmRP;
 	PBMPMScene pbmpmScene;
 
@@ -75,67 +85,41 @@ private:
 	RenderPipeline objectRPSolid;
 	ObjectScene objectSceneSolid;
 
+	// Surface construction, one set of compute pipelines shared by every material
+	ComputePipeline materialBinCountCP;
+	ComputePipeline materialBinScatterCP;
+	ComputePipeline bilevelUniformGridCP;
+	ComputePipeline cellParticleOffsetsCP;
+	ComputePipeline cellParticleScatterCP;
+	ComputePipeline surfaceBlockDetectionCP;
+	ComputePipeline surfaceCellDetectionCP;
+	ComputePipeline surfaceVertexCompactionCP;
+	ComputePipeline surfaceVertexDensityCP;
+	ComputePipeline surfaceBufferClearCP;
+	MaterialBins materialBins;
+
 	// Fluid Mesh
 	RenderPipeline fluidRP;
-	ComputePipeline fluidBilevelUniformGridCP;
-	ComputePipeline fluidSurfaceBlockDetectionCP;
-	ComputePipeline fluidSurfaceCellDetectionCP;
-	ComputePipeline fluidSurfaceVertexCompactionCP;
-	ComputePipeline fluidSurfaceVertexDensityCP;
-	ComputePipeline fluidSurfaceVertexNormalCP;
-	ComputePipeline fluidBufferClearCP;
-	ComputePipeline fluidDispatchArgDivideCP;
 	MeshPipeline fluidMeshPipeline;
 	MeshShadingScene fluidScene;
 
 	// Elastic Mesh
 	RenderPipeline elasticRP;
-	ComputePipeline elasticBilevelUniformGridCP;
-	ComputePipeline elasticSurfaceBlockDetectionCP;
-	ComputePipeline elasticSurfaceCellDetectionCP;
-	ComputePipeline elasticSurfaceVertexCompactionCP;
-	ComputePipeline elasticSurfaceVertexDensityCP;
-	ComputePipeline elasticSurfaceVertexNormalCP;
-	ComputePipeline elasticBufferClearCP;
-	ComputePipeline elasticDispatchArgDivideCP;
 	MeshPipeline elasticMeshPipeline;
 	MeshShadingScene elasticScene;
 
 	// Sand Mesh
 	RenderPipeline sandRP;
-	ComputePipeline sandBilevelUniformGridCP;
-	ComputePipeline sandSurfaceBlockDetectionCP;
-	ComputePipeline sandSurfaceCellDetectionCP;
-	ComputePipeline sandSurfaceVertexCompactionCP;
-	ComputePipeline sandSurfaceVertexDensityCP;
-	ComputePipeline sandSurfaceVertexNormalCP;
-	ComputePipeline sandBufferClearCP;
-	ComputePipeline sandDispatchArgDivideCP;
 	MeshPipeline sandMeshPipeline;
 	MeshShadingScene sandScene;
 
 	// Visco Mesh
 	RenderPipeline viscoRP;
-	ComputePipeline viscoBilevelUniformGridCP;
-	ComputePipeline viscoSurfaceBlockDetectionCP;
-	ComputePipeline viscoSurfaceCellDetectionCP;
-	ComputePipeline viscoSurfaceVertexCompactionCP;
-	ComputePipeline viscoSurfaceVertexDensityCP;
-	ComputePipeline viscoSurfaceVertexNormalCP;
-	ComputePipeline viscoBufferClearCP;
-	ComputePipeline viscoDispatchArgDivideCP;
 	MeshPipeline viscoMeshPipeline;
 	MeshShadingScene viscoScene;
 
 	// Snow Mesh
 	/*RenderPipeline snowRP;
-	ComputePipeline snowBilevelUniformGridCP;
-	ComputePipeline snowSurfaceBlockDetectionCP;
-	ComputePipeline snowSurfaceCellDetectionCP;
-	ComputePipeline snowSurfaceVertexCompactionCP;
-	ComputePipeline snowSurfaceVertexDensityCP;
-	ComputePipeline snowSurfaceVertexNormalCP;
-	ComputePipeline snowBufferClearCP;
 	MeshPipeline snowMeshPipeline;
 	MeshShadingScene snowScene;*/
 
@@ -3,4 +3,8 @@
 #define GRID_WIDTH 32
 #define GRID_HEIGHT 32
 #define GRID_DEPTH 32
+
+// Shared by the simulation buffers and the surface cell lists, which hold at most one entry per particle
+const unsigned int maxParticles = 500000;
+
 static const float GROUND_PLANE_COLOR[3] = {0.76f, 0.70f, 0.50f};
\ No newline at end of file
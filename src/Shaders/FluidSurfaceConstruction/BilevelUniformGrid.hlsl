@@ -6,11 +6,15 @@
 StructuredBuffer<float4> positionsBuffer : register(t0);
 // SRV for materials buffer (input buffer), material enum stored in fourth component
 StructuredBuffer<float4> materialsBuffer : register(t1);
+// Particles of every material per bin, see MaterialBinCount
+StructuredBuffer<int> materialBinCounts : register(t2);
+// Particle indices sorted by material
+StructuredBuffer<int> binnedParticleIndices : register(t3);
 
 // UAV for the bilevel uniform grid (output buffers)
+// Only counts here, CellParticleOffsets and CellParticleScatter then build the compressed cell lists
 RWStructuredBuffer<int> cellParticleCounts : register(u0);
-RWStructuredBuffer<int> cellParticleIndices : register(u1);
-RWStructuredBuffer<int> blocks : register(u2);
+RWStructuredBuffer<int> blocks : register(u1);
 
 ConstantBuffer<BilevelUniformGridConstants> cb : register(b0);
 
@@ -23,17 +27,20 @@ int3 getCellIndex(float3 particlePosition) {
 }
 
 // NOTE: if this compute shader changes to 3D, the logic also needs to change to get and use the particle index correctly.
+// Dispatched with this material's arguments from MaterialBinScatter.
 [numthreads(BILEVEL_UNIFORM_GRID_THREADS_X, 1, 1)]
 void main(uint3 globalThreadId : SV_DispatchThreadID) {
-    if (globalThreadId.x >= cb.numParticles) {
+    // One thread per particle of this material
+    int binOffset = 0;
+    for (int m = 0; m < cb.material; m++) {
+        binOffset += materialBinCounts[m];
+    }
+    if (globalThreadId.x >= (uint)materialBinCounts[cb.material]) {
         return;
     }
 
-	if (materialsBuffer[globalThreadId.x].w != cb.material) {
-		return;
-	}
-
-    float3 position = positionsBuffer[globalThreadId.x].xyz;
+    int particleIndex = binnedParticleIndices[binOffset + globalThreadId.x];
+    float3 position = positionsBuffer[particleIndex].xyz;
     int3 cellIndices = getCellIndex(position);
     int cellIndex1D = to1D(cellIndices, cb.dimensions);
     int3 blockIndices = cellIndices / CELLS_PER_BLOCK_EDGE;
@@ -45,12 +52,9 @@ void main(uint3 globalThreadId : SV_DispatchThreadID) {
     float halfCellsPerBlockEdgeMinusOne = ((CELLS_PER_BLOCK_EDGE - 1) / 2.0);
     int3 edge = int3(trunc((localCellIndices - halfCellsPerBlockEdgeMinusOne) / halfCellsPerBlockEdgeMinusOne));
 
-    // Add this particle to the cell
+    // Count this particle in the cell
     int particleIndexInCell;
     InterlockedAdd(cellParticleCounts[cellIndex1D], 1, particleIndexInCell);
-    if (particleIndexInCell < MAX_PARTICLES_PER_CELL) {
-        cellParticleIndices[cellIndex1D * MAX_PARTICLES_PER_CELL + particleIndexInCell] = globalThreadId.x;
-    }
 
     // Do this only once per cell, when the first particle is added to the cell
     if (particleIndexInCell == 0) {
@@ -2,5 +2,6 @@
 "DescriptorTable(SRV(t0, numDescriptors=2)), " \
 "DescriptorTable(UAV(u0, numDescriptors=1)), " \
 "DescriptorTable(UAV(u1, numDescriptors=1)), " \
-"DescriptorTable(UAV(u2, numDescriptors=1)), " \
-"RootConstants(num32BitConstants=11, b0), " \
\ No newline at end of file
+"RootConstants(num32BitConstants=11, b0), " \
+"SRV(t2), " \
+"SRV(t3)"
\ No newline at end of file
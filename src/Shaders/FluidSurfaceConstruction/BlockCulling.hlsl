@@ -0,0 +1,52 @@
+/*
+    View culling of surface blocks, the GPU side of Surface/BlockCulling.h.
+
+    viewProj is read from root constants the way MeshShadingConstants does it, so mul(viewProj, p) gives clip coordinates
+    and row j of the matrix is clip coordinate j. Clip space is D3D's, x and y in [-w, w] and z in [0, w].
+*/
+
+// Conservative, a box that is outside no single plane counts as intersecting even when it misses a corner of the frustum
+bool intersectsFrustum(float4x4 viewProj, float3 boxMin, float3 boxMax) {
+    // Planes as (normal, offset) with the normals facing inwards, not normalized since only the signs are used
+    float4 planes[6] = {
+        viewProj[3] + viewProj[0],
+        viewProj[3] - viewProj[0],
+        viewProj[3] + viewProj[1],
+        viewProj[3] - viewProj[1],
+        viewProj[2],
+        viewProj[3] - viewProj[2]
+    };
+
+    [unroll]
+    for (int i = 0; i < 6; i++) {
+        // The corner furthest along the normal, if that one is outside the whole box is
+        float3 corner = float3(planes[i].x >= 0.0 ? boxMax.x : boxMin.x,
+                               planes[i].y >= 0.0 ? boxMax.y : boxMin.y,
+                               planes[i].z >= 0.0 ? boxMax.z : boxMin.z);
+        if (dot(planes[i].xyz, corner) + planes[i].w < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Height of the box's bounding sphere on screen as a fraction of the viewport height. Infinite when the camera is inside the sphere
+float projectedSize(float4x4 viewProj, float3 boxMin, float3 boxMax) {
+    float3 center = (boxMin + boxMax) * 0.5;
+    float radius = length(boxMax - boxMin) * 0.5;
+    float w = dot(viewProj[3], float4(center, 1.0));
+    if (w <= radius) {
+        return asfloat(0x7f800000);
+    }
+
+    // The projection's y scale, the view rotation doesn't change the length of the row
+    return radius * length(viewProj[1].xyz) / w;
+}
+
+// minScreenSize is a fraction of the viewport height, 0 keeps every block in view
+bool isBlockVisible(float4x4 viewProj, float minScreenSize, float3 boxMin, float3 boxMax) {
+    if (!intersectsFrustum(viewProj, boxMin, boxMax)) {
+        return false;
+    }
+    return minScreenSize <= 0.0 || projectedSize(viewProj, boxMin, boxMax) >= minScreenSize;
+}
@@ -0,0 +1,46 @@
+#include "CellParticleOffsetsRootSig.hlsl"
+#include "utils.hlsl"
+#include "../constants.h"
+
+// SRV for the particle count of every cell (input buffer)
+StructuredBuffer<int> cellParticleCounts : register(t0);
+
+// UAV for the cell offsets (output buffer). Has one extra element past the last cell, which gets the total
+RWStructuredBuffer<int> cellParticleOffsets : register(u0);
+
+// UAV for the scan's partition states, cleared every frame
+RWStructuredBuffer<uint> scanState : register(u1);
+
+ConstantBuffer<BilevelUniformGridConstants> cb : register(b0);
+
+#define SCAN_GROUP_SIZE CELL_PARTICLE_OFFSETS_THREADS_X
+#include "ParallelScan.hlsl"
+
+/*
+    Hands every cell a contiguous range of cellParticleIndices, sized exactly by its particle count.
+    The ranges come from an exclusive prefix sum over the counts, so cells are laid out in index order like on the CPU.
+
+    The offset written is the END of the range: CellParticleScatter counts it down while filling the range, which leaves the start behind.
+*/
+[numthreads(CELL_PARTICLE_OFFSETS_THREADS_X, 1, 1)]
+void main(uint3 groupThreadId : SV_GroupThreadID) {
+    int numCells = cb.dimensions.x * cb.dimensions.y * cb.dimensions.z;
+    uint partition = claimScanPartition(groupThreadId.x);
+    uint cell = partition * CELL_PARTICLE_OFFSETS_THREADS_X + groupThreadId.x;
+
+    // No early return, every thread has to take part in the scan
+    bool isCell = cell < (uint)numCells;
+    int count = isCell ? cellParticleCounts[cell] : 0;
+
+    int total;
+    int offset = exclusiveScan(partition, groupThreadId.x, count, total);
+
+    if (isCell) {
+        cellParticleOffsets[cell] = offset + count;
+    }
+
+    uint partitionCount = (numCells + CELL_PARTICLE_OFFSETS_THREADS_X - 1) / CELL_PARTICLE_OFFSETS_THREADS_X;
+    if (groupThreadId.x == 0 && partition == partitionCount - 1) {
+        cellParticleOffsets[numCells] = total;
+    }
+}
@@ -0,0 +1,5 @@
+#define ROOTSIG \
+"DescriptorTable(SRV(t0, numDescriptors=1)), " \
+"DescriptorTable(UAV(u0, numDescriptors=1)), " \
+"RootConstants(num32BitConstants=11, b0), " \
+"DescriptorTable(UAV(u1, numDescriptors=1))"
@@ -0,0 +1,40 @@
+#include "CellParticleScatterRootSig.hlsl"
+#include "utils.hlsl"
+#include "../constants.h"
+
+// SRV for positions buffer (input buffer)
+StructuredBuffer<float4> positionsBuffer : register(t0);
+// SRV for materials buffer (input buffer), material enum stored in fourth component
+StructuredBuffer<float4> materialsBuffer : register(t1);
+// Particles of every material per bin, see MaterialBinCount
+StructuredBuffer<int> materialBinCounts : register(t2);
+// Particle indices sorted by material
+StructuredBuffer<int> binnedParticleIndices : register(t3);
+
+// UAV for the cell offsets, the end of each cell's range on input and its start once every particle is placed
+RWStructuredBuffer<int> cellParticleOffsets : register(u0);
+// UAV for the compressed cell lists (output buffer), one entry per particle in the grid
+RWStructuredBuffer<int> cellParticleIndices : register(u1);
+
+ConstantBuffer<BilevelUniformGridConstants> cb : register(b0);
+
+// Second half of the counting sort started in BilevelUniformGrid: must pick exactly the particles and cells that pass counted.
+[numthreads(CELL_PARTICLE_SCATTER_THREADS_X, 1, 1)]
+void main(uint3 globalThreadId : SV_DispatchThreadID) {
+    int binOffset = 0;
+    for (int m = 0; m < cb.material; m++) {
+        binOffset += materialBinCounts[m];
+    }
+    if (globalThreadId.x >= (uint)materialBinCounts[cb.material]) {
+        return;
+    }
+
+    int particleIndex = binnedParticleIndices[binOffset + globalThreadId.x];
+    float3 position = positionsBuffer[particleIndex].xyz;
+    int3 cellIndices = int3(floor((position - cb.minBounds) / cb.resolution));
+    int cellIndex1D = to1D(cellIndices, cb.dimensions);
+
+    int rangeEnd;
+    InterlockedAdd(cellParticleOffsets[cellIndex1D], -1, rangeEnd);
+    cellParticleIndices[rangeEnd - 1] = particleIndex;
+}
@@ -152,7 +152,10 @@ void main(
         surfaceVertDensityDispatch[0].x = 0;
     }
 
+    // Culled blocks are only listed, as ~blockIdx, for the vertices they share with the blocks in view.
+    // The whole workgroup is in the same block, so it leaves together without outputs
     int blockIdx1d = surfaceBlockIndices[globalThreadId / CELLS_PER_BLOCK];
+    if (blockIdx1d < 0) return;
     int3 blockIdx3d = to3D(blockIdx1d, (cb.dimensions / CELLS_PER_BLOCK_EDGE));
     
     int localCellIdx1d = globalThreadId % CELLS_PER_BLOCK;
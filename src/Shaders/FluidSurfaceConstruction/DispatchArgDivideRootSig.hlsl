@@ -1,3 +0,0 @@
-#define ROOTSIG \
-"UAV(u0, space=0), " \
-"RootConstants(num32BitConstants=1, b0), " \
\ No newline at end of file
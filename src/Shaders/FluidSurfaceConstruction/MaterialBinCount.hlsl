@@ -0,0 +1,31 @@
+#include "MaterialBinCountRootSig.hlsl"
+#include "../constants.h"
+
+// SRV for positions buffer (input buffer), only bound because it shares a descriptor table with the materials
+StructuredBuffer<float4> positionsBuffer : register(t0);
+// SRV for materials buffer (input buffer), material enum stored in fourth component
+StructuredBuffer<float4> materialsBuffer : register(t1);
+// Live particle count written by the simulation, in x
+StructuredBuffer<uint4> particleCount : register(t2);
+
+// UAV for the bin counters (output buffer): particles per material, then the fill cursor of each bin for MaterialBinScatter
+RWStructuredBuffer<int> materialBinCounts : register(u0);
+
+// First half of sorting particles by material. This is the only surface pass that looks at every live particle,
+// everything after it only reads the particles of the material it is building.
+[numthreads(MATERIAL_BIN_THREADS_X, 1, 1)]
+void main(uint3 globalThreadId : SV_DispatchThreadID) {
+    // No early return, every lane has to take part in the wave operations below
+    int material = -1;
+    if (globalThreadId.x < particleCount[0].x) {
+        material = int(materialsBuffer[globalThreadId.x].w);
+    }
+
+    // One atomic per wave and material
+    for (int m = 0; m < MAX_SURFACE_MATERIALS; m++) {
+        int waveCount = WaveActiveCountBits(material == m);
+        if (waveCount > 0 && WaveIsFirstLane()) {
+            InterlockedAdd(materialBinCounts[m], waveCount);
+        }
+    }
+}
@@ -0,0 +1,4 @@
+#define ROOTSIG \
+"DescriptorTable(SRV(t0, numDescriptors=2)), " \
+"DescriptorTable(UAV(u0, numDescriptors=1)), " \
+"SRV(t2)"
\ No newline at end of file
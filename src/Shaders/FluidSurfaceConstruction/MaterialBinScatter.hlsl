@@ -0,0 +1,55 @@
+#include "MaterialBinScatterRootSig.hlsl"
+#include "utils.hlsl"
+#include "../constants.h"
+
+// SRV for positions buffer (input buffer), only bound because it shares a descriptor table with the materials
+StructuredBuffer<float4> positionsBuffer : register(t0);
+// SRV for materials buffer (input buffer), material enum stored in fourth component
+StructuredBuffer<float4> materialsBuffer : register(t1);
+// Live particle count written by the simulation, in x
+StructuredBuffer<uint4> particleCount : register(t2);
+
+// UAV for the bin counters, counts from MaterialBinCount followed by the fill cursors
+RWStructuredBuffer<int> materialBinCounts : register(u0);
+// UAV for the particle indices sorted by material (output buffer)
+RWStructuredBuffer<int> binnedParticleIndices : register(u1);
+// UAV for the dispatch arguments of each bin's per-particle surface passes (output buffer)
+RWStructuredBuffer<uint3> materialBinDispatch : register(u2);
+
+// Second half of sorting particles by material. Bins are laid out in material order,
+// so a bin starts after the particles of every lower material.
+[numthreads(MATERIAL_BIN_THREADS_X, 1, 1)]
+void main(uint3 globalThreadId : SV_DispatchThreadID) {
+    if (globalThreadId.x == 0) {
+        for (int bin = 0; bin < MAX_SURFACE_MATERIALS; bin++) {
+            materialBinDispatch[bin] = uint3(divRoundUp(materialBinCounts[bin], BILEVEL_UNIFORM_GRID_THREADS_X), 1, 1);
+        }
+    }
+
+    // No early return, every lane has to take part in the wave operations below
+    int material = -1;
+    if (globalThreadId.x < particleCount[0].x) {
+        material = int(materialsBuffer[globalThreadId.x].w);
+    }
+
+    int binOffset = 0;
+    for (int m = 0; m < MAX_SURFACE_MATERIALS; m++) {
+        bool inBin = material == m;
+        int waveCount = WaveActiveCountBits(inBin);
+
+        if (waveCount > 0) {
+            int localIndexInWave = WavePrefixCountBits(inBin);
+            int waveStartIdx = 0;
+            if (WaveIsFirstLane()) {
+                InterlockedAdd(materialBinCounts[MAX_SURFACE_MATERIALS + m], waveCount, waveStartIdx);
+            }
+            waveStartIdx = WaveReadLaneFirst(waveStartIdx);
+
+            if (inBin) {
+                binnedParticleIndices[binOffset + waveStartIdx + localIndexInWave] = globalThreadId.x;
+            }
+        }
+
+        binOffset += materialBinCounts[m];
+    }
+}
@@ -0,0 +1,6 @@
+#define ROOTSIG \
+"DescriptorTable(SRV(t0, numDescriptors=2)), " \
+"DescriptorTable(UAV(u0, numDescriptors=1)), " \
+"DescriptorTable(UAV(u1, numDescriptors=1)), " \
+"DescriptorTable(UAV(u2, numDescriptors=1)), " \
+"SRV(t2)"
\ No newline at end of file
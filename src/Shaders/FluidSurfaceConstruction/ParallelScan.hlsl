@@ -0,0 +1,100 @@
+/*
+    Single pass prefix sums and stream compaction with decoupled look-back, the GPU side of Support/ParallelScan.h.
+
+    Every thread group scans one partition of SCAN_GROUP_SIZE items, one per thread. Partitions are handed out by an
+    atomic counter rather than taken from SV_GroupID, so a group only ever waits on partitions whose groups are already running.
+    A group publishes its partition's aggregate, walks back over its predecessors until one has published an inclusive
+    prefix, and publishes its own inclusive prefix for the groups after it. The result is the same as a serial scan,
+    so compacted lists come out in index order and the last partition knows the exact total.
+
+    Before including, define SCAN_GROUP_SIZE and declare
+        RWStructuredBuffer<uint> scanState
+    with one element for the partition counter plus one per partition, all cleared to 0 before the dispatch.
+    None of the functions below may be called under divergent control flow, every thread of the group has to take part.
+*/
+
+static const uint SCAN_FLAG_AGGREGATE = 1u << 30;
+static const uint SCAN_FLAG_INCLUSIVE = 2u << 30;
+static const uint SCAN_VALUE_MASK = SCAN_FLAG_AGGREGATE - 1;
+
+groupshared uint s_scanPartition;
+// Waves have at least 4 lanes
+groupshared int s_scanWaveOffsets[(SCAN_GROUP_SIZE + 3) / 4];
+groupshared int s_scanPrefix;
+groupshared int s_scanTotal;
+
+// The partition this group scans, items partition * SCAN_GROUP_SIZE onwards
+uint claimScanPartition(uint groupThreadIndex) {
+    if (groupThreadIndex == 0) {
+        uint partition;
+        InterlockedAdd(scanState[0], 1, partition);
+        s_scanPartition = partition;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    return s_scanPartition;
+}
+
+// Sum of the values of every item before this thread's. total is the sum up to and including this partition,
+// so the group holding the last partition gets the sum of everything
+int exclusiveScan(uint partition, uint groupThreadIndex, int value, out int total) {
+    uint laneCount = WaveGetLaneCount();
+    uint waveIndex = groupThreadIndex / laneCount;
+    int wavePrefix = WavePrefixSum(value);
+    int waveSum = WaveActiveSum(value);
+
+    if (WaveIsFirstLane()) {
+        s_scanWaveOffsets[waveIndex] = waveSum;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (groupThreadIndex == 0) {
+        uint waveCount = (SCAN_GROUP_SIZE + laneCount - 1) / laneCount;
+        int aggregate = 0;
+        for (uint w = 0; w < waveCount; w++) {
+            int sum = s_scanWaveOffsets[w];
+            s_scanWaveOffsets[w] = aggregate;
+            aggregate += sum;
+        }
+
+        // States are read and written with atomics so they're seen across groups without extra barriers
+        uint previousState;
+        int prefix = 0;
+        if (partition == 0) {
+            InterlockedExchange(scanState[1], SCAN_FLAG_INCLUSIVE | uint(aggregate), previousState);
+        }
+        else {
+            InterlockedExchange(scanState[1 + partition], SCAN_FLAG_AGGREGATE | uint(aggregate), previousState);
+
+            uint predecessor = partition - 1;
+            [allow_uav_condition]
+            while (true) {
+                uint state;
+                InterlockedOr(scanState[1 + predecessor], 0, state);
+                if (state & SCAN_FLAG_INCLUSIVE) {
+                    prefix += int(state & SCAN_VALUE_MASK);
+                    break;
+                }
+                if (state & SCAN_FLAG_AGGREGATE) {
+                    prefix += int(state & SCAN_VALUE_MASK);
+                    predecessor--;
+                }
+                // Otherwise the predecessor hasn't published yet, spin
+            }
+
+            InterlockedExchange(scanState[1 + partition], SCAN_FLAG_INCLUSIVE | uint(prefix + aggregate), previousState);
+        }
+
+        s_scanPrefix = prefix;
+        s_scanTotal = prefix + aggregate;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    total = s_scanTotal;
+    return s_scanPrefix + s_scanWaveOffsets[waveIndex] + wavePrefix;
+}
+
+// Where this thread's item goes in the compacted list if keep is set. count is the number kept up to and including
+// this partition, like total above
+int compact(uint partition, uint groupThreadIndex, bool keep, out int count) {
+    return exclusiveScan(partition, groupThreadIndex, keep ? 1 : 0, count);
+}
@@ -1,11 +1,9 @@
 #include "SurfaceBlockDetectionRootSig.hlsl"
 #include "../constants.h"
+#include "utils.hlsl"
+#include "BlockCulling.hlsl"
 
-struct NumberOfBlocks {
-    int value;
-};
-
-ConstantBuffer<NumberOfBlocks> numberOfBlocks : register(b0);
+ConstantBuffer<SurfaceBlockDetectionConstants> cb : register(b0);
 
 // SRV for blocks buffer (input buffer)
 StructuredBuffer<int> blocks : register(t0);
@@ -15,37 +13,48 @@ RWStructuredBuffer<int> surfaceBlockIndices : register(u0);
 
 RWStructuredBuffer<int3> surfaceBlockDispatch : register(u1);
 
-/*
-    Rather than follow the paper directly, which uses an atomic add per-thread to get a write-index into the surfaceBlockIndices buffer,
-    we'll use wave intrinsics to reduce the number of atomics to one-per-wave. Parallel prefix sum might be even better, but its more complex and I wasn't able to find
-    a library to do it for me.
+// UAV for the scan's partition states, cleared every frame
+RWStructuredBuffer<uint> scanState : register(u2);
+
+#define SCAN_GROUP_SIZE SURFACE_BLOCK_DETECTION_THREADS_X
+#include "ParallelScan.hlsl"
 
-    Inspired by this article on "stream compaction using wave intrinsics:" https://interplayoflight.wordpress.com/2022/12/25/stream-compaction-using-wave-intrinsics/
+/*
+    Stream compaction of the surface blocks with a prefix scan (see ParallelScan.hlsl), rather than an atomic per
+    surface block like the paper. Surface blocks are listed in block order, and the group that scans the last
+    partition writes the exact count as the dispatch for surface cell detection. The whole dispatch is overwritten
+    every frame, so nothing has to reset it in between.
+
+    Culling only decides which blocks get meshed. A block outside the camera's view is still listed while one next to
+    it is in view, since its cells mark corner vertices that block reads, so the visible blocks come out the same as
+    without culling. The block's box grown by a block on every side holds all of its neighbours' boxes, so one test
+    covers them. Listed blocks that are culled themselves are stored as ~blockIdx, cell detection decodes them and the
+    mesh shader skips them. Blocks with no neighbour in view are left out, none of their vertices get densities.
 */
 [numthreads(SURFACE_BLOCK_DETECTION_THREADS_X, 1, 1)]
-void main(int3 globalThreadId : SV_DispatchThreadID) {
-    if (globalThreadId.x >= numberOfBlocks.value) {
-        return;
-    }
+void main(uint3 groupThreadId : SV_GroupThreadID) {
+    uint partition = claimScanPartition(groupThreadId.x);
+    int blockIdx = partition * SURFACE_BLOCK_DETECTION_THREADS_X + groupThreadId.x;
 
-    int blockNonEmptyCellCount = blocks[globalThreadId.x];
+    // No early return, every thread has to take part in the scan
+    int blockNonEmptyCellCount = blockIdx < cb.numBlocks ? blocks[blockIdx] : 0;
     bool isSurfaceBlock = blockNonEmptyCellCount > 0 && blockNonEmptyCellCount < FILLED_BLOCK;
-    int localSurfaceBlockIndexInWave = WavePrefixCountBits(isSurfaceBlock);
-    int surfaceBlockWaveCount = WaveActiveCountBits(isSurfaceBlock);
-    int surfaceBlockGlobalStartIdx;
-
-    if (surfaceBlockWaveCount <= 0) {
-        return;
+    bool culled = false;
+    if (isSurfaceBlock && cb.cullBlocks) {
+        float3 boxMin = cb.minBounds + float3(to3D(blockIdx, cb.blockDimensions)) * cb.blockWidth;
+        culled = !isBlockVisible(cb.viewProj, cb.minScreenSize, boxMin, boxMin + cb.blockWidth);
+        isSurfaceBlock = !culled || isBlockVisible(cb.viewProj, cb.minScreenSize, boxMin - cb.blockWidth, boxMin + 2.0 * cb.blockWidth);
     }
 
-    if (WaveIsFirstLane()) {
-        InterlockedAdd(surfaceBlockDispatch[0].x, surfaceBlockWaveCount, surfaceBlockGlobalStartIdx);
-        // No synchronziation is necessary, because we only care about the value within a wave.
-    }
-    surfaceBlockGlobalStartIdx = WaveReadLaneFirst(surfaceBlockGlobalStartIdx); // (its faster to use an intrinsic here than to write to a shared variable and sync)
+    int surfaceBlockCount;
+    int surfaceBlockGlobalIdx = compact(partition, groupThreadId.x, isSurfaceBlock, surfaceBlockCount);
 
     if (isSurfaceBlock) {
-        int surfaceBlockGlobalIdx = surfaceBlockGlobalStartIdx + localSurfaceBlockIndexInWave;
-        surfaceBlockIndices[surfaceBlockGlobalIdx] = globalThreadId.x;
+        surfaceBlockIndices[surfaceBlockGlobalIdx] = culled ? ~blockIdx : blockIdx;
+    }
+
+    uint partitionCount = (cb.numBlocks + SURFACE_BLOCK_DETECTION_THREADS_X - 1) / SURFACE_BLOCK_DETECTION_THREADS_X;
+    if (groupThreadId.x == 0 && partition == partitionCount - 1) {
+        surfaceBlockDispatch[0] = int3(surfaceBlockCount, 1, 1);
     }
 }
\ No newline at end of file
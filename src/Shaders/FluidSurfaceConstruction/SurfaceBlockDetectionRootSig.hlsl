@@ -2,4 +2,5 @@
 "DescriptorTable(SRV(t0, numDescriptors=1)), " \
 "DescriptorTable(UAV(u0, numDescriptors=1)), " \
 "UAV(u1, space=0), " \
-"RootConstants(num32BitConstants=1, b0), " \
\ No newline at end of file
+"RootConstants(num32BitConstants=26, b0), " \
+"DescriptorTable(UAV(u2, numDescriptors=1))"
\ No newline at end of file
@@ -87,6 +87,10 @@ void main(uint3 localThreadId : SV_GroupThreadID, uint3 groupId : SV_GroupID) {
 
     // First order of business: we launched a thread for each cell within surface blocks. We need to figure out the global index for this thread's cell. 
     int surfaceBlockIdx1d = surfaceBlockIndices[globalThreadId / CELLS_PER_BLOCK];
+    // Culled blocks next to one in view are listed as ~blockIdx, their cells are detected all the same
+    if (surfaceBlockIdx1d < 0) {
+        surfaceBlockIdx1d = ~surfaceBlockIdx1d;
+    }
     // By aligning the number of threads per workgroup with the number of threads in a block, we can use the local thread ID as a proxy for the local cell index.
     int3 surfaceBlockIdx3d = to3D(surfaceBlockIdx1d, cb.dimensions / CELLS_PER_BLOCK_EDGE);
     int3 localCellIndex3d = int3(localThreadId.x, localThreadId.y, localThreadId.z);
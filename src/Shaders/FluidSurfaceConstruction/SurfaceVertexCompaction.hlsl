@@ -7,40 +7,42 @@ StructuredBuffer<int> surfaceVertices : register(t0);
 
 // Outputs (UAVs)
 RWStructuredBuffer<int> surfaceVertexIndices : register(u0);
+// The density dispatch, then the exact vertex count in x
 RWStructuredBuffer<int3> surfaceVertDensityDispatch : register(u1);
+// UAV for the scan's partition states, cleared every frame
+RWStructuredBuffer<uint> scanState : register(u2);
 
 // Constant buffer (root constant)
 ConstantBuffer<BilevelUniformGridConstants> cb : register(b0);
 
+#define SCAN_GROUP_SIZE SURFACE_VERTEX_COMPACTION_THREADS_X
+#include "ParallelScan.hlsl"
+
 /*
-    Similar to SurfaceBlockDetection, this is effectively a stream compaction step. Again, instead of following the paper directly,
-    which uses many atomic operations, we'll use wave intrinsics to reduce the number of atomics to one-per-wave.
+    Similar to SurfaceBlockDetection, this is a stream compaction step done with a prefix scan, so surface vertices
+    are listed in vertex order and the exact count is known at the end.
 
     This compute pass launches a thread per vertex.
 */
 [numthreads(SURFACE_VERTEX_COMPACTION_THREADS_X, 1, 1)]
-void main(uint3 globalThreadId : SV_DispatchThreadID) {
-    if (globalThreadId.x >= (cb.dimensions.x + 1) * (cb.dimensions.y + 1) * (cb.dimensions.z + 1)) {
-        return;
-    }
+void main(uint3 groupThreadId : SV_GroupThreadID) {
+    int numVertices = (cb.dimensions.x + 1) * (cb.dimensions.y + 1) * (cb.dimensions.z + 1);
+    uint partition = claimScanPartition(groupThreadId.x);
+    int vertexIdx = partition * SURFACE_VERTEX_COMPACTION_THREADS_X + groupThreadId.x;
 
-    bool isSurfaceVertex = surfaceVertices[globalThreadId.x] > 0;  
-    int localSurfaceVertexIndexInWave = WavePrefixCountBits(isSurfaceVertex);
-    int surfaceVertexWaveCount = WaveActiveCountBits(isSurfaceVertex);
-    int surfaceVertexGlobalStartIdx;
-    
-    if (surfaceVertexWaveCount <= 0) {
-        return;
-    }
+    // No early return, every thread has to take part in the scan
+    bool isSurfaceVertex = vertexIdx < numVertices && surfaceVertices[vertexIdx] > 0;
 
-    if (WaveIsFirstLane()) {
-        InterlockedAdd(surfaceVertDensityDispatch[0].x, surfaceVertexWaveCount, surfaceVertexGlobalStartIdx);
-        // No synchronziation is necessary, because we only care about the value within a wave.
-    }
-    surfaceVertexGlobalStartIdx = WaveReadLaneFirst(surfaceVertexGlobalStartIdx); // (its faster to use an intrinsic here than to write to a shared variable and sync)
+    int surfaceVertexCount;
+    int surfaceVertexGlobalIdx = compact(partition, groupThreadId.x, isSurfaceVertex, surfaceVertexCount);
 
     if (isSurfaceVertex) {
-        int surfaceVertexGlobalIdx = surfaceVertexGlobalStartIdx + localSurfaceVertexIndexInWave;
-        surfaceVertexIndices[surfaceVertexGlobalIdx] = globalThreadId.x;
+        surfaceVertexIndices[surfaceVertexGlobalIdx] = vertexIdx;
+    }
+
+    uint partitionCount = (numVertices + SURFACE_VERTEX_COMPACTION_THREADS_X - 1) / SURFACE_VERTEX_COMPACTION_THREADS_X;
+    if (groupThreadId.x == 0 && partition == partitionCount - 1) {
+        surfaceVertDensityDispatch[0] = int3((surfaceVertexCount + SURFACE_VERTEX_DENSITY_THREADS_X - 1) / SURFACE_VERTEX_DENSITY_THREADS_X, 1, 1);
+        surfaceVertDensityDispatch[1] = int3(surfaceVertexCount, 1, 1);
     }
 }
\ No newline at end of file
@@ -9,40 +9,56 @@ StructuredBuffer<float4> positionsBuffer : register(t0);
 StructuredBuffer<float4> materialsBuffer : register(t1);
 // SRV for the surface cell particle counts
 StructuredBuffer<int> cellParticleCounts : register(t2);
-// SRV for the surface cell particle indices
+// SRV for the compressed cell lists, each cell's particles are contiguous
 StructuredBuffer<int> cellParticleIndices : register(t3);
 // SRV for the surface vertex indices
 StructuredBuffer<int> surfaceVertexIndices : register(t4);
 // Root SRV for dispatch params for this pass
 StructuredBuffer<int3> surfaceVertDensityDispatch : register(t5);
+// SRV for where each cell's range starts in cellParticleIndices
+StructuredBuffer<int> cellParticleOffsets : register(t6);
 
 // Root constants
 ConstantBuffer<BilevelUniformGridConstants> cb : register(b0);
 
 // Outputs
-// Root UAV for the surface block dispatch (SOLELY to reset it without an extra compute pass)
-RWStructuredBuffer<int3> surfaceBlockDispatch : register(u0);
 // UAV for the surface vertex densities
 RWStructuredBuffer<float> surfaceVertexDensities : register(u1);
 // UAV for the surface vertex colors
 RWStructuredBuffer<float4> surfaceVertexColors : register(u2);
+// UAV for the surface vertex normals
+RWStructuredBuffer<float3> surfaceVertexNormals : register(u3);
 
-float P(float d, float h)
+// Poly6 kernel. With h the kernel radius and s the kernel scale the support is h * h * s, at most out to the cells a
+// vertex reads so no particle the kernel still slopes for is left out of the gradient, and the peak is
+// 315 / (64 pi (h s)^6). Only depends on the constants, so it's worked out once per thread instead of per particle
+struct KernelCoefficients {
+    float inverseSupportSquared;
+    float norm;
+};
+
+KernelCoefficients makeKernelCoefficients(int kernelOffset)
 {
-    if (d >= 0.0 && d < h) {
-        float kernelNorm = 315.0 / (64.0 * PI * pow(h, 9.0));
-        return max(0.0, kernelNorm * cubic(h * h - d * d));
-    } else {
-        return 0.0;
-    }
+    float scaledRadius = cb.kernelRadius * cb.kernelScale;
+    float support = min(cb.kernelRadius * scaledRadius, (kernelOffset + 1) * cb.resolution);
+
+    KernelCoefficients coefficients;
+    coefficients.inverseSupportSquared = 1.0 / (support * support);
+    coefficients.norm = 315.0 / (64.0 * PI * cubic(scaledRadius * scaledRadius));
+    return coefficients;
+}
+
+float poly6(KernelCoefficients coefficients, float distanceSquared)
+{
+    float q2 = min(distanceSquared * coefficients.inverseSupportSquared, 1.0);
+    return coefficients.norm * cubic(1.0 - q2);
 }
 
-float isotropicKernel(float3 r, float h)
+// Derivative of the poly6 shape with respect to q^2
+float poly6Slope(KernelCoefficients coefficients, float distanceSquared)
 {
-    r *= cb.kernelScale;
-    h *= cb.kernelScale;
-    float d = length(r);
-    return P(d / h, h) / cubic(h);
+    float q2 = min(distanceSquared * coefficients.inverseSupportSquared, 1.0);
+    return -3.0 * (1.0 - q2) * (1.0 - q2);
 }
 
 // Unfortunately, at this point, threads no longer correspond to spatially-collocated geometry. A single workgroup may span multiple grid blocks.
@@ -51,23 +67,20 @@ float isotropicKernel(float3 r, float h)
 // to make sure the non-retired threads are contiguous.) It's a tradeoff between extra threads for non-surface verts and extra global memory access.
 [numthreads(SURFACE_VERTEX_DENSITY_THREADS_X, 1, 1)]
 void main( uint3 globalThreadId : SV_DispatchThreadID ) {
-    if (globalThreadId.x >= (surfaceVertDensityDispatch[0].x * SURFACE_VERTEX_DENSITY_THREADS_X)) { // TODO: this might overshoot. Need total number of surface verts.
+    if (globalThreadId.x >= surfaceVertDensityDispatch[1].x) { // Exact surface vertex count, the group count in [0] rounds up
         return;
     }
 
-    // Piggy back off this pass to reset the surface block dispatch buffer for the next frame.
-    if (globalThreadId.x == 0) {
-        surfaceBlockDispatch[0].x = 0;
-    }
-
     int globalSurfaceVertIndex1d = surfaceVertexIndices[globalThreadId.x];
     int3 globalSurfaceVertIndex3d = to3D(globalSurfaceVertIndex1d, (cb.dimensions + int3(1, 1, 1)));
 
     float3 vertPos = cb.minBounds + float3(globalSurfaceVertIndex3d) * cb.resolution;
+    int kernelOffset = int(0.999 * cb.kernelRadius / cb.resolution);
+    KernelCoefficients kernelCoefficients = makeKernelCoefficients(kernelOffset);
     float totalDensity = 0.0f;
+    float3 densityGradient = float3(0.0f, 0.0f, 0.0f);
     float4 averageColor = float4(0.0f, 0.0f, 0.0f, 0.0f);
 
-    int kernelOffset = int(0.999 * cb.kernelRadius / cb.resolution);
     int3 minLoopBounds = max(globalSurfaceVertIndex3d - kernelOffset - int3(1, 1, 1), int3(0, 0, 0));
     int3 maxLoopBounds = min(globalSurfaceVertIndex3d + kernelOffset, cb.dimensions - int3(1, 1, 1)); // Note, this is NOT a mistake. Not supposed to add 1 here. Each vertex has at most 8 abutting cells.
 
@@ -81,11 +94,15 @@ void main( uint3 globalThreadId : SV_DispatchThreadID ) {
                 int neighborCellIdx1d = to1D(neighborCellIdx3d, cb.dimensions);
 
                 int particleCount = cellParticleCounts[neighborCellIdx1d];
+                int particleOffset = cellParticleOffsets[neighborCellIdx1d];
                 for (int i = 0; i < particleCount; i++) {
-                    int particleIdx = cellParticleIndices[neighborCellIdx1d * MAX_PARTICLES_PER_CELL + i];
+                    int particleIdx = cellParticleIndices[particleOffset + i];
                     float3 particlePos = positionsBuffer[particleIdx].xyz;
                     float3 r = vertPos - particlePos;
-                    totalDensity += isotropicKernel(r, cb.kernelRadius);
+                    float distanceSquared = dot(r, r);
+                    totalDensity += poly6(kernelCoefficients, distanceSquared);
+                    // Summed without the constant factor, which doesn't change the direction
+                    densityGradient += poly6Slope(kernelCoefficients, distanceSquared) * r;
                     averageColor += materialsBuffer[particleIdx];
 					colorCount++;
                 }
@@ -99,4 +116,8 @@ void main( uint3 globalThreadId : SV_DispatchThreadID ) {
     surfaceVertexDensities[globalSurfaceVertIndex1d] = totalDensity;
 	// Store average color for the vertex, fourth component unused
 	surfaceVertexColors[globalSurfaceVertIndex1d] = float4(averageColor.xyz, 0.0);
+    // The normal is the direction of the density gradient, taken analytically from the same particles as the density
+    // instead of from neighbouring densities in a second pass
+    float gradientLength = length(densityGradient);
+    surfaceVertexNormals[globalSurfaceVertIndex1d] = gradientLength > 0.0 ? densityGradient / gradientLength : float3(0.0, 0.0, 0.0);
 }
\ No newline at end of file
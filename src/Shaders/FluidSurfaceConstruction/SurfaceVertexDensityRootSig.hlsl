@@ -4,7 +4,8 @@
 "DescriptorTable(SRV(t3, numDescriptors=1)), " \
 "DescriptorTable(SRV(t4, numDescriptors=1)), " \
 "SRV(t5, space=0), " \
-"UAV(u0, space=0), " \
 "DescriptorTable(UAV(u1, numDescriptors=1)), " \
 "DescriptorTable(UAV(u2, numDescriptors=1)), " \
-"RootConstants(num32BitConstants=10, b0), " \
\ No newline at end of file
+"RootConstants(num32BitConstants=10, b0), " \
+"DescriptorTable(SRV(t6, numDescriptors=1)), " \
+"DescriptorTable(UAV(u3, numDescriptors=1))"
\ No newline at end of file
@@ -1,6 +0,0 @@
-#define ROOTSIG \
-"DescriptorTable(SRV(t0, numDescriptors=1)), " \
-"DescriptorTable(SRV(t1, numDescriptors=1)), " \
-"SRV(t2, space=0), " \
-"DescriptorTable(UAV(u0, numDescriptors=1)), " \
-"RootConstants(num32BitConstants=10, b0), " \
\ No newline at end of file
@@ -6,7 +6,8 @@ static const float PI = 3.1415926f;
 
 /* ================== Constants for the mesh shading pipeline ================== */ 
 
-static const int MAX_PARTICLES_PER_CELL = 16;
+// Materials with a surface, particles are binned by material once per frame and each bin is surfaced on its own
+static const int MAX_SURFACE_MATERIALS = 5;
 // This really should not be changed. Mesh shaders have very hard limits on how many verts and primitives they can output.
 // If this is made any bigger, the mesh shader will have vertex overflow.
 static const int CELLS_PER_BLOCK_EDGE = 4; // each block has 4x4x4 cells
@@ -16,7 +17,13 @@ static const int HALFBLOCK_CELLS_X = CELLS_PER_BLOCK_EDGE;
 static const int HALFBLOCK_CELLS_Y = CELLS_PER_BLOCK_EDGE;
 static const int HALFBLOCK_CELLS_Z = CELLS_PER_BLOCK_EDGE / 2;
 static const int FILLED_BLOCK = (CELLS_PER_BLOCK_EDGE + 2) * (CELLS_PER_BLOCK_EDGE + 2) * (CELLS_PER_BLOCK_EDGE + 2);
+// Dispatched with the simulation's indirect arguments, keep equal to ParticleDispatchSize in PBMPMCommon.hlsl
+static const int MATERIAL_BIN_THREADS_X = 64;
+// Dispatched over one material's bin, MaterialBinScatter writes the group counts
 static const int BILEVEL_UNIFORM_GRID_THREADS_X = 64;
+// Cell lists are compressed: each cell owns a contiguous range of cellParticleIndices, placed by these two passes
+static const int CELL_PARTICLE_OFFSETS_THREADS_X = 64;
+static const int CELL_PARTICLE_SCATTER_THREADS_X = BILEVEL_UNIFORM_GRID_THREADS_X;
 static const int SURFACE_BLOCK_DETECTION_THREADS_X = 64;
 // For this compute pass, its important for the workgroup size to match the number of cells per block,
 // because we use shared memory in this pass and its most coherent if workgroups map to blocks.
@@ -25,7 +32,6 @@ static const int SURFACE_VERTEX_COMPACTION_THREADS_X = 64;
 // It's actually not so important for the workgroup size for this pass to match the number of vertices per block. By this point
 // we no longer have block-level coherency of vertices anyway. But use this as a starting point - can adjust it later.
 static const int SURFACE_VERTEX_DENSITY_THREADS_X = 32;
-static const int SURFACE_VERTEX_NORMAL_THREADS_X = SURFACE_VERTEX_DENSITY_THREADS_X;
 // Given the method of mesh shading half-blocks, we can place these upper limits on the outputs of each mesh shader workgroup:
 static const float EPSILON = 0.00001f;
 static const int MAX_PRIMITIVES = 128;
@@ -44,6 +50,17 @@ struct BilevelUniformGridConstants {
     int material;
 };
 
+// Surface blocks outside the view, or covering less than minScreenSize of its height, aren't meshed when cullBlocks is set
+struct SurfaceBlockDetectionConstants {
+    float4x4 viewProj;
+    int3 blockDimensions;
+    int numBlocks;
+    float3 minBounds;
+    float blockWidth;
+    float minScreenSize;
+    unsigned int cullBlocks;
+};
+
 struct MeshShadingConstants {
     float4x4 viewProj;
     int3 dimensions;
@@ -21,6 +21,26 @@
 #define ShapeFunctionDrain  2
 #define ShapeFunctionInitialEmit  3
 
+// Sleep and rate state of a bukkit, BukkitSleepStride uints each
+#define BukkitSleepStride 6
+// Largest distance a particle of the bukkit moved in its last step, float bits. Per deltaTime whatever the bukkit's rate
+#define BukkitSleepMotion 0
+// Substeps in a row the bukkit has been at rest, saturates at sleepSubstepCount
+#define BukkitSleepQuiet 1
+// Particle count after the bukkit's last step, a change wakes the bukkit
+#define BukkitSleepCount 2
+// One of the BukkitState values, set by bukkitAllocate. Only awake bukkits are dispatched
+#define BukkitSleepState 3
+// Rate level the bukkit steps at, it takes a step of deltaTime * 2^level every 2^level substeps
+#define BukkitSleepRate 4
+// Rate level the bukkit's own motion allows, bukkitAllocate lowers it to stay close to the neighbours'
+#define BukkitSleepRateTarget 5
+
+#define BukkitStateAwake 0
+#define BukkitStateAsleep 1
+// Partway through a step longer than one substep, its particles wait for the substep the step ends on
+#define BukkitStateWaiting 2
+
 #define TotalBukkitEdgeLength (BukkitSize + BukkitHaloSize * 2)
 #define TileDataSizePerEdge (TotalBukkitEdgeLength * 5) //4->5
 #define TileDataSize (TileDataSizePerEdge * TileDataSizePerEdge * TileDataSizePerEdge)
@@ -53,6 +73,11 @@ struct PBMPMConstants {
 
     float sandRelaxation;
     float sandRatio;
+    float displacementScale;
+    unsigned int sleepSubstepCount;
+    float sleepSpeed;
+    unsigned int rateLevelCount;
+    float rateDisplacement;
 };
 
 struct MouseConstants {
@@ -191,6 +216,12 @@ uint divUp(uint threadCount, uint groupSize)
     return (threadCount + groupSize - 1) / groupSize;
 }
 
+// Steps at a rate level start and end on substeps that are multiples of 2^level, so every level meets the faster ones there
+bool isRateStepBoundary(uint substep, uint rateLevel)
+{
+    return (substep & ((1u << rateLevel) - 1)) == 0;
+}
+
 // Collision
 
 float2x2 rot(float angle)
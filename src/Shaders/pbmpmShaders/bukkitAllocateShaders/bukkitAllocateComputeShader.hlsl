@@ -11,6 +11,70 @@ RWStructuredBuffer<uint> g_bukkitParticleAllocator : register(u1);
 StructuredBuffer<uint> g_bukkitCounts : register(t0);
 RWStructuredBuffer<BukkitThreadData> g_bukkitThreadData : register(u0);
 RWStructuredBuffer<uint> g_bukkitIndexStart : register(u2);
+RWStructuredBuffer<uint> g_bukkitSleep : register(u4);
+
+// A bukkit sleeps when it and all of its neighbours have been at rest for sleepSubstepCount substeps,
+// so its particles' frozen contribution is never next to one that moves
+bool isBukkitAsleep(int3 bukkit)
+{
+    if (g_simConstants.sleepSubstepCount == 0)
+    {
+        return false;
+    }
+
+    for (int z = -1; z <= 1; z++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int x = -1; x <= 1; x++)
+            {
+                int3 neighbor = bukkit + int3(x, y, z);
+                if (any(neighbor < int3(0, 0, 0)) || any(neighbor >= int3(g_simConstants.bukkitCountX, g_simConstants.bukkitCountY, g_simConstants.bukkitCountZ)))
+                {
+                    continue;
+                }
+
+                uint neighborIndex = bukkitAddressToIndex(uint3(neighbor), g_simConstants.bukkitCountX, g_simConstants.bukkitCountY);
+                if (g_bukkitSleep[neighborIndex * BukkitSleepStride + BukkitSleepQuiet] < g_simConstants.sleepSubstepCount)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// The level the bukkit's motion allows, held to at most one level slower than any neighbour's so steps of very different
+// lengths never meet. Lowered further until the next substep is a boundary of it
+uint chooseRateLevel(int3 bukkit, uint nextSubstep)
+{
+    uint rate = g_bukkitSleep[bukkitAddressToIndex(uint3(bukkit), g_simConstants.bukkitCountX, g_simConstants.bukkitCountY) * BukkitSleepStride + BukkitSleepRateTarget];
+
+    for (int z = -1; z <= 1; z++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int x = -1; x <= 1; x++)
+            {
+                int3 neighbor = bukkit + int3(x, y, z);
+                if (any(neighbor < int3(0, 0, 0)) || any(neighbor >= int3(g_simConstants.bukkitCountX, g_simConstants.bukkitCountY, g_simConstants.bukkitCountZ)))
+                {
+                    continue;
+                }
+
+                uint neighborIndex = bukkitAddressToIndex(uint3(neighbor), g_simConstants.bukkitCountX, g_simConstants.bukkitCountY);
+                rate = min(rate, g_bukkitSleep[neighborIndex * BukkitSleepStride + BukkitSleepRateTarget] + 1);
+            }
+        }
+    }
+
+    while (rate > 0 && !isRateStepBoundary(nextSubstep, rate))
+    {
+        rate--;
+    }
+    return rate;
+}
 
 // Compute Shader Entry Point
 [numthreads(GridDispatchSize, GridDispatchSize, GridDispatchSize)]
@@ -29,9 +93,33 @@ void main(uint3 id : SV_DispatchThreadID)
     uint bukkitCount = g_bukkitCounts[bukkitIndex];
     uint bukkitCountResidual = bukkitCount % ParticleDispatchSize;
 
+    uint sleepIndex = bukkitIndex * BukkitSleepStride;
+
     // Skip if no particles in the current bukkit
     if (bukkitCount == 0)
     {
+        // Particles moving in start at the fastest level, so they aren't held back by a step this bukkit started empty
+        g_bukkitSleep[sleepIndex + BukkitSleepRate] = 0;
+        return;
+    }
+
+    // The bukkit is partway through a longer step, its particles stay where the step will pick them up
+    uint nextSubstep = g_simConstants.simFrame + 1;
+    if (!isRateStepBoundary(nextSubstep, g_bukkitSleep[sleepIndex + BukkitSleepRate]))
+    {
+        g_bukkitSleep[sleepIndex + BukkitSleepState] = BukkitStateWaiting;
+        // The allocator's z component counts waiting bukkits for the stats readback
+        InterlockedAdd(g_bukkitParticleAllocator[2], 1);
+        return;
+    }
+    g_bukkitSleep[sleepIndex + BukkitSleepRate] = chooseRateLevel(int3(id), nextSubstep);
+
+    bool asleep = isBukkitAsleep(int3(id));
+    g_bukkitSleep[sleepIndex + BukkitSleepState] = asleep ? BukkitStateAsleep : BukkitStateAwake;
+    if (asleep)
+    {
+        // The allocator's y component counts asleep bukkits for the stats readback
+        InterlockedAdd(g_bukkitParticleAllocator[1], 1);
         return;
     }
 
@@ -41,6 +129,8 @@ void main(uint3 id : SV_DispatchThreadID)
     // Update global dispatch and particle allocators atomically
     uint dispatchStartIndex;
     InterlockedAdd(g_bukkitIndirectDispatch[0], dispatchCount, dispatchStartIndex);
+    // The w component isn't part of the dispatch arguments, it counts active bukkits for the stats readback
+    InterlockedAdd(g_bukkitIndirectDispatch[3], 1);
     
     uint particleStartIndex;
     InterlockedAdd(g_bukkitParticleAllocator[0], bukkitCount, particleStartIndex);
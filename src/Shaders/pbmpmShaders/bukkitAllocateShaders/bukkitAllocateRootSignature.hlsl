@@ -1,5 +1,6 @@
 #define ROOTSIG \
 "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)," \
-"RootConstants(num32BitConstants=34, b0)," \
+"RootConstants(num32BitConstants=36, b0)," \
 "DescriptorTable(SRV(t0)),"                      /* SRV for g_bukkitCounts */ \
-"DescriptorTable(UAV(u0, numDescriptors=4)),"    /* UAVs for g_bukkitThreadData, g_bukkitParticleAllocator, g_bukkitIndirectDispatch, g_bukkitIndexStart */ \
\ No newline at end of file
+"DescriptorTable(UAV(u0, numDescriptors=4)),"    /* UAVs for g_bukkitThreadData, g_bukkitParticleAllocator, g_bukkitIndirectDispatch, g_bukkitIndexStart */ \
+"DescriptorTable(UAV(u4, numDescriptors=1))"     /* UAV for g_bukkitSleep */
\ No newline at end of file
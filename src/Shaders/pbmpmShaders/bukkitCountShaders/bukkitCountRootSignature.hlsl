@@ -1,6 +1,6 @@
 #define ROOTSIG \
 "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)," \
-"RootConstants(num32BitConstants=34, b0)," \
+"RootConstants(num32BitConstants=36, b0)," \
 "DescriptorTable(SRV(t0, numDescriptors=1)),"     /* SRV Table for g_particleCount */ \
 "DescriptorTable(SRV(t1, numDescriptors=1)),"     /* SRV table for g_particles */ \
 "DescriptorTable(SRV(t2, numDescriptors=1)),"     /* SRV table for g_positions */ \
@@ -12,6 +12,7 @@ StructuredBuffer<uint> g_bukkitIndexStart : register(t2);
 StructuredBuffer<float4> g_positions : register(t3);
 RWStructuredBuffer<uint> g_particleInsertCounters : register(u0);
 RWStructuredBuffer<uint> g_particleData : register(u1);
+RWStructuredBuffer<uint> g_bukkitSleep : register(u2);
 
 // Compute Shader Entry Point
 [numthreads(ParticleDispatchSize, 1, 1)]
@@ -49,6 +50,13 @@ void main(uint3 id : SV_DispatchThreadID)
 
     // Calculate the linear bukkit index
     uint bukkitIndex = bukkitAddressToIndex(uint3(particleBukkit), g_simConstants.bukkitCountX, g_simConstants.bukkitCountY);
+
+    // Asleep and waiting bukkits got no range in bukkitAllocate, their particles are left where they are
+    if (g_bukkitSleep[bukkitIndex * BukkitSleepStride + BukkitSleepState] != BukkitStateAwake)
+    {
+        return;
+    }
+
     // Getting the first particle of this bucket
     uint bukkitIndexStart = g_bukkitIndexStart[bukkitIndex];
 
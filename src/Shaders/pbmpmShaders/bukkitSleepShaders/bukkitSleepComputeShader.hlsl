@@ -0,0 +1,80 @@
+#include "bukkitSleepRootSignature.hlsl"  // Includes the ROOTSIG definition
+#include "../../pbmpmShaders/PBMPMCommon.hlsl"  // Includes the bukkit sleep layout
+
+// Counts the substeps each bukkit has been at rest for and picks the rate level its motion allows. bukkitAllocate puts
+// a bukkit to sleep once every bukkit around it has been at rest for long enough too, and settles its rate level.
+// Runs after every substep, but a bukkit is only looked at once the step it is taking has ended
+
+// Root constants bound to b0
+ConstantBuffer<PBMPMConstants> g_simConstants : register(b0);
+
+cbuffer mouseConstants : register(b1) {
+    MouseConstants g_mouseConstants;
+};
+
+StructuredBuffer<uint> g_bukkitCounts : register(t0);
+RWStructuredBuffer<uint> g_bukkitSleep : register(u0);
+
+// Distance from a point to the mouse ray
+float distanceToRay(float3 origin, float3 direction, float3 position)
+{
+    float t = max(dot(position - origin, direction) / max(dot(direction, direction), 1e-8), 0.0);
+    return length(origin + direction * t - position);
+}
+
+[numthreads(GridDispatchSize, GridDispatchSize, GridDispatchSize)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= g_simConstants.bukkitCountX || id.y >= g_simConstants.bukkitCountY || id.z >= g_simConstants.bukkitCountZ)
+    {
+        return;
+    }
+
+    uint bukkitIndex = bukkitAddressToIndex(id, g_simConstants.bukkitCountX, g_simConstants.bukkitCountY);
+    uint sleepIndex = bukkitIndex * BukkitSleepStride;
+
+    // bukkitAllocate only changes the level on the substep the bukkit's step ends on
+    uint rate = g_bukkitSleep[sleepIndex + BukkitSleepRate];
+    if (!isRateStepBoundary(g_simConstants.simFrame + 1, rate))
+    {
+        return;
+    }
+
+    uint count = g_bukkitCounts[bukkitIndex];
+    float motion = asfloat(g_bukkitSleep[sleepIndex + BukkitSleepMotion]);
+
+    // Asleep bukkits weren't simulated and have no motion. Particles arriving, leaving, emitted or drained
+    // change the count, which wakes them
+    bool moving = motion > g_simConstants.sleepSpeed * g_simConstants.deltaTime ||
+        count != g_bukkitSleep[sleepIndex + BukkitSleepCount];
+
+    // Anything the mouse could reach this frame, the same test g2p2g makes against each particle with the
+    // bukkit's bounding sphere added to the radius
+    bool nearMouse = false;
+    if (g_mouseConstants.mouseActivation != 0)
+    {
+        float3 center = (float3(id) + 0.5) * BukkitSize;
+        float reach = g_mouseConstants.mouseRadius + 0.87 * BukkitSize;
+        nearMouse = distanceToRay(g_mouseConstants.mousePosition.xyz, g_mouseConstants.mouseRayDirection.xyz, center) < reach;
+    }
+    moving = moving || nearMouse;
+
+    // A step at this level covers 2^rate substeps
+    uint quiet = g_bukkitSleep[sleepIndex + BukkitSleepQuiet];
+    quiet = moving ? 0 : min(quiet + (1u << rate), g_simConstants.sleepSubstepCount);
+
+    // The slowest level at which the bukkit's particles still move no more than rateDisplacement cells a step
+    uint rateTarget = 0;
+    if (!nearMouse)
+    {
+        while (rateTarget + 1 < g_simConstants.rateLevelCount && motion * float(2u << rateTarget) <= g_simConstants.rateDisplacement)
+        {
+            rateTarget++;
+        }
+    }
+
+    g_bukkitSleep[sleepIndex + BukkitSleepMotion] = 0;
+    g_bukkitSleep[sleepIndex + BukkitSleepQuiet] = quiet;
+    g_bukkitSleep[sleepIndex + BukkitSleepCount] = count;
+    g_bukkitSleep[sleepIndex + BukkitSleepRateTarget] = rateTarget;
+}
@@ -0,0 +1,6 @@
+#define ROOTSIG \
+"RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)," \
+"RootConstants(num32BitConstants=36, b0)," \
+"CBV(b1),"                                       /* Mouse constants */ \
+"DescriptorTable(SRV(t0, numDescriptors=1)),"    /* SRV for g_bukkitCounts */ \
+"DescriptorTable(UAV(u0, numDescriptors=1))"     /* UAV for g_bukkitSleep */
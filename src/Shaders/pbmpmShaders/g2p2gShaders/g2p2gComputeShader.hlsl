@@ -3,7 +3,7 @@
 
 // Taken from https://github.com/electronicarts/pbmpm
 
-// Root constants bound to b0
+// Per-dispatch constants bound to b0, sub-allocated from the upload ring
 cbuffer simConstants : register(b0) {
 	PBMPMConstants g_simConstants;
 };
@@ -51,8 +51,24 @@ RWStructuredBuffer<float4> g_displacements : register(u7);
 
 StructuredBuffer<float4> g_massVolumeData : register(t3);
 
+// Largest change in any particle's displacement during each iteration, in grid cells. Stored as float bits,
+// non-negative floats order the same way as their bits so InterlockedMax works on them.
+// Iteration 0 has no residual, slot 0 takes the largest displacement of the substep for choosing substep counts
+RWStructuredBuffer<uint> g_iterationResiduals : register(u8);
+
+// Frozen contribution of the particles in asleep and waiting bukkits, added to every grid read
+StructuredBuffer<int> g_sleepingGrid : register(t4);
+
+// This bukkit's motion is recorded for bukkitSleep to decide when it may sleep and how fast it steps, and its rate level read
+RWStructuredBuffer<uint> g_bukkitSleep : register(u9);
+
 //groupshared int s_tileData[TileDataSize];
 groupshared int s_tileDataDst[TileDataSize];
+// This bukkit's share of the residual, so each group makes one global atomic
+groupshared uint s_residual;
+groupshared uint s_maxDisplacement;
+// Largest distance a particle of the bukkit moved, without the external forces applied for the next substep
+groupshared uint s_bukkitMotion;
 
 static const float3 darkColorTable[] = {
     float3(0.0, 0.573, 0.878), // Water
@@ -206,8 +222,9 @@ SVDResult svd(float3x3 A) {
                     continue;
 
                 converged = false;
+                // The smaller root of t^2 - 2 zeta t - 1, which zeroes b for the rotation below
                 float zeta = (c - a) / (2.0f * b);
-                float t = sign(zeta) / (abs(zeta) + sqrt(1.0f + zeta * zeta));
+                float t = -(zeta >= 0.0f ? 1.0f : -1.0f) / (abs(zeta) + sqrt(1.0f + zeta * zeta));
                 float c_rot = 1.0f / sqrt(1.0f + t * t);
                 float s_rot = c_rot * t;
 
@@ -222,6 +239,8 @@ SVDResult svd(float3x3 A) {
     }
 
     float3 singularValues;
+    int degenerate[3] = { 0, 0, 0 };
+    int degenerateCount = 0;
     for (int i = 0; i < 3; i++) {
         float norm = length(float3(B[0][i], B[1][i], B[2][i]));
         singularValues[i] = norm > EPSILON ? norm : EPSILON; // Ensure no zero singular values
@@ -231,6 +250,34 @@ SVDResult svd(float3x3 A) {
             B[1][i] /= norm;
             B[2][i] /= norm;
         }
+        else {
+            degenerate[degenerateCount++] = i;
+        }
+    }
+
+    // The columns of a rank deficient matrix come out as zero, U is filled in to an orthonormal basis so U * Vt stays
+    // a rotation
+    if (degenerateCount == 3) {
+        B = Identity;
+    }
+    else if (degenerateCount == 2) {
+        int kept = 3 - degenerate[0] - degenerate[1];
+        float3 u = float3(B[0][kept], B[1][kept], B[2][kept]);
+        // The axis furthest from u
+        float3 absU = abs(u);
+        float3 axis = absU.x < absU.y ? (absU.x < absU.z ? float3(1, 0, 0) : float3(0, 0, 1)) :
+            (absU.y < absU.z ? float3(0, 1, 0) : float3(0, 0, 1));
+        float3 v = normalize(cross(u, axis));
+        float3 w = cross(u, v);
+        B[0][degenerate[0]] = v.x; B[1][degenerate[0]] = v.y; B[2][degenerate[0]] = v.z;
+        B[0][degenerate[1]] = w.x; B[1][degenerate[1]] = w.y; B[2][degenerate[1]] = w.z;
+    }
+    else if (degenerateCount == 1) {
+        int i = degenerate[0];
+        int j = (i + 1) % 3;
+        int k = (i + 2) % 3;
+        float3 v = normalize(cross(float3(B[0][j], B[1][j], B[2][j]), float3(B[0][k], B[1][k], B[2][k])));
+        B[0][i] = v.x; B[1][i] = v.y; B[2][i] = v.z;
     }
 
     if (det(B) < 0) {
@@ -248,6 +295,62 @@ SVDResult svd(float3x3 A) {
     return result;
 }
 
+// Rotation of the polar decomposition A = RS, the U * Vt of svd() without the singular values.
+// Newton iterations scaled by det^-1/3, Higham 1986, Computing the polar decomposition with applications.
+// Inverted and nearly singular matrices fall back to svd(), the iteration would return a reflection for them
+float3x3 polarRotation(float3x3 A) {
+    const int MAX_ITERATIONS = 10;
+    const float EPSILON = 1e-6f;
+
+    float3x3 X = A;
+    for (int iter = 0; iter < MAX_ITERATIONS; iter++) {
+        // Transposed adjugate, X^-T times the determinant
+        float3x3 cofactor = float3x3(
+            cross(X[1], X[2]),
+            cross(X[2], X[0]),
+            cross(X[0], X[1])
+        );
+        float d = dot(X[0], cofactor[0]);
+        if (d < EPSILON)
+            break;
+
+        float gamma = 1.0f / pow(d, 1.0f / 3.0f);
+        float3x3 next = 0.5f * (gamma * X + cofactor / (gamma * d));
+
+        float3x3 delta = abs(next - X);
+        float change = max(max(max(delta[0].x, delta[0].y), max(delta[0].z, delta[1].x)),
+            max(max(delta[1].y, delta[1].z), max(delta[2].x, max(delta[2].y, delta[2].z))));
+        X = next;
+        // Quadratic convergence, the iteration after a change this small would be below float precision
+        if (change < 1e-3f)
+            return X;
+    }
+
+    SVDResult svdResult = svd(A);
+    return mul(svdResult.U, svdResult.Vt);
+}
+
+// Leading principal minors all positive, each clearing a margin over its rounding error for entries up to scale
+bool isPositiveDefinite(float3x3 M, float scale) {
+    float margin = 1e-5f * scale;
+    return M[0][0] > margin
+        && M[0][0] * M[1][1] - M[0][1] * M[1][0] > margin * scale
+        && det(M) > margin * scale * scale;
+}
+
+// Whether every singular value of A is within [lo, hi], without an SVD: A^T A - lo^2 I and hi^2 I - A^T A have to be
+// positive definite. A reflection counts as outside, svd() returns it as a negative singular value.
+// Errs towards outside
+bool singularValuesWithin(float3x3 A, float lo, float hi) {
+    if (det(A) <= 0.0f)
+        return false;
+
+    float3x3 C = mul(transpose(A), A);
+    float traceC = tr3D(C);
+    return isPositiveDefinite(C - lo * lo * Identity, lo * lo + traceC)
+        && isPositiveDefinite(hi * hi * Identity - C, hi * hi + traceC);
+}
+
 bool intersectRaySphere(float3 rayOrigin, float3 rayDir, float3 sphereCenter, float sphereRadius, out float t) {
     float3 oc = rayOrigin - sphereCenter;
 
@@ -283,6 +386,13 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
 {
     // Load thread-specific data
     BukkitThreadData threadData = g_bukkitThreadData[groupId.x];
+    uint bukkitIndex = bukkitAddressToIndex(uint3(threadData.bukkitX, threadData.bukkitY, threadData.bukkitZ),
+        g_simConstants.bukkitCountX, g_simConstants.bukkitCountY);
+
+    // The bukkit takes one step over this many substeps. The grid holds displacements over deltaTime, the bukkit's
+    // particles and tile hold them over its own step
+    float rateScale = float(1u << g_bukkitSleep[bukkitIndex * BukkitSleepStride + BukkitSleepRate]);
+    float stepTime = g_simConstants.deltaTime * rateScale;
 
     // Calculate grid origin
     int3 localGridOrigin = BukkitSize * int3(threadData.bukkitX, threadData.bukkitY, threadData.bukkitZ)
@@ -309,12 +419,12 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
     {
         uint gridVertexAddress = gridVertexIndex(uint3(gridVertex), g_simConstants.gridSize);
 
-		// Load grid data
-        dx = decodeFixedPoint(g_gridSrc[gridVertexAddress + 0], g_simConstants.fixedPointMultiplier);
-        dy = decodeFixedPoint(g_gridSrc[gridVertexAddress + 1], g_simConstants.fixedPointMultiplier);
-        dz = decodeFixedPoint(g_gridSrc[gridVertexAddress + 2], g_simConstants.fixedPointMultiplier);
-        w = decodeFixedPoint(g_gridSrc[gridVertexAddress + 3], g_simConstants.fixedPointMultiplier);
-        v = decodeFixedPoint(g_gridSrc[gridVertexAddress + 4], g_simConstants.fixedPointMultiplier);
+		// Load grid data, with the asleep particles around this bukkit
+        dx = decodeFixedPoint(g_gridSrc[gridVertexAddress + 0] + g_sleepingGrid[gridVertexAddress + 0], g_simConstants.fixedPointMultiplier);
+        dy = decodeFixedPoint(g_gridSrc[gridVertexAddress + 1] + g_sleepingGrid[gridVertexAddress + 1], g_simConstants.fixedPointMultiplier);
+        dz = decodeFixedPoint(g_gridSrc[gridVertexAddress + 2] + g_sleepingGrid[gridVertexAddress + 2], g_simConstants.fixedPointMultiplier);
+        w = decodeFixedPoint(g_gridSrc[gridVertexAddress + 3] + g_sleepingGrid[gridVertexAddress + 3], g_simConstants.fixedPointMultiplier);
+        v = decodeFixedPoint(g_gridSrc[gridVertexAddress + 4] + g_sleepingGrid[gridVertexAddress + 4], g_simConstants.fixedPointMultiplier);
 
         // Grid update
         if (w < 1e-5f)
@@ -330,7 +440,7 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
             dz /= w;
         }
 
-        float3 gridDisplacement = float3(dx, dy, dz);
+        float3 gridDisplacement = float3(dx, dy, dz) * rateScale;
 
         // Collision detection against shapes
         for (int shapeIndex = 0; shapeIndex < g_simConstants.shapeCount; shapeIndex++)
@@ -401,6 +511,13 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
     s_tileDataDst[tileDataIndex + 3] = 0;
     s_tileDataDst[tileDataIndex + 4] = 0;
 
+    if (indexInGroup == 0)
+    {
+        s_residual = 0;
+        s_maxDisplacement = 0;
+        s_bukkitMotion = 0;
+    }
+
     // Synchronize all threads in the group
     GroupMemoryBarrierWithGroupSync();
     
@@ -416,7 +533,20 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
         float3 p = g_positions[myParticleIndex].xyz;
         QuadraticWeightInfo weightInfo = quadraticWeightInit(p);
 
-		float3 displacement = g_displacements[myParticleIndex].xyz;
+		float4 carried = g_displacements[myParticleIndex];
+		float3 displacement = carried.xyz;
+        // The carried velocities are rescaled to this step when deltaTime or the bukkit's rate level changed. w is the step
+        // they were taken over, 0 before the particle's first. Displacements aren't written back before iteration 1's G2P,
+        // so it compares against the scaled ones too
+        float carriedScale = carried.w > 0.0 ? stepTime / carried.w : g_simConstants.displacementScale;
+        if (g_simConstants.iteration < 2)
+        {
+            displacement *= carriedScale;
+        }
+        if (g_simConstants.iteration == 0)
+        {
+            particle.deformationDisplacement *= carriedScale;
+        }
         
         if (g_simConstants.iteration != 0)
         {
@@ -486,6 +616,9 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
             
             // Save the deformation gradient as a 3x3 matrix by adding the identity matrix to the rest
             particle.deformationDisplacement = B * 4.0;
+
+            // How far this iteration moved the particle's displacement, the solver stops once it is small everywhere
+            InterlockedMax(s_residual, asuint(length(d - displacement)));
             displacement = d;
             
             // Integration
@@ -510,7 +643,19 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
                     particle.deformationGradient = (Identity + particle.deformationDisplacement) * particle.deformationGradient;
                 }
 
-                if (material != MaterialLiquid) {
+                // Elastic and visco only clamp the singular values, recomposing the SVD gives F back when none of them
+                // is clamped. Elastic's lower bound is svd()'s own 0.5 rather than the 0.1 below
+                float plasticity = 0.9f;
+                float yieldSurface = exp(1.0 - plasticity);
+                bool keepDeformationGradient = false;
+                if (material == MaterialElastic) {
+                    keepDeformationGradient = singularValuesWithin(particle.deformationGradient, 0.5, 1000.0);
+                }
+                else if (material == MaterialVisco) {
+                    keepDeformationGradient = singularValuesWithin(particle.deformationGradient, 1.0 / yieldSurface, yieldSurface);
+                }
+
+                if (material != MaterialLiquid && !keepDeformationGradient) {
 
 
                     SVDResult svdResult = svd(particle.deformationGradient);
@@ -576,8 +721,6 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
                     else if (material == MaterialVisco)
                     {
                         //SVDResult svdResult = svd(particle.deformationGradient);
-                         float plasticity = 0.9f;
-                         float yieldSurface = exp(1.0 - plasticity);
                          // Calculate current volume
                          float J = svdResult.Sigma.x * svdResult.Sigma.y * svdResult.Sigma.z;  // Changed for 3D
                          
@@ -618,6 +761,7 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
                 
                 // Update particle position
                 p += displacement;
+                InterlockedMax(s_bukkitMotion, asuint(length(displacement) / rateScale));
 
 				// Color the liquid based on the displacement, before external forces
                 float maxDisplacement = 0.03;
@@ -638,23 +782,23 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
 
 						if (g_mouseConstants.mouseFunction == 0) // Push
                         {
-                            displacement += normOffset * g_mouseConstants.mouseActivation * g_mouseConstants.mouseStrength * g_simConstants.deltaTime * 3.f;
+                            displacement += normOffset * g_mouseConstants.mouseActivation * g_mouseConstants.mouseStrength * stepTime * 3.f;
                         }
                         else if (g_mouseConstants.mouseFunction == 1) // Grab
                         {
                             float3 isect_pos = g_mouseConstants.mousePosition.xyz + g_mouseConstants.mouseRayDirection.xyz * 60;
-                            displacement = -(p - isect_pos) * g_simConstants.deltaTime * g_mouseConstants.mouseStrength * 0.5;
+                            displacement = -(p - isect_pos) * stepTime * g_mouseConstants.mouseStrength * 0.5;
                         }
                         else if (g_mouseConstants.mouseFunction == 2) // Pull
 						{
                             float3 isect_pos = g_mouseConstants.mousePosition.xyz + g_mouseConstants.mouseRayDirection.xyz * t;
-                            displacement = -(p - isect_pos) * g_simConstants.deltaTime * g_mouseConstants.mouseStrength * 0.5;
+                            displacement = -(p - isect_pos) * stepTime * g_mouseConstants.mouseStrength * 0.5;
 						}
                     }
                 }
 
                 // Gravity Acceleration is normalized to the vertical size of the window
-                displacement.y -= float(g_simConstants.gridSize.y) * g_simConstants.gravityStrength * g_simConstants.deltaTime * g_simConstants.deltaTime;
+                displacement.y -= float(g_simConstants.gridSize.y) * g_simConstants.gravityStrength * stepTime * stepTime;
 
                 // Free count may be negative because of emission. So make sure it is at last zero before incrementing.
                 int originalMax; // Needed for InterlockedMax output parameter
@@ -692,12 +836,15 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
                 }
 
                 p = projectInsideGuardian(p, g_simConstants.gridSize, GuardianSize);
+
+                // Per deltaTime like the motion, the rate levels already keep slower bukkits' longer steps in check
+                InterlockedMax(s_maxDisplacement, asuint(length(displacement) / rateScale));
             }
             
             // Save the particle back to the buffer
             g_particles[myParticleIndex] = particle;
 			g_positions[myParticleIndex] = float4(p, liquidDensity);
-			g_displacements[myParticleIndex] = float4(displacement, 0);
+			g_displacements[myParticleIndex] = float4(displacement, stepTime);
         }
         
         {
@@ -753,17 +900,16 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
             else if (material == MaterialVisco) {
              
                 float3x3 F = mul(Identity + particle.deformationDisplacement, particle.deformationGradient);
-                SVDResult svdResult = svd(F);
                 float elasticRelaxation = g_simConstants.elasticRelaxation;
                 float elasticityRatio = g_simConstants.elasticityRatio;
                 
                 float df = det(F);
                 float cdf = clamp(abs(df), 0.1, 1000.0);
                 float3x3 Q = mul((1.0 / (sign(df) * cbrt(cdf))), F);
-                // Interpolate between rotation (svdResult.U * svdResult.Vt) and 
+                // Interpolate between rotation (the polar decomposition's R) and 
                 // volume preserving (Q) target shapes
                 float alpha = elasticityRatio;
-                float3x3 rotationPart = mul(svdResult.U, svdResult.Vt);
+                float3x3 rotationPart = polarRotation(F);
                 float3x3 targetState = alpha * rotationPart + (1.0 - alpha) * Q;
                 // Calculate displacement difference
                 float3x3 invDefGrad = inverse(particle.deformationGradient);
@@ -774,17 +920,16 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
             else if (material == MaterialElastic) {
 
                 float3x3 F = mul(Identity + particle.deformationDisplacement, particle.deformationGradient);
-                SVDResult svdResult = svd(F);
                 float elasticRelaxation = g_simConstants.elasticRelaxation;
                 float elasticityRatio = g_simConstants.elasticityRatio;
 
                 float df = det(F);
                 float cdf = clamp(abs(df), 0.1, 1000.0);
                 float3x3 Q = mul((1.0 / (sign(df) * cbrt(cdf))), F);
-                // Interpolate between rotation (svdResult.U * svdResult.Vt) and 
+                // Interpolate between rotation (the polar decomposition's R) and 
                 // volume preserving (Q) target shapes
                 float alpha = elasticityRatio;
-                float3x3 rotationPart = mul(svdResult.U, svdResult.Vt);
+                float3x3 rotationPart = polarRotation(F);
                 float3x3 targetState = alpha * rotationPart + (1.0 - alpha) * Q;
                 // Calculate displacement difference
                 float3x3 invDefGrad = inverse(particle.deformationGradient);
@@ -857,7 +1002,7 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
                         float3 offset = float3(neighborCellIndex) - p + 0.5;
 
                         float weightedMass = weight * g_massVolumeData[myParticleIndex].x;
-                        float3 momentum = weightedMass * (displacement + mul(particle.deformationDisplacement, offset));
+                        float3 momentum = weightedMass * (displacement + mul(particle.deformationDisplacement, offset)) / rateScale;
 
                         InterlockedAdd(s_tileDataDst[gridVertexIdx + 0], encodeFixedPoint(momentum.x, g_simConstants.fixedPointMultiplier));
                         InterlockedAdd(s_tileDataDst[gridVertexIdx + 1], encodeFixedPoint(momentum.y, g_simConstants.fixedPointMultiplier));
@@ -876,6 +1021,16 @@ void main(uint indexInGroup : SV_GroupIndex, uint3 groupId : SV_GroupID)
     
     // Synchronize all threads in the group
     GroupMemoryBarrierWithGroupSync();
+
+    if (indexInGroup == 0 && g_simConstants.iteration != 0)
+    {
+        InterlockedMax(g_iterationResiduals[g_simConstants.iteration], s_residual);
+        if (g_simConstants.iteration == g_simConstants.iterationCount - 1)
+        {
+            InterlockedMax(g_iterationResiduals[0], s_maxDisplacement);
+            InterlockedMax(g_bukkitSleep[bukkitIndex * BukkitSleepStride + BukkitSleepMotion], s_bukkitMotion);
+        }
+    }
     
     // Save Grid
     if (gridVertexIsValid)
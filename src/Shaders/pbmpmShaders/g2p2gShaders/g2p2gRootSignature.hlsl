@@ -1,7 +1,7 @@
 #define ROOTSIG \
 "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)," \
-"RootConstants(num32BitConstants=24, b0)," \
-"RootConstants(num32BitConstants=12, b1)," \
+"CBV(b0)," /* Sim constants, from the upload ring */ \
+"CBV(b1)," /* Mouse constants, from the upload ring */ \
 "CBV(b2)," /* For Sim Shapes */ \
 "DescriptorTable(UAV(u0, numDescriptors=2)),"    /* Table for particleBuffer, freeIndicesBuffer */ \
 "DescriptorTable(SRV(t0, numDescriptors=2))," /* Table for BukkitParticleData & ThreadData */ \
@@ -10,6 +10,9 @@
 "DescriptorTable(UAV(u3, numDescriptors=1))," /* Table for nextnext grid */ \
 "DescriptorTable(UAV(u4, numDescriptors=1))," /* Table for temp tile data */ \
 "DescriptorTable(UAV(u5, numDescriptors=3))," /* Table for g_positions & materials & displacement*/ \
-"DescriptorTable(SRV(t3, numDescriptors=1))" /* Table for read only volume mass data */
+"DescriptorTable(SRV(t3, numDescriptors=1))," /* Table for read only volume mass data */ \
+"DescriptorTable(UAV(u8, numDescriptors=1))," /* Table for iteration residuals */ \
+"DescriptorTable(SRV(t4, numDescriptors=1))," /* Table for the sleeping grid */ \
+"DescriptorTable(UAV(u9, numDescriptors=1))" /* Table for bukkit sleep state */
 
 
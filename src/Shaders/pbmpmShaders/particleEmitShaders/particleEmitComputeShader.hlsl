@@ -3,7 +3,7 @@
 
 // Taken from https://github.com/electronicarts/pbmpm
 
-// Root constants bound to b0 & b1
+// Per-frame constants bound to b0 & b1, sub-allocated from the upload ring
 cbuffer simConstants : register(b0) {
 	PBMPMConstants g_simConstants;
 };
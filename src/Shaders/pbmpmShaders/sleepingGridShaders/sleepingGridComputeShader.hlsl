@@ -0,0 +1,91 @@
+#include "sleepingGridRootSignature.hlsl"  // Includes the ROOTSIG definition
+#include "../../pbmpmShaders/PBMPMCommon.hlsl"  // Includes the bukkit sleep layout
+
+// Scatters the particles of asleep and waiting bukkits into the sleeping grid, which g2p2g adds to the grid it reads every
+// iteration. Awake neighbours keep seeing their mass and volume while they aren't simulated. Asleep particles don't move,
+// so their momentum only has the affine part, with the deformation displacement they fell asleep with. Waiting ones bring
+// the displacement their last step ended with, which is how the faster levels around them feel them between steps
+
+// Root constants bound to b0
+ConstantBuffer<PBMPMConstants> g_simConstants : register(b0);
+
+StructuredBuffer<Particle> g_particles : register(t0);
+StructuredBuffer<uint> g_particleCount : register(t1);
+StructuredBuffer<float4> g_positions : register(t2);
+StructuredBuffer<float4> g_massVolumeData : register(t3);
+StructuredBuffer<uint> g_bukkitSleep : register(t4);
+RWStructuredBuffer<int> g_sleepingGrid : register(u0);
+StructuredBuffer<float4> g_displacements : register(t5);
+
+[numthreads(ParticleDispatchSize, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= g_particleCount[0])
+    {
+        return;
+    }
+
+    Particle particle = g_particles[id.x];
+    if (particle.enabled == 0.0f)
+    {
+        return;
+    }
+
+    float3 p = g_positions[id.x].xyz;
+    int3 particleBukkit = positionToBukkitId(p);
+    if (any(particleBukkit < int3(0, 0, 0)) ||
+        uint(particleBukkit.x) >= g_simConstants.bukkitCountX ||
+        uint(particleBukkit.y) >= g_simConstants.bukkitCountY ||
+        uint(particleBukkit.z) >= g_simConstants.bukkitCountZ)
+    {
+        return;
+    }
+
+    uint bukkitIndex = bukkitAddressToIndex(uint3(particleBukkit), g_simConstants.bukkitCountX, g_simConstants.bukkitCountY);
+    uint state = g_bukkitSleep[bukkitIndex * BukkitSleepStride + BukkitSleepState];
+    if (state == BukkitStateAwake)
+    {
+        return;
+    }
+
+    // The grid holds displacements over deltaTime. w is the time step the particle's were taken over, 0 before its first step
+    float4 displacement = g_displacements[id.x];
+    float displacementScale = displacement.w > 0.0 ? g_simConstants.deltaTime / displacement.w : 1.0;
+    float3 velocity = state == BukkitStateWaiting ? displacement.xyz : float3(0, 0, 0);
+
+    // Same P2G as g2p2g, into the global grid instead of a tile
+    QuadraticWeightInfo weightInfo = quadraticWeightInit(p);
+    float4 massVolume = g_massVolumeData[id.x];
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                float weight = weightInfo.weights[i].x * weightInfo.weights[j].y * weightInfo.weights[k].z;
+                int3 neighborCellIndex = int3(weightInfo.cellIndex) + int3(i, j, k);
+                if (any(neighborCellIndex < int3(0, 0, 0)) || any(neighborCellIndex >= int3(g_simConstants.gridSize)))
+                {
+                    continue;
+                }
+
+                uint gridVertexAddress = gridVertexIndex(uint3(neighborCellIndex), g_simConstants.gridSize);
+
+                float3 offset = float3(neighborCellIndex) - p + 0.5;
+                float weightedMass = weight * massVolume.x;
+                float3 momentum = weightedMass * (velocity + mul(particle.deformationDisplacement, offset)) * displacementScale;
+
+                InterlockedAdd(g_sleepingGrid[gridVertexAddress + 0], encodeFixedPoint(momentum.x, g_simConstants.fixedPointMultiplier));
+                InterlockedAdd(g_sleepingGrid[gridVertexAddress + 1], encodeFixedPoint(momentum.y, g_simConstants.fixedPointMultiplier));
+                InterlockedAdd(g_sleepingGrid[gridVertexAddress + 2], encodeFixedPoint(momentum.z, g_simConstants.fixedPointMultiplier));
+                InterlockedAdd(g_sleepingGrid[gridVertexAddress + 3], encodeFixedPoint(weightedMass, g_simConstants.fixedPointMultiplier));
+
+                if (g_simConstants.useGridVolumeForLiquid != 0)
+                {
+                    InterlockedAdd(g_sleepingGrid[gridVertexAddress + 4], encodeFixedPoint(weight * massVolume.y, g_simConstants.fixedPointMultiplier));
+                }
+            }
+        }
+    }
+}
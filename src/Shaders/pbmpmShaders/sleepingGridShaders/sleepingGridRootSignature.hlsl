@@ -0,0 +1,9 @@
+#define ROOTSIG \
+"RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT)," \
+"RootConstants(num32BitConstants=36, b0)," \
+"DescriptorTable(SRV(t0, numDescriptors=2)),"    /* SRVs for g_particles, g_particleCount */ \
+"DescriptorTable(SRV(t2, numDescriptors=1)),"    /* SRV for g_positions */ \
+"DescriptorTable(SRV(t3, numDescriptors=1)),"    /* SRV for g_massVolumeData */ \
+"DescriptorTable(SRV(t4, numDescriptors=1)),"    /* SRV for g_bukkitSleep */ \
+"DescriptorTable(UAV(u0, numDescriptors=1)),"    /* UAV for g_sleepingGrid */ \
+"DescriptorTable(SRV(t5, numDescriptors=1))"     /* SRV for g_displacements */
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "SimulationMath.h"
+#include "SimulationParams.h"
+
+// The material dependent parts of g2p2gComputeShader.hlsl, one instantiation per material so the particle loop has no
+// material branches. Everything here follows the shader except where noted
+
+// Which particle fields a material reads and writes, the kernel doesn't touch the others
+template<int Material>
+struct MaterialTraits {
+	static constexpr bool hasLiquidDensity = Material == SimMaterialLiquid;
+	static constexpr bool hasDeformationGradient = Material != SimMaterialLiquid;
+	static constexpr bool hasLogJp = Material == SimMaterialSand;
+};
+
+// One particle while a kernel works on it
+struct ParticleState {
+	Vec3 position;
+	Vec3 displacement;
+	Mat3 deformationDisplacement;
+	// Only loaded for the fields MaterialTraits asks for
+	float liquidDensity;
+	Mat3 deformationGradient;
+	float logJp;
+};
+
+// Colors by displacement at integration, like darkColorTable / lightColorTable
+static const Vec3 simDarkColors[SIM_MATERIAL_COUNT] = {
+	{ 0.0f, 0.573f, 0.878f }, { 0.0f, 0.8f, 0.0f }, { 0.9f, 0.83f, 0.0f }, { 0.7f, 0.0f, 0.8f }, { 0.8f, 0.8f, 0.8f }
+};
+static const Vec3 simLightColors[SIM_MATERIAL_COUNT] = {
+	{ 0.094f, 0.8f, 0.929f }, { 0.1f, 0.85f, 0.0f }, { 1.0f, 0.9f, 0.0f }, { 0.9f, 0.15f, 0.95f }, { 0.9f, 0.9f, 0.9f }
+};
+// Color of new particles, like colorTable in particleEmitComputeShader.hlsl
+static const Vec3 simEmitColors[SIM_MATERIAL_COUNT] = {
+	{ 0.0f, 0.573f, 0.878f }, { 0.0f, 0.75f, 0.0f }, { 0.8f, 0.8f, 0.0f }, { 0.7f, 0.0f, 0.8f }, { 0.8f, 0.8f, 0.8f }
+};
+
+// Visco's singular values are kept within [1 / yieldSurface, yieldSurface], exp(1 - plasticity) with a plasticity of 0.9
+static const float simViscoYieldSurface = std::exp(1.0f - 0.9f);
+
+// Removes the deviatoric part of the deformation displacement
+inline void applyViscosity(Mat3& deformationDisplacement, float viscosity) {
+	Mat3 deviatoric = (deformationDisplacement + transpose(deformationDisplacement)) * -1.0f;
+	deformationDisplacement += deviatoric * (viscosity * 0.5f);
+}
+
+// Pulls the deformation displacement towards a mix of the rotation, or the elastic part for sand, and the volume
+// preserving shape, the particle update at the end of every g2p2g iteration
+template<int Material>
+void relaxMaterial(ParticleState& s, const SimulationParams& params) {
+	if constexpr (Material == SimMaterialLiquid) {
+		applyViscosity(s.deformationDisplacement, params.liquidViscosity);
+
+		float alpha = 0.5f * (1.0f / s.liquidDensity - trace(s.deformationDisplacement) - 1.0f);
+		s.deformationDisplacement += identity3() * (params.liquidRelaxation * alpha);
+	}
+	else if constexpr (Material == SimMaterialSnow) {
+		SvdResult svdResult = svd(s.deformationGradient);
+
+		Vec3 elasticSigma = clampVec3(svdResult.sigma, 0.5f, 1.5f);
+		float Je = elasticSigma.x * elasticSigma.y * elasticSigma.z;
+
+		applyViscosity(s.deformationDisplacement, 1.0f);
+
+		// The shader also works out a hardened deformation gradient here, but doesn't keep it
+		float alpha = 0.5f * (1.0f / (Je + 1e-3f) - trace(s.deformationDisplacement) - 1.0f);
+		s.deformationDisplacement += identity3() * (0.2f * alpha);
+	}
+	else {
+		Mat3 F = mul(identity3() + s.deformationDisplacement, s.deformationGradient);
+
+		float relaxation = Material == SimMaterialSand ? params.sandRelaxation : params.elasticRelaxation;
+		float ratio = Material == SimMaterialSand ? params.sandRatio : params.elasticityRatio;
+
+		// Sand keeps its clamped elastic part, elastic and visco just the rotation
+		Mat3 target;
+		if constexpr (Material == SimMaterialSand) {
+			SvdResult svdResult = svd(F);
+			if (s.logJp == 0.0f) {
+				svdResult.sigma = clampVec3(svdResult.sigma, 1.0f, 1000.0f);
+			}
+			target = recompose(svdResult, svdResult.sigma);
+		}
+		else {
+			target = polarRotation(F);
+		}
+
+		float df = det(F);
+		float cdf = Material == SimMaterialSand ? std::clamp(std::abs(df), 0.4f, 1.6f) : std::clamp(std::abs(df), 0.1f, 1000.0f);
+		Mat3 Q = F * (1.0f / (signOf(df) * std::cbrt(cdf)));
+
+		target = target * ratio + Q * (1.0f - ratio);
+
+		Mat3 diff = mul(target, inverse(s.deformationGradient)) - identity3() - s.deformationDisplacement;
+		s.deformationDisplacement += diff * relaxation;
+
+		if constexpr (Material == SimMaterialSand) {
+			applyViscosity(s.deformationDisplacement, params.liquidViscosity);
+		}
+	}
+}
+
+// Evolves the deformation gradient, or the liquid density, by the step's deformation displacement and applies the
+// material's plasticity. Runs on the last iteration of a substep
+template<int Material>
+void integrateMaterial(ParticleState& s, const SimulationParams& params) {
+	if constexpr (Material == SimMaterialLiquid) {
+		// det(I + D) is about 1 + tr(D), see the shader for why this keeps volume better than evolving F
+		s.liquidDensity *= trace(s.deformationDisplacement) + 1.0f;
+		s.liquidDensity = std::max(s.liquidDensity, 0.05f);
+	}
+	else if constexpr (Material == SimMaterialSnow) {
+		// Component-wise like the shader, the material parameters are tuned for it and sand comes apart with a matrix product
+		s.deformationGradient = mulComponents(identity3() + s.deformationDisplacement, s.deformationGradient);
+		SvdResult svdResult = svd(s.deformationGradient);
+
+		const float criticalCompression = 0.025f;
+		const float criticalStretch = 0.025f;
+		const float hardeningCoeff = 10.0f;
+
+		Vec3 elasticSigma = clampVec3(svdResult.sigma, 1.0f - criticalCompression, 1.0f + criticalStretch);
+		float Je = elasticSigma.x * elasticSigma.y * elasticSigma.z;
+		float hardening = std::exp(hardeningCoeff * (1.0f - Je));
+
+		Mat3 Fe = recompose(svdResult, elasticSigma);
+		Mat3 FeInverse = recompose(svdResult, { 1.0f / elasticSigma.x, 1.0f / elasticSigma.y, 1.0f / elasticSigma.z });
+		Mat3 Fp = mul(s.deformationGradient, FeInverse);
+		s.deformationGradient = mul(Fe * hardening, Fp);
+	}
+	else {
+		s.deformationGradient = mulComponents(identity3() + s.deformationDisplacement, s.deformationGradient);
+
+		// Elastic and visco only clamp the singular values, recomposing the SVD gives F back when none of them is
+		// clamped. Elastic's lower bound is svd()'s own 0.5 rather than the 0.1 below
+		if constexpr (Material == SimMaterialElastic) {
+			if (singularValuesWithin(s.deformationGradient, 0.5f, 1000.0f)) {
+				return;
+			}
+		}
+		else if constexpr (Material == SimMaterialVisco) {
+			if (singularValuesWithin(s.deformationGradient, 1.0f / simViscoYieldSurface, simViscoYieldSurface)) {
+				return;
+			}
+		}
+
+		SvdResult svdResult = svd(s.deformationGradient);
+		svdResult.sigma = clampVec3(svdResult.sigma, 0.1f, 1000.0f);
+
+		if constexpr (Material == SimMaterialSand) {
+			// Drucker-Prager, Klár et al. 2016, Drucker-prager elastoplasticity for sand animation
+			float sinPhi = std::sin(params.frictionAngle * 3.14159f / 180.0f);
+			float alpha = std::sqrt(2.0f / 3.0f) * (2.0f * sinPhi) / (3.0f - sinPhi);
+			const float beta = 0.5f;
+
+			Vec3 safeSigma = maxVec3(absVec3(svdResult.sigma), { 1e-6f, 1e-6f, 1e-6f });
+			Vec3 eDiag = { std::log(safeSigma.x), std::log(safeSigma.y), std::log(safeSigma.z) };
+			float strainTrace = eDiag.x + eDiag.y + eDiag.z + s.logJp;
+			float meanStrain = strainTrace / 3.0f;
+
+			// The strain is diagonal, so is its deviatoric part
+			Vec3 eHat = eDiag - Vec3{ meanStrain, meanStrain, meanStrain };
+			float frobNorm = length(eHat);
+
+			if (strainTrace >= 0.0f) {
+				svdResult.sigma = lerp(svdResult.sigma, Vec3{ 1.0f, 1.0f, 1.0f }, 0.5f);
+				s.logJp = beta * strainTrace;
+			}
+			else {
+				float deltaGamma = frobNorm + (params.sandRatio + 1.0f) * strainTrace * alpha;
+				if (deltaGamma > 0.0f) {
+					Vec3 h = eDiag - eHat * (deltaGamma / std::max(frobNorm, 1e-9f));
+					svdResult.sigma = { std::exp(h.x), std::exp(h.y), std::exp(h.z) };
+				}
+				s.logJp = 0.0f;
+			}
+		}
+		else if constexpr (Material == SimMaterialVisco) {
+			float J = svdResult.sigma.x * svdResult.sigma.y * svdResult.sigma.z;
+
+			svdResult.sigma = clampVec3(svdResult.sigma, 1.0f / simViscoYieldSurface, simViscoYieldSurface);
+			float newJ = svdResult.sigma.x * svdResult.sigma.y * svdResult.sigma.z;
+			svdResult.sigma = svdResult.sigma * std::cbrt(J / newJ);
+		}
+
+		s.deformationGradient = recompose(svdResult, svdResult.sigma);
+	}
+}
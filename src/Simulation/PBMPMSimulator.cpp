@@ -0,0 +1,896 @@
+#include "PBMPMSimulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+// Vertices of the float grid a bukkit owns, its tile in the shader also reaches into its neighbours' ones
+static_assert(PBMPMSimulator::TILE_EDGE == 4, "The grid update below assumes 2x2x2 bukkits with a halo of 1");
+
+static int divUp(int count, int groupSize) {
+	return (count + groupSize - 1) / groupSize;
+}
+
+static Vec3 projectInsideGuardian(const Vec3& p, const Int3& gridSize, float guardianSize) {
+	Vec3 clampMin = { guardianSize, guardianSize, guardianSize };
+	Vec3 clampMax = toVec3(gridSize) - clampMin - Vec3{ 1.0f, 1.0f, 1.0f };
+	return clampVec3(p, clampMin, clampMax);
+}
+
+// Rounds towards zero like encodeFixedPoint in PBMPMCommon.hlsl. The product is a double so multipliers a float can't hold,
+// like 10^13, stay exact. Clamped to what an int64 holds, a 32 bit grid checks its own range when the tile is added to it
+static int64_t encodeFixedPoint(float value, double multiplier) {
+	return (int64_t)std::clamp(value * multiplier, -9.2e18, 9.2e18);
+}
+
+static void atomicMax(std::atomic<uint32_t>& target, uint32_t value) {
+	uint32_t previous = target.load(std::memory_order_relaxed);
+	while (value > previous && !target.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+	}
+}
+
+// FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = (const uint8_t*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static const uint64_t HASH_SEED = 14695981039346656037ull;
+
+static float getBias(float time, float bias) {
+	return time / (((1.0f / bias) - 2.0f) * (1.0f - time) + 1.0f);
+}
+
+static Mat3 rotZ(float theta) {
+	float ct = std::cos(theta);
+	float st = std::sin(theta);
+	return { { { ct, -st, 0 }, { st, ct, 0 }, { 0, 0, 1 } } };
+}
+
+struct CollideResult {
+	bool collides;
+	float penetration;
+	Vec3 normal;
+};
+
+// Same as collide() in PBMPMCommon.hlsl
+static CollideResult collide(const SimulationShape& shape, const Vec3& pos) {
+	CollideResult result{ false, 0.0f, { 0.0f, 0.0f, 0.0f } };
+	if (shape.shapeType == SimShapeCircle) {
+		Vec3 offset = shape.position - pos;
+		float offsetLen = length(offset);
+		result.collides = offsetLen <= shape.radius;
+		result.penetration = -(offsetLen - shape.radius);
+		result.normal = offset * (offsetLen == 0.0f ? 0.0f : 1.0f / offsetLen);
+	}
+	else if (shape.shapeType == SimShapeBox) {
+		Mat3 R = rotZ(shape.rotation / 180.0f * 3.14159f);
+		Vec3 rotOffset = mul(R, pos - shape.position);
+		Vec3 penetration = (absVec3(rotOffset) - shape.halfSize) * -1.0f;
+		Vec3 normal = mul(transpose(R), penetration.y < penetration.x ? Vec3{ signOf(rotOffset.x), 0.0f, 0.0f } : Vec3{ 0.0f, signOf(rotOffset.y), 0.0f });
+
+		float minPen = std::min(std::min(penetration.x, penetration.y), penetration.z);
+		result.collides = minPen > 0.0f;
+		result.penetration = minPen;
+		result.normal = normal * -1.0f;
+	}
+	return result;
+}
+
+// Same weights as quadraticWeightInit, multiplied out for the 3x3x3 vertices
+static void buildStencil(const Vec3& position, ParticleStencil& stencil) {
+	Vec3 roundDownPosition = floorVec3(position);
+	Vec3 offset = position - roundDownPosition - Vec3{ 0.5f, 0.5f, 0.5f };
+	Vec3 below = Vec3{ 0.5f, 0.5f, 0.5f } - offset;
+	Vec3 above = Vec3{ 0.5f, 0.5f, 0.5f } + offset;
+
+	Vec3 weights[3];
+	weights[0] = mulComponents(below, below) * 0.5f;
+	weights[1] = Vec3{ 0.75f, 0.75f, 0.75f } - mulComponents(offset, offset);
+	weights[2] = mulComponents(above, above) * 0.5f;
+
+	int w = 0;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			float weightXY = weights[i].x * weights[j].y;
+			for (int k = 0; k < 3; k++) {
+				stencil.weights[w++] = weightXY * weights[k].z;
+			}
+		}
+	}
+
+	stencil.cellIndex = { (int)roundDownPosition.x - 1, (int)roundDownPosition.y - 1, (int)roundDownPosition.z - 1 };
+	stencil.offset = toVec3(stencil.cellIndex) - position + Vec3{ 0.5f, 0.5f, 0.5f };
+}
+
+PBMPMSimulator::PBMPMSimulator(WorkerPool* pool)
+	: pool(pool), scan(pool)
+{
+}
+
+template<typename Task>
+void PBMPMSimulator::parallelFor(size_t count, size_t grainSize, const Task& task) {
+	if (pool) {
+		pool->parallelFor(count, grainSize, task);
+	}
+	else if (count > 0) {
+		task(0, count);
+	}
+}
+
+int PBMPMSimulator::addParticle(const Vec3& position, int material, float volume, float density) {
+	int index;
+	if (!freeIndices.empty()) {
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else {
+		index = (int)positions.size();
+		positions.emplace_back();
+		displacements.emplace_back();
+		masses.emplace_back();
+		volumes.emplace_back();
+		enabled.emplace_back();
+		if (storageFormat == SimStorageFloat) {
+			materials.emplace_back();
+			deformationGradients.emplace_back();
+			deformationDisplacements.emplace_back();
+			logJps.emplace_back();
+		}
+		else {
+			packedMaterials.resize(packedMaterials.size() + 4);
+			packedDeformationGradients.resize(packedDeformationGradients.size() + 9);
+			packedDeformationDisplacements.resize(packedDeformationDisplacements.size() + 9);
+			packedLogJps.emplace_back();
+		}
+	}
+
+	// Like createParticle and addParticle in particleEmitComputeShader.hlsl, without the jitter
+	Vec3 color = simEmitColors[material];
+	positions[index] = { position.x, position.y, position.z, 1.0f };
+	storeMaterial(index, { color.x, color.y, color.z, (float)material });
+	displacements[index] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	masses[index] = volume * density;
+	volumes[index] = volume;
+	storeDeformationGradient(index, identity3());
+	storeDeformationDisplacement(index, zero3());
+	storeLogJp(index, 1.0f);
+	enabled[index] = 1;
+	return index;
+}
+
+Vec4 PBMPMSimulator::getMaterial(size_t index) const {
+	if (storageFormat == SimStorageFloat) {
+		return materials[index];
+	}
+	const uint16_t* packed = &packedMaterials[index * 4];
+	return { unpack(packed[0]), unpack(packed[1]), unpack(packed[2]), unpack(packed[3]) };
+}
+
+void PBMPMSimulator::copyMaterials(std::vector<Vec4>& out) const {
+	out.resize(positions.size());
+	for (size_t i = 0; i < out.size(); i++) {
+		out[i] = getMaterial(i);
+	}
+}
+
+Mat3 PBMPMSimulator::getDeformationGradient(size_t index) const {
+	return loadDeformationGradient(index);
+}
+
+Mat3 PBMPMSimulator::getDeformationDisplacement(size_t index) const {
+	return loadDeformationDisplacement(index);
+}
+
+float PBMPMSimulator::getLogJp(size_t index) const {
+	return loadLogJp(index);
+}
+
+size_t PBMPMSimulator::getBytesPerParticle() const {
+	size_t bytes = sizeof(Vec4) * 2 + sizeof(float) * 2 + sizeof(uint8_t);
+	return bytes + (storageFormat == SimStorageFloat ? sizeof(Vec4) + sizeof(Mat3) * 2 + sizeof(float) : sizeof(uint16_t) * 23);
+}
+
+// Packed as F - I, which stays small for every material that keeps F near a rotation, so half keeps most of its bits
+Mat3 PBMPMSimulator::loadDeformationGradient(size_t index) const {
+	if (storageFormat == SimStorageFloat) {
+		return deformationGradients[index];
+	}
+	const uint16_t* packed = &packedDeformationGradients[index * 9];
+	Mat3 result;
+	for (int i = 0; i < 9; i++) {
+		result.m[i / 3][i % 3] = unpack(packed[i]) + (i % 4 == 0 ? 1.0f : 0.0f);
+	}
+	return result;
+}
+
+void PBMPMSimulator::storeDeformationGradient(size_t index, const Mat3& deformationGradient) {
+	if (storageFormat == SimStorageFloat) {
+		deformationGradients[index] = deformationGradient;
+		return;
+	}
+	uint16_t* packed = &packedDeformationGradients[index * 9];
+	for (int i = 0; i < 9; i++) {
+		packed[i] = pack(deformationGradient.m[i / 3][i % 3] - (i % 4 == 0 ? 1.0f : 0.0f));
+	}
+}
+
+Mat3 PBMPMSimulator::loadDeformationDisplacement(size_t index) const {
+	if (storageFormat == SimStorageFloat) {
+		return deformationDisplacements[index];
+	}
+	const uint16_t* packed = &packedDeformationDisplacements[index * 9];
+	Mat3 result;
+	for (int i = 0; i < 9; i++) {
+		result.m[i / 3][i % 3] = unpack(packed[i]);
+	}
+	return result;
+}
+
+void PBMPMSimulator::storeDeformationDisplacement(size_t index, const Mat3& deformationDisplacement) {
+	if (storageFormat == SimStorageFloat) {
+		deformationDisplacements[index] = deformationDisplacement;
+		return;
+	}
+	uint16_t* packed = &packedDeformationDisplacements[index * 9];
+	for (int i = 0; i < 9; i++) {
+		packed[i] = pack(deformationDisplacement.m[i / 3][i % 3]);
+	}
+}
+
+float PBMPMSimulator::loadLogJp(size_t index) const {
+	return storageFormat == SimStorageFloat ? logJps[index] : unpack(packedLogJps[index]);
+}
+
+void PBMPMSimulator::storeLogJp(size_t index, float logJp) {
+	if (storageFormat == SimStorageFloat) {
+		logJps[index] = logJp;
+		return;
+	}
+	packedLogJps[index] = pack(logJp);
+}
+
+void PBMPMSimulator::storeColor(size_t index, const Vec3& color) {
+	if (storageFormat == SimStorageFloat) {
+		materials[index] = { color.x, color.y, color.z, materials[index].w };
+		return;
+	}
+	uint16_t* packed = &packedMaterials[index * 4];
+	packed[0] = pack(color.x);
+	packed[1] = pack(color.y);
+	packed[2] = pack(color.z);
+}
+
+void PBMPMSimulator::storeMaterial(size_t index, const Vec4& material) {
+	if (storageFormat == SimStorageFloat) {
+		materials[index] = material;
+		return;
+	}
+	// Material numbers are small integers, exact in either format
+	uint16_t* packed = &packedMaterials[index * 4];
+	packed[0] = pack(material.x);
+	packed[1] = pack(material.y);
+	packed[2] = pack(material.z);
+	packed[3] = pack(material.w);
+}
+
+void PBMPMSimulator::setStorageFormat(SimStorageFormat format) {
+	if (format == storageFormat) {
+		return;
+	}
+
+	size_t particleCount = positions.size();
+	std::vector<Vec4> floatMaterials(particleCount);
+	std::vector<Mat3> floatDeformationGradients(particleCount);
+	std::vector<Mat3> floatDeformationDisplacements(particleCount);
+	std::vector<float> floatLogJps(particleCount);
+	for (size_t i = 0; i < particleCount; i++) {
+		floatMaterials[i] = getMaterial(i);
+		floatDeformationGradients[i] = loadDeformationGradient(i);
+		floatDeformationDisplacements[i] = loadDeformationDisplacement(i);
+		floatLogJps[i] = loadLogJp(i);
+	}
+
+	storageFormat = format;
+	if (format == SimStorageFloat) {
+		materials = std::move(floatMaterials);
+		deformationGradients = std::move(floatDeformationGradients);
+		deformationDisplacements = std::move(floatDeformationDisplacements);
+		logJps = std::move(floatLogJps);
+		// Assigning {} would keep the capacity, the memory only comes back with a new vector
+		packedMaterials = std::vector<uint16_t>();
+		packedDeformationGradients = std::vector<uint16_t>();
+		packedDeformationDisplacements = std::vector<uint16_t>();
+		packedLogJps = std::vector<uint16_t>();
+		return;
+	}
+
+	materials = std::vector<Vec4>();
+	deformationGradients = std::vector<Mat3>();
+	deformationDisplacements = std::vector<Mat3>();
+	logJps = std::vector<float>();
+	packedMaterials.resize(particleCount * 4);
+	packedDeformationGradients.resize(particleCount * 9);
+	packedDeformationDisplacements.resize(particleCount * 9);
+	packedLogJps.resize(particleCount);
+	for (size_t i = 0; i < particleCount; i++) {
+		storeMaterial(i, floatMaterials[i]);
+		storeDeformationGradient(i, floatDeformationGradients[i]);
+		storeDeformationDisplacement(i, floatDeformationDisplacements[i]);
+		storeLogJp(i, floatLogJps[i]);
+	}
+}
+
+void PBMPMSimulator::resize() {
+	gridDimensions = params.gridSize;
+	bukkitDimensions = { divUp(gridDimensions.x, BUKKIT_SIZE), divUp(gridDimensions.y, BUKKIT_SIZE), divUp(gridDimensions.z, BUKKIT_SIZE) };
+	bukkitCount = (size_t)bukkitDimensions.x * bukkitDimensions.y * bukkitDimensions.z;
+
+	// The grids are left empty at the end of every step, only bigger ones need clearing
+	size_t vertexCount = (size_t)gridDimensions.x * gridDimensions.y * gridDimensions.z;
+	if (!params.wideFixedPoint && vertexCount * 5 > gridCapacity) {
+		gridCapacity = vertexCount * 5;
+		grid.reset(new std::atomic<int32_t>[gridCapacity]);
+		for (size_t i = 0; i < gridCapacity; i++) {
+			grid[i].store(0, std::memory_order_relaxed);
+		}
+	}
+	if (params.wideFixedPoint && vertexCount * 5 > wideGridCapacity) {
+		wideGridCapacity = vertexCount * 5;
+		wideGrid.reset(new std::atomic<int64_t>[wideGridCapacity]);
+		for (size_t i = 0; i < wideGridCapacity; i++) {
+			wideGrid[i].store(0, std::memory_order_relaxed);
+		}
+	}
+	gridValues.resize(vertexCount);
+
+	size_t keyCount = bukkitCount * SIM_MATERIAL_COUNT;
+	if (keyCount > keyCapacity) {
+		keyCapacity = keyCount;
+		keyCounts.reset(new std::atomic<int>[keyCapacity]);
+		keyCursors.reset(new std::atomic<int>[keyCapacity]);
+	}
+	bukkitOccupied.resize(bukkitCount);
+}
+
+void PBMPMSimulator::chooseMultiplier() {
+	multiplier = params.fixedPointMultiplier;
+	if (!params.autoFixedPoint || gridStats.maxGridValue <= 0.0f) {
+		return;
+	}
+
+	// A power of two, so encoding only moves the exponent, that leaves the largest value room to grow 8 times
+	double limit = params.wideFixedPoint ? 9.2e18 : 2147483647.0;
+	multiplier = std::max(std::exp2(std::floor(std::log2(limit / (gridStats.maxGridValue * 8.0)))), 1.0);
+}
+
+void PBMPMSimulator::step(const SimulationParams& newParams) {
+	using Clock = std::chrono::steady_clock;
+	auto millisecondsSince = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	params = newParams;
+	// Iteration 0 only scatters, with nothing after it no particle would gather or move
+	params.iterationCount = std::max(params.iterationCount, 2u);
+	resize();
+	chooseMultiplier();
+	setStorageFormat(params.particleStorage);
+	stageTimes = {};
+	overflowCount.store(0, std::memory_order_relaxed);
+	underflowCount.store(0, std::memory_order_relaxed);
+	maxGridValueBits.store(0, std::memory_order_relaxed);
+
+	auto start = Clock::now();
+	bukkitize();
+	stageTimes.bukkitize = millisecondsSince(start);
+
+	// Drained particles are appended from any thread, the list is trimmed back once the step is done
+	size_t firstDrained = freeIndices.size();
+	freeCount.store((int)firstDrained, std::memory_order_relaxed);
+	freeIndices.resize(positions.size());
+
+	for (unsigned int iteration = 0; iteration < params.iterationCount; iteration++) {
+		bool gather = iteration != 0;
+		bool integrate = gather && iteration == params.iterationCount - 1;
+		// Only emission reads the grid after the last iteration, and there is no emission here
+		bool scatter = iteration + 1 < params.iterationCount;
+
+		if (gather) {
+			start = Clock::now();
+			updateGrid();
+			stageTimes.gridUpdate += millisecondsSince(start);
+		}
+
+		start = Clock::now();
+		runMaterial<SimMaterialLiquid>(gather, integrate, scatter);
+		runMaterial<SimMaterialElastic>(gather, integrate, scatter);
+		runMaterial<SimMaterialSand>(gather, integrate, scatter);
+		runMaterial<SimMaterialVisco>(gather, integrate, scatter);
+		runMaterial<SimMaterialSnow>(gather, integrate, scatter);
+		stageTimes.particles += millisecondsSince(start);
+	}
+
+	freeIndices.resize(freeCount.load(std::memory_order_relaxed));
+	if (params.deterministic) {
+		// Highest index first, addParticle takes them from the back
+		std::sort(freeIndices.begin() + firstDrained, freeIndices.end(), std::greater<int>());
+	}
+
+	uint32_t maxBits = maxGridValueBits.load(std::memory_order_relaxed);
+	gridStats.fixedPointMultiplier = multiplier;
+	std::memcpy(&gridStats.maxGridValue, &maxBits, sizeof(float));
+	gridStats.overflowCount = overflowCount.load(std::memory_order_relaxed);
+	gridStats.underflowCount = underflowCount.load(std::memory_order_relaxed);
+
+	stateHash = params.deterministic ? hashState() : 0;
+}
+
+void PBMPMSimulator::bukkitize() {
+	size_t particleCount = positions.size();
+	size_t keyCount = bukkitCount * SIM_MATERIAL_COUNT;
+
+	parallelFor(keyCount, 65536, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			keyCounts[i].store(0, std::memory_order_relaxed);
+			keyCursors[i].store(0, std::memory_order_relaxed);
+		}
+	});
+
+	// Count. Added particles can start anywhere, they are brought inside the guardian before they touch the grid
+	particleKeys.resize(particleCount);
+	parallelFor(particleCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (!enabled[i]) {
+				particleKeys[i] = -1;
+				continue;
+			}
+
+			Vec3 p = projectInsideGuardian(toVec3(positions[i]), gridDimensions, (float)GUARDIAN_SIZE);
+			positions[i] = { p.x, p.y, p.z, positions[i].w };
+
+			Int3 bukkit = { (int)p.x / BUKKIT_SIZE, (int)p.y / BUKKIT_SIZE, (int)p.z / BUKKIT_SIZE };
+			int key = (int)getMaterial(i).w * (int)bukkitCount + getBukkitIndex(bukkit);
+			particleKeys[i] = key;
+			keyCounts[key].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// Allocate, material major so every material's ranges end up next to each other
+	keyOffsets.resize(keyCount);
+	int total = scan.exclusiveScan(keyCount, [&](size_t i) { return keyCounts[i].load(std::memory_order_relaxed); }, keyOffsets.data());
+	bukkitParticles.resize(total);
+	stencils.resize(total);
+
+	keyRangeOffsets.resize(keyCount + 1);
+	int rangeTotal = scan.exclusiveScan(keyCount, [&](size_t i) { return divUp(keyCounts[i].load(std::memory_order_relaxed), RANGE_SIZE); }, keyRangeOffsets.data());
+	keyRangeOffsets[keyCount] = rangeTotal;
+	ranges.resize(rangeTotal);
+
+	parallelFor(keyCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t key = begin; key < end; key++) {
+			int count = keyCounts[key].load(std::memory_order_relaxed);
+			Int3 bukkit = to3D((int)(key % bukkitCount), bukkitDimensions);
+			for (int r = 0; r * RANGE_SIZE < count; r++) {
+				ranges[keyRangeOffsets[key] + r] = { keyOffsets[key] + r * RANGE_SIZE, std::min(RANGE_SIZE, count - r * RANGE_SIZE), bukkit };
+			}
+		}
+	});
+	for (int material = 0; material <= SIM_MATERIAL_COUNT; material++) {
+		materialRangeOffsets[material] = keyRangeOffsets[material * bukkitCount];
+	}
+
+	// Insert
+	parallelFor(particleCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			int key = particleKeys[i];
+			if (key >= 0) {
+				bukkitParticles[keyOffsets[key] + keyCursors[key].fetch_add(1, std::memory_order_relaxed)] = (int)i;
+			}
+		}
+	});
+
+	// Threads insert in whatever order they reach the particles, so a key's particles can be split into ranges differently
+	// from run to run. The integer sums don't mind, but a 32 bit grid clamps tile by tile on overflow
+	if (params.deterministic) {
+		parallelFor(keyCount, 256, [&](size_t begin, size_t end) {
+			for (size_t key = begin; key < end; key++) {
+				int* first = bukkitParticles.data() + keyOffsets[key];
+				std::sort(first, first + keyCounts[key].load(std::memory_order_relaxed));
+			}
+		});
+	}
+
+	// The particles of a bukkit reach the vertices of the bukkits next to it, those are the ones the grid update visits
+	parallelFor(bukkitCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t bukkit = begin; bukkit < end; bukkit++) {
+			bool occupied = false;
+			for (int material = 0; material < SIM_MATERIAL_COUNT && !occupied; material++) {
+				occupied = keyCounts[material * bukkitCount + bukkit].load(std::memory_order_relaxed) > 0;
+			}
+			bukkitOccupied[bukkit] = occupied;
+		}
+	});
+
+	gridBukkits.resize(bukkitCount);
+	int gridBukkitCount = scan.compact(bukkitCount, [&](size_t i) {
+		Int3 bukkit = to3D((int)i, bukkitDimensions);
+		Int3 first = maxInt3(bukkit - Int3{ 1, 1, 1 }, { 0, 0, 0 });
+		Int3 last = minInt3(bukkit + Int3{ 1, 1, 1 }, bukkitDimensions - Int3{ 1, 1, 1 });
+		for (int z = first.z; z <= last.z; z++) {
+			for (int y = first.y; y <= last.y; y++) {
+				for (int x = first.x; x <= last.x; x++) {
+					if (bukkitOccupied[getBukkitIndex({ x, y, z })]) {
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}, gridBukkits.data());
+	gridBukkits.resize(gridBukkitCount);
+}
+
+void PBMPMSimulator::updateGrid() {
+	parallelFor(gridBukkits.size(), 64, [&](size_t begin, size_t end) {
+		double maxValue = 0.0;
+		uint64_t underflows = 0;
+
+		for (size_t i = begin; i < end; i++) {
+			Int3 first = to3D(gridBukkits[i], bukkitDimensions) * BUKKIT_SIZE;
+			Int3 last = minInt3(first + Int3{ BUKKIT_SIZE, BUKKIT_SIZE, BUKKIT_SIZE }, gridDimensions);
+
+			for (int z = first.z; z < last.z; z++) {
+				for (int y = first.y; y < last.y; y++) {
+					for (int x = first.x; x < last.x; x++) {
+						Int3 gridVertex = { x, y, z };
+						size_t vertexIndex = to1D(gridVertex, gridDimensions);
+
+						// Taking the values out leaves the grid empty for the next scatter
+						int64_t fixedPoint[5];
+						for (int c = 0; c < 5; c++) {
+							fixedPoint[c] = params.wideFixedPoint ?
+								wideGrid[vertexIndex * 5 + c].exchange(0, std::memory_order_relaxed) :
+								grid[vertexIndex * 5 + c].exchange(0, std::memory_order_relaxed);
+						}
+						if (fixedPoint[3] > 0 && fixedPoint[3] < 1024) {
+							underflows++;
+						}
+
+						float values[5];
+						for (int c = 0; c < 5; c++) {
+							double value = (double)fixedPoint[c] / multiplier;
+							maxValue = std::max(maxValue, std::abs(value));
+							values[c] = (float)value;
+						}
+
+						float w = values[3];
+						Vec3 gridDisplacement = w < 1e-5f ? Vec3{ 0.0f, 0.0f, 0.0f } : Vec3{ values[0], values[1], values[2] } / w;
+						Vec3 gridPosition = toVec3(gridVertex);
+
+						for (const SimulationShape& shape : shapes) {
+							if (shape.functionality != SimShapeCollider) {
+								continue;
+							}
+
+							CollideResult c = collide(shape, gridPosition + gridDisplacement);
+							if (c.collides) {
+								float penetration = std::max(dot(c.normal, gridDisplacement), 0.0f);
+								gridDisplacement = gridDisplacement - c.normal * (penetration * (1.0f - params.borderFriction));
+							}
+						}
+
+						// Vertices that would move into the guardian lose their normal motion and some of the rest
+						Vec3 displacedGridPosition = gridPosition + gridDisplacement;
+						Vec3 projectedDifference = projectInsideGuardian(displacedGridPosition, gridDimensions, (float)GUARDIAN_SIZE) - displacedGridPosition;
+						if (projectedDifference.x != 0.0f || projectedDifference.y != 0.0f || projectedDifference.z != 0.0f) {
+							Vec3 normal = normalize(projectedDifference);
+							Vec3 tangential = gridDisplacement - normal * dot(gridDisplacement, normal);
+							gridDisplacement = tangential * (1.0f - params.borderFriction);
+						}
+
+						gridValues[vertexIndex] = { gridDisplacement.x, gridDisplacement.y, gridDisplacement.z, values[4] };
+					}
+				}
+			}
+		}
+
+		float maxFloat = (float)maxValue;
+		uint32_t maxBits;
+		std::memcpy(&maxBits, &maxFloat, sizeof(float));
+		atomicMax(maxGridValueBits, maxBits);
+		if (underflows > 0) {
+			underflowCount.fetch_add(underflows, std::memory_order_relaxed);
+		}
+	});
+}
+
+template<int Material>
+void PBMPMSimulator::runMaterial(bool gather, bool integrate, bool scatter) {
+	int first = materialRangeOffsets[Material];
+	int count = materialRangeOffsets[Material + 1] - first;
+
+	parallelFor(count, 16, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			runRange<Material>(ranges[first + i], gather, integrate, scatter);
+		}
+	});
+}
+
+template<int Material>
+void PBMPMSimulator::runRange(const ParticleRange& range, bool gather, bool integrate, bool scatter) {
+	using Traits = MaterialTraits<Material>;
+	const bool gridVolume = Traits::hasLiquidDensity && params.useGridVolumeForLiquid;
+
+	// Scatter goes to the bukkit's tile first, so each vertex takes one atomic add per range. The tile is always 64 bit,
+	// a 32 bit grid finds out at the flush whether the sums fit
+	const Int3 tileOrigin = range.bukkit * BUKKIT_SIZE - Int3{ BUKKIT_HALO_SIZE, BUKKIT_HALO_SIZE, BUKKIT_HALO_SIZE };
+	int64_t tile[TILE_EDGE * TILE_EDGE * TILE_EDGE * 5];
+	if (scatter) {
+		std::fill(std::begin(tile), std::end(tile), 0);
+	}
+
+	for (int n = 0; n < range.rangeCount; n++) {
+		int index = bukkitParticles[range.rangeStart + n];
+
+		ParticleState s;
+		s.position = toVec3(positions[index]);
+		s.deformationDisplacement = loadDeformationDisplacement(index);
+		if constexpr (Traits::hasLiquidDensity) {
+			s.liquidDensity = positions[index].w;
+		}
+		if constexpr (Traits::hasDeformationGradient) {
+			s.deformationGradient = loadDeformationGradient(index);
+		}
+		if constexpr (Traits::hasLogJp) {
+			s.logJp = loadLogJp(index);
+		}
+
+		Vec4 carried = displacements[index];
+		s.displacement = toVec3(carried);
+		if (!gather) {
+			// Carried velocities are rescaled when deltaTime changed. Later iterations replace them from the grid
+			float carriedScale = carried.w > 0.0f ? params.deltaTime / carried.w : 1.0f;
+			s.displacement = s.displacement * carriedScale;
+			s.deformationDisplacement = s.deformationDisplacement * carriedScale;
+		}
+
+		ParticleStencil& stencil = stencils[range.rangeStart + n];
+		if (!gather) {
+			buildStencil(s.position, stencil);
+		}
+
+		if (gather) {
+			Mat3 B = zero3();
+			Vec3 d = { 0.0f, 0.0f, 0.0f };
+			float volume = 0.0f;
+
+			int w = 0;
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					for (int k = 0; k < 3; k++) {
+						float weight = stencil.weights[w++];
+						const Vec4& value = gridValues[to1D(stencil.cellIndex + Int3{ i, j, k }, gridDimensions)];
+
+						Vec3 weightedDisplacement = toVec3(value) * weight;
+						Vec3 offset = stencil.offset + Vec3{ (float)i, (float)j, (float)k };
+						B += outerProduct(weightedDisplacement, offset);
+						d = d + weightedDisplacement;
+
+						if (gridVolume) {
+							volume += weight * value.w;
+						}
+					}
+				}
+			}
+
+			if constexpr (Traits::hasLiquidDensity) {
+				if (gridVolume) {
+					float density = 1.0f / std::max(volume, 1e-6f);
+					if (density < 1.0f) {
+						s.liquidDensity = s.liquidDensity + (density - s.liquidDensity) * 0.1f;
+					}
+				}
+			}
+
+			s.deformationDisplacement = B * 4.0f;
+			s.displacement = d;
+
+			if (integrate) {
+				integrateMaterial<Material>(s, params);
+				s.position = s.position + s.displacement;
+
+				// Color by the displacement before external forces
+				float displacementRatio = std::min(std::abs(getBias(length(s.displacement), 0.25f)) / 0.03f, 7.0f);
+				Vec3 color = lerp(simDarkColors[Material], simLightColors[Material], displacementRatio);
+				storeColor(index, color);
+
+				// Gravity is normalized to the vertical size of the grid
+				s.displacement.y -= (float)params.gridSize.y * params.gravityStrength * params.deltaTime * params.deltaTime;
+
+				for (const SimulationShape& shape : shapes) {
+					if (shape.functionality == SimShapeCollider) {
+						CollideResult c = collide(shape, s.position);
+						if (c.collides) {
+							s.displacement = s.displacement - c.normal * (c.penetration * (1.0f - params.borderFriction));
+						}
+					}
+
+					if (shape.functionality == SimShapeDrain && enabled[index] && collide(shape, s.position).collides) {
+						enabled[index] = 0;
+						Vec4 material = getMaterial(index);
+						storeMaterial(index, { material.x, material.y, material.z, (float)SIM_MATERIAL_DRAINED });
+						freeIndices[freeCount.fetch_add(1, std::memory_order_relaxed)] = index;
+					}
+				}
+
+				s.position = projectInsideGuardian(s.position, gridDimensions, (float)GUARDIAN_SIZE);
+
+				if constexpr (Traits::hasDeformationGradient) {
+					storeDeformationGradient(index, s.deformationGradient);
+				}
+				if constexpr (Traits::hasLogJp) {
+					storeLogJp(index, s.logJp);
+				}
+			}
+
+			// The stored deformation displacement is the gathered one, relaxation only feeds the scatter
+			storeDeformationDisplacement(index, s.deformationDisplacement);
+			positions[index] = { s.position.x, s.position.y, s.position.z, Traits::hasLiquidDensity ? s.liquidDensity : positions[index].w };
+			displacements[index] = { s.displacement.x, s.displacement.y, s.displacement.z, params.deltaTime };
+		}
+
+		if (!scatter) {
+			continue;
+		}
+
+		relaxMaterial<Material>(s, params);
+
+		float mass = masses[index];
+		float particleVolume = volumes[index];
+
+		// The velocity at each vertex is D times its offset plus the displacement, and the offsets step by one along each
+		// axis, so it is worked out once and then moved along by the columns of D
+		const Mat3& D = s.deformationDisplacement;
+		Vec3 columns[3] = { { D.m[0][0], D.m[1][0], D.m[2][0] }, { D.m[0][1], D.m[1][1], D.m[2][1] }, { D.m[0][2], D.m[1][2], D.m[2][2] } };
+		Vec3 firstVelocity = s.displacement + mul(D, stencil.offset);
+		int tileFirst = to1D(stencil.cellIndex - tileOrigin, { TILE_EDGE, TILE_EDGE, TILE_EDGE });
+
+		int w = 0;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				Vec3 velocity = firstVelocity + columns[0] * (float)i + columns[1] * (float)j;
+				for (int k = 0; k < 3; k++) {
+					float weight = stencil.weights[w++];
+					int64_t* vertex = tile + (tileFirst + i + j * TILE_EDGE + k * TILE_EDGE * TILE_EDGE) * 5;
+
+					float weightedMass = weight * mass;
+					Vec3 momentum = velocity * weightedMass;
+					velocity = velocity + columns[2];
+
+					vertex[0] += encodeFixedPoint(momentum.x, multiplier);
+					vertex[1] += encodeFixedPoint(momentum.y, multiplier);
+					vertex[2] += encodeFixedPoint(momentum.z, multiplier);
+					vertex[3] += encodeFixedPoint(weightedMass, multiplier);
+					if (params.useGridVolumeForLiquid) {
+						vertex[4] += encodeFixedPoint(weight * particleVolume, multiplier);
+					}
+				}
+			}
+		}
+	}
+
+	if (scatter && range.rangeCount > 0) {
+		flushTile(tile, tileOrigin);
+	}
+}
+
+void PBMPMSimulator::flushTile(const int64_t* tile, const Int3& tileOrigin) {
+	uint64_t overflows = 0;
+	for (int t = 0; t < TILE_EDGE * TILE_EDGE * TILE_EDGE; t++) {
+		Int3 gridVertex = tileOrigin + to3D(t, { TILE_EDGE, TILE_EDGE, TILE_EDGE });
+		if (gridVertex.x < 0 || gridVertex.y < 0 || gridVertex.z < 0 ||
+			gridVertex.x >= gridDimensions.x || gridVertex.y >= gridDimensions.y || gridVertex.z >= gridDimensions.z) {
+			continue;
+		}
+
+		size_t address = (size_t)to1D(gridVertex, gridDimensions) * 5;
+		for (int c = 0; c < 5; c++) {
+			int64_t value = tile[t * 5 + c];
+			if (value == 0) {
+				continue;
+			}
+
+			if (params.wideFixedPoint) {
+				// Adding to a value of the same sign wraps past the end of the range
+				int64_t previous = wideGrid[address + c].fetch_add(value, std::memory_order_relaxed);
+				if ((previous > 0 && value > INT64_MAX - previous) || (previous < 0 && value < INT64_MIN - previous)) {
+					overflows++;
+				}
+			}
+			else {
+				int32_t clamped = (int32_t)std::clamp<int64_t>(value, INT32_MIN, INT32_MAX);
+				int64_t sum = (int64_t)grid[address + c].fetch_add(clamped, std::memory_order_relaxed) + clamped;
+				if (clamped != value || sum < INT32_MIN || sum > INT32_MAX) {
+					overflows++;
+				}
+			}
+		}
+	}
+
+	if (overflows > 0) {
+		overflowCount.fetch_add(overflows, std::memory_order_relaxed);
+	}
+}
+
+uint64_t PBMPMSimulator::hashState() {
+	// Blocks of a fixed size hashed on their own and then in order, so the hash doesn't depend on how the pool splits them
+	const size_t blockSize = 4096;
+	size_t particleCount = positions.size();
+	size_t blockCount = (particleCount + blockSize - 1) / blockSize;
+	blockHashes.resize(blockCount);
+
+	parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+		for (size_t block = begin; block < end; block++) {
+			size_t first = block * blockSize;
+			size_t count = std::min(blockSize, particleCount - first);
+
+			uint64_t hash = HASH_SEED;
+			hash = hashBytes(hash, positions.data() + first, count * sizeof(Vec4));
+			if (storageFormat == SimStorageFloat) {
+				hash = hashBytes(hash, materials.data() + first, count * sizeof(Vec4));
+				hash = hashBytes(hash, deformationGradients.data() + first, count * sizeof(Mat3));
+				hash = hashBytes(hash, deformationDisplacements.data() + first, count * sizeof(Mat3));
+				hash = hashBytes(hash, logJps.data() + first, count * sizeof(float));
+			}
+			else {
+				hash = hashBytes(hash, packedMaterials.data() + first * 4, count * 4 * sizeof(uint16_t));
+				hash = hashBytes(hash, packedDeformationGradients.data() + first * 9, count * 9 * sizeof(uint16_t));
+				hash = hashBytes(hash, packedDeformationDisplacements.data() + first * 9, count * 9 * sizeof(uint16_t));
+				hash = hashBytes(hash, packedLogJps.data() + first, count * sizeof(uint16_t));
+			}
+			hash = hashBytes(hash, displacements.data() + first, count * sizeof(Vec4));
+			hash = hashBytes(hash, masses.data() + first, count * sizeof(float));
+			hash = hashBytes(hash, volumes.data() + first, count * sizeof(float));
+			hash = hashBytes(hash, enabled.data() + first, count * sizeof(uint8_t));
+			blockHashes[block] = hash;
+		}
+	});
+
+	uint64_t hash = hashBytes(HASH_SEED, blockHashes.data(), blockCount * sizeof(uint64_t));
+	return hashBytes(hash, freeIndices.data(), freeIndices.size() * sizeof(int));
+}
+
+SimulationComparison compareSimulations(const PBMPMSimulator& reference, const PBMPMSimulator& other) {
+	SimulationComparison result;
+	double squaredError = 0.0;
+	size_t particleCount = std::min(reference.getParticleCount(), other.getParticleCount());
+
+	for (size_t i = 0; i < particleCount; i++) {
+		Vec4 referenceMaterial = reference.getMaterial(i);
+		Vec4 otherMaterial = other.getMaterial(i);
+		if (referenceMaterial.w == SIM_MATERIAL_DRAINED || otherMaterial.w == SIM_MATERIAL_DRAINED) {
+			continue;
+		}
+
+		float positionError = length(toVec3(reference.getPositions()[i]) - toVec3(other.getPositions()[i]));
+		result.maxPositionError = std::max(result.maxPositionError, positionError);
+		squaredError += (double)positionError * positionError;
+
+		Mat3 deformationDisplacementError = reference.getDeformationDisplacement(i) - other.getDeformationDisplacement(i);
+		for (int j = 0; j < 9; j++) {
+			result.maxDeformationDisplacementError = std::max(result.maxDeformationDisplacementError, std::abs(deformationDisplacementError.m[j / 3][j % 3]));
+		}
+
+		Vec3 colorError = absVec3(toVec3(referenceMaterial) - toVec3(otherMaterial));
+		result.maxColorError = std::max(result.maxColorError, std::max(colorError.x, std::max(colorError.y, colorError.z)));
+		result.comparedCount++;
+	}
+
+	result.rmsPositionError = result.comparedCount > 0 ? (float)std::sqrt(squaredError / result.comparedCount) : 0.0f;
+	return result;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "SimulationMath.h"
+#include "SimulationParams.h"
+#include "MaterialKernels.h"
+#include "Support/ParallelScan.h"
+#include "Support/WorkerPool.h"
+
+// Wall time of each stage of the last step, in milliseconds
+struct SimulationStageTimes {
+	double bukkitize = 0.0;
+	// Decoding the grid and resolving collisions, every iteration after the first
+	double gridUpdate = 0.0;
+	double particles = 0.0;
+};
+
+// How the fixed point grid fared over the last step
+struct SimulationGridStats {
+	double fixedPointMultiplier = 0.0;
+	// Largest magnitude of any summed grid value, momentum, mass or volume, what the automatic multiplier is picked from
+	float maxGridValue = 0.0f;
+	// Contributions and sums that didn't fit the grid's ints and were clamped or wrapped
+	uint64_t overflowCount = 0;
+	// Vertices whose mass came out under 2^10 units of the multiplier, so it is off by more than about 0.1%
+	uint64_t underflowCount = 0;
+};
+
+// Differences between two simulators run from the same particles, slot by slot over the particles enabled in both
+struct SimulationComparison {
+	float maxPositionError = 0.0f;
+	float rmsPositionError = 0.0f;
+	float maxDeformationDisplacementError = 0.0f;
+	float maxColorError = 0.0f;
+	size_t comparedCount = 0;
+};
+
+// A run of at most RANGE_SIZE particles of one material in one bukkit, like BukkitThreadData
+struct ParticleRange {
+	int rangeStart;
+	int rangeCount;
+	Int3 bukkit;
+};
+
+// Quadratic B-spline stencil of one particle. Positions only change when a substep integrates, after its last scatter,
+// so the first iteration works these out and every gather and scatter of the substep reuses them
+struct ParticleStencil {
+	// Weight of vertex cellIndex + (i, j, k), in the order of the g2p2g loops with k fastest
+	float weights[27];
+	// From the particle to the first vertex's cell centre, the other vertices add i, j, k
+	Vec3 offset;
+	Int3 cellIndex;
+};
+
+// CPU version of the PBMPM substep in Scene/PBMPMScene.cpp: bukkit count, allocate and insert, then g2p2g iterations.
+// Particle buffers keep the GPU layouts where they have one, the particle struct is split into one array per field.
+//
+// Bukkit contents are sorted by material as well as by bukkit, and the ranges handed to the particle loop come out
+// grouped by material. Each material runs its own instantiation of the g2p2g kernel, with no per-particle material
+// branches, and only loads the fields MaterialTraits lists for it.
+//
+// Differences from the shader: the grid is decoded to floats once per iteration instead of per bukkit tile, the
+// integrating iteration doesn't scatter since only emission reads that grid, and mouse interaction and emission
+// are left out, the caller adds particles.
+class PBMPMSimulator {
+public:
+	// Keep consistent with PBMPMCommon.hlsl
+	static constexpr int BUKKIT_SIZE = 2;
+	static constexpr int BUKKIT_HALO_SIZE = 1;
+	static constexpr int GUARDIAN_SIZE = 1;
+	static constexpr int RANGE_SIZE = 64;
+	// Vertices per axis a bukkit's particles scatter to
+	static constexpr int TILE_EDGE = BUKKIT_SIZE + BUKKIT_HALO_SIZE * 2;
+
+	// Runs single threaded without a pool
+	PBMPMSimulator(WorkerPool* pool = nullptr);
+
+	// Reuses a drained particle's slot when there is one, returns the particle's index
+	int addParticle(const Vec3& position, int material, float volume, float density = 1.0f);
+	void setShapes(const std::vector<SimulationShape>& newShapes) { shapes = newShapes; }
+
+	// One substep, bukkitizing and then params.iterationCount g2p2g iterations
+	void step(const SimulationParams& params);
+
+	// Every particle slot including drained ones, which are disabled and have material SIM_MATERIAL_DRAINED
+	size_t getParticleCount() const { return positions.size(); }
+	// xyz and the liquid density, like the GPU position buffer
+	const std::vector<Vec4>& getPositions() const { return positions; }
+	// Color in xyz and the material in w, in whichever format they are stored
+	Vec4 getMaterial(size_t index) const;
+	void copyMaterials(std::vector<Vec4>& out) const;
+	// xyz and the time step it was taken over in w
+	const std::vector<Vec4>& getDisplacements() const { return displacements; }
+	// These three in whichever format they are stored
+	Mat3 getDeformationGradient(size_t index) const;
+	Mat3 getDeformationDisplacement(size_t index) const;
+	float getLogJp(size_t index) const;
+	const std::vector<int>& getFreeIndices() const { return freeIndices; }
+
+	// Dispatch of the last step. Material m's ranges are getRanges()[offsets[m], offsets[m + 1])
+	const std::vector<ParticleRange>& getRanges() const { return ranges; }
+	const std::array<int, SIM_MATERIAL_COUNT + 1>& getMaterialRangeOffsets() const { return materialRangeOffsets; }
+	// Indices of the particles in range order, a range covers bukkitParticles[rangeStart, rangeStart + rangeCount)
+	const std::vector<int>& getBukkitParticles() const { return bukkitParticles; }
+
+	const SimulationStageTimes& getStageTimes() const { return stageTimes; }
+	const SimulationGridStats& getGridStats() const { return gridStats; }
+	// Hash of every particle field and the free list after the last step, 0 unless SimulationParams::deterministic is set
+	uint64_t getStateHash() const { return stateHash; }
+	// Memory every particle slot takes in the current storage format, not counting the bukkit lists
+	size_t getBytesPerParticle() const;
+
+private:
+	void resize();
+	void chooseMultiplier();
+	void flushTile(const int64_t* tile, const Int3& tileOrigin);
+	uint64_t hashState();
+	void setStorageFormat(SimStorageFormat format);
+	uint16_t pack(float value) const { return storageFormat == SimStorageHalf ? floatToHalf(value) : floatToBFloat16(value); }
+	float unpack(uint16_t value) const { return storageFormat == SimStorageHalf ? halfToFloat(value) : bfloat16ToFloat(value); }
+	Mat3 loadDeformationGradient(size_t index) const;
+	void storeDeformationGradient(size_t index, const Mat3& deformationGradient);
+	Mat3 loadDeformationDisplacement(size_t index) const;
+	void storeDeformationDisplacement(size_t index, const Mat3& deformationDisplacement);
+	float loadLogJp(size_t index) const;
+	void storeLogJp(size_t index, float logJp);
+	void storeColor(size_t index, const Vec3& color);
+	void storeMaterial(size_t index, const Vec4& material);
+	void bukkitize();
+	void updateGrid();
+	template<int Material>
+	void runMaterial(bool gather, bool integrate, bool scatter);
+	template<int Material>
+	void runRange(const ParticleRange& range, bool gather, bool integrate, bool scatter);
+	template<typename Task>
+	void parallelFor(size_t count, size_t grainSize, const Task& task);
+
+	int getBukkitIndex(const Int3& bukkit) const { return to1D(bukkit, bukkitDimensions); }
+
+	WorkerPool* pool;
+	ParallelScan scan;
+	SimulationParams params{};
+	std::vector<SimulationShape> shapes;
+
+	// One entry per particle slot
+	std::vector<Vec4> positions;
+	std::vector<Vec4> materials;
+	std::vector<Vec4> displacements;
+	std::vector<float> masses;
+	std::vector<float> volumes;
+	std::vector<Mat3> deformationGradients;
+	std::vector<Mat3> deformationDisplacements;
+	std::vector<float> logJps;
+	std::vector<uint8_t> enabled;
+
+	// With 16 bit storage the deformation gradient, deformation displacement, logJp and material live here instead,
+	// 9, 9, 1 and 4 values per particle
+	SimStorageFormat storageFormat = SimStorageFloat;
+	std::vector<uint16_t> packedDeformationGradients;
+	std::vector<uint16_t> packedDeformationDisplacements;
+	std::vector<uint16_t> packedLogJps;
+	std::vector<uint16_t> packedMaterials;
+
+	// Drained slots, the first freeCount entries are valid
+	std::vector<int> freeIndices;
+	std::atomic<int> freeCount{ 0 };
+
+	Int3 gridDimensions{};
+	Int3 bukkitDimensions{};
+	size_t bukkitCount = 0;
+
+	// Particles counted and inserted per material and bukkit, material major
+	std::vector<int> particleKeys;
+	std::unique_ptr<std::atomic<int>[]> keyCounts;
+	std::unique_ptr<std::atomic<int>[]> keyCursors;
+	size_t keyCapacity = 0;
+	std::vector<int> keyOffsets;
+	std::vector<int> keyRangeOffsets;
+	std::vector<int> bukkitParticles;
+	// Stencil of every particle in bukkitParticles, at the same index
+	std::vector<ParticleStencil> stencils;
+	std::vector<ParticleRange> ranges;
+	std::array<int, SIM_MATERIAL_COUNT + 1> materialRangeOffsets{};
+
+	// Bukkits whose vertices a particle can reach, the only ones the grid update visits
+	std::vector<uint8_t> bukkitOccupied;
+	std::vector<int> gridBukkits;
+
+	// Fixed point momentum, mass and volume per vertex, like the GPU grid buffers. Only the one for the current
+	// precision is allocated, both are left empty at the end of every step
+	std::unique_ptr<std::atomic<int32_t>[]> grid;
+	size_t gridCapacity = 0;
+	std::unique_ptr<std::atomic<int64_t>[]> wideGrid;
+	size_t wideGridCapacity = 0;
+	double multiplier = 0.0;
+	// Decoded displacement after collisions in xyz, volume in w
+	std::vector<Vec4> gridValues;
+
+	SimulationStageTimes stageTimes;
+	SimulationGridStats gridStats;
+	std::atomic<uint64_t> overflowCount{ 0 };
+	std::atomic<uint64_t> underflowCount{ 0 };
+	// Float bits, non-negative floats order the same way as their bits
+	std::atomic<uint32_t> maxGridValueBits{ 0 };
+
+	uint64_t stateHash = 0;
+	std::vector<uint64_t> blockHashes;
+};
+
+// Both are expected to have started from the same particles with the same settings apart from the storage format
+SimulationComparison compareSimulations(const PBMPMSimulator& reference, const PBMPMSimulator& other);
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "Surface/SurfaceMath.h"
+
+// 3x3 matrices for the CPU simulation, laid out like the shaders' float3x3: m[row][column], vectors are columns.
+// The helpers below mirror the ones in Shaders/pbmpmShaders/PBMPMCommon.hlsl
+
+struct Mat3 {
+	float m[3][3];
+
+	Mat3 operator+(const Mat3& o) const {
+		Mat3 r;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				r.m[i][j] = m[i][j] + o.m[i][j];
+			}
+		}
+		return r;
+	}
+
+	Mat3 operator-(const Mat3& o) const {
+		Mat3 r;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				r.m[i][j] = m[i][j] - o.m[i][j];
+			}
+		}
+		return r;
+	}
+
+	Mat3 operator*(float s) const {
+		Mat3 r;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				r.m[i][j] = m[i][j] * s;
+			}
+		}
+		return r;
+	}
+
+	Mat3& operator+=(const Mat3& o) { return *this = *this + o; }
+};
+
+inline Mat3 identity3() { return { { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } } }; }
+inline Mat3 zero3() { return { { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } } }; }
+
+inline Mat3 diag(const Vec3& d) { return { { { d.x, 0, 0 }, { 0, d.y, 0 }, { 0, 0, d.z } } }; }
+
+inline Mat3 mul(const Mat3& a, const Mat3& b) {
+	Mat3 r;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+		}
+	}
+	return r;
+}
+
+inline Vec3 mul(const Mat3& a, const Vec3& v) {
+	return { a.m[0][0] * v.x + a.m[0][1] * v.y + a.m[0][2] * v.z,
+		a.m[1][0] * v.x + a.m[1][1] * v.y + a.m[1][2] * v.z,
+		a.m[2][0] * v.x + a.m[2][1] * v.y + a.m[2][2] * v.z };
+}
+
+// Component-wise, what the shaders' * does between matrices
+inline Mat3 mulComponents(const Mat3& a, const Mat3& b) {
+	Mat3 r;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			r.m[i][j] = a.m[i][j] * b.m[i][j];
+		}
+	}
+	return r;
+}
+
+inline Mat3 transpose(const Mat3& a) {
+	Mat3 r;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			r.m[i][j] = a.m[j][i];
+		}
+	}
+	return r;
+}
+
+inline Mat3 outerProduct(const Vec3& x, const Vec3& y) {
+	return { { { x.x * y.x, x.x * y.y, x.x * y.z }, { x.y * y.x, x.y * y.y, x.y * y.z }, { x.z * y.x, x.z * y.y, x.z * y.z } } };
+}
+
+inline float trace(const Mat3& a) { return a.m[0][0] + a.m[1][1] + a.m[2][2]; }
+
+inline float det(const Mat3& a) {
+	return a.m[0][0] * (a.m[1][1] * a.m[2][2] - a.m[1][2] * a.m[2][1])
+		- a.m[0][1] * (a.m[1][0] * a.m[2][2] - a.m[1][2] * a.m[2][0])
+		+ a.m[0][2] * (a.m[1][0] * a.m[2][1] - a.m[1][1] * a.m[2][0]);
+}
+
+// Identity for singular matrices, like the shader
+inline Mat3 inverse(const Mat3& a) {
+	float d = det(a);
+	if (std::abs(d) < 1e-12f) {
+		return identity3();
+	}
+
+	Mat3 adj;
+	adj.m[0][0] = +(a.m[1][1] * a.m[2][2] - a.m[2][1] * a.m[1][2]);
+	adj.m[0][1] = -(a.m[0][1] * a.m[2][2] - a.m[2][1] * a.m[0][2]);
+	adj.m[0][2] = +(a.m[0][1] * a.m[1][2] - a.m[1][1] * a.m[0][2]);
+	adj.m[1][0] = -(a.m[1][0] * a.m[2][2] - a.m[2][0] * a.m[1][2]);
+	adj.m[1][1] = +(a.m[0][0] * a.m[2][2] - a.m[2][0] * a.m[0][2]);
+	adj.m[1][2] = -(a.m[0][0] * a.m[1][2] - a.m[1][0] * a.m[0][2]);
+	adj.m[2][0] = +(a.m[1][0] * a.m[2][1] - a.m[2][0] * a.m[1][1]);
+	adj.m[2][1] = -(a.m[0][0] * a.m[2][1] - a.m[2][0] * a.m[0][1]);
+	adj.m[2][2] = +(a.m[0][0] * a.m[1][1] - a.m[1][0] * a.m[0][1]);
+	return adj * (1.0f / d);
+}
+
+inline float signOf(float x) { return x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f); }
+
+inline Vec3 mulComponents(const Vec3& a, const Vec3& b) { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+inline Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline Vec3 absVec3(const Vec3& v) { return { std::abs(v.x), std::abs(v.y), std::abs(v.z) }; }
+inline Vec3 floorVec3(const Vec3& v) { return { std::floor(v.x), std::floor(v.y), std::floor(v.z) }; }
+inline Vec3 minVec3(const Vec3& a, const Vec3& b) { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+inline Vec3 maxVec3(const Vec3& a, const Vec3& b) { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+inline Vec3 clampVec3(const Vec3& v, const Vec3& lo, const Vec3& hi) { return minVec3(maxVec3(v, lo), hi); }
+inline Vec3 clampVec3(const Vec3& v, float lo, float hi) { return clampVec3(v, Vec3{ lo, lo, lo }, Vec3{ hi, hi, hi }); }
+
+struct SvdResult {
+	Mat3 U;
+	Vec3 sigma;
+	Mat3 Vt;
+};
+
+// One-sided Jacobi, the same sweeps, tolerances and clamps as svd() in PBMPMCommon.hlsl
+inline SvdResult svd(const Mat3& a) {
+	const int maxIterations = 20;
+	const float epsilon = 1e-6f;
+
+	Mat3 V = identity3();
+	Mat3 B = a;
+
+	for (int iteration = 0; iteration < maxIterations; iteration++) {
+		bool converged = true;
+		for (int i = 0; i < 3; i++) {
+			for (int j = i + 1; j < 3; j++) {
+				float alpha = B.m[0][i] * B.m[0][i] + B.m[1][i] * B.m[1][i] + B.m[2][i] * B.m[2][i];
+				float gamma = B.m[0][j] * B.m[0][j] + B.m[1][j] * B.m[1][j] + B.m[2][j] * B.m[2][j];
+				float beta = B.m[0][i] * B.m[0][j] + B.m[1][i] * B.m[1][j] + B.m[2][i] * B.m[2][j];
+				if (std::abs(beta) < epsilon * std::sqrt(alpha * gamma)) {
+					continue;
+				}
+				converged = false;
+
+				// The smaller root of t^2 - 2 zeta t - 1, which zeroes beta for the rotation below
+				float zeta = (gamma - alpha) / (2.0f * beta);
+				float t = -(zeta >= 0.0f ? 1.0f : -1.0f) / (std::abs(zeta) + std::sqrt(1.0f + zeta * zeta));
+				float c = 1.0f / std::sqrt(1.0f + t * t);
+				float s = c * t;
+
+				// Right multiplication by the rotation in the i, j plane
+				for (int row = 0; row < 3; row++) {
+					float bi = B.m[row][i], bj = B.m[row][j];
+					B.m[row][i] = c * bi + s * bj;
+					B.m[row][j] = -s * bi + c * bj;
+					float vi = V.m[row][i], vj = V.m[row][j];
+					V.m[row][i] = c * vi + s * vj;
+					V.m[row][j] = -s * vi + c * vj;
+				}
+			}
+		}
+		if (converged) {
+			break;
+		}
+	}
+
+	float singular[3];
+	int degenerate[3];
+	int degenerateCount = 0;
+	for (int i = 0; i < 3; i++) {
+		float norm = std::sqrt(B.m[0][i] * B.m[0][i] + B.m[1][i] * B.m[1][i] + B.m[2][i] * B.m[2][i]);
+		singular[i] = norm > epsilon ? norm : epsilon;
+		if (norm > epsilon) {
+			B.m[0][i] /= norm;
+			B.m[1][i] /= norm;
+			B.m[2][i] /= norm;
+		}
+		else {
+			degenerate[degenerateCount++] = i;
+		}
+	}
+
+	// The columns of a rank deficient matrix come out as zero, U is filled in to an orthonormal basis so U * Vt stays
+	// a rotation
+	if (degenerateCount == 3) {
+		B = identity3();
+	}
+	else if (degenerateCount > 0) {
+		auto column = [&](int i) { return Vec3{ B.m[0][i], B.m[1][i], B.m[2][i] }; };
+		auto setColumn = [&](int i, const Vec3& v) { B.m[0][i] = v.x; B.m[1][i] = v.y; B.m[2][i] = v.z; };
+		if (degenerateCount == 2) {
+			int kept = 3 - degenerate[0] - degenerate[1];
+			Vec3 u = column(kept);
+			// The axis furthest from u
+			Vec3 axis = std::abs(u.x) < std::abs(u.y) ? (std::abs(u.x) < std::abs(u.z) ? Vec3{ 1, 0, 0 } : Vec3{ 0, 0, 1 }) :
+				(std::abs(u.y) < std::abs(u.z) ? Vec3{ 0, 1, 0 } : Vec3{ 0, 0, 1 });
+			Vec3 v = normalize(cross(u, axis));
+			setColumn(degenerate[0], v);
+			setColumn(degenerate[1], cross(u, v));
+		}
+		else {
+			int i = degenerate[0];
+			setColumn(i, normalize(cross(column((i + 1) % 3), column((i + 2) % 3))));
+		}
+	}
+
+	if (det(B) < 0.0f) {
+		B.m[0][2] = -B.m[0][2];
+		B.m[1][2] = -B.m[1][2];
+		B.m[2][2] = -B.m[2][2];
+		singular[2] = -singular[2];
+	}
+
+	SvdResult result;
+	result.U = B;
+	result.sigma = clampVec3({ singular[0], singular[1], singular[2] }, 0.5f, 5000.0f);
+	result.Vt = transpose(V);
+	return result;
+}
+
+inline Mat3 recompose(const SvdResult& svd, const Vec3& sigma) { return mul(mul(svd.U, diag(sigma)), svd.Vt); }
+
+// Rotation of the polar decomposition a = RS, the U * Vt of svd() without working out the singular values.
+// Newton iterations scaled by det^-1/3, Higham 1986, Computing the polar decomposition with applications.
+// Inverted and nearly singular matrices go to svd(), the iteration would return a reflection for them
+inline Mat3 polarRotation(const Mat3& a) {
+	const int maxIterations = 10;
+	const float epsilon = 1e-6f;
+
+	Mat3 X = a;
+	for (int iteration = 0; iteration < maxIterations; iteration++) {
+		// Transposed adjugate, X^-T times the determinant
+		Mat3 cofactor;
+		cofactor.m[0][0] = X.m[1][1] * X.m[2][2] - X.m[1][2] * X.m[2][1];
+		cofactor.m[0][1] = X.m[1][2] * X.m[2][0] - X.m[1][0] * X.m[2][2];
+		cofactor.m[0][2] = X.m[1][0] * X.m[2][1] - X.m[1][1] * X.m[2][0];
+		cofactor.m[1][0] = X.m[0][2] * X.m[2][1] - X.m[0][1] * X.m[2][2];
+		cofactor.m[1][1] = X.m[0][0] * X.m[2][2] - X.m[0][2] * X.m[2][0];
+		cofactor.m[1][2] = X.m[0][1] * X.m[2][0] - X.m[0][0] * X.m[2][1];
+		cofactor.m[2][0] = X.m[0][1] * X.m[1][2] - X.m[0][2] * X.m[1][1];
+		cofactor.m[2][1] = X.m[0][2] * X.m[1][0] - X.m[0][0] * X.m[1][2];
+		cofactor.m[2][2] = X.m[0][0] * X.m[1][1] - X.m[0][1] * X.m[1][0];
+
+		float d = X.m[0][0] * cofactor.m[0][0] + X.m[0][1] * cofactor.m[0][1] + X.m[0][2] * cofactor.m[0][2];
+		if (d < epsilon) {
+			break;
+		}
+
+		float gamma = 1.0f / std::cbrt(d);
+		Mat3 next = (X * gamma + cofactor * (1.0f / (gamma * d))) * 0.5f;
+
+		float change = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				change = std::max(change, std::abs(next.m[i][j] - X.m[i][j]));
+			}
+		}
+		X = next;
+		// Quadratic convergence, the iteration after a change this small would be below float precision
+		if (change < 1e-3f) {
+			return X;
+		}
+	}
+
+	SvdResult result = svd(a);
+	return mul(result.U, result.Vt);
+}
+
+// Whether every singular value of a is within [lo, hi], without an SVD: a^T a - lo^2 I and hi^2 I - a^T a have to be
+// positive definite. A reflection counts as outside, svd() returns it as a negative singular value.
+// Errs towards outside, the minors have to clear a margin over their rounding error
+inline bool singularValuesWithin(const Mat3& a, float lo, float hi) {
+	if (det(a) <= 0.0f) {
+		return false;
+	}
+
+	Mat3 C = mul(transpose(a), a);
+	// Leading principal minors of C - shift * I times sign, all positive for a positive definite matrix
+	auto positiveDefinite = [&](float shift, float sign) {
+		Mat3 M = (C - identity3() * shift) * sign;
+		float scale = shift + trace(C);
+		float margin = 1e-5f * scale;
+		return M.m[0][0] > margin
+			&& M.m[0][0] * M.m[1][1] - M.m[0][1] * M.m[1][0] > margin * scale
+			&& det(M) > margin * scale * scale;
+	};
+	return positiveDefinite(lo * lo, 1.0f) && positiveDefinite(hi * hi, -1.0f);
+}
+
+// 16 bit floats for particle data that doesn't need full precision. Both round to nearest even
+
+inline uint32_t floatBits(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+inline float bitsToFloat(uint32_t bits) {
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// IEEE half, overflows to infinity and keeps subnormals
+inline uint16_t floatToHalf(float value) {
+	uint32_t bits = floatBits(value);
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	bits &= 0x7fffffffu;
+
+	uint32_t half;
+	if (bits >= 0x47800000u) {
+		// Too big for a half, or already infinite or NaN
+		half = bits > 0x7f800000u ? 0x7e00u : 0x7c00u;
+	}
+	else if (bits < 0x38800000u) {
+		// Subnormal or zero, adding 0.5 lets the float adder do the shift and the rounding
+		half = floatBits(bitsToFloat(bits) + 0.5f) - 0x3f000000u;
+	}
+	else {
+		uint32_t mantissaOdd = (bits >> 13) & 1u;
+		bits += 0xc8000fffu + mantissaOdd;
+		half = bits >> 13;
+	}
+	return (uint16_t)(half | sign);
+}
+
+inline float halfToFloat(uint16_t half) {
+	uint32_t bits = (uint32_t)(half & 0x7fffu) << 13;
+	uint32_t exponent = bits & 0x0f800000u;
+	bits += 0x38000000u;
+	if (exponent == 0x0f800000u) {
+		bits += 0x38000000u;
+	}
+	else if (exponent == 0) {
+		bits = floatBits(bitsToFloat(bits + 0x00800000u) - bitsToFloat(0x38800000u));
+	}
+	return bitsToFloat(bits | (uint32_t)(half & 0x8000u) << 16);
+}
+
+// The top half of a float, same range with 8 bits of mantissa
+inline uint16_t floatToBFloat16(float value) {
+	uint32_t bits = floatBits(value);
+	if ((bits & 0x7fffffffu) > 0x7f800000u) {
+		return (uint16_t)((bits >> 16) | 0x40u);
+	}
+	bits += 0x7fffu + ((bits >> 16) & 1u);
+	return (uint16_t)(bits >> 16);
+}
+
+inline float bfloat16ToFloat(uint16_t value) {
+	return bitsToFloat((uint32_t)value << 16);
+}
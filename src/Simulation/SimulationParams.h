@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Surface/SurfaceMath.h"
+
+// Settings and shapes of the CPU simulation. Names and defaults follow PBMPMConstants and SimShape in Scene/PBMPMScene.h,
+// the values are the ones in PBMPMCommon.hlsl
+
+enum SimMaterial : int {
+	SimMaterialLiquid = 0,
+	SimMaterialElastic = 1,
+	SimMaterialSand = 2,
+	SimMaterialVisco = 3,
+	SimMaterialSnow = 4,
+	SIM_MATERIAL_COUNT = 5
+};
+
+// Drained particles are given this material so nothing draws them
+static const int SIM_MATERIAL_DRAINED = 99;
+
+enum SimShapeType : int {
+	SimShapeBox = 0,
+	SimShapeCircle = 1
+};
+
+// Emitters are left to the caller, addParticle takes their particles
+enum SimShapeFunction : int {
+	SimShapeEmit = 0,
+	SimShapeCollider = 1,
+	SimShapeDrain = 2,
+	SimShapeInitialEmit = 3
+};
+
+struct SimulationShape {
+	int shapeType = SimShapeBox;
+	int functionality = SimShapeCollider;
+	Vec3 position{};
+	// Degrees about z
+	float rotation = 0.0f;
+	Vec3 halfSize{};
+	float radius = 0.0f;
+};
+
+// Format the deformation gradient and displacement, logJp and color are kept in between kernels, they are always worked
+// on as floats. The packed formats keep the gradient as F - I
+enum SimStorageFormat : int {
+	SimStorageFloat = 0,
+	SimStorageHalf = 1,
+	SimStorageBFloat16 = 2
+};
+
+struct SimulationParams {
+	// Grid vertices per axis, in grid cells
+	Int3 gridSize{ 64, 64, 64 };
+	float deltaTime = 0.01f;
+	float gravityStrength = 2.5f;
+	float liquidRelaxation = 0.2f;
+	float liquidViscosity = 0.01f;
+	// Wider than the GPU's uint so the 64 bit grid can use multipliers past 2^32
+	double fixedPointMultiplier = 10000000.0;
+	// Sums the grid in 64 bit ints instead of 32 bit ones
+	bool wideFixedPoint = false;
+	// Picks the multiplier from the largest grid value of the previous step instead of fixedPointMultiplier
+	bool autoFixedPoint = false;
+	// Results that don't depend on the thread count: bukkit contents and drained particles are sorted, and the state is
+	// hashed after every step. The grid sums are integers, so their order never mattered
+	bool deterministic = false;
+	SimStorageFormat particleStorage = SimStorageFloat;
+	bool useGridVolumeForLiquid = true;
+	float frictionAngle = 30.0f;
+	// Iteration 0 only scatters, the last one gathers and integrates. Counts under 2 run 2
+	unsigned int iterationCount = 5;
+	float borderFriction = 0.25f;
+	float elasticRelaxation = 2.3f;
+	float elasticityRatio = 1.2f;
+	float sandRelaxation = 1.5f;
+	float sandRatio = 0.5f;
+};
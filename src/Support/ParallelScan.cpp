@@ -0,0 +1,49 @@
+#include "ParallelScan.h"
+
+#include <algorithm>
+
+ParallelScan::ParallelScan(WorkerPool* pool, size_t partitionSize)
+	: pool(pool), partitionSize(std::max<size_t>(partitionSize, 1))
+{
+}
+
+void ParallelScan::reset(size_t partitionCount) {
+	if (partitionCapacity < partitionCount) {
+		partitionStates.reset(new std::atomic<uint64_t>[partitionCount]);
+		partitionCapacity = partitionCount;
+	}
+	for (size_t p = 0; p < partitionCount; p++) {
+		partitionStates[p].store(0, std::memory_order_relaxed);
+	}
+	nextPartition.store(0, std::memory_order_relaxed);
+}
+
+int64_t ParallelScan::lookBack(size_t partition, int64_t aggregate) {
+	if (partition == 0) {
+		partitionStates[0].store(FLAG_INCLUSIVE | (uint64_t)aggregate, std::memory_order_release);
+		return 0;
+	}
+
+	// Let the partitions after this one look past it before its own prefix is known
+	partitionStates[partition].store(FLAG_AGGREGATE | (uint64_t)aggregate, std::memory_order_release);
+
+	int64_t prefix = 0;
+	size_t predecessor = partition - 1;
+	while (true) {
+		uint64_t state = partitionStates[predecessor].load(std::memory_order_acquire);
+		if (state & FLAG_INCLUSIVE) {
+			prefix += (int64_t)(state & VALUE_MASK);
+			break;
+		}
+		if (state & FLAG_AGGREGATE) {
+			prefix += (int64_t)(state & VALUE_MASK);
+			predecessor--;
+			continue;
+		}
+		// Claimed but not summed yet, its thread is running so this ends
+		std::this_thread::yield();
+	}
+
+	partitionStates[partition].store(FLAG_INCLUSIVE | (uint64_t)(prefix + aggregate), std::memory_order_release);
+	return prefix;
+}
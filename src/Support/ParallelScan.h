@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "WorkerPool.h"
+
+// Single pass prefix sums and stream compaction on a WorkerPool, using decoupled look-back.
+// The input is cut into partitions that are handed out in increasing order. Each partition sums its own items and
+// publishes that aggregate, then walks back over its predecessors until one has published an inclusive prefix, and
+// publishes its own inclusive prefix for the partitions after it. Only then does it write its results, so every item
+// is read twice but the output is written once, in order, whatever the number of threads.
+//
+// Shaders/FluidSurfaceConstruction/ParallelScan.hlsl has the same operations for one thread group per partition.
+// Calls must not be nested, and a ParallelScan runs one scan at a time.
+class ParallelScan {
+public:
+	// Single threaded without a pool
+	explicit ParallelScan(WorkerPool* pool = nullptr, size_t partitionSize = 4096);
+
+	ParallelScan(const ParallelScan&) = delete;
+	ParallelScan& operator=(const ParallelScan&) = delete;
+
+	// out[i] = value(0) + ... + value(i - 1) for i in [0, count), returns the sum of all of them.
+	// value is called twice per item, from any thread
+	template<typename Value>
+	int exclusiveScan(size_t count, const Value& value, int* out);
+
+	// Writes every i in [0, count) for which keep(i) holds to out, in increasing order, and returns how many there were.
+	// out needs room for that many. keep is called twice per item, from any thread
+	template<typename Predicate>
+	int compact(size_t count, const Predicate& keep, int* out);
+
+private:
+	// Published per partition, the flag sits above the value
+	static constexpr uint64_t FLAG_AGGREGATE = 1ull << 62;
+	static constexpr uint64_t FLAG_INCLUSIVE = 2ull << 62;
+	static constexpr uint64_t VALUE_MASK = FLAG_AGGREGATE - 1;
+
+	// sum(begin, end) returns the partition's aggregate, write(begin, end, prefix) its results
+	template<typename Sum, typename Write>
+	int run(size_t count, const Sum& sum, const Write& write);
+	void reset(size_t partitionCount);
+	// Sum of every partition before this one, after publishing aggregate
+	int64_t lookBack(size_t partition, int64_t aggregate);
+
+	WorkerPool* pool;
+	size_t partitionSize;
+
+	std::unique_ptr<std::atomic<uint64_t>[]> partitionStates;
+	size_t partitionCapacity = 0;
+	std::atomic<size_t> nextPartition{ 0 };
+};
+
+template<typename Sum, typename Write>
+int ParallelScan::run(size_t count, const Sum& sum, const Write& write) {
+	if (count == 0) {
+		return 0;
+	}
+
+	size_t partitionCount = (count + partitionSize - 1) / partitionSize;
+	reset(partitionCount);
+
+	auto task = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			// Claimed in order rather than taken from i, so every partition a thread looks back on is already being worked on
+			size_t partition = nextPartition.fetch_add(1);
+			size_t first = partition * partitionSize;
+			size_t last = std::min(first + partitionSize, count);
+
+			int64_t aggregate = sum(first, last);
+			int64_t prefix = lookBack(partition, aggregate);
+			write(first, last, (int)prefix);
+		}
+	};
+
+	if (pool) {
+		pool->parallelFor(partitionCount, 1, task);
+	}
+	else {
+		task(0, partitionCount);
+	}
+
+	return (int)(partitionStates[partitionCount - 1].load(std::memory_order_acquire) & VALUE_MASK);
+}
+
+template<typename Value>
+int ParallelScan::exclusiveScan(size_t count, const Value& value, int* out) {
+	return run(count,
+		[&](size_t begin, size_t end) {
+			int64_t aggregate = 0;
+			for (size_t i = begin; i < end; i++) {
+				aggregate += value(i);
+			}
+			return aggregate;
+		},
+		[&](size_t begin, size_t end, int prefix) {
+			for (size_t i = begin; i < end; i++) {
+				out[i] = prefix;
+				prefix += value(i);
+			}
+		});
+}
+
+template<typename Predicate>
+int ParallelScan::compact(size_t count, const Predicate& keep, int* out) {
+	return run(count,
+		[&](size_t begin, size_t end) {
+			int64_t aggregate = 0;
+			for (size_t i = begin; i < end; i++) {
+				aggregate += keep(i) ? 1 : 0;
+			}
+			return aggregate;
+		},
+		[&](size_t begin, size_t end, int prefix) {
+			for (size_t i = begin; i < end; i++) {
+				if (keep(i)) {
+					out[prefix++] = (int)i;
+				}
+			}
+		});
+}
@@ -0,0 +1,100 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int i = 1; i < threadCount; i++) {
+		workers.emplace_back(&WorkerPool::workerLoop, this);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void WorkerPool::parallelFor(size_t itemCount, size_t grain, const std::function<void(size_t, size_t)>& job) {
+	if (itemCount == 0) {
+		return;
+	}
+
+	grain = std::max<size_t>(grain, 1);
+	size_t chunks = (itemCount + grain - 1) / grain;
+
+	// Not worth waking anyone up
+	if (chunks == 1 || workers.empty()) {
+		job(0, itemCount);
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busyWorkers == 0; });
+		task = &job;
+		count = itemCount;
+		grainSize = grain;
+		chunkCount = chunks;
+		nextChunk = 0;
+		generation++;
+	}
+	wake.notify_all();
+
+	runChunks(&job, itemCount, grain, chunks);
+
+	// Every chunk has been claimed, wait for the workers still running theirs
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busyWorkers == 0; });
+	task = nullptr;
+	chunkCount = 0;
+}
+
+void WorkerPool::workerLoop() {
+	uint64_t seenGeneration = 0;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+		if (stopping) {
+			return;
+		}
+
+		// Copy the job while holding the lock, it can't change until busyWorkers drops back to 0
+		seenGeneration = generation;
+		const std::function<void(size_t, size_t)>* jobTask = task;
+		size_t jobCount = count;
+		size_t jobGrain = grainSize;
+		size_t jobChunks = chunkCount;
+		busyWorkers++;
+
+		lock.unlock();
+		runChunks(jobTask, jobCount, jobGrain, jobChunks);
+		lock.lock();
+
+		if (--busyWorkers == 0) {
+			done.notify_all();
+		}
+	}
+}
+
+void WorkerPool::runChunks(const std::function<void(size_t, size_t)>* jobTask, size_t jobCount, size_t jobGrain, size_t jobChunks) {
+	if (jobChunks == 0) {
+		return;
+	}
+
+	for (size_t chunk = nextChunk.fetch_add(1); chunk < jobChunks; chunk = nextChunk.fetch_add(1)) {
+		size_t begin = chunk * jobGrain;
+		size_t end = std::min(begin + jobGrain, jobCount);
+		(*jobTask)(begin, end);
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for data parallel loops on the CPU.
+// parallelFor splits a range into chunks that the workers and the calling thread pull from until
+// none are left, then returns once every chunk has finished. Calls must not be nested.
+class WorkerPool {
+public:
+	// threadCount includes the calling thread, 0 uses every hardware thread
+	explicit WorkerPool(unsigned int threadCount = 0);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Calls task(begin, end) for consecutive ranges of at most grainSize items covering [0, count)
+	void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& task);
+
+	unsigned int getThreadCount() const { return (unsigned int)workers.size() + 1; }
+
+private:
+	void workerLoop();
+	void runChunks(const std::function<void(size_t, size_t)>* jobTask, size_t jobCount, size_t jobGrain, size_t jobChunks);
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// Current job, only changed while no worker is busy
+	const std::function<void(size_t, size_t)>* task = nullptr;
+	size_t count = 0;
+	size_t grainSize = 1;
+	size_t chunkCount = 0;
+	std::atomic<size_t> nextChunk{ 0 };
+
+	uint64_t generation = 0;
+	unsigned int busyWorkers = 0;
+	bool stopping = false;
+};
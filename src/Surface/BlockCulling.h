@@ -0,0 +1,77 @@
+#pragma once
+
+#include <limits>
+#include "SurfaceMath.h"
+
+// View culling of surface blocks, shared by SurfaceExtractor and mirrored in Shaders/FluidSurfaceConstruction/BlockCulling.hlsl
+
+// Row-major with row vectors on the left, like DirectXMath, so an XMFLOAT4X4 copies straight in
+struct Mat4 {
+	float m[4][4];
+};
+
+// Planes as (normal, offset) with the normals facing inwards, a point p is on the inside of one when dot(normal, p) + offset >= 0.
+// Not normalized, only the signs are used
+struct Frustum {
+	Vec4 planes[6];
+};
+
+struct BlockCulling {
+	bool enabled = false;
+	Mat4 viewProj{};
+	// Fraction of the viewport height, blocks that cover less are skipped. 0 keeps every block in view
+	float minScreenSize = 0.0f;
+};
+
+// Column j of viewProj gives clip coordinate j. Clip space is D3D's, x and y in [-w, w] and z in [0, w]
+inline Frustum makeFrustum(const Mat4& viewProj) {
+	auto column = [&](int j) { return Vec4{ viewProj.m[0][j], viewProj.m[1][j], viewProj.m[2][j], viewProj.m[3][j] }; };
+	Vec4 x = column(0), y = column(1), z = column(2), w = column(3);
+	auto add = [](const Vec4& a, const Vec4& b) { return Vec4{ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; };
+	auto subtract = [](const Vec4& a, const Vec4& b) { return Vec4{ a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; };
+
+	Frustum frustum;
+	frustum.planes[0] = add(w, x);
+	frustum.planes[1] = subtract(w, x);
+	frustum.planes[2] = add(w, y);
+	frustum.planes[3] = subtract(w, y);
+	frustum.planes[4] = z;
+	frustum.planes[5] = subtract(w, z);
+	return frustum;
+}
+
+// Conservative, a box that is outside no single plane counts as intersecting even when it misses a corner of the frustum
+inline bool intersectsFrustum(const Frustum& frustum, const Vec3& boxMin, const Vec3& boxMax) {
+	for (const Vec4& plane : frustum.planes) {
+		// The corner furthest along the normal, if that one is outside the whole box is
+		Vec3 corner = { plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y, plane.z >= 0.0f ? boxMax.z : boxMin.z };
+		if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Height of the box's bounding sphere on screen as a fraction of the viewport height. Infinite when the camera is inside the sphere
+inline float projectedSize(const Mat4& viewProj, const Vec3& boxMin, const Vec3& boxMax) {
+	Vec3 center = (boxMin + boxMax) * 0.5f;
+	float radius = length(boxMax - boxMin) * 0.5f;
+	float w = center.x * viewProj.m[0][3] + center.y * viewProj.m[1][3] + center.z * viewProj.m[2][3] + viewProj.m[3][3];
+	if (w <= radius) {
+		return std::numeric_limits<float>::infinity();
+	}
+
+	// The projection's y scale, the view rotation doesn't change the length of the column
+	float yScale = length(Vec3{ viewProj.m[0][1], viewProj.m[1][1], viewProj.m[2][1] });
+	return radius * yScale / w;
+}
+
+inline bool isBlockVisible(const BlockCulling& culling, const Frustum& frustum, const Vec3& boxMin, const Vec3& boxMax) {
+	if (!culling.enabled) {
+		return true;
+	}
+	if (!intersectsFrustum(frustum, boxMin, boxMax)) {
+		return false;
+	}
+	return culling.minScreenSize <= 0.0f || projectedSize(culling.viewProj, boxMin, boxMax) >= culling.minScreenSize;
+}
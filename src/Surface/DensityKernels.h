@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include "SimdLanes.h"
+#include "SurfaceMath.h"
+#include "Shaders/constants.h"
+
+// Smoothing kernels for the surface density. Each one is a shape over q^2 = (distance / support)^2 and its derivative
+// with respect to q^2, written once for plain floats and FloatLanes, and both are zero from q = 1 on. Everything that only depends on the settings is folded into
+// KernelCoefficients once per extraction, so a particle costs a squared distance and the shape.
+//
+// The support and scale follow SurfaceVertexDensity.hlsl: with h the kernel radius and s the kernel scale, the support
+// is h * h * s and Poly6 peaks at 315 / (64 pi (h s)^6). The support is cut to the radius a vertex gathers particles
+// from, past it the kernel would still slope and the particles left out would bend the normals. The other kernels are scaled to enclose
+// the same volume as Poly6, so an isovalue tuned for one stays in the right range for the others.
+
+enum class DensityKernel {
+	Poly6,
+	CubicSpline,
+	Wendland
+};
+
+struct KernelCoefficients {
+	float inverseSupportSquared;
+	float norm;
+	// d(q^2)/dr is 2 r / support^2, so the gradient at r from a particle is gradientScale * slope(q^2) * r
+	float gradientScale;
+};
+
+struct Poly6Kernel {
+	static constexpr float volumeScale = 1.0f;
+
+	template<typename T>
+	static T shape(T q2) {
+		T t = T(1.0f) - q2;
+		return t * t * t;
+	}
+
+	template<typename T>
+	static T slope(T q2) {
+		T t = T(1.0f) - q2;
+		return T(-3.0f) * t * t;
+	}
+};
+
+// M4 cubic B-spline, 1 at the centre
+struct CubicSplineKernel {
+	// Volume of Poly6 over the volume of this shape, (64 pi / 315) / (pi / 8)
+	static constexpr float volumeScale = 512.0f / 315.0f;
+
+	template<typename T>
+	static T shape(T q2) {
+		T q = lanes::sqrt(q2);
+		T inner = T(1.0f) - T(6.0f) * q2 + T(6.0f) * q2 * q;
+		T t = T(1.0f) - q;
+		T outer = T(2.0f) * t * t * t;
+		return lanes::select(lanes::lessThan(q, T(0.5f)), inner, outer);
+	}
+
+	template<typename T>
+	static T slope(T q2) {
+		T q = lanes::sqrt(q2);
+		T inner = T(-6.0f) + T(9.0f) * q;
+		// Both sides get evaluated, keep the unused one away from q = 0
+		T t = T(1.0f) - q;
+		T outer = T(-3.0f) * t * t / lanes::max(q, T(0.5f));
+		return lanes::select(lanes::lessThan(q, T(0.5f)), inner, outer);
+	}
+};
+
+// Wendland C2, 1 at the centre
+struct WendlandKernel {
+	// (64 pi / 315) / (2 pi / 21)
+	static constexpr float volumeScale = 32.0f / 15.0f;
+
+	template<typename T>
+	static T shape(T q2) {
+		T q = lanes::sqrt(q2);
+		T t = T(1.0f) - q;
+		T t2 = t * t;
+		return t2 * t2 * (T(1.0f) + T(4.0f) * q);
+	}
+
+	template<typename T>
+	static T slope(T q2) {
+		T t = T(1.0f) - lanes::sqrt(q2);
+		return T(-10.0f) * t * t * t;
+	}
+};
+
+template<typename Kernel>
+inline KernelCoefficients makeKernelCoefficients(float kernelRadius, float kernelScale, float gatherRadius) {
+	float scaledRadius = kernelRadius * kernelScale;
+	float scaledRadiusSquared = scaledRadius * scaledRadius;
+	float support = std::min(kernelRadius * scaledRadius, gatherRadius);
+
+	KernelCoefficients coefficients;
+	coefficients.inverseSupportSquared = 1.0f / (support * support);
+	coefficients.norm = Kernel::volumeScale * 315.0f / (64.0f * PI * scaledRadiusSquared * scaledRadiusSquared * scaledRadiusSquared);
+	coefficients.gradientScale = 2.0f * coefficients.norm * coefficients.inverseSupportSquared;
+	return coefficients;
+}
+
+template<typename Kernel>
+inline float evaluateKernel(const KernelCoefficients& coefficients, float distanceSquared) {
+	float q2 = lanes::min(distanceSquared * coefficients.inverseSupportSquared, 1.0f);
+	return coefficients.norm * Kernel::shape(q2);
+}
+
+// Multiply by the offset from the particle to get the gradient
+template<typename Kernel>
+inline float evaluateKernelGradientScale(const KernelCoefficients& coefficients, float distanceSquared) {
+	float q2 = lanes::min(distanceSquared * coefficients.inverseSupportSquared, 1.0f);
+	return coefficients.gradientScale * Kernel::slope(q2);
+}
+
+// Sum of the kernel at point over count particles stored as separate x, y and z arrays, adding the sum of their
+// gradients to gradient
+template<typename Kernel>
+inline float sumKernel(const KernelCoefficients& coefficients, const Vec3& point, const float* xs, const float* ys, const float* zs, int count,
+	Vec3& gradient) {
+	FloatLanes px = point.x, py = point.y, pz = point.z;
+	FloatLanes inverseSupportSquared = coefficients.inverseSupportSquared;
+	FloatLanes sum = 0.0f;
+	FloatLanes gx = 0.0f, gy = 0.0f, gz = 0.0f;
+
+	int i = 0;
+	for (; i + FloatLanes::width <= count; i += FloatLanes::width) {
+		FloatLanes dx = px - FloatLanes::load(xs + i);
+		FloatLanes dy = py - FloatLanes::load(ys + i);
+		FloatLanes dz = pz - FloatLanes::load(zs + i);
+		FloatLanes q2 = lanes::min((dx * dx + dy * dy + dz * dz) * inverseSupportSquared, FloatLanes(1.0f));
+		sum += Kernel::shape(q2);
+		FloatLanes slope = Kernel::slope(q2);
+		gx += slope * dx;
+		gy += slope * dy;
+		gz += slope * dz;
+	}
+
+	float total = sum.sum();
+	Vec3 slopeSum = { gx.sum(), gy.sum(), gz.sum() };
+	for (; i < count; i++) {
+		Vec3 r = { point.x - xs[i], point.y - ys[i], point.z - zs[i] };
+		float q2 = lanes::min(dot(r, r) * coefficients.inverseSupportSquared, 1.0f);
+		total += Kernel::shape(q2);
+		slopeSum = slopeSum + r * Kernel::slope(q2);
+	}
+
+	gradient = gradient + slopeSum * coefficients.gradientScale;
+	return coefficients.norm * total;
+}
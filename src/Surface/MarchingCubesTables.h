@@ -0,0 +1,285 @@
+#pragma once
+
+// C++ copy of Shaders/FluidSurfaceConstruction/MarchingCubesTables.hlsl, keep the two in sync.
+// Cell corners and edges are numbered as in the diagram there: corner bit i of a case is set when
+// corner (i & 1, (i >> 2) & 1, (i >> 1) & 1) in (x, y, z) is above the isovalue, and edges are
+// grouped by axis with four edges per axis (x: 0-3, y: 4-7, z: 8-11).
+
+static const unsigned int triangleCounts[256] = {
+    0, 1, 1, 2, 1, 2, 4, 3, 1, 4, 2, 3, 2, 3, 3, 2, // 0 -
+    1, 2, 4, 3, 4, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 3, // 16 -
+    1, 4, 2, 3, 2, 3, 3, 4, 4, 3, 3, 4, 3, 4, 4, 3, // 32 -
+    2, 3, 3, 2, 3, 4, 4, 3, 3, 4, 4, 3, 4, 3, 3, 2, // 48 -
+    1, 4, 2, 3, 2, 3, 3, 4, 4, 3, 3, 4, 3, 4, 4, 3, // 64 -
+    2, 3, 3, 4, 3, 2, 4, 3, 3, 4, 4, 3, 4, 3, 3, 2, // 80 -
+    4, 3, 3, 4, 3, 4, 4, 3, 3, 4, 4, 3, 4, 3, 3, 4, // 96 -
+    3, 4, 4, 3, 4, 3, 3, 2, 4, 3, 3, 4, 3, 4, 2, 1, // 112 -
+    1, 2, 4, 3, 4, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 3, // 128 -
+    4, 3, 3, 4, 3, 4, 4, 3, 3, 4, 4, 3, 4, 3, 3, 4, // 144 -
+    2, 3, 3, 4, 3, 4, 4, 3, 3, 4, 2, 3, 4, 3, 3, 2, // 160 -
+    3, 4, 4, 3, 4, 3, 3, 4, 4, 3, 3, 2, 3, 2, 4, 1, // 176 -
+    2, 3, 3, 4, 3, 4, 4, 3, 3, 4, 4, 3, 2, 3, 3, 2, // 192 -
+    3, 4, 4, 3, 4, 3, 3, 4, 4, 3, 3, 2, 3, 2, 4, 1, // 208 -
+    3, 4, 4, 3, 4, 3, 3, 2, 4, 3, 3, 4, 3, 4, 2, 1, // 224 -
+    2, 3, 3, 2, 3, 2, 4, 1, 3, 4, 2, 1, 2, 1, 1, 0  // 240 -
+};
+
+// Stored values are edge index
+static const int triangleTable[256][12] = {
+    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 5, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {8, 4, 9, 9, 4, 5, -1, -1, -1, -1, -1, -1},
+    {2, 6, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 0, 6, 6, 0, 2, -1, -1, -1, -1, -1, -1},
+    {8, 6, 5, 5, 0, 8, 9, 5, 6, 6, 2, 9},
+    {6, 9, 2, 6, 5, 9, 6, 4, 5, -1, -1, -1},
+    {9, 7, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {7, 9, 0, 0, 4, 7, 4, 8, 2, 2, 7, 4},
+    {7, 2, 5, 5, 2, 0, -1, -1, -1, -1, -1, -1},
+    {4, 2, 8, 4, 7, 2, 4, 5, 7, -1, -1, -1},
+    {6, 8, 7, 7, 8, 9, -1, -1, -1, -1, -1, -1},
+    {7, 0, 9, 7, 4, 0, 7, 6, 4, -1, -1, -1},
+    {5, 8, 0, 5, 6, 8, 5, 7, 6, -1, -1, -1},
+    {4, 5, 6, 6, 5, 7, -1, -1, -1, -1, -1, -1},
+    {1, 4, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {10, 1, 8, 8, 1, 0, -1, -1, -1, -1, -1, -1},
+    {10, 4, 0, 0, 9, 10, 9, 5, 1, 1, 10, 9},
+    {9, 1, 5, 9, 10, 1, 9, 8, 10, -1, -1, -1},
+    {2, 8, 4, 4, 1, 2, 1, 10, 6, 6, 2, 1},
+    {1, 6, 10, 1, 2, 6, 1, 0, 2, -1, -1, -1},
+    {0, 5, 9, 4, 10, 1, 6, 8, 2, -1, -1, -1},
+    {10, 1, 6, 6, 1, 2, 2, 1, 5, 2, 5, 9},
+    {1, 4, 10, 2, 9, 7, -1, -1, -1, -1, -1, -1},
+    {10, 1, 8, 8, 1, 0, 7, 2, 9, -1, -1, -1},
+    {7, 2, 5, 5, 2, 0, 10, 1, 4, -1, -1, -1},
+    {7, 2, 8, 7, 8, 1, 8, 10, 1, 5, 7, 1},
+    {9, 7, 8, 8, 7, 6, 1, 4, 10, -1, -1, -1},
+    {7, 6, 9, 6, 10, 1, 9, 6, 1, 9, 1, 0},
+    {10, 1, 4, 5, 8, 0, 5, 6, 8, 5, 7, 6},
+    {10, 1, 6, 1, 5, 6, 5, 7, 6, -1, -1, -1},
+    {5, 1, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {8, 0, 5, 5, 11, 8, 11, 1, 4, 4, 8, 11},
+    {1, 11, 0, 0, 11, 9, -1, -1, -1, -1, -1, -1},
+    {11, 4, 1, 11, 8, 4, 11, 9, 8, -1, -1, -1},
+    {5, 1, 11, 6, 8, 2, -1, -1, -1, -1, -1, -1},
+    {2, 6, 0, 0, 6, 4, 11, 5, 1, -1, -1, -1},
+    {1, 11, 0, 0, 11, 9, 6, 8, 2, -1, -1, -1},
+    {11, 9, 1, 9, 2, 6, 1, 9, 6, 1, 6, 4},
+    {1, 5, 9, 9, 2, 1, 2, 7, 11, 11, 1, 2},
+    {5, 1, 11, 0, 8, 4, 2, 9, 7, -1, -1, -1},
+    {2, 11, 7, 2, 1, 11, 2, 0, 1, -1, -1, -1},
+    {7, 2, 11, 11, 2, 1, 1, 2, 8, 1, 8, 4},
+    {6, 8, 7, 7, 8, 9, 1, 11, 5, -1, -1, -1},
+    {1, 11, 5, 7, 0, 9, 7, 4, 0, 7, 6, 4},
+    {6, 8, 0, 6, 0, 11, 0, 1, 11, 7, 6, 11},
+    {1, 11, 4, 11, 7, 4, 7, 6, 4, -1, -1, -1},
+    {4, 10, 5, 5, 10, 11, -1, -1, -1, -1, -1, -1},
+    {8, 5, 0, 8, 11, 5, 8, 10, 11, -1, -1, -1},
+    {10, 0, 4, 10, 9, 0, 10, 11, 9, -1, -1, -1},
+    {10, 11, 8, 8, 11, 9, -1, -1, -1, -1, -1, -1},
+    {11, 5, 10, 10, 5, 4, 2, 6, 8, -1, -1, -1},
+    {2, 6, 10, 2, 10, 5, 10, 11, 5, 0, 2, 5},
+    {2, 6, 8, 10, 0, 4, 10, 9, 0, 10, 11, 9},
+    {2, 6, 9, 6, 10, 9, 10, 11, 9, -1, -1, -1},
+    {4, 10, 5, 5, 10, 11, 2, 9, 7, -1, -1, -1},
+    {7, 2, 9, 8, 5, 0, 8, 11, 5, 8, 10, 11},
+    {10, 11, 4, 11, 7, 2, 4, 11, 2, 4, 2, 0},
+    {7, 2, 11, 2, 8, 11, 8, 10, 11, -1, -1, -1},
+    {4, 10, 11, 4, 11, 5, 6, 8, 7, 8, 9, 7},
+    {11, 6, 10, 7, 6, 11, 9, 5, 0, -1, -1, -1},
+    {6, 11, 7, 10, 11, 6, 4, 8, 0, -1, -1, -1},
+    {11, 6, 10, 7, 6, 11, -1, -1, -1, -1, -1, -1},
+    {3, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 4, 10, 10, 3, 0, 3, 6, 8, 8, 0, 3},
+    {3, 10, 6, 0, 5, 9, -1, -1, -1, -1, -1, -1},
+    {5, 9, 4, 4, 9, 8, 3, 10, 6, -1, -1, -1},
+    {8, 2, 10, 10, 2, 3, -1, -1, -1, -1, -1, -1},
+    {0, 10, 4, 0, 3, 10, 0, 2, 3, -1, -1, -1},
+    {3, 10, 2, 2, 10, 8, 5, 9, 0, -1, -1, -1},
+    {3, 10, 4, 3, 4, 9, 4, 5, 9, 2, 3, 9},
+    {9, 2, 6, 6, 10, 9, 10, 3, 7, 7, 9, 10},
+    {8, 4, 0, 6, 3, 10, 7, 2, 9, -1, -1, -1},
+    {0, 5, 2, 2, 5, 7, 10, 6, 3, -1, -1, -1},
+    {3, 10, 6, 4, 2, 8, 4, 7, 2, 4, 5, 7},
+    {10, 7, 3, 10, 9, 7, 10, 8, 9, -1, -1, -1},
+    {4, 0, 10, 10, 0, 3, 3, 0, 9, 3, 9, 7},
+    {10, 8, 3, 8, 0, 5, 3, 8, 5, 3, 5, 7},
+    {3, 10, 7, 10, 4, 7, 4, 5, 7, -1, -1, -1},
+    {6, 3, 4, 4, 3, 1, -1, -1, -1, -1, -1, -1},
+    {3, 8, 6, 3, 0, 8, 3, 1, 0, -1, -1, -1},
+    {6, 3, 4, 4, 3, 1, 9, 0, 5, -1, -1, -1},
+    {9, 8, 5, 8, 6, 3, 5, 8, 3, 5, 3, 1},
+    {2, 4, 8, 2, 1, 4, 2, 3, 1, -1, -1, -1},
+    {1, 0, 3, 3, 0, 2, -1, -1, -1, -1, -1, -1},
+    {5, 9, 0, 2, 4, 8, 2, 1, 4, 2, 3, 1},
+    {5, 9, 1, 9, 2, 1, 2, 3, 1, -1, -1, -1},
+    {1, 4, 3, 3, 4, 6, 9, 7, 2, -1, -1, -1},
+    {9, 7, 2, 3, 8, 6, 3, 0, 8, 3, 1, 0},
+    {6, 3, 1, 6, 1, 4, 7, 2, 5, 2, 0, 5},
+    {7, 1, 5, 3, 1, 7, 6, 2, 8, -1, -1, -1},
+    {1, 4, 8, 1, 8, 7, 8, 9, 7, 3, 1, 7},
+    {9, 7, 0, 7, 3, 0, 3, 1, 0, -1, -1, -1},
+    {1, 7, 3, 5, 7, 1, 0, 4, 8, -1, -1, -1},
+    {1, 7, 3, 5, 7, 1, -1, -1, -1, -1, -1, -1},
+    {6, 10, 1, 1, 5, 6, 5, 11, 3, 3, 6, 5},
+    {1, 11, 5, 10, 6, 3, 8, 4, 0, -1, -1, -1},
+    {9, 0, 11, 11, 0, 1, 6, 3, 10, -1, -1, -1},
+    {6, 3, 10, 11, 4, 1, 11, 8, 4, 11, 9, 8},
+    {8, 2, 10, 10, 2, 3, 5, 1, 11, -1, -1, -1},
+    {11, 5, 1, 0, 10, 4, 0, 3, 10, 0, 2, 3},
+    {8, 2, 3, 8, 3, 10, 9, 0, 11, 0, 1, 11},
+    {3, 9, 2, 11, 9, 3, 1, 10, 4, -1, -1, -1},
+    {7, 2, 9, 3, 10, 6, 1, 11, 5, -1, -1, -1},
+    {0, 8, 4, 1, 11, 5, 6, 3, 10, 7, 2, 9},
+    {10, 6, 3, 2, 11, 7, 2, 1, 11, 2, 0, 1},
+    {4, 1, 10, 11, 7, 3, 8, 6, 2, -1, -1, -1},
+    {5, 1, 11, 10, 7, 3, 10, 9, 7, 10, 8, 9},
+    {7, 3, 11, 10, 4, 1, 9, 5, 0, -1, -1, -1},
+    {1, 8, 0, 10, 8, 1, 3, 11, 7, -1, -1, -1},
+    {4, 1, 11, 11, 7, 4, 7, 3, 10, 10, 4, 7},
+    {5, 3, 11, 5, 6, 3, 5, 4, 6, -1, -1, -1},
+    {6, 3, 8, 8, 3, 0, 0, 3, 11, 0, 11, 5},
+    {6, 3, 11, 6, 11, 0, 11, 9, 0, 4, 6, 0},
+    {6, 3, 8, 3, 11, 8, 11, 9, 8, -1, -1, -1},
+    {5, 4, 11, 4, 8, 2, 11, 4, 2, 11, 2, 3},
+    {11, 5, 3, 5, 0, 3, 0, 2, 3, -1, -1, -1},
+    {9, 3, 11, 2, 3, 9, 8, 0, 4, -1, -1, -1},
+    {9, 3, 11, 2, 3, 9, -1, -1, -1, -1, -1, -1},
+    {2, 9, 7, 5, 3, 11, 5, 6, 3, 5, 4, 6},
+    {5, 0, 9, 8, 6, 2, 11, 7, 3, -1, -1, -1},
+    {6, 0, 4, 2, 0, 6, 7, 3, 11, -1, -1, -1},
+    {11, 7, 2, 2, 8, 11, 8, 6, 3, 3, 11, 8},
+    {9, 4, 8, 5, 4, 9, 11, 7, 3, -1, -1, -1},
+    {3, 11, 5, 5, 0, 3, 0, 9, 7, 7, 3, 0},
+    {4, 8, 0, 11, 7, 3, -1, -1, -1, -1, -1, -1},
+    {3, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {7, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {0, 8, 4, 3, 7, 11, -1, -1, -1, -1, -1, -1},
+    {3, 11, 5, 5, 0, 3, 0, 9, 7, 7, 3, 0},
+    {8, 4, 9, 9, 4, 5, 3, 7, 11, -1, -1, -1},
+    {11, 7, 2, 2, 8, 11, 8, 6, 3, 3, 11, 8},
+    {4, 0, 6, 6, 0, 2, 11, 3, 7, -1, -1, -1},
+    {9, 0, 5, 2, 6, 8, 3, 7, 11, -1, -1, -1},
+    {11, 3, 7, 6, 9, 2, 6, 5, 9, 6, 4, 5},
+    {11, 3, 9, 9, 3, 2, -1, -1, -1, -1, -1, -1},
+    {11, 3, 9, 9, 3, 2, 4, 0, 8, -1, -1, -1},
+    {3, 5, 11, 3, 0, 5, 3, 2, 0, -1, -1, -1},
+    {3, 2, 11, 2, 8, 4, 11, 2, 4, 11, 4, 5},
+    {8, 3, 6, 8, 11, 3, 8, 9, 11, -1, -1, -1},
+    {4, 0, 9, 4, 9, 3, 9, 11, 3, 6, 4, 3},
+    {6, 8, 3, 3, 8, 11, 11, 8, 0, 11, 0, 5},
+    {11, 3, 5, 3, 6, 5, 6, 4, 5, -1, -1, -1},
+    {4, 1, 11, 11, 7, 4, 7, 3, 10, 10, 4, 7},
+    {0, 8, 1, 1, 8, 10, 7, 11, 3, -1, -1, -1},
+    {11, 3, 7, 1, 4, 10, 0, 5, 9, -1, -1, -1},
+    {3, 7, 11, 9, 1, 5, 9, 10, 1, 9, 8, 10},
+    {10, 1, 4, 3, 7, 11, 2, 6, 8, -1, -1, -1},
+    {7, 11, 3, 1, 6, 10, 1, 2, 6, 1, 0, 2},
+    {1, 4, 10, 3, 7, 11, 8, 2, 6, 9, 0, 5},
+    {9, 2, 7, 6, 10, 3, 5, 11, 1, -1, -1, -1},
+    {2, 9, 3, 3, 9, 11, 4, 10, 1, -1, -1, -1},
+    {0, 8, 10, 0, 10, 1, 2, 9, 3, 9, 11, 3},
+    {4, 10, 1, 3, 5, 11, 3, 0, 5, 3, 2, 0},
+    {10, 2, 8, 3, 2, 10, 11, 1, 5, -1, -1, -1},
+    {1, 4, 10, 8, 3, 6, 8, 11, 3, 8, 9, 11},
+    {11, 0, 9, 1, 0, 11, 10, 3, 6, -1, -1, -1},
+    {5, 11, 1, 3, 6, 10, 0, 4, 8, -1, -1, -1},
+    {6, 10, 1, 1, 5, 6, 5, 11, 3, 3, 6, 5},
+    {3, 7, 1, 1, 7, 5, -1, -1, -1, -1, -1, -1},
+    {3, 7, 1, 1, 7, 5, 8, 4, 0, -1, -1, -1},
+    {0, 7, 9, 0, 3, 7, 0, 1, 3, -1, -1, -1},
+    {3, 7, 9, 3, 9, 4, 9, 8, 4, 1, 3, 4},
+    {5, 1, 7, 7, 1, 3, 8, 2, 6, -1, -1, -1},
+    {2, 6, 4, 2, 4, 0, 3, 7, 1, 7, 5, 1},
+    {6, 8, 2, 0, 7, 9, 0, 3, 7, 0, 1, 3},
+    {3, 4, 1, 6, 4, 3, 2, 7, 9, -1, -1, -1},
+    {1, 9, 5, 1, 2, 9, 1, 3, 2, -1, -1, -1},
+    {8, 4, 0, 1, 9, 5, 1, 2, 9, 1, 3, 2},
+    {3, 2, 1, 1, 2, 0, -1, -1, -1, -1, -1, -1},
+    {8, 4, 2, 4, 1, 2, 1, 3, 2, -1, -1, -1},
+    {1, 3, 5, 3, 6, 8, 5, 3, 8, 5, 8, 9},
+    {4, 3, 6, 1, 3, 4, 5, 0, 9, -1, -1, -1},
+    {6, 8, 3, 8, 0, 3, 0, 1, 3, -1, -1, -1},
+    {4, 3, 6, 1, 3, 4, -1, -1, -1, -1, -1, -1},
+    {7, 10, 3, 7, 4, 10, 7, 5, 4, -1, -1, -1},
+    {8, 10, 0, 10, 3, 7, 0, 10, 7, 0, 7, 5},
+    {3, 7, 10, 10, 7, 4, 4, 7, 9, 4, 9, 0},
+    {3, 7, 10, 7, 9, 10, 9, 8, 10, -1, -1, -1},
+    {8, 2, 6, 7, 10, 3, 7, 4, 10, 7, 5, 4},
+    {2, 5, 0, 7, 5, 2, 3, 6, 10, -1, -1, -1},
+    {0, 4, 8, 10, 3, 6, 9, 2, 7, -1, -1, -1},
+    {9, 2, 6, 6, 10, 9, 10, 3, 7, 7, 9, 10},
+    {2, 9, 5, 2, 5, 10, 5, 4, 10, 3, 2, 10},
+    {2, 10, 3, 8, 10, 2, 0, 9, 5, -1, -1, -1},
+    {4, 10, 0, 10, 3, 0, 3, 2, 0, -1, -1, -1},
+    {10, 2, 8, 3, 2, 10, -1, -1, -1, -1, -1, -1},
+    {4, 9, 5, 8, 9, 4, 6, 10, 3, -1, -1, -1},
+    {6, 10, 3, 9, 5, 0, -1, -1, -1, -1, -1, -1},
+    {0, 4, 10, 10, 3, 0, 3, 6, 8, 8, 0, 3},
+    {6, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {10, 6, 11, 11, 6, 7, -1, -1, -1, -1, -1, -1},
+    {7, 11, 6, 6, 11, 10, 0, 8, 4, -1, -1, -1},
+    {10, 6, 11, 11, 6, 7, 0, 5, 9, -1, -1, -1},
+    {10, 6, 7, 10, 7, 11, 8, 4, 9, 4, 5, 9},
+    {11, 2, 7, 11, 8, 2, 11, 10, 8, -1, -1, -1},
+    {11, 10, 7, 10, 4, 0, 7, 10, 0, 7, 0, 2},
+    {0, 5, 9, 11, 2, 7, 11, 8, 2, 11, 10, 8},
+    {5, 10, 4, 11, 10, 5, 7, 9, 2, -1, -1, -1},
+    {9, 6, 2, 9, 10, 6, 9, 11, 10, -1, -1, -1},
+    {4, 0, 8, 9, 6, 2, 9, 10, 6, 9, 11, 10},
+    {10, 6, 2, 10, 2, 5, 2, 0, 5, 11, 10, 5},
+    {10, 5, 11, 4, 5, 10, 8, 6, 2, -1, -1, -1},
+    {8, 9, 10, 10, 9, 11, -1, -1, -1, -1, -1, -1},
+    {4, 0, 10, 0, 9, 10, 9, 11, 10, -1, -1, -1},
+    {0, 5, 8, 5, 11, 8, 11, 10, 8, -1, -1, -1},
+    {5, 10, 4, 11, 10, 5, -1, -1, -1, -1, -1, -1},
+    {4, 11, 1, 4, 7, 11, 4, 6, 7, -1, -1, -1},
+    {0, 8, 6, 0, 6, 11, 6, 7, 11, 1, 0, 11},
+    {9, 0, 5, 4, 11, 1, 4, 7, 11, 4, 6, 7},
+    {7, 8, 6, 9, 8, 7, 5, 11, 1, -1, -1, -1},
+    {8, 2, 4, 4, 2, 1, 1, 2, 7, 1, 7, 11},
+    {7, 11, 2, 11, 1, 2, 1, 0, 2, -1, -1, -1},
+    {11, 1, 5, 4, 8, 0, 7, 9, 2, -1, -1, -1},
+    {1, 5, 9, 9, 2, 1, 2, 7, 11, 11, 1, 2},
+    {4, 6, 1, 6, 2, 9, 1, 6, 9, 1, 9, 11},
+    {0, 11, 1, 9, 11, 0, 2, 8, 6, -1, -1, -1},
+    {0, 6, 2, 4, 6, 0, 1, 5, 11, -1, -1, -1},
+    {11, 1, 5, 2, 8, 6, -1, -1, -1, -1, -1, -1},
+    {1, 4, 11, 4, 8, 11, 8, 9, 11, -1, -1, -1},
+    {0, 11, 1, 9, 11, 0, -1, -1, -1, -1, -1, -1},
+    {8, 0, 5, 5, 11, 8, 11, 1, 4, 4, 8, 11},
+    {11, 1, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 1, 10, 6, 5, 1, 6, 7, 5, -1, -1, -1},
+    {0, 8, 4, 6, 1, 10, 6, 5, 1, 6, 7, 5},
+    {6, 7, 10, 7, 9, 0, 10, 7, 0, 10, 0, 1},
+    {8, 7, 9, 6, 7, 8, 10, 4, 1, -1, -1, -1},
+    {8, 2, 7, 8, 7, 1, 7, 5, 1, 10, 8, 1},
+    {5, 2, 7, 0, 2, 5, 4, 1, 10, -1, -1, -1},
+    {8, 1, 10, 0, 1, 8, 9, 2, 7, -1, -1, -1},
+    {10, 4, 1, 7, 9, 2, -1, -1, -1, -1, -1, -1},
+    {10, 6, 1, 1, 6, 5, 5, 6, 2, 5, 2, 9},
+    {9, 5, 0, 1, 10, 4, 2, 8, 6, -1, -1, -1},
+    {10, 6, 1, 6, 2, 1, 2, 0, 1, -1, -1, -1},
+    {2, 8, 4, 4, 1, 2, 1, 10, 6, 6, 2, 1},
+    {5, 1, 9, 1, 10, 9, 10, 8, 9, -1, -1, -1},
+    {10, 4, 0, 0, 9, 10, 9, 5, 1, 1, 10, 9},
+    {8, 1, 10, 0, 1, 8, -1, -1, -1, -1, -1, -1},
+    {10, 4, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {6, 7, 4, 4, 7, 5, -1, -1, -1, -1, -1, -1},
+    {0, 8, 5, 8, 6, 5, 6, 7, 5, -1, -1, -1},
+    {9, 0, 7, 0, 4, 7, 4, 6, 7, -1, -1, -1},
+    {7, 8, 6, 9, 8, 7, -1, -1, -1, -1, -1, -1},
+    {8, 2, 4, 2, 7, 4, 7, 5, 4, -1, -1, -1},
+    {5, 2, 7, 0, 2, 5, -1, -1, -1, -1, -1, -1},
+    {7, 9, 0, 0, 4, 7, 4, 8, 2, 2, 7, 4},
+    {2, 7, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {2, 9, 6, 9, 5, 6, 5, 4, 6, -1, -1, -1},
+    {8, 6, 5, 5, 0, 8, 9, 5, 6, 6, 2, 9},
+    {6, 0, 4, 2, 0, 6, -1, -1, -1, -1, -1, -1},
+    {8, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {9, 4, 8, 5, 4, 9, -1, -1, -1, -1, -1, -1},
+    {9, 5, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {4, 8, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+    {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// A few floats processed together. SSE2 where the compiler targets it (always on x64), otherwise a single float,
+// so code written against FloatLanes and the functions below runs either way. Define SURFACE_SIMD_SCALAR to force the
+// single float path, the benchmarks use it to measure what SSE2 buys
+
+#if !defined(SURFACE_SIMD_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SURFACE_SIMD_SSE2 1
+
+struct FloatLanes {
+	static constexpr int width = 4;
+	__m128 v;
+
+	FloatLanes() = default;
+	FloatLanes(__m128 v) : v(v) {}
+	FloatLanes(float s) : v(_mm_set1_ps(s)) {}
+
+	static FloatLanes load(const float* p) { return _mm_loadu_ps(p); }
+
+	float sum() const {
+		__m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+
+	FloatLanes operator+(const FloatLanes& o) const { return _mm_add_ps(v, o.v); }
+	FloatLanes operator-(const FloatLanes& o) const { return _mm_sub_ps(v, o.v); }
+	FloatLanes operator*(const FloatLanes& o) const { return _mm_mul_ps(v, o.v); }
+	FloatLanes operator/(const FloatLanes& o) const { return _mm_div_ps(v, o.v); }
+	FloatLanes& operator+=(const FloatLanes& o) { v = _mm_add_ps(v, o.v); return *this; }
+};
+
+namespace lanes {
+	inline FloatLanes min(const FloatLanes& a, const FloatLanes& b) { return _mm_min_ps(a.v, b.v); }
+	inline FloatLanes max(const FloatLanes& a, const FloatLanes& b) { return _mm_max_ps(a.v, b.v); }
+	inline FloatLanes sqrt(const FloatLanes& a) { return _mm_sqrt_ps(a.v); }
+	// All bits set in lanes where a < b
+	inline FloatLanes lessThan(const FloatLanes& a, const FloatLanes& b) { return _mm_cmplt_ps(a.v, b.v); }
+	inline FloatLanes select(const FloatLanes& mask, const FloatLanes& a, const FloatLanes& b) {
+		return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+	}
+}
+
+#else
+
+struct FloatLanes {
+	static constexpr int width = 1;
+	float v;
+
+	FloatLanes() = default;
+	FloatLanes(float s) : v(s) {}
+
+	static FloatLanes load(const float* p) { return *p; }
+	float sum() const { return v; }
+
+	FloatLanes operator+(const FloatLanes& o) const { return v + o.v; }
+	FloatLanes operator-(const FloatLanes& o) const { return v - o.v; }
+	FloatLanes operator*(const FloatLanes& o) const { return v * o.v; }
+	FloatLanes operator/(const FloatLanes& o) const { return v / o.v; }
+	FloatLanes& operator+=(const FloatLanes& o) { v += o.v; return *this; }
+};
+
+namespace lanes {
+	inline FloatLanes min(const FloatLanes& a, const FloatLanes& b) { return std::min(a.v, b.v); }
+	inline FloatLanes max(const FloatLanes& a, const FloatLanes& b) { return std::max(a.v, b.v); }
+	inline FloatLanes sqrt(const FloatLanes& a) { return std::sqrt(a.v); }
+	inline bool lessThan(const FloatLanes& a, const FloatLanes& b) { return a.v < b.v; }
+	inline FloatLanes select(bool mask, const FloatLanes& a, const FloatLanes& b) { return mask ? a : b; }
+}
+
+#endif
+
+// Plain float versions, so kernels can be written once for both
+namespace lanes {
+	inline float min(float a, float b) { return std::min(a, b); }
+	inline float max(float a, float b) { return std::max(a, b); }
+	inline float sqrt(float a) { return std::sqrt(a); }
+	inline bool lessThan(float a, float b) { return a < b; }
+	inline float select(bool mask, float a, float b) { return mask ? a : b; }
+}
@@ -0,0 +1,1228 @@
+#include "SurfaceExtractor.h"
+#include "MarchingCubesTables.h"
+#include "DensityKernels.h"
+
+#include <chrono>
+
+static_assert(CELLS_PER_BLOCK_EDGE == 4, "The half-block edge layout below assumes 4x4x4 blocks");
+
+// Edges of a 4x4x2 half-block are numbered axis by axis, each axis as a grid of the vertices they start from.
+// Same layout as getGlobalVerticesForEdge / cellEdgeToBlockEdge in ConstructMeshShader.hlsl
+static const Int3 edgeDims[3] = { { 4, 5, 3 }, { 5, 4, 3 }, { 5, 5, 2 } };
+static const int edgesPerAxis = 60;
+static const int edgeOffsets[12] = { 0, 4, 20, 24, 60, 61, 80, 81, 120, 121, 125, 126 };
+
+static int& component(Int3& v, int axis) {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+static int cellEdgeToBlockEdge(int localCellIdx1d, int localEdgeIdx, int halfBlockIndex) {
+	int axis = localEdgeIdx / 4;
+	Int3 localCellIdx3d = to3D(localCellIdx1d - halfBlockIndex * CELLS_PER_HALFBLOCK, { CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE });
+	return edgeOffsets[localEdgeIdx] + to1D(localCellIdx3d, edgeDims[axis]);
+}
+
+// -1 on the first cell of a block edge, 1 on the last one, 0 in between (see BilevelUniformGrid.hlsl)
+static int blockEdgeSide(int localCellIndex) {
+	float halfCellsPerBlockEdgeMinusOne = (CELLS_PER_BLOCK_EDGE - 1) / 2.0f;
+	return (int)std::trunc((localCellIndex - halfCellsPerBlockEdgeMinusOne) / halfCellsPerBlockEdgeMinusOne);
+}
+
+// Corner i of a cell, bit 0 is x, bit 1 z and bit 2 y like the tables
+static Int3 cellCorner(int corner) {
+	return { corner & 1, (corner >> 2) & 1, (corner >> 1) & 1 };
+}
+
+// Corner of a cell that edge starts from, edges are grouped by axis like the tables
+static Int3 cellEdgeOrigin(int edge) {
+	int k = edge % 4;
+	switch (edge / 4) {
+	case 0: return { 0, k & 1, k >> 1 };
+	case 1: return { k & 1, 0, k >> 1 };
+	default: return { k & 1, k >> 1, 0 };
+	}
+}
+
+// Everything a surface depends on that can change between extractions without the particles moving
+static bool sameSurfaceSettings(const SurfaceParams& a, const SurfaceParams& b) {
+	return a.dimensions == b.dimensions &&
+		a.minBounds.x == b.minBounds.x && a.minBounds.y == b.minBounds.y && a.minBounds.z == b.minBounds.z &&
+		a.resolution == b.resolution && a.kernelScale == b.kernelScale && a.kernelRadius == b.kernelRadius &&
+		a.isovalue == b.isovalue && a.material == b.material && a.reuseTolerance == b.reuseTolerance && a.kernel == b.kernel;
+}
+
+void SurfaceMesh::clear() {
+	positions.clear();
+	normals.clear();
+	colors.clear();
+	indices.clear();
+}
+
+SurfaceExtractor::SurfaceExtractor(WorkerPool* pool)
+	: pool(pool), scan(pool)
+{
+}
+
+template<typename Task>
+void SurfaceExtractor::parallelFor(size_t count, size_t grainSize, const Task& task) {
+	if (pool) {
+		pool->parallelFor(count, grainSize, task);
+	}
+	else if (count > 0) {
+		task(0, count);
+	}
+}
+
+int SurfaceExtractor::getKernelOffset() const {
+	return (int)(0.999f * params.kernelRadius / params.resolution);
+}
+
+void SurfaceExtractor::extract(const Vec4* positions, const Vec4* materials, size_t particleCount, const SurfaceParams& newParams, SurfaceMesh& mesh) {
+	params = newParams;
+	if (params.material < 0) {
+		extractParticles(positions, materials, nullptr, particleCount, mesh);
+		return;
+	}
+
+	binMaterials(materials, particleCount);
+	extractBin(positions, materials, params.material, mesh);
+}
+
+void SurfaceExtractor::extractMaterials(const Vec4* positions, const Vec4* materials, size_t particleCount,
+	const std::vector<SurfaceParams>& materialParams, std::vector<SurfaceMesh>& meshes)
+{
+	// One pass over the particles for every material, the stages below then only touch their own bin
+	binMaterials(materials, particleCount);
+
+	meshes.resize(materialParams.size());
+	if (materialHistories.size() < materialParams.size()) {
+		materialHistories.resize(materialParams.size());
+	}
+
+	for (size_t i = 0; i < materialParams.size(); i++) {
+		// Each entry keeps its own cached blocks between calls
+		swapHistory(materialHistories[i]);
+
+		params = materialParams[i];
+		if (params.material < 0) {
+			extractParticles(positions, materials, nullptr, particleCount, meshes[i]);
+		}
+		else {
+			extractBin(positions, materials, params.material, meshes[i]);
+		}
+
+		swapHistory(materialHistories[i]);
+	}
+}
+
+void SurfaceExtractor::swapHistory(SurfaceHistory& history) {
+	std::swap(builtParams, history.params);
+	std::swap(hasHistory, history.valid);
+	std::swap(extractionIndex, history.extractionIndex);
+	lastParticleCells.swap(history.lastParticleCells);
+	particleExtractions.swap(history.particleExtractions);
+	lastCellParticleCounts.swap(history.lastCellParticleCounts);
+	referencePositions.swap(history.referencePositions);
+	blockMeshes.swap(history.blockMeshes);
+	blockCulled.swap(history.blockCulled);
+	vertexDensities.swap(history.vertexDensities);
+	vertexNormals.swap(history.vertexNormals);
+	vertexColors.swap(history.vertexColors);
+}
+
+void SurfaceExtractor::extractBin(const Vec4* positions, const Vec4* materials, int material, SurfaceMesh& mesh) {
+	if (material >= MAX_SURFACE_MATERIALS) {
+		extractParticles(positions, materials, nullptr, 0, mesh);
+		return;
+	}
+
+	int first = materialBinOffsets[material];
+	int count = materialBinOffsets[material + 1] - first;
+	extractParticles(positions, materials, materialParticleIndices.data() + first, count, mesh);
+}
+
+void SurfaceExtractor::extractParticles(const Vec4* positions, const Vec4* materials, const int* particles, size_t particleCount, SurfaceMesh& mesh) {
+	using Clock = std::chrono::steady_clock;
+	auto millisecondsSince = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	// Levels follow the camera, so cached blocks would hardly ever match
+	if (params.lod.enabled) {
+		params.reuseTolerance = 0.0f;
+	}
+
+	Clock::time_point start = Clock::now();
+	resize();
+	buildBilevelGrid(positions, particles, particleCount);
+	stageTimes.bilevelGrid = millisecondsSince(start);
+
+	start = Clock::now();
+	detectSurfaceBlocks();
+	detectDirtyBlocks(positions);
+	selectBlockLevels();
+	detectSurfaceCells();
+	compactSurfaceVertices();
+	stageTimes.surfaceDetection = millisecondsSince(start);
+
+	start = Clock::now();
+	computeVertexDensities(positions, materials);
+	if (params.lod.enabled) {
+		constrainLodVertices();
+	}
+	stageTimes.density = millisecondsSince(start);
+
+	start = Clock::now();
+	triangulate(mesh);
+	stageTimes.triangulation = millisecondsSince(start);
+}
+
+void SurfaceExtractor::binMaterials(const Vec4* materials, size_t particleCount) {
+	// Same layout as MaterialBins on the GPU: bins in material order, particles in their original order within a bin.
+	// Particles of materials without a surface are left out
+	int binCounts[MAX_SURFACE_MATERIALS] = {};
+	for (size_t i = 0; i < particleCount; i++) {
+		int material = (int)materials[i].w;
+		if (material >= 0 && material < MAX_SURFACE_MATERIALS) {
+			binCounts[material]++;
+		}
+	}
+
+	materialBinOffsets.assign(MAX_SURFACE_MATERIALS + 1, 0);
+	for (int m = 0; m < MAX_SURFACE_MATERIALS; m++) {
+		materialBinOffsets[m + 1] = materialBinOffsets[m] + binCounts[m];
+	}
+
+	materialParticleIndices.resize(materialBinOffsets[MAX_SURFACE_MATERIALS]);
+	int binCursors[MAX_SURFACE_MATERIALS];
+	std::copy(materialBinOffsets.begin(), materialBinOffsets.end() - 1, binCursors);
+	for (size_t i = 0; i < particleCount; i++) {
+		int material = (int)materials[i].w;
+		if (material >= 0 && material < MAX_SURFACE_MATERIALS) {
+			materialParticleIndices[binCursors[material]++] = (int)i;
+		}
+	}
+}
+
+void SurfaceExtractor::resize() {
+	Int3 blockDims = getBlockDimensions();
+	Int3 vertexDims = getVertexDimensions();
+	size_t numCells = (size_t)params.dimensions.x * params.dimensions.y * params.dimensions.z;
+	size_t numBlocks = (size_t)blockDims.x * blockDims.y * blockDims.z;
+	size_t numVerts = (size_t)vertexDims.x * vertexDims.y * vertexDims.z;
+
+	// Everything starts cleared each extraction, like the GPU buffers after resetBuffers
+	cellParticleCounts.assign(numCells, 0);
+	cellParticleOffsets.assign(numCells + 1, 0);
+	blocks.assign(numBlocks, 0);
+
+	// Except for what the cached blocks still use, which only gets dropped when the settings change
+	bool reusable = hasHistory && params.reuseTolerance > 0.0f && sameSurfaceSettings(params, builtParams) && blockMeshes.size() == numBlocks;
+	if (!reusable) {
+		hasHistory = false;
+		vertexDensities.assign(numVerts, 0.0f);
+		vertexNormals.assign(numVerts, { 0.0f, 0.0f, 0.0f });
+		vertexColors.assign(numVerts, { 0.0f, 0.0f, 0.0f, 0.0f });
+		blockMeshes.resize(numBlocks);
+		blockCulled.assign(numBlocks, 0);
+	}
+	builtParams = params;
+	blockDirty.resize(numBlocks);
+	vertexDirty.resize(numVerts);
+
+	if (surfaceVertexCapacity < numVerts) {
+		surfaceVertices.reset(new std::atomic<uint8_t>[numVerts]);
+		surfaceVertexCapacity = numVerts;
+	}
+	parallelFor(numVerts, 65536, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			surfaceVertices[i].store(0, std::memory_order_relaxed);
+		}
+	});
+}
+
+void SurfaceExtractor::buildBilevelGrid(const Vec4* positions, const int* particles, size_t particleCount) {
+	// Cell of every listed particle, -1 when it is outside the grid
+	particleCells.resize(particleCount);
+	parallelFor(particleCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			int particle = particles ? particles[i] : (int)i;
+			Vec3 local = (toVec3(positions[particle]) - params.minBounds) / params.resolution;
+			Int3 cell = { (int)std::floor(local.x), (int)std::floor(local.y), (int)std::floor(local.z) };
+			bool inside = cell.x >= 0 && cell.y >= 0 && cell.z >= 0 &&
+				cell.x < params.dimensions.x && cell.y < params.dimensions.y && cell.z < params.dimensions.z;
+			particleCells[i] = inside ? to1D(cell, params.dimensions) : -1;
+		}
+	});
+
+	// Counting sort into compressed cell lists: count, turn counts into offsets, then place every particle.
+	// Cells end up in ascending order and particles in their original order within a cell
+	size_t particlesInGrid = 0;
+	for (size_t i = 0; i < particleCount; i++) {
+		if (particleCells[i] >= 0) {
+			cellParticleCounts[particleCells[i]]++;
+			particlesInGrid++;
+		}
+	}
+
+	size_t numCells = cellParticleCounts.size();
+	cellParticleOffsets[numCells] = scan.exclusiveScan(numCells, [&](size_t c) { return cellParticleCounts[c]; }, cellParticleOffsets.data());
+
+	cellParticleIndices.resize(particlesInGrid);
+	cellCursors.assign(cellParticleOffsets.begin(), cellParticleOffsets.end() - 1);
+	for (size_t i = 0; i < particleCount; i++) {
+		if (particleCells[i] >= 0) {
+			cellParticleIndices[cellCursors[particleCells[i]]++] = particles ? particles[i] : (int)i;
+		}
+	}
+
+	// A non-empty cell counts towards its own block and the blocks it borders on. Gather that per block
+	// from the block and a one cell ring around it, so blocks can be processed independently
+	Int3 blockDims = getBlockDimensions();
+	parallelFor(blocks.size(), 64, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			Int3 blockIndex = to3D((int)b, blockDims);
+			Int3 firstCell = maxInt3(blockIndex * CELLS_PER_BLOCK_EDGE - Int3{ 1, 1, 1 }, { 0, 0, 0 });
+			Int3 lastCell = minInt3(blockIndex * CELLS_PER_BLOCK_EDGE + Int3{ CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE }, params.dimensions - Int3{ 1, 1, 1 });
+
+			int nonEmptyCells = 0;
+			for (int z = firstCell.z; z <= lastCell.z; z++) {
+				for (int y = firstCell.y; y <= lastCell.y; y++) {
+					for (int x = firstCell.x; x <= lastCell.x; x++) {
+						Int3 cell = { x, y, z };
+						if (cellParticleCounts[to1D(cell, params.dimensions)] == 0) {
+							continue;
+						}
+
+						Int3 cellBlock = cell / CELLS_PER_BLOCK_EDGE;
+						Int3 local = cell - cellBlock * CELLS_PER_BLOCK_EDGE;
+						Int3 edge = { blockEdgeSide(local.x), blockEdgeSide(local.y), blockEdgeSide(local.z) };
+						Int3 neighbor = clampInt3(cellBlock + edge, { 0, 0, 0 }, blockDims - Int3{ 1, 1, 1 });
+						Int3 lo = minInt3(cellBlock, neighbor);
+						Int3 hi = maxInt3(cellBlock, neighbor);
+
+						if (blockIndex.x >= lo.x && blockIndex.x <= hi.x &&
+							blockIndex.y >= lo.y && blockIndex.y <= hi.y &&
+							blockIndex.z >= lo.z && blockIndex.z <= hi.z) {
+							nonEmptyCells++;
+						}
+					}
+				}
+			}
+			blocks[b] = nonEmptyCells;
+		}
+	});
+}
+
+void SurfaceExtractor::detectDirtyBlocks(const Vec4* positions) {
+	Int3 blockDims = getBlockDimensions();
+	Int3 vertexDims = getVertexDimensions();
+	size_t numCells = cellParticleCounts.size();
+
+	if (params.reuseTolerance <= 0.0f) {
+		std::fill(blockDirty.begin(), blockDirty.end(), 1);
+		std::fill(vertexDirty.begin(), vertexDirty.end(), 1);
+		return;
+	}
+
+	// Particles are recognised by index, so these cover every index up to the highest one extracted so far
+	size_t particleSlots = cellParticleIndices.empty() ? 0 : (size_t)*std::max_element(cellParticleIndices.begin(), cellParticleIndices.end()) + 1;
+	if (lastParticleCells.size() < particleSlots) {
+		lastParticleCells.resize(particleSlots, -1);
+		particleExtractions.resize(particleSlots, 0);
+		referencePositions.resize(particleSlots);
+	}
+	if (!hasHistory) {
+		std::fill(lastParticleCells.begin(), lastParticleCells.end(), -1);
+		lastCellParticleCounts.assign(numCells, 0);
+	}
+	extractionIndex++;
+
+	// A cell changed when it turned empty or non-empty, gained a particle that wasn't extracted last time, or holds
+	// one that moved further than the tolerance from where its block was last built. Moving between cells within
+	// the tolerance barely changes the densities, so it doesn't count
+	float toleranceSquared = params.reuseTolerance * params.reuseTolerance;
+	cellChanged.resize(numCells);
+	parallelFor(numCells, 4096, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			bool changed = (cellParticleCounts[c] > 0) != (lastCellParticleCounts[c] > 0);
+			for (int i = cellParticleOffsets[c]; i < cellParticleOffsets[c + 1]; i++) {
+				int particle = cellParticleIndices[i];
+				Vec3 offset = toVec3(positions[particle]) - referencePositions[particle];
+				changed |= lastParticleCells[particle] < 0 || dot(offset, offset) > toleranceSquared;
+				lastParticleCells[particle] = (int)c;
+				particleExtractions[particle] = extractionIndex;
+			}
+			cellChanged[c] = changed;
+			lastCellParticleCounts[c] = cellParticleCounts[c];
+		}
+	});
+
+	// Particles that were extracted last time but not this time were deleted or changed material, their old cell changed
+	for (size_t particle = 0; particle < lastParticleCells.size(); particle++) {
+		if (lastParticleCells[particle] >= 0 && particleExtractions[particle] != extractionIndex) {
+			cellChanged[lastParticleCells[particle]] = 1;
+			lastParticleCells[particle] = -1;
+		}
+	}
+
+	blockChanged.resize(blocks.size());
+	parallelFor(blocks.size(), 64, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			Int3 firstCell = to3D((int)b, blockDims) * CELLS_PER_BLOCK_EDGE;
+			uint8_t changed = 0;
+			for (int c = 0; c < CELLS_PER_BLOCK && !changed; c++) {
+				Int3 cell = firstCell + to3D(c, { CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE });
+				changed = cellChanged[to1D(cell, params.dimensions)];
+			}
+			blockChanged[b] = changed || blockCullingChanged[b];
+		}
+	});
+
+	// A block's triangles read the densities and normals of its own vertices. Those read cells kernelOffset + 1
+	// further out, surface cells look kernelOffset + 1 around them, and whether the neighbouring blocks are surface
+	// blocks depends on a one cell ring around them. Any change within that reach of the block rebuilds it, and so does
+	// a block in reach entering or leaving the view, which decides whether the vertices around it are detected
+	int reachCells = std::max(getKernelOffset() + 2, CELLS_PER_BLOCK_EDGE + 1);
+	int reachBlocks = (reachCells + CELLS_PER_BLOCK_EDGE - 1) / CELLS_PER_BLOCK_EDGE;
+	Int3 maxBlock = blockDims - Int3{ 1, 1, 1 };
+
+	parallelFor(blocks.size(), 64, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			Int3 blockIndex = to3D((int)b, blockDims);
+			Int3 lo = clampInt3(blockIndex - Int3{ reachBlocks, reachBlocks, reachBlocks }, { 0, 0, 0 }, maxBlock);
+			Int3 hi = clampInt3(blockIndex + Int3{ reachBlocks, reachBlocks, reachBlocks }, { 0, 0, 0 }, maxBlock);
+
+			uint8_t dirty = !hasHistory;
+			for (int z = lo.z; z <= hi.z && !dirty; z++) {
+				for (int y = lo.y; y <= hi.y && !dirty; y++) {
+					for (int x = lo.x; x <= hi.x && !dirty; x++) {
+						dirty = blockChanged[to1D({ x, y, z }, blockDims)];
+					}
+				}
+			}
+			blockDirty[b] = dirty;
+		}
+	});
+	hasHistory = true;
+
+	// Rebuilt blocks become the new reference for their particles
+	parallelFor(blocks.size(), 64, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			if (!blockDirty[b]) {
+				continue;
+			}
+
+			Int3 firstCell = to3D((int)b, blockDims) * CELLS_PER_BLOCK_EDGE;
+			for (int c = 0; c < CELLS_PER_BLOCK; c++) {
+				int cell = to1D(firstCell + to3D(c, { CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE }), params.dimensions);
+				for (int i = cellParticleOffsets[cell]; i < cellParticleOffsets[cell + 1]; i++) {
+					int particle = cellParticleIndices[i];
+					referencePositions[particle] = toVec3(positions[particle]);
+				}
+			}
+		}
+	});
+
+	// Vertices whose density, color or normal a dirty block reads, from its first corner to its far one
+	parallelFor(vertexDirty.size(), 4096, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			Int3 vertex = to3D((int)v, vertexDims);
+			Int3 lo = clampInt3((vertex - Int3{ CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE }) / CELLS_PER_BLOCK_EDGE, { 0, 0, 0 }, maxBlock);
+			Int3 hi = clampInt3(vertex / CELLS_PER_BLOCK_EDGE, { 0, 0, 0 }, maxBlock);
+
+			uint8_t dirty = 0;
+			for (int z = lo.z; z <= hi.z && !dirty; z++) {
+				for (int y = lo.y; y <= hi.y && !dirty; y++) {
+					for (int x = lo.x; x <= hi.x && !dirty; x++) {
+						Int3 block = { x, y, z };
+						Int3 first = block * CELLS_PER_BLOCK_EDGE;
+						Int3 last = block * CELLS_PER_BLOCK_EDGE + Int3{ CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE };
+						bool inside = vertex.x >= first.x && vertex.y >= first.y && vertex.z >= first.z &&
+							vertex.x <= last.x && vertex.y <= last.y && vertex.z <= last.z;
+						dirty = inside && blockDirty[to1D(block, blockDims)];
+					}
+				}
+			}
+			vertexDirty[v] = dirty;
+		}
+	});
+}
+
+bool SurfaceExtractor::isSurfaceBlock(size_t block) const {
+	// A block is at the surface unless its neighbourhood is entirely empty or entirely filled
+	return blocks[block] > 0 && blocks[block] < FILLED_BLOCK;
+}
+
+void SurfaceExtractor::detectSurfaceBlocks() {
+	// Culling only decides which blocks are triangulated. The cells of a block next to one in view still mark the
+	// corner vertices they share with it, or that block would read densities of 0 there. The block's box grown by a
+	// block on every side holds the boxes of all its neighbours, so one test covers them.
+	// Decided once per block so both reads of the scans agree
+	Int3 blockDims = getBlockDimensions();
+	Frustum frustum = makeFrustum(params.culling.viewProj);
+	float blockWidth = params.resolution * CELLS_PER_BLOCK_EDGE;
+	Vec3 margin = { blockWidth, blockWidth, blockWidth };
+	blockCullingChanged.resize(blocks.size());
+	blockDetected.resize(blocks.size());
+	std::atomic<size_t> culled{ 0 };
+	parallelFor(blocks.size(), 256, [&](size_t begin, size_t end) {
+		size_t culledHere = 0;
+		for (size_t b = begin; b < end; b++) {
+			Vec3 boxMin = params.minBounds + toVec3(to3D((int)b, blockDims)) * blockWidth;
+			Vec3 boxMax = boxMin + margin;
+			bool surface = isSurfaceBlock(b);
+			uint8_t culledNow = surface && !isBlockVisible(params.culling, frustum, boxMin, boxMax);
+			blockDetected[b] = surface && (!culledNow || isBlockVisible(params.culling, frustum, boxMin - margin, boxMax + margin));
+			blockCullingChanged[b] = culledNow != blockCulled[b];
+			blockCulled[b] = culledNow;
+			culledHere += culledNow;
+		}
+		culled += culledHere;
+	});
+	culledBlockCount = culled;
+
+	surfaceBlockIndices.resize(blocks.size());
+	int surfaceBlockCount = scan.compact(blocks.size(), [&](size_t b) { return blockDetected[b] != 0; }, surfaceBlockIndices.data());
+	surfaceBlockIndices.resize(surfaceBlockCount);
+
+	meshedBlockIndices.resize(blocks.size());
+	int meshedBlockCount = scan.compact(blocks.size(), [&](size_t b) { return blockDetected[b] && !blockCulled[b]; }, meshedBlockIndices.data());
+	meshedBlockIndices.resize(meshedBlockCount);
+}
+
+void SurfaceExtractor::selectBlockLevels() {
+	Int3 blockDims = getBlockDimensions();
+	blockLevels.assign(blocks.size(), -1);
+	for (int block : surfaceBlockIndices) {
+		blockLevels[block] = 0;
+	}
+	if (!params.lod.enabled) {
+		return;
+	}
+
+	// Every surface block takes part, culled or not, since the refinement below spreads levels from block to block
+	lodBlockIndices.resize(blocks.size());
+	int lodBlockCount = scan.compact(blocks.size(), [&](size_t b) { return isSurfaceBlock(b); }, lodBlockIndices.data());
+	lodBlockIndices.resize(lodBlockCount);
+
+	// Cells grow with the distance, so they cover about as much of the screen near and far
+	float blockWidth = params.resolution * CELLS_PER_BLOCK_EDGE;
+	for (int block : lodBlockIndices) {
+		Vec3 center = params.minBounds + (toVec3(to3D(block, blockDims)) + Vec3{ 0.5f, 0.5f, 0.5f }) * blockWidth;
+		float distance = length(center - params.lod.cameraPosition);
+		int level = 0;
+		while (level < MAX_SURFACE_LOD && distance >= params.lod.fullDetailDistance * (float)(1 << level)) {
+			level++;
+		}
+		blockLevels[block] = (int8_t)level;
+	}
+
+	// Blocks sharing a vertex may be one level apart at most, so a stitched face always has coarse cells twice as wide
+	// as the fine ones. Only ever refines, so it ends
+	Int3 maxBlock = blockDims - Int3{ 1, 1, 1 };
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (int block : lodBlockIndices) {
+			Int3 blockIndex = to3D(block, blockDims);
+			Int3 lo = clampInt3(blockIndex - Int3{ 1, 1, 1 }, { 0, 0, 0 }, maxBlock);
+			Int3 hi = clampInt3(blockIndex + Int3{ 1, 1, 1 }, { 0, 0, 0 }, maxBlock);
+			for (int z = lo.z; z <= hi.z; z++) {
+				for (int y = lo.y; y <= hi.y; y++) {
+					for (int x = lo.x; x <= hi.x; x++) {
+						int neighborLevel = blockLevels[to1D({ x, y, z }, blockDims)];
+						if (neighborLevel >= 0 && blockLevels[block] > neighborLevel + 1) {
+							blockLevels[block] = (int8_t)(neighborLevel + 1);
+							changed = true;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void SurfaceExtractor::detectSurfaceCells() {
+	Int3 blockDims = getBlockDimensions();
+	Int3 vertexDims = getVertexDimensions();
+	Int3 maxCell = params.dimensions - Int3{ 1, 1, 1 };
+	int kernelOffset = getKernelOffset();
+	Int3 searchRadius = { 1 + kernelOffset, 1 + kernelOffset, 1 + kernelOffset };
+
+	parallelFor(surfaceBlockIndices.size(), 4, [&](size_t begin, size_t end) {
+		for (size_t s = begin; s < end; s++) {
+			Int3 blockIndex = to3D(surfaceBlockIndices[s], blockDims);
+			int stride = getBlockStride(blockIndex);
+
+			for (int c = 0; c < CELLS_PER_BLOCK; c++) {
+				Int3 localCell = to3D(c, { CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE });
+				Int3 cell = blockIndex * CELLS_PER_BLOCK_EDGE + localCell;
+				Int3 lo = clampInt3(cell - searchRadius, { 0, 0, 0 }, maxCell);
+				Int3 hi = clampInt3(cell + searchRadius, { 0, 0, 0 }, maxCell);
+
+				// A surface cell has both empty and non-empty cells around it, it can be empty itself
+				bool firstCellEmpty = cellParticleCounts[to1D(cell, params.dimensions)] == 0;
+				bool isSurfaceCell = false;
+				for (int z = lo.z; z <= hi.z && !isSurfaceCell; z++) {
+					for (int y = lo.y; y <= hi.y && !isSurfaceCell; y++) {
+						for (int x = lo.x; x <= hi.x; x++) {
+							if ((cellParticleCounts[to1D({ x, y, z }, params.dimensions)] == 0) != firstCellEmpty) {
+								isSurfaceCell = true;
+								break;
+							}
+						}
+					}
+				}
+
+				if (!isSurfaceCell) {
+					continue;
+				}
+
+				// Neighbouring blocks share corner vertices, every writer stores the same value.
+				// Coarser blocks keep the corners of the coarse cell this one is part of
+				Int3 coarseCell = blockIndex * CELLS_PER_BLOCK_EDGE + (localCell / stride) * stride;
+				for (int corner = 0; corner < 8; corner++) {
+					Int3 vertex = coarseCell + Int3{ corner & 1, (corner >> 1) & 1, (corner >> 2) & 1 } * stride;
+					surfaceVertices[to1D(vertex, vertexDims)].store(1, std::memory_order_relaxed);
+				}
+			}
+		}
+	});
+}
+
+void SurfaceExtractor::compactSurfaceVertices() {
+	Int3 vertexDims = getVertexDimensions();
+	int numVerts = vertexDims.x * vertexDims.y * vertexDims.z;
+
+	surfaceVertexIndices.resize(numVerts);
+	int surfaceVertexCount = scan.compact(numVerts, [&](size_t v) { return surfaceVertices[v].load(std::memory_order_relaxed) != 0; },
+		surfaceVertexIndices.data());
+	surfaceVertexIndices.resize(surfaceVertexCount);
+}
+
+void SurfaceExtractor::computeVertexDensities(const Vec4* positions, const Vec4* materials) {
+	// Dirty vertices that are no longer on the surface go back to empty, like after resetBuffers
+	if (params.reuseTolerance > 0.0f) {
+		parallelFor(vertexDirty.size(), 65536, [&](size_t begin, size_t end) {
+			for (size_t v = begin; v < end; v++) {
+				if (vertexDirty[v] && !surfaceVertices[v].load(std::memory_order_relaxed)) {
+					vertexDensities[v] = 0.0f;
+					vertexNormals[v] = { 0.0f, 0.0f, 0.0f };
+					vertexColors[v] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				}
+			}
+		});
+	}
+
+	switch (params.kernel) {
+	case DensityKernel::CubicSpline:
+		computeVertexDensities<CubicSplineKernel>(positions, materials);
+		break;
+	case DensityKernel::Wendland:
+		computeVertexDensities<WendlandKernel>(positions, materials);
+		break;
+	default:
+		computeVertexDensities<Poly6Kernel>(positions, materials);
+		break;
+	}
+}
+
+template<typename Kernel>
+void SurfaceExtractor::computeVertexDensities(const Vec4* positions, const Vec4* materials) {
+	// Every particle within kernelOffset + 1 cells of a vertex along each axis is read
+	float gatherRadius = (getKernelOffset() + 1) * params.resolution;
+	KernelCoefficients coefficients = makeKernelCoefficients<Kernel>(params.kernelRadius, params.kernelScale, gatherRadius);
+	if (params.densityMode == DensityMode::PerVertex) {
+		computeVertexDensitiesPerVertex<Kernel>(coefficients, positions, materials);
+	}
+	else {
+		computeVertexDensitiesTiled<Kernel>(coefficients, positions, materials);
+	}
+}
+
+template<typename Kernel>
+void SurfaceExtractor::computeVertexDensitiesPerVertex(const KernelCoefficients& coefficients, const Vec4* positions, const Vec4* materials) {
+	Int3 vertexDims = getVertexDimensions();
+	Int3 maxCell = params.dimensions - Int3{ 1, 1, 1 };
+	int kernelOffset = getKernelOffset();
+
+	parallelFor(surfaceVertexIndices.size(), 256, [&](size_t begin, size_t end) {
+		for (size_t s = begin; s < end; s++) {
+			int vertexIndex1d = surfaceVertexIndices[s];
+			if (!vertexDirty[vertexIndex1d]) {
+				continue;
+			}
+
+			Int3 vertexIndex = to3D(vertexIndex1d, vertexDims);
+			Vec3 vertexPos = params.minBounds + toVec3(vertexIndex) * params.resolution;
+
+			// Cells from kernelOffset + 1 below the vertex up to kernelOffset above it, the vertex is their shared corner
+			Int3 lo = maxInt3(vertexIndex - Int3{ kernelOffset + 1, kernelOffset + 1, kernelOffset + 1 }, { 0, 0, 0 });
+			Int3 hi = minInt3(vertexIndex + Int3{ kernelOffset, kernelOffset, kernelOffset }, maxCell);
+
+			float totalDensity = 0.0f;
+			Vec3 gradient = { 0.0f, 0.0f, 0.0f };
+			Vec4 colorSum = { 0.0f, 0.0f, 0.0f, 0.0f };
+			int colorCount = 0;
+
+			for (int z = lo.z; z <= hi.z; z++) {
+				for (int y = lo.y; y <= hi.y; y++) {
+					for (int x = lo.x; x <= hi.x; x++) {
+						int cell = to1D({ x, y, z }, params.dimensions);
+						for (int i = cellParticleOffsets[cell]; i < cellParticleOffsets[cell + 1]; i++) {
+							int particle = cellParticleIndices[i];
+							Vec3 r = vertexPos - toVec3(positions[particle]);
+							float distanceSquared = dot(r, r);
+							totalDensity += evaluateKernel<Kernel>(coefficients, distanceSquared);
+							gradient = gradient + r * evaluateKernelGradientScale<Kernel>(coefficients, distanceSquared);
+							colorSum = colorSum + materials[particle];
+							colorCount++;
+						}
+					}
+				}
+			}
+
+			vertexDensities[vertexIndex1d] = totalDensity;
+			vertexNormals[vertexIndex1d] = normalize(gradient);
+			if (colorCount > 0) {
+				Vec4 average = colorSum * (1.0f / colorCount);
+				vertexColors[vertexIndex1d] = { average.x, average.y, average.z, 0.0f };
+			}
+			else {
+				vertexColors[vertexIndex1d] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			}
+		}
+	});
+}
+
+template<typename Kernel>
+void SurfaceExtractor::computeVertexDensitiesTiled(const KernelCoefficients& coefficients, const Vec4* positions, const Vec4* materials) {
+	Int3 vertexDims = getVertexDimensions();
+	Int3 maxCell = params.dimensions - Int3{ 1, 1, 1 };
+	int kernelOffset = getKernelOffset();
+	Int3 tileDims = (vertexDims + Int3{ CELLS_PER_BLOCK_EDGE - 1, CELLS_PER_BLOCK_EDGE - 1, CELLS_PER_BLOCK_EDGE - 1 }) / CELLS_PER_BLOCK_EDGE;
+	size_t numTiles = (size_t)tileDims.x * tileDims.y * tileDims.z;
+
+	// Group the vertices to compute by the block of vertices they fall in, a counting sort like the cell lists
+	auto tileOf = [&](int vertexIndex1d) {
+		return to1D(to3D(vertexIndex1d, vertexDims) / CELLS_PER_BLOCK_EDGE, tileDims);
+	};
+
+	tileVertexOffsets.assign(numTiles + 1, 0);
+	for (int vertexIndex1d : surfaceVertexIndices) {
+		if (vertexDirty[vertexIndex1d]) {
+			tileVertexOffsets[tileOf(vertexIndex1d) + 1]++;
+		}
+	}
+
+	activeTiles.clear();
+	for (size_t t = 0; t < numTiles; t++) {
+		if (tileVertexOffsets[t + 1] > 0) {
+			activeTiles.push_back((int)t);
+		}
+		tileVertexOffsets[t + 1] += tileVertexOffsets[t];
+	}
+
+	tileVertices.resize(tileVertexOffsets[numTiles]);
+	std::vector<int> tileCursors(tileVertexOffsets.begin(), tileVertexOffsets.end() - 1);
+	for (int vertexIndex1d : surfaceVertexIndices) {
+		if (vertexDirty[vertexIndex1d]) {
+			tileVertices[tileCursors[tileOf(vertexIndex1d)]++] = vertexIndex1d;
+		}
+	}
+
+	parallelFor(activeTiles.size(), 1, [&](size_t begin, size_t end) {
+		// Particles of the block and its halo, copied once and read by all of the block's vertices.
+		// Positions are split by component and laid out cell by cell in the same order as the cell lists
+		std::vector<float> cachedX, cachedY, cachedZ;
+		std::vector<int> cachedCellStarts;
+		std::vector<Vec4> cachedCellColors;
+
+		for (size_t a = begin; a < end; a++) {
+			int tile = activeTiles[a];
+			Int3 firstVertex = to3D(tile, tileDims) * CELLS_PER_BLOCK_EDGE;
+			Int3 lastVertex = minInt3(firstVertex + Int3{ CELLS_PER_BLOCK_EDGE - 1, CELLS_PER_BLOCK_EDGE - 1, CELLS_PER_BLOCK_EDGE - 1 }, vertexDims - Int3{ 1, 1, 1 });
+
+			// Every cell any of the block's vertices reads, see the per-vertex version for the range of one vertex
+			Int3 firstCell = maxInt3(firstVertex - Int3{ kernelOffset + 1, kernelOffset + 1, kernelOffset + 1 }, { 0, 0, 0 });
+			Int3 lastCell = minInt3(lastVertex + Int3{ kernelOffset, kernelOffset, kernelOffset }, maxCell);
+			Int3 cacheDims = lastCell - firstCell + Int3{ 1, 1, 1 };
+
+			cachedX.clear();
+			cachedY.clear();
+			cachedZ.clear();
+			cachedCellStarts.clear();
+			cachedCellColors.clear();
+
+			for (int z = firstCell.z; z <= lastCell.z; z++) {
+				for (int y = firstCell.y; y <= lastCell.y; y++) {
+					for (int x = firstCell.x; x <= lastCell.x; x++) {
+						int cell = to1D({ x, y, z }, params.dimensions);
+						Vec4 colorSum = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+						cachedCellStarts.push_back((int)cachedX.size());
+						for (int i = cellParticleOffsets[cell]; i < cellParticleOffsets[cell + 1]; i++) {
+							int particle = cellParticleIndices[i];
+							cachedX.push_back(positions[particle].x);
+							cachedY.push_back(positions[particle].y);
+							cachedZ.push_back(positions[particle].z);
+							colorSum = colorSum + materials[particle];
+						}
+						cachedCellColors.push_back(colorSum);
+					}
+				}
+			}
+			cachedCellStarts.push_back((int)cachedX.size());
+
+			for (int v = tileVertexOffsets[tile]; v < tileVertexOffsets[tile + 1]; v++) {
+				int vertexIndex1d = tileVertices[v];
+				Int3 vertexIndex = to3D(vertexIndex1d, vertexDims);
+				Vec3 vertexPos = params.minBounds + toVec3(vertexIndex) * params.resolution;
+
+				Int3 lo = maxInt3(vertexIndex - Int3{ kernelOffset + 1, kernelOffset + 1, kernelOffset + 1 }, { 0, 0, 0 }) - firstCell;
+				Int3 hi = minInt3(vertexIndex + Int3{ kernelOffset, kernelOffset, kernelOffset }, maxCell) - firstCell;
+
+				float totalDensity = 0.0f;
+				Vec3 gradient = { 0.0f, 0.0f, 0.0f };
+				Vec4 colorSum = { 0.0f, 0.0f, 0.0f, 0.0f };
+				int colorCount = 0;
+
+				for (int z = lo.z; z <= hi.z; z++) {
+					for (int y = lo.y; y <= hi.y; y++) {
+						// A row of cells is contiguous in the cache
+						int rowStart = to1D({ lo.x, y, z }, cacheDims);
+						int rowEnd = to1D({ hi.x, y, z }, cacheDims) + 1;
+						int first = cachedCellStarts[rowStart];
+						totalDensity += sumKernel<Kernel>(coefficients, vertexPos, cachedX.data() + first, cachedY.data() + first, cachedZ.data() + first,
+							cachedCellStarts[rowEnd] - first, gradient);
+						for (int c = rowStart; c < rowEnd; c++) {
+							colorSum = colorSum + cachedCellColors[c];
+						}
+						colorCount += cachedCellStarts[rowEnd] - cachedCellStarts[rowStart];
+					}
+				}
+
+				vertexDensities[vertexIndex1d] = totalDensity;
+				vertexNormals[vertexIndex1d] = normalize(gradient);
+				if (colorCount > 0) {
+					Vec4 average = colorSum * (1.0f / colorCount);
+					vertexColors[vertexIndex1d] = { average.x, average.y, average.z, 0.0f };
+				}
+				else {
+					vertexColors[vertexIndex1d] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				}
+			}
+		}
+	});
+}
+
+void SurfaceExtractor::triangulate(SurfaceMesh& mesh) {
+	Int3 blockDims = getBlockDimensions();
+
+	// Clean blocks keep the mesh they were last built with
+	std::atomic<size_t> rebuilt{ 0 };
+	parallelFor(meshedBlockIndices.size(), 4, [&](size_t begin, size_t end) {
+		size_t rebuiltHere = 0;
+		for (size_t s = begin; s < end; s++) {
+			int block = meshedBlockIndices[s];
+			if (!blockDirty[block]) {
+				continue;
+			}
+
+			SurfaceMesh& blockMesh = blockMeshes[block];
+			blockMesh.clear();
+
+			Int3 blockIndex = to3D(block, blockDims);
+			if (params.lod.enabled) {
+				triangulateLodBlock(blockIndex, blockMesh);
+			}
+			else {
+				triangulateHalfBlock(blockIndex, 0, blockMesh);
+				triangulateHalfBlock(blockIndex, 1, blockMesh);
+			}
+			rebuiltHere++;
+		}
+		rebuilt += rebuiltHere;
+	});
+	rebuiltBlockCount = rebuilt;
+
+	// Concatenate, offsetting each block's indices by the vertices in front of it
+	std::vector<size_t> vertexOffsets(meshedBlockIndices.size() + 1, 0);
+	std::vector<size_t> indexOffsets(meshedBlockIndices.size() + 1, 0);
+	for (size_t s = 0; s < meshedBlockIndices.size(); s++) {
+		const SurfaceMesh& blockMesh = blockMeshes[meshedBlockIndices[s]];
+		vertexOffsets[s + 1] = vertexOffsets[s] + blockMesh.positions.size();
+		indexOffsets[s + 1] = indexOffsets[s] + blockMesh.indices.size();
+	}
+
+	mesh.positions.resize(vertexOffsets.back());
+	mesh.normals.resize(vertexOffsets.back());
+	mesh.colors.resize(vertexOffsets.back());
+	mesh.indices.resize(indexOffsets.back());
+
+	parallelFor(meshedBlockIndices.size(), 16, [&](size_t begin, size_t end) {
+		for (size_t s = begin; s < end; s++) {
+			const SurfaceMesh& blockMesh = blockMeshes[meshedBlockIndices[s]];
+			std::copy(blockMesh.positions.begin(), blockMesh.positions.end(), mesh.positions.begin() + vertexOffsets[s]);
+			std::copy(blockMesh.normals.begin(), blockMesh.normals.end(), mesh.normals.begin() + vertexOffsets[s]);
+			std::copy(blockMesh.colors.begin(), blockMesh.colors.end(), mesh.colors.begin() + vertexOffsets[s]);
+
+			uint32_t base = (uint32_t)vertexOffsets[s];
+			for (size_t i = 0; i < blockMesh.indices.size(); i++) {
+				mesh.indices[indexOffsets[s] + i] = blockMesh.indices[i] + base;
+			}
+		}
+	});
+}
+
+void SurfaceExtractor::triangulateHalfBlock(const Int3& blockIndex, int halfBlockIndex, SurfaceMesh& out) {
+	Int3 vertexDims = getVertexDimensions();
+	uint32_t firstVertex = (uint32_t)out.positions.size();
+
+	// One vertex per edge that crosses the isovalue, indexed by half-block edge
+	int edgeVertices[EDGES_PER_HALFBLOCK];
+	for (int edge = 0; edge < EDGES_PER_HALFBLOCK; edge++) {
+		int axis = edge / edgesPerAxis;
+		Int3 v0 = blockIndex * CELLS_PER_BLOCK_EDGE + to3D(edge % edgesPerAxis, edgeDims[axis]);
+		v0.z += halfBlockIndex * 2;
+		Int3 v1 = v0;
+		component(v1, axis)++;
+
+		int index0 = to1D(v0, vertexDims);
+		int index1 = to1D(v1, vertexDims);
+		float density0 = vertexDensities[index0];
+		float density1 = vertexDensities[index1];
+		if ((density0 > params.isovalue) == (density1 > params.isovalue)) {
+			continue;
+		}
+
+		float t = std::clamp((params.isovalue - density0) / (density1 - density0), 0.0f, 1.0f);
+		edgeVertices[edge] = (int)(out.positions.size() - firstVertex);
+		out.positions.push_back(params.minBounds + lerp(toVec3(v0), toVec3(v1), t) * params.resolution);
+		out.normals.push_back(normalize(lerp(vertexNormals[index0], vertexNormals[index1], t)));
+		out.colors.push_back(lerp(vertexColors[index0], vertexColors[index1], t));
+	}
+
+	// A surface block's half can still miss the surface entirely
+	if (out.positions.size() == firstVertex) {
+		return;
+	}
+
+	for (int c = 0; c < CELLS_PER_HALFBLOCK; c++) {
+		int localCellIdx1d = halfBlockIndex * CELLS_PER_HALFBLOCK + c;
+		Int3 cell = blockIndex * CELLS_PER_BLOCK_EDGE + to3D(localCellIdx1d, { CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE, CELLS_PER_BLOCK_EDGE });
+
+		int mcCase = 0;
+		for (int corner = 0; corner < 8; corner++) {
+			Int3 vertex = cell + Int3{ corner & 1, (corner >> 2) & 1, (corner >> 1) & 1 };
+			mcCase |= (vertexDensities[to1D(vertex, vertexDims)] > params.isovalue) << corner;
+		}
+
+		int numTris = (int)triangleCounts[mcCase];
+		for (int t = 0; t < numTris * 3; t++) {
+			int blockEdge = cellEdgeToBlockEdge(localCellIdx1d, triangleTable[mcCase][t], halfBlockIndex);
+			out.indices.push_back(firstVertex + edgeVertices[blockEdge]);
+		}
+	}
+}
+
+int SurfaceExtractor::getBlockStride(const Int3& blockIndex) const {
+	int level = blockLevels[to1D(blockIndex, getBlockDimensions())];
+	return level < 0 ? 0 : 1 << level;
+}
+
+int SurfaceExtractor::getMaxStride(const Int3& first, const Int3& last) const {
+	// Block b holds vertices b * CELLS_PER_BLOCK_EDGE to (b + 1) * CELLS_PER_BLOCK_EDGE
+	Int3 blockDims = getBlockDimensions();
+	Int3 lo = maxInt3((last - Int3{ 1, 1, 1 }) / CELLS_PER_BLOCK_EDGE, { 0, 0, 0 });
+	Int3 hi = minInt3(first / CELLS_PER_BLOCK_EDGE, blockDims - Int3{ 1, 1, 1 });
+
+	int stride = 0;
+	for (int z = lo.z; z <= hi.z; z++) {
+		for (int y = lo.y; y <= hi.y; y++) {
+			for (int x = lo.x; x <= hi.x; x++) {
+				stride = std::max(stride, getBlockStride({ x, y, z }));
+			}
+		}
+	}
+	return stride;
+}
+
+void SurfaceExtractor::constrainLodVertices() {
+	Int3 blockDims = getBlockDimensions();
+	Int3 vertexDims = getVertexDimensions();
+
+	// Coarsest first, the samples a level interpolates from may have been constrained by the level above.
+	// Serial, a vertex is shared by up to eight blocks
+	for (int level = MAX_SURFACE_LOD; level >= 1; level--) {
+		int coarseStride = 1 << level;
+		int fineStride = coarseStride / 2;
+		int samples = CELLS_PER_BLOCK_EDGE / fineStride + 1;
+
+		for (int block : surfaceBlockIndices) {
+			if (blockLevels[block] != level - 1) {
+				continue;
+			}
+
+			Int3 origin = to3D(block, blockDims) * CELLS_PER_BLOCK_EDGE;
+			for (int i = 0; i < samples * samples * samples; i++) {
+				Int3 local = to3D(i, { samples, samples, samples });
+				bool boundary = local.x == 0 || local.y == 0 || local.z == 0 ||
+					local.x == samples - 1 || local.y == samples - 1 || local.z == samples - 1;
+				if (!boundary) {
+					continue;
+				}
+
+				Int3 vertex = origin + local * fineStride;
+				Int3 cellOrigin = vertex / coarseStride * coarseStride;
+				Int3 offset = vertex - cellOrigin;
+				if (offset == Int3{ 0, 0, 0 } || getMaxStride(vertex, vertex) != coarseStride) {
+					continue;
+				}
+
+				// Multilinear in the coarse cell, the vertex is halfway along every axis it is off the coarse lattice
+				float density = 0.0f;
+				Vec3 normal = { 0.0f, 0.0f, 0.0f };
+				Vec4 color = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (int corner = 0; corner < 8; corner++) {
+					Int3 cornerOffset = cellCorner(corner);
+					if ((cornerOffset.x && !offset.x) || (cornerOffset.y && !offset.y) || (cornerOffset.z && !offset.z)) {
+						continue;
+					}
+
+					float weight = (offset.x ? 0.5f : 1.0f) * (offset.y ? 0.5f : 1.0f) * (offset.z ? 0.5f : 1.0f);
+					int source = to1D(cellOrigin + cornerOffset * coarseStride, vertexDims);
+					density += vertexDensities[source] * weight;
+					normal = normal + vertexNormals[source] * weight;
+					color = color + vertexColors[source] * weight;
+				}
+
+				// Normals stay unnormalized so crossings interpolate them the same way on either side
+				int target = to1D(vertex, vertexDims);
+				vertexDensities[target] = density;
+				vertexNormals[target] = normal;
+				vertexColors[target] = color;
+			}
+		}
+	}
+}
+
+bool SurfaceExtractor::getLodCrossing(const Int3& v0, int axis, int stride, LodVertex& out) const {
+	Int3 vertexDims = getVertexDimensions();
+	Int3 v1 = v0;
+	component(v1, axis) += stride;
+	if ((vertexDensities[to1D(v0, vertexDims)] > params.isovalue) == (vertexDensities[to1D(v1, vertexDims)] > params.isovalue)) {
+		return false;
+	}
+
+	// Samples along an edge a coarser block holds are linear in that block's edge, so interpolating over the whole of
+	// it puts the crossing in the same place, bit for bit, as the coarser block does
+	Int3 first = v0;
+	Int3 last = v1;
+	int edgeStride = getMaxStride(v0, v1);
+	if (edgeStride > stride) {
+		component(first, axis) = component(first, axis) / edgeStride * edgeStride;
+		last = first;
+		component(last, axis) += edgeStride;
+	}
+
+	int index0 = to1D(first, vertexDims);
+	int index1 = to1D(last, vertexDims);
+	float density0 = vertexDensities[index0];
+	float density1 = vertexDensities[index1];
+	float t = std::clamp((params.isovalue - density0) / (density1 - density0), 0.0f, 1.0f);
+	out.position = params.minBounds + lerp(toVec3(first), toVec3(last), t) * params.resolution;
+	out.normal = normalize(lerp(vertexNormals[index0], vertexNormals[index1], t));
+	out.color = lerp(vertexColors[index0], vertexColors[index1], t);
+	return true;
+}
+
+void SurfaceExtractor::triangulateLodBlock(const Int3& blockIndex, SurfaceMesh& out) {
+	Int3 vertexDims = getVertexDimensions();
+	Int3 blockDims = getBlockDimensions();
+	int stride = getBlockStride(blockIndex);
+	int cellsPerEdge = CELLS_PER_BLOCK_EDGE / stride;
+	Int3 cellDims = { cellsPerEdge, cellsPerEdge, cellsPerEdge };
+	Int3 sampleDims = cellDims + Int3{ 1, 1, 1 };
+	Int3 origin = blockIndex * CELLS_PER_BLOCK_EDGE;
+
+	// One vertex per lattice edge that crosses the isovalue, by axis and the sample it starts from
+	constexpr int maxSamples = (CELLS_PER_BLOCK_EDGE + 1) * (CELLS_PER_BLOCK_EDGE + 1) * (CELLS_PER_BLOCK_EDGE + 1);
+	int edgeVertices[3 * maxSamples];
+	std::fill(edgeVertices, edgeVertices + 3 * maxSamples, -1);
+
+	for (int c = 0; c < cellsPerEdge * cellsPerEdge * cellsPerEdge; c++) {
+		Int3 cell = to3D(c, cellDims);
+
+		int mcCase = 0;
+		for (int corner = 0; corner < 8; corner++) {
+			Int3 vertex = origin + (cell + cellCorner(corner)) * stride;
+			mcCase |= (vertexDensities[to1D(vertex, vertexDims)] > params.isovalue) << corner;
+		}
+
+		int numTris = (int)triangleCounts[mcCase];
+		for (int t = 0; t < numTris * 3; t++) {
+			int edge = triangleTable[mcCase][t];
+			Int3 sample = cell + cellEdgeOrigin(edge);
+			int key = (edge / 4) * maxSamples + to1D(sample, sampleDims);
+			if (edgeVertices[key] < 0) {
+				LodVertex vertex;
+				getLodCrossing(origin + sample * stride, edge / 4, stride, vertex);
+				edgeVertices[key] = (int)out.positions.size();
+				out.positions.push_back(vertex.position);
+				out.normals.push_back(vertex.normal);
+				out.colors.push_back(vertex.color);
+			}
+			out.indices.push_back((uint32_t)edgeVertices[key]);
+		}
+	}
+
+	for (int axis = 0; axis < 3; axis++) {
+		for (int side = 0; side < 2; side++) {
+			Int3 neighbor = blockIndex;
+			component(neighbor, axis) += side ? 1 : -1;
+			if (component(neighbor, axis) >= 0 && component(neighbor, axis) < component(blockDims, axis) && getBlockStride(neighbor) > stride) {
+				stitchLodFace(blockIndex, axis, side, out);
+			}
+		}
+	}
+}
+
+void SurfaceExtractor::stitchLodFace(const Int3& blockIndex, int axis, int side, SurfaceMesh& out) {
+	Int3 vertexDims = getVertexDimensions();
+	int stride = getBlockStride(blockIndex);
+	int coarseStride = stride * 2;
+	int u = (axis + 1) % 3;
+	int v = (axis + 2) % 3;
+	Int3 blockOrigin = blockIndex * CELLS_PER_BLOCK_EDGE;
+	int plane = component(blockOrigin, axis) + side * CELLS_PER_BLOCK_EDGE;
+
+	// Along the face the fine samples are bilinear in the coarse ones, so the contour both sides leave on it starts and
+	// ends at the same points of the coarse edges but bends in between on the fine side. Each square of the coarse
+	// lattice is filled on its own: the boundary edges both sides leave on the face, each reversed, form closed loops
+	// around those gaps, wound so the fill faces the same way as the triangles next to it
+	int squares = CELLS_PER_BLOCK_EDGE / coarseStride;
+	for (int square = 0; square < squares * squares; square++) {
+		Int3 corner = blockOrigin;
+		component(corner, u) += (square % squares) * coarseStride;
+		component(corner, v) += (square / squares) * coarseStride;
+		component(corner, axis) = plane;
+
+		// The neighbour's coarse cell on the far side of the square, then this block's four fine cells against it
+		Int3 cellOrigins[5];
+		int cellStrides[5];
+		cellOrigins[0] = corner;
+		component(cellOrigins[0], axis) = side ? plane : plane - coarseStride;
+		cellStrides[0] = coarseStride;
+		for (int i = 0; i < 4; i++) {
+			cellOrigins[i + 1] = corner;
+			component(cellOrigins[i + 1], u) += (i & 1) * stride;
+			component(cellOrigins[i + 1], v) += (i >> 1) * stride;
+			component(cellOrigins[i + 1], axis) = side ? plane - stride : plane;
+			cellStrides[i + 1] = stride;
+		}
+
+		std::vector<LodVertex> points;
+		std::vector<int> next;
+		auto findPoint = [&](const LodVertex& vertex) {
+			for (size_t p = 0; p < points.size(); p++) {
+				if (points[p].position.x == vertex.position.x && points[p].position.y == vertex.position.y && points[p].position.z == vertex.position.z) {
+					return (int)p;
+				}
+			}
+			points.push_back(vertex);
+			next.push_back(-1);
+			return (int)points.size() - 1;
+		};
+
+		bool consistent = true;
+		for (int c = 0; c < 5 && consistent; c++) {
+			Int3 cellOrigin = cellOrigins[c];
+			int cellStride = cellStrides[c];
+			int faceSide = component(cellOrigin, axis) == plane ? 0 : 1;
+
+			int mcCase = 0;
+			for (int k = 0; k < 8; k++) {
+				mcCase |= (vertexDensities[to1D(cellOrigin + cellCorner(k) * cellStride, vertexDims)] > params.isovalue) << k;
+			}
+
+			// Triangle edges used once in the cell are the boundary of its surface patch, which lies on the cell's faces
+			int numTris = (int)triangleCounts[mcCase];
+			const int* table = triangleTable[mcCase];
+			auto onFace = [&](int edge) {
+				Int3 edgeOrigin = cellEdgeOrigin(edge);
+				return edge / 4 != axis && component(edgeOrigin, axis) == faceSide;
+			};
+			auto countEdge = [&](int a, int b) {
+				int count = 0;
+				for (int t = 0; t < numTris * 3; t += 3) {
+					for (int k = 0; k < 3; k++) {
+						int p = table[t + k], q = table[t + (k + 1) % 3];
+						count += (p == a && q == b) || (p == b && q == a);
+					}
+				}
+				return count;
+			};
+
+			for (int t = 0; t < numTris * 3 && consistent; t += 3) {
+				for (int k = 0; k < 3; k++) {
+					int a = table[t + k];
+					int b = table[t + (k + 1) % 3];
+					if (!onFace(a) || !onFace(b) || countEdge(a, b) != 1) {
+						continue;
+					}
+
+					LodVertex vertexA, vertexB;
+					getLodCrossing(cellOrigin + cellEdgeOrigin(a) * cellStride, a / 4, cellStride, vertexA);
+					getLodCrossing(cellOrigin + cellEdgeOrigin(b) * cellStride, b / 4, cellStride, vertexB);
+					int from = findPoint(vertexB);
+					int to = findPoint(vertexA);
+					if (next[from] >= 0) {
+						consistent = false;
+						break;
+					}
+					next[from] = to;
+				}
+			}
+		}
+
+		// Ambiguous faces that the two sides resolved differently leave no loop to close, the square is left as it is
+		if (!consistent) {
+			continue;
+		}
+
+		std::vector<uint8_t> visited(points.size(), 0);
+		std::vector<int> loop;
+		for (size_t start = 0; start < points.size(); start++) {
+			if (visited[start]) {
+				continue;
+			}
+
+			loop.clear();
+			int p = (int)start;
+			while (p >= 0 && !visited[p]) {
+				visited[p] = 1;
+				loop.push_back(p);
+				p = next[p];
+			}
+
+			// Coinciding edges from both sides make loops of two that enclose nothing
+			if (p != (int)start || loop.size() < 3) {
+				continue;
+			}
+
+			uint32_t firstVertex = (uint32_t)out.positions.size();
+			for (int point : loop) {
+				out.positions.push_back(points[point].position);
+				out.normals.push_back(points[point].normal);
+				out.colors.push_back(points[point].color);
+			}
+			for (uint32_t i = 1; i + 1 < loop.size(); i++) {
+				out.indices.push_back(firstVertex);
+				out.indices.push_back(firstVertex + i);
+				out.indices.push_back(firstVertex + i + 1);
+			}
+		}
+	}
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "SurfaceMath.h"
+#include "DensityKernels.h"
+#include "BlockCulling.h"
+#include "Support/ParallelScan.h"
+#include "Support/WorkerPool.h"
+#include "Shaders/constants.h"
+
+enum class DensityMode {
+	// One vertex at a time straight from the cell lists, like SurfaceVertexDensity.hlsl
+	PerVertex,
+	// Copies each block's particles and halo into a small cache once, then evaluates all of the block's vertices from it
+	BlockTiled
+};
+
+// Coarsest level of detail, a block at level l is meshed on cells 2^l wide. Level 2 makes a whole block one cell
+static const int MAX_SURFACE_LOD = 2;
+
+// Distance based level of detail. A surface block closer to the camera than fullDetailDistance keeps the grid's cells,
+// and each doubling of the distance beyond that doubles the cell size. Blocks that touch differ by at most one level,
+// and the faces where they do are stitched so the mesh stays closed
+struct SurfaceLod {
+	bool enabled = false;
+	Vec3 cameraPosition{};
+	// In world units
+	float fullDetailDistance = 0.0f;
+};
+
+// Settings of one extraction, the same values MeshShadingScene passes in GridConstants / MeshShadingConstants
+struct SurfaceParams {
+	// Cells per axis
+	Int3 dimensions;
+	Vec3 minBounds;
+	// Cell width
+	float resolution;
+	float kernelScale;
+	// In world units
+	float kernelRadius;
+	float isovalue;
+	// Only particles whose material w equals this contribute, negative takes every particle.
+	// Materials at or above MAX_SURFACE_MATERIALS have no surface
+	int material = -1;
+	// In world units. A block keeps its mesh, densities and normals from earlier extractions while no particle within
+	// reach of it moves further than this from where it was at the last rebuild, and no cell in reach empties or fills.
+	// 0 rebuilds every block.
+	// Particles are told apart by index, so indices must stay stable between extractions for reuse to pay off
+	float reuseTolerance = 0.0f;
+	// Both give the same densities up to rounding
+	DensityMode densityMode = DensityMode::BlockTiled;
+	// Poly6 matches the GPU passes
+	DensityKernel kernel = DensityKernel::Poly6;
+	// Surface blocks outside the view or too small aren't triangulated, like SurfaceBlockDetection.hlsl. Blocks next to
+	// one in view still detect their cells and compute densities, so the blocks in view come out as without culling.
+	// Changing it doesn't throw away cached blocks, every block within reach of one that enters or leaves the view is rebuilt
+	BlockCulling culling;
+	// Every block is rebuilt while this is on, reuseTolerance is ignored
+	SurfaceLod lod;
+};
+
+// Wall time of each stage of the last extraction, in milliseconds
+struct SurfaceStageTimes {
+	double bilevelGrid = 0.0;
+	// Dirty blocks, surface blocks and cells, vertex compaction
+	double surfaceDetection = 0.0;
+	// Densities, colors and normals, which are the normalized density gradient
+	double density = 0.0;
+	double triangulation = 0.0;
+};
+
+struct SurfaceMesh {
+	std::vector<Vec3> positions;
+	std::vector<Vec3> normals;
+	std::vector<Vec4> colors;
+	std::vector<uint32_t> indices;
+
+	void clear();
+	size_t getTriangleCount() const { return indices.size() / 3; }
+};
+
+// CPU version of the mesh shading surface construction: bilevel uniform grid, surface block and cell
+// detection, surface vertex compaction, SPH density, normals and marching cubes by half-block.
+// Every stage follows its shader in Shaders/FluidSurfaceConstruction and keeps the same buffer layouts,
+// so results can be compared against the GPU passes. Vertices are not shared between half-blocks,
+// matching what the mesh shader emits.
+class SurfaceExtractor {
+public:
+	// Runs single threaded without a pool
+	SurfaceExtractor(WorkerPool* pool = nullptr);
+
+	// positions hold xyz per particle, materials hold color in xyz and the material in w, like the PBMPM buffers
+	void extract(const Vec4* positions, const Vec4* materials, size_t particleCount, const SurfaceParams& params, SurfaceMesh& mesh);
+	// One mesh per entry of params. Particles are binned by material once and every extraction reads only its bin
+	void extractMaterials(const Vec4* positions, const Vec4* materials, size_t particleCount,
+		const std::vector<SurfaceParams>& params, std::vector<SurfaceMesh>& meshes);
+
+	// Intermediate results of the last extract, laid out like their GPU buffers.
+	// A cell's particles are cellParticleIndices[offsets[cell], offsets[cell + 1]),
+	// a material's are materialParticleIndices[binOffsets[material], binOffsets[material + 1])
+	const std::vector<int>& getMaterialBinOffsets() const { return materialBinOffsets; }
+	const std::vector<int>& getMaterialParticleIndices() const { return materialParticleIndices; }
+	const std::vector<int>& getCellParticleCounts() const { return cellParticleCounts; }
+	const std::vector<int>& getCellParticleOffsets() const { return cellParticleOffsets; }
+	const std::vector<int>& getCellParticleIndices() const { return cellParticleIndices; }
+	const std::vector<int>& getBlocks() const { return blocks; }
+	// Surface blocks whose cells were detected, the culled ones among them only because they touch a block in view
+	const std::vector<int>& getSurfaceBlockIndices() const { return surfaceBlockIndices; }
+	// Surface blocks that were triangulated, the ones of getSurfaceBlockIndices that weren't culled
+	const std::vector<int>& getMeshedBlockIndices() const { return meshedBlockIndices; }
+	const std::vector<int>& getSurfaceVertexIndices() const { return surfaceVertexIndices; }
+	const std::vector<float>& getVertexDensities() const { return vertexDensities; }
+	const std::vector<Vec3>& getVertexNormals() const { return vertexNormals; }
+	// Level of detail of every block, -1 for blocks whose cells weren't detected. All 0 without SurfaceParams::lod.
+	// With it every surface block gets one, culled or not, so the blocks in view get the levels they'd have without culling
+	const std::vector<int8_t>& getBlockLevels() const { return blockLevels; }
+
+	const SurfaceStageTimes& getStageTimes() const { return stageTimes; }
+	// Surface blocks triangulated by the last extract, every other surface block reused its cached mesh
+	size_t getRebuiltBlockCount() const { return rebuiltBlockCount; }
+	// Surface blocks the last extract didn't triangulate as out of view or too small, they aren't in getMeshedBlockIndices
+	size_t getCulledBlockCount() const { return culledBlockCount; }
+
+	Int3 getBlockDimensions() const { return params.dimensions / CELLS_PER_BLOCK_EDGE; }
+	Int3 getVertexDimensions() const { return params.dimensions + Int3{ 1, 1, 1 }; }
+
+private:
+	// What an extraction leaves behind for the next one to reuse
+	struct SurfaceHistory {
+		SurfaceParams params{};
+		bool valid = false;
+		uint32_t extractionIndex = 0;
+		std::vector<int> lastParticleCells;
+		std::vector<uint32_t> particleExtractions;
+		std::vector<int> lastCellParticleCounts;
+		std::vector<Vec3> referencePositions;
+		std::vector<SurfaceMesh> blockMeshes;
+		std::vector<uint8_t> blockCulled;
+		std::vector<float> vertexDensities;
+		std::vector<Vec3> vertexNormals;
+		std::vector<Vec4> vertexColors;
+	};
+
+	void swapHistory(SurfaceHistory& history);
+	void binMaterials(const Vec4* materials, size_t particleCount);
+	void extractBin(const Vec4* positions, const Vec4* materials, int material, SurfaceMesh& mesh);
+	// particles lists the indices to surface, null takes the first particleCount
+	void extractParticles(const Vec4* positions, const Vec4* materials, const int* particles, size_t particleCount, SurfaceMesh& mesh);
+	void resize();
+	void buildBilevelGrid(const Vec4* positions, const int* particles, size_t particleCount);
+	void detectDirtyBlocks(const Vec4* positions);
+	bool isSurfaceBlock(size_t block) const;
+	void detectSurfaceBlocks();
+	void detectSurfaceCells();
+	void selectBlockLevels();
+	void compactSurfaceVertices();
+	void computeVertexDensities(const Vec4* positions, const Vec4* materials);
+	template<typename Kernel>
+	void computeVertexDensities(const Vec4* positions, const Vec4* materials);
+	template<typename Kernel>
+	void computeVertexDensitiesPerVertex(const KernelCoefficients& coefficients, const Vec4* positions, const Vec4* materials);
+	template<typename Kernel>
+	void computeVertexDensitiesTiled(const KernelCoefficients& coefficients, const Vec4* positions, const Vec4* materials);
+	// Overwrites the samples that finer blocks read on faces, edges and corners they share with coarser blocks by
+	// interpolating the coarser block's, so both sides see the same field there
+	void constrainLodVertices();
+	void triangulate(SurfaceMesh& mesh);
+	void triangulateHalfBlock(const Int3& blockIndex, int halfBlockIndex, SurfaceMesh& out);
+	void triangulateLodBlock(const Int3& blockIndex, SurfaceMesh& out);
+	// Fills the gaps between this block's triangles and its coarser neighbour's on the face towards it
+	void stitchLodFace(const Int3& blockIndex, int axis, int side, SurfaceMesh& out);
+
+	// Cell width of the meshed blocks' lattices, 0 without one
+	int getBlockStride(const Int3& blockIndex) const;
+	// Largest stride among the meshed blocks that contain every vertex from first to last
+	int getMaxStride(const Int3& first, const Int3& last) const;
+	struct LodVertex {
+		Vec3 position;
+		Vec3 normal;
+		Vec4 color;
+	};
+	// Where the surface crosses the lattice edge from v0 along axis, stride cells long. False when it doesn't.
+	// The crossing is placed on the longest lattice edge containing this one, so blocks of different levels agree on it
+	bool getLodCrossing(const Int3& v0, int axis, int stride, LodVertex& out) const;
+
+	int getKernelOffset() const;
+	template<typename Task>
+	void parallelFor(size_t count, size_t grainSize, const Task& task);
+
+	WorkerPool* pool;
+	// Cell offsets and the surface block and vertex lists, in the same order whatever the thread count
+	ParallelScan scan;
+	SurfaceParams params{};
+
+	// MAX_SURFACE_MATERIALS + 1 entries, like the counts of MaterialBins but already scanned
+	std::vector<int> materialBinOffsets;
+	std::vector<int> materialParticleIndices;
+	std::vector<int> particleCells;
+	std::vector<int> cellParticleCounts;
+	// numCells + 1 entries, the last one is the total
+	std::vector<int> cellParticleOffsets;
+	std::vector<int> cellCursors;
+	std::vector<int> cellParticleIndices;
+	std::vector<int> blocks;
+	std::vector<int> surfaceBlockIndices;
+	std::vector<int> meshedBlockIndices;
+	// Every surface block, culled or not, for the levels of detail
+	std::vector<int> lodBlockIndices;
+	std::unique_ptr<std::atomic<uint8_t>[]> surfaceVertices;
+	size_t surfaceVertexCapacity = 0;
+	std::vector<int> surfaceVertexIndices;
+	// Surface vertices to compute grouped by block, for DensityMode::BlockTiled
+	std::vector<int> tileVertexOffsets;
+	std::vector<int> tileVertices;
+	std::vector<int> activeTiles;
+	std::vector<float> vertexDensities;
+	std::vector<Vec3> vertexNormals;
+	std::vector<Vec4> vertexColors;
+
+	// One mesh per block, indexed like blocks and concatenated at the end. Only surface blocks hold a valid one
+	std::vector<SurfaceMesh> blockMeshes;
+
+	// Incremental rebuilds, the occupancy of every cell and where each particle was when its block was last built
+	SurfaceParams builtParams{};
+	bool hasHistory = false;
+	uint32_t extractionIndex = 0;
+	std::vector<int> lastParticleCells;
+	// extractionIndex of the last extraction that included each particle
+	std::vector<uint32_t> particleExtractions;
+	std::vector<int> lastCellParticleCounts;
+	std::vector<Vec3> referencePositions;
+	std::vector<uint8_t> cellChanged;
+	std::vector<uint8_t> blockChanged;
+	std::vector<uint8_t> blockDirty;
+	std::vector<uint8_t> vertexDirty;
+	// Surface blocks left out by the culling, their cached meshes are out of date
+	std::vector<uint8_t> blockCulled;
+	// Whether blockCulled differs from the last extraction, that counts as a change for every block within reach
+	std::vector<uint8_t> blockCullingChanged;
+	// Surface blocks in view or next to one, the ones whose cells are detected
+	std::vector<uint8_t> blockDetected;
+	std::vector<int8_t> blockLevels;
+	size_t rebuiltBlockCount = 0;
+	size_t culledBlockCount = 0;
+	SurfaceStageTimes stageTimes;
+	// Cached state of the extractMaterials entries, swapped in while each one is extracted
+	std::vector<SurfaceHistory> materialHistories;
+};
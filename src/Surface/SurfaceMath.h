@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Minimal vector types for the CPU surface path, kept free of DirectXMath so it builds anywhere
+
+struct Int3 {
+	int x, y, z;
+
+	Int3 operator+(const Int3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+	Int3 operator-(const Int3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+	Int3 operator*(int s) const { return { x * s, y * s, z * s }; }
+	Int3 operator/(int s) const { return { x / s, y / s, z / s }; }
+	bool operator==(const Int3& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct Vec3 {
+	float x, y, z;
+
+	Vec3 operator+(const Vec3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+	Vec3 operator-(const Vec3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+	Vec3 operator*(float s) const { return { x * s, y * s, z * s }; }
+	Vec3 operator/(float s) const { return { x / s, y / s, z / s }; }
+};
+
+struct Vec4 {
+	float x, y, z, w;
+
+	Vec4 operator+(const Vec4& o) const { return { x + o.x, y + o.y, z + o.z, w + o.w }; }
+	Vec4 operator*(float s) const { return { x * s, y * s, z * s, w * s }; }
+};
+
+inline Int3 minInt3(const Int3& a, const Int3& b) { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+inline Int3 maxInt3(const Int3& a, const Int3& b) { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+inline Int3 clampInt3(const Int3& v, const Int3& lo, const Int3& hi) { return minInt3(maxInt3(v, lo), hi); }
+
+// Same ordering as to1D / to3D in utils.hlsl
+inline int to1D(const Int3& index, const Int3& dimensions) {
+	return index.x + index.y * dimensions.x + index.z * dimensions.x * dimensions.y;
+}
+
+inline Int3 to3D(int index, const Int3& dimensions) {
+	return { index % dimensions.x, (index / dimensions.x) % dimensions.y, index / (dimensions.x * dimensions.y) };
+}
+
+inline Vec3 toVec3(const Int3& v) { return { (float)v.x, (float)v.y, (float)v.z }; }
+inline Vec3 toVec3(const Vec4& v) { return { v.x, v.y, v.z }; }
+
+inline float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float length(const Vec3& v) { return std::sqrt(dot(v, v)); }
+
+// Zero vectors stay zero instead of turning into NaNs
+inline Vec3 normalize(const Vec3& v) {
+	float len = length(v);
+	return len > 0.0f ? v / len : v;
+}
+
+inline Vec3 lerp(const Vec3& a, const Vec3& b, float t) { return a + (b - a) * t; }
+inline Vec4 lerp(const Vec4& a, const Vec4& b, float t) { return a * (1.0f - t) + b * t; }
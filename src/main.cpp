@@ -194,7 +194,11 @@ int main() {
             scene.getViscoKernelScale(),
             scene.getViscoKernelRadius(),
             scene.getPBMPMSubstepCount(),
-            scene.getNumParticles());
+            scene.getPBMPMAdaptiveSubsteps(),
+            &scene.cullSurfaceBlocks,
+            &scene.minSurfaceBlockScreenSize,
+            scene.getStats(),
+            scene.getPBMPMSubstepStats());
 
         //render ImGUI
         ImGui::Render();
@@ -216,6 +220,8 @@ int main() {
 		context.executeCommandList(firstPipeline->getCommandListID());
 
         Window::get().present();
+        context.getGlobalDescriptorHeap()->FinishFrame();
+        context.getBufferAllocator()->finishFrame();
 		context.resetCommandList(renderPipeline->getCommandListID());
 		if (scene.renderToggles[0]) {
 			context.resetCommandList(fluidMeshPipeline->getCommandListID());
@@ -75,11 +75,27 @@ void drawImGUIWindow(PBMPMConstants& pbmpmConstants, ImGuiIO& io,
     float* elasticIsovalue, float* elasticKernelScale, float* elasticKernelRadius,
 	float* sandIsovalue, float* sandKernelScale, float* sandKernelRadius,
 	float* viscoIsovalue, float* viscoKernelScale, float* viscoKernelRadius,
-    unsigned int* substepCount, int numParticles) {
+    unsigned int* substepCount, AdaptiveSubsteps* adaptiveSubsteps, bool* cullSurfaceBlocks, float* minSurfaceBlockScreenSize,
+    const SimulationStats& stats, const SubstepStats& substepStats) {
     ImGui::Begin("Scene Options");
 
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
-    ImGui::Text("Number of Particles: %d", numParticles);
+    ImGui::Text("Number of Particles: %u", stats.particleCount);
+
+    if (ImGui::CollapsingHeader("Simulation Stats")) {
+        const char* materialNames[MAX_STATS_MATERIALS] = { "Fluid", "Elastic", "Sand", "Visco" };
+
+        ImGui::Text("Free List Size: %u", stats.freeListSize);
+        ImGui::Text("Active Bukkits: %u", stats.activeBukkits);
+        ImGui::Text("Sleeping Bukkits: %u", stats.sleepingBukkits);
+        ImGui::Text("Waiting Bukkits: %u", stats.waitingBukkits);
+        ImGui::Text("Substeps: %u, Delta Time: %.4f", substepStats.substepCount, substepStats.deltaTime);
+        ImGui::Text("Iterations Per Substep: %.2f", substepStats.iterationsPerSubstep);
+        ImGui::Text("Max Displacement Per Substep: %.3f cells", substepStats.maxDisplacement);
+        for (int i = 0; i < MAX_STATS_MATERIALS; i++) {
+            ImGui::Text("%s Surface: %u blocks, %u vertices", materialNames[i], stats.surfaceBlockCount[i], stats.surfaceVertexCount[i]);
+        }
+    }
 
     if (ImGui::CollapsingHeader("Simulation Parameters")) {
         ImGui::SliderFloat("Gravity Strength", &pbmpmConstants.gravityStrength, 0.0f, 20.0f);
@@ -99,8 +115,22 @@ void drawImGUIWindow(PBMPMConstants& pbmpmConstants, ImGuiIO& io,
 
         ImGui::SliderFloat("Border Friction", &pbmpmConstants.borderFriction, 0.0f, 1.0f);
 
-        ImGui::SliderInt("Iteration Count", (int*)&pbmpmConstants.iterationCount, 1, 10);
+        ImGui::SliderInt("Iteration Count", (int*)&pbmpmConstants.iterationCount, 1, MaxIterationCount);
+        ImGui::SliderInt("Min Iteration Count", (int*)&pbmpmConstants.minIterationCount, 1, MaxIterationCount);
+        ImGui::SliderFloat("Convergence Tolerance", &pbmpmConstants.convergenceTolerance, 0.0f, 0.01f, "%.5f", ImGuiSliderFlags_Logarithmic);
         ImGui::SliderInt("Substep Count", (int*)substepCount, 1, 20);
+        ImGui::Checkbox("Adaptive Substeps", &adaptiveSubsteps->enabled);
+        if (adaptiveSubsteps->enabled) {
+            ImGui::SliderFloat("Target CFL", &adaptiveSubsteps->targetCfl, 0.05f, 2.0f);
+            ImGui::SliderInt("Max Substep Count", (int*)&adaptiveSubsteps->maxSubstepCount, 1, 40);
+            ImGui::SliderFloat("Simulation Budget (ms)", &adaptiveSubsteps->frameBudget, 0.0f, 50.0f);
+            ImGui::SliderInt("Substep Hysteresis Frames", (int*)&adaptiveSubsteps->hysteresisFrames, 1, 120);
+        }
+
+        ImGui::SliderInt("Sleep After Substeps", (int*)&pbmpmConstants.sleepSubstepCount, 0, 120);
+        ImGui::SliderFloat("Sleep Speed", &pbmpmConstants.sleepSpeed, 0.0f, 5.0f);
+        ImGui::SliderInt("Rate Levels", (int*)&pbmpmConstants.rateLevelCount, 1, MaxRateLevelCount);
+        ImGui::SliderFloat("Rate Displacement", &pbmpmConstants.rateDisplacement, 0.01f, 1.0f);
 
         ImGui::SliderFloat("Mouse Radius", &pbmpmConstants.mouseRadius, 0.1f, 10.f);
         ImGui::SliderFloat("Mouse Strength", &pbmpmConstants.mouseStrength, 0.f, 40.f);
@@ -152,6 +182,11 @@ void drawImGUIWindow(PBMPMConstants& pbmpmConstants, ImGuiIO& io,
         ImGui::Checkbox("Render Grid", &renderGrid);
 
         ImGui::Checkbox("Render Spawners", &renderSpawn);
+
+        ImGui::Checkbox("Cull Surface Blocks", cullSurfaceBlocks);
+        if (*cullSurfaceBlocks) {
+            ImGui::SliderFloat("Min Block Screen Size", minSurfaceBlockScreenSize, 0.0f, 0.05f);
+        }
     }
 
     ImGui::End();
@@ -0,0 +1,74 @@
+#include "Check.h"
+#include "ViewProj.h"
+#include "Surface/BlockCulling.h"
+
+#include <cmath>
+
+static const float FOV_Y = 0.8f;
+
+// At the origin looking down +z, a square viewport so the side planes are as far out as the top and bottom ones
+static BlockCulling makeCulling(float minScreenSize = 0.0f) {
+	BlockCulling culling;
+	culling.enabled = true;
+	culling.viewProj = makeViewProj({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, FOV_Y, 1.0f, 0.1f, 100.0f);
+	culling.minScreenSize = minScreenSize;
+	return culling;
+}
+
+static bool isVisible(const BlockCulling& culling, const Vec3& boxMin, const Vec3& boxMax) {
+	return isBlockVisible(culling, makeFrustum(culling.viewProj), boxMin, boxMax);
+}
+
+static void keepsBoxesStraddlingAPlane() {
+	BlockCulling culling = makeCulling();
+	float halfWidth = std::tan(FOV_Y * 0.5f) * 10.0f;
+
+	// Across the right, top, near and far planes, none of their corners inside all six
+	CHECK(isVisible(culling, { halfWidth - 0.5f, -0.5f, 9.5f }, { halfWidth + 0.5f, 0.5f, 10.5f }));
+	CHECK(isVisible(culling, { -0.5f, halfWidth - 0.5f, 9.5f }, { 0.5f, halfWidth + 0.5f, 10.5f }));
+	CHECK(isVisible(culling, { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f }));
+	CHECK(isVisible(culling, { -0.5f, -0.5f, 99.5f }, { 0.5f, 0.5f, 100.5f }));
+
+	// The same boxes moved just past those planes
+	CHECK(!isVisible(culling, { halfWidth + 1.0f, -0.5f, 9.5f }, { halfWidth + 2.0f, 0.5f, 10.5f }));
+	CHECK(!isVisible(culling, { -0.5f, halfWidth + 1.0f, 9.5f }, { 0.5f, halfWidth + 2.0f, 10.5f }));
+	CHECK(!isVisible(culling, { -0.5f, -0.5f, 100.5f }, { 0.5f, 0.5f, 101.5f }));
+}
+
+static void cullsBoxesBehindTheCamera() {
+	BlockCulling culling = makeCulling();
+	CHECK(!isVisible(culling, { -0.5f, -0.5f, -10.5f }, { 0.5f, 0.5f, -9.5f }));
+	// Wide enough that every side plane on its own lets it through, only the near plane rejects it
+	CHECK(!isVisible(culling, { -20.0f, -20.0f, -10.5f }, { 20.0f, 20.0f, -9.5f }));
+
+	// Its projected size is infinite there, the frustum still has to reject it
+	culling.minScreenSize = 0.5f;
+	CHECK(!isVisible(culling, { -0.5f, -0.5f, -10.5f }, { 0.5f, 0.5f, -9.5f }));
+
+	culling.enabled = false;
+	CHECK(isVisible(culling, { -0.5f, -0.5f, -10.5f }, { 0.5f, 0.5f, -9.5f }));
+}
+
+static void cullsBoxesBelowMinScreenSize() {
+	Vec3 boxMin = { -0.5f, -0.5f, 19.5f };
+	Vec3 boxMax = { 0.5f, 0.5f, 20.5f };
+
+	// The bounding sphere's radius over the distance, scaled by the projection's y scale
+	float expected = length(boxMax - boxMin) * 0.5f / std::tan(FOV_Y * 0.5f) / 20.0f;
+	float size = projectedSize(makeCulling().viewProj, boxMin, boxMax);
+	CHECK(std::fabs(size - expected) < 1e-4f);
+
+	CHECK(isVisible(makeCulling(0.0f), boxMin, boxMax));
+	CHECK(isVisible(makeCulling(size * 0.99f), boxMin, boxMax));
+	CHECK(!isVisible(makeCulling(size * 1.01f), boxMin, boxMax));
+
+	// A box around the camera covers the whole screen whatever the threshold
+	CHECK(isVisible(makeCulling(1000.0f), { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f }));
+}
+
+int main() {
+	RUN_TEST(keepsBoxesStraddlingAPlane);
+	RUN_TEST(cullsBoxesBehindTheCamera);
+	RUN_TEST(cullsBoxesBelowMinScreenSize);
+	return checkResult();
+}
@@ -0,0 +1,135 @@
+#include "Check.h"
+#include "Memory/BufferPlacer.h"
+
+#include <cstdint>
+#include <vector>
+
+static const uint64_t K = 65536;
+
+struct PlacedBuffer {
+	uint64_t size;
+	uint32_t firstPass;
+	uint32_t lastPass;
+};
+
+// Buffers that are alive at the same time must never share memory
+static bool placementIsValid(const BufferPlacer& placer, const std::vector<PlacedBuffer>& buffers, uint64_t alignment) {
+	for (uint32_t i = 0; i < buffers.size(); i++) {
+		uint64_t offsetA = placer.getOffset(i);
+		if (offsetA % alignment != 0 || offsetA + buffers[i].size > placer.getHeapSize()) {
+			return false;
+		}
+
+		for (uint32_t j = i + 1; j < buffers.size(); j++) {
+			if (!BufferPlacer::lifetimesOverlap(buffers[i].firstPass, buffers[i].lastPass, buffers[j].firstPass, buffers[j].lastPass)) {
+				continue;
+			}
+
+			uint64_t offsetB = placer.getOffset(j);
+			if (offsetA < offsetB + buffers[j].size && offsetB < offsetA + buffers[i].size) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void aliasesScratchAcrossMaterials() {
+	BufferPlacer placer;
+	std::vector<PlacedBuffer> buffers;
+
+	// Four materials, each with scratch buffers alive only in its own pass, plus one buffer alive throughout
+	for (uint32_t material = 0; material < 4; material++) {
+		for (uint64_t size : { 10 * K, 3 * K + 5, K, 7 * K }) {
+			buffers.push_back({ size, material, material });
+		}
+	}
+	buffers.push_back({ 2 * K, 0, BufferPlacer::LastPass });
+
+	for (const PlacedBuffer& buffer : buffers) {
+		placer.addBuffer(buffer.size, K, buffer.firstPass, buffer.lastPass);
+	}
+	uint64_t heapSize = placer.place();
+
+	// One material's scratch plus the persistent buffer, the 3K+5 buffer rounds up to 4K
+	CHECK(heapSize == 10 * K + 7 * K + 4 * K + K + 2 * K);
+	CHECK(placer.getHeapSize() == heapSize);
+	CHECK(placer.getUnaliasedSize() > 4 * heapSize - 8 * K);
+	CHECK(placementIsValid(placer, buffers, K));
+}
+
+static void overlappingLifetimesDontAlias() {
+	BufferPlacer placer;
+	std::vector<PlacedBuffer> buffers = {
+		{ 4 * K, 0, 1 },
+		{ 4 * K, 1, 2 },
+		{ 4 * K, 2, 3 },
+		{ 4 * K, 3, 4 },
+	};
+	for (const PlacedBuffer& buffer : buffers) {
+		placer.addBuffer(buffer.size, K, buffer.firstPass, buffer.lastPass);
+	}
+
+	// Neighbours overlap by one pass, every other buffer can share memory
+	CHECK(placer.place() == 8 * K);
+	CHECK(placementIsValid(placer, buffers, K));
+}
+
+static void fillsGapsBetweenPlacedBuffers() {
+	BufferPlacer placer;
+	std::vector<PlacedBuffer> buffers = {
+		{ 8 * K, 0, 0 },
+		{ 2 * K, 1, 1 },
+		{ 3 * K, 0, 1 },
+		{ 5 * K, 1, 1 },
+	};
+	for (const PlacedBuffer& buffer : buffers) {
+		placer.addBuffer(buffer.size, K, buffer.firstPass, buffer.lastPass);
+	}
+
+	// Pass 1 fits its 2K and 5K buffers into the space the 8K pass 0 buffer leaves behind
+	CHECK(placer.place() == 11 * K);
+	CHECK(placementIsValid(placer, buffers, K));
+}
+
+static void manyRandomLifetimes() {
+	BufferPlacer placer;
+	std::vector<PlacedBuffer> buffers;
+
+	uint32_t state = 12345;
+	auto next = [&]() {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	};
+	for (int i = 0; i < 200; i++) {
+		uint32_t first = next() % 32;
+		uint32_t last = first + next() % 6;
+		buffers.push_back({ (next() % 64 + 1) * 1000, first, last });
+		placer.addBuffer(buffers.back().size, 256, first, last);
+	}
+
+	uint64_t heapSize = placer.place();
+	CHECK(heapSize < placer.getUnaliasedSize());
+	CHECK(placementIsValid(placer, buffers, 256));
+}
+
+static void clearStartsOver() {
+	BufferPlacer placer;
+	placer.addBuffer(4 * K, K, 0, 0);
+	placer.place();
+	placer.clear();
+
+	CHECK(placer.getBufferCount() == 0);
+	CHECK(placer.getHeapSize() == 0);
+	CHECK(placer.addBuffer(K, K, 0, 0) == 0);
+	CHECK(placer.place() == K);
+}
+
+int main() {
+	RUN_TEST(aliasesScratchAcrossMaterials);
+	RUN_TEST(overlappingLifetimesDontAlias);
+	RUN_TEST(fillsGapsBetweenPlacedBuffers);
+	RUN_TEST(manyRandomLifetimes);
+	RUN_TEST(clearStartsOver);
+	return checkResult();
+}
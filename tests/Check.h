@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdio>
+#include <exception>
+
+// Minimal assertions for the host tests. A failed check is reported and makes the test executable fail,
+// the remaining checks still run.
+
+inline int& checkFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++checkFailures(); \
+		} \
+	} while (0)
+
+#define CHECK_THROWS(expression) \
+	do { \
+		bool thrown = false; \
+		try { expression; } \
+		catch (const std::exception&) { thrown = true; } \
+		if (!thrown) { \
+			std::fprintf(stderr, "%s:%d: CHECK_THROWS(%s) did not throw\n", __FILE__, __LINE__, #expression); \
+			++checkFailures(); \
+		} \
+	} while (0)
+
+#define RUN_TEST(test) \
+	do { \
+		int before = checkFailures(); \
+		test(); \
+		std::printf("%s %s\n", checkFailures() == before ? "passed" : "FAILED", #test); \
+	} while (0)
+
+inline int checkResult() {
+	return checkFailures() == 0 ? 0 : 1;
+}
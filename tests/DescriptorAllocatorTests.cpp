@@ -0,0 +1,136 @@
+#include "Check.h"
+#include "Memory/DescriptorAllocator.h"
+
+static void allocatesFirstFit() {
+	DescriptorAllocator allocator(16, 0);
+
+	CHECK(allocator.allocate(4) == 0);
+	CHECK(allocator.allocate(4) == 4);
+	CHECK(allocator.allocate(4) == 8);
+	CHECK(allocator.getFreePersistentCount() == 4);
+
+	CHECK(allocator.allocate(5) == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.allocate(4) == 12);
+	CHECK(allocator.allocate(1) == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.allocate(0) == DescriptorAllocator::InvalidIndex);
+}
+
+static void defersFreesUntilFence() {
+	DescriptorAllocator allocator(8, 0);
+	allocator.allocate(8);
+
+	allocator.free(2, 2, 5);
+	CHECK(allocator.getFreePersistentCount() == 0);
+	CHECK(allocator.allocate(1) == DescriptorAllocator::InvalidIndex);
+
+	allocator.releaseCompleted(4);
+	CHECK(allocator.allocate(1) == DescriptorAllocator::InvalidIndex);
+
+	allocator.releaseCompleted(5);
+	CHECK(allocator.getFreePersistentCount() == 2);
+	CHECK(allocator.allocate(2) == 2);
+}
+
+static void releasesOutOfOrderFences() {
+	DescriptorAllocator allocator(8, 0);
+	allocator.allocate(8);
+
+	allocator.free(0, 2, 9);
+	allocator.free(4, 2, 3);
+	allocator.releaseCompleted(3);
+	CHECK(allocator.getFreePersistentCount() == 2);
+	CHECK(allocator.allocate(2) == 4);
+
+	allocator.releaseCompleted(9);
+	CHECK(allocator.allocate(2) == 0);
+}
+
+static void mergesAdjacentRanges() {
+	DescriptorAllocator allocator(12, 0);
+	allocator.allocate(4);
+	allocator.allocate(4);
+	allocator.allocate(4);
+
+	// Free the outer ranges first, then the middle one joins all three
+	allocator.free(0, 4, 1);
+	allocator.free(8, 4, 1);
+	allocator.releaseCompleted(1);
+	CHECK(allocator.allocate(8) == DescriptorAllocator::InvalidIndex);
+
+	allocator.free(4, 4, 2);
+	allocator.releaseCompleted(2);
+	CHECK(allocator.getFreePersistentCount() == 12);
+	CHECK(allocator.allocate(12) == 0);
+}
+
+static void rangesFreedOneByOneMerge() {
+	// Descriptor tables are allocated as one range but each view frees its own slot
+	DescriptorAllocator allocator(6, 0);
+	uint32_t table = allocator.allocate(3);
+	allocator.allocate(3);
+
+	allocator.free(table + 2, 1, 1);
+	allocator.free(table, 1, 1);
+	allocator.free(table + 1, 1, 1);
+	allocator.releaseCompleted(1);
+	CHECK(allocator.allocate(3) == table);
+}
+
+static void rejectsInvalidFrees() {
+	DescriptorAllocator allocator(8, 4);
+	allocator.allocate(8);
+
+	CHECK_THROWS(allocator.free(6, 4, 1));
+	CHECK_THROWS(allocator.free(8, 1, 1));
+
+	allocator.free(0, 4, 1);
+	allocator.free(2, 2, 1);
+	CHECK_THROWS(allocator.releaseCompleted(1));
+}
+
+static void transientRingWrapsAround() {
+	DescriptorAllocator allocator(16, 8);
+
+	// Transient indices start after the persistent section
+	CHECK(allocator.allocateTransient(5) == 16);
+	allocator.finishFrame(1);
+	CHECK(allocator.allocateTransient(2) == 21);
+	allocator.finishFrame(2);
+
+	// Only frame 1 has retired, so the ring is full until the fence moves
+	CHECK(allocator.allocateTransient(3) == DescriptorAllocator::InvalidIndex);
+	CHECK(allocator.getOldestTransientFenceValue() == 1);
+
+	// A range never straddles the end of the ring, it restarts at the front
+	allocator.releaseCompleted(1);
+	CHECK(allocator.allocateTransient(3) == 16);
+	CHECK(allocator.allocateTransient(2) == 19);
+	CHECK(allocator.allocateTransient(1) == DescriptorAllocator::InvalidIndex);
+	allocator.finishFrame(3);
+
+	allocator.releaseCompleted(3);
+	CHECK(allocator.getOldestTransientFenceValue() == 0);
+	CHECK(allocator.allocateTransient(8) == 16);
+	CHECK(allocator.allocateTransient(9) == DescriptorAllocator::InvalidIndex);
+}
+
+static void transientsDontTouchPersistentRanges() {
+	DescriptorAllocator allocator(4, 4);
+	CHECK(allocator.allocateTransient(4) == 4);
+	CHECK(allocator.allocate(4) == 0);
+
+	DescriptorAllocator persistentOnly(4, 0);
+	CHECK(persistentOnly.allocateTransient(1) == DescriptorAllocator::InvalidIndex);
+}
+
+int main() {
+	RUN_TEST(allocatesFirstFit);
+	RUN_TEST(defersFreesUntilFence);
+	RUN_TEST(releasesOutOfOrderFences);
+	RUN_TEST(mergesAdjacentRanges);
+	RUN_TEST(rangesFreedOneByOneMerge);
+	RUN_TEST(rejectsInvalidFrees);
+	RUN_TEST(transientRingWrapsAround);
+	RUN_TEST(transientsDontTouchPersistentRanges);
+	return checkResult();
+}
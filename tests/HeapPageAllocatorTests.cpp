@@ -0,0 +1,128 @@
+#include "Check.h"
+#include "Memory/HeapPageAllocator.h"
+
+static const uint64_t K = 65536;
+
+static void fillsPagesFirstFit() {
+	HeapPageAllocator allocator(16 * K);
+
+	HeapAllocation a = allocator.allocate(5 * K, K);
+	HeapAllocation b = allocator.allocate(5 * K, K);
+	CHECK(a.page == 0 && a.offset == 0);
+	CHECK(b.page == 0 && b.offset == 5 * K);
+
+	// Too big for what's left of the first page
+	HeapAllocation c = allocator.allocate(8 * K, K);
+	CHECK(c.page == 1 && c.offset == 0);
+	CHECK(allocator.getPageCount() == 2);
+	CHECK(allocator.getAllocatedSize() == 18 * K);
+	CHECK(allocator.getReservedSize() == 32 * K);
+
+	CHECK(!allocator.allocate(0, K).isValid());
+}
+
+static void alignsOffsets() {
+	HeapPageAllocator allocator(16 * K);
+
+	CHECK(allocator.allocate(100, 256).offset == 0);
+	CHECK(allocator.allocate(100, K).offset == K);
+
+	// The gap left by alignment is still usable
+	HeapAllocation gap = allocator.allocate(1000, 256);
+	CHECK(gap.page == 0 && gap.offset == 256);
+}
+
+static void oversizedRequestsGetTheirOwnPage() {
+	HeapPageAllocator allocator(16 * K);
+
+	HeapAllocation large = allocator.allocate(40 * K + 1, K);
+	CHECK(large.page == 0 && large.offset == 0);
+	CHECK(allocator.getPageSize(0) == 41 * K);
+
+	CHECK(allocator.allocate(K, K).page == 1);
+	CHECK(allocator.getPageSize(1) == 16 * K);
+}
+
+static void holdsFreesUntilFence() {
+	HeapPageAllocator allocator(16 * K);
+
+	HeapAllocation a = allocator.allocate(8 * K, K);
+	allocator.allocate(8 * K, K);
+
+	// The GPU may still be using the range, so a new buffer must not land on it
+	allocator.free(a, 3);
+	CHECK(allocator.allocate(8 * K, K).page == 1);
+	CHECK(allocator.getAllocatedSize() == 24 * K);
+
+	allocator.releaseCompleted(2);
+	CHECK(allocator.allocate(8 * K, K).page == 1);
+
+	allocator.releaseCompleted(3);
+	CHECK(allocator.getAllocatedSize() == 24 * K);
+	HeapAllocation reused = allocator.allocate(8 * K, K);
+	CHECK(reused.page == 0 && reused.offset == 0);
+}
+
+static void releasesOutOfOrderFences() {
+	HeapPageAllocator allocator(16 * K);
+
+	HeapAllocation a = allocator.allocate(8 * K, K);
+	HeapAllocation b = allocator.allocate(8 * K, K);
+	allocator.free(a, 7);
+	allocator.free(b, 2);
+
+	allocator.releaseCompleted(2);
+	HeapAllocation reused = allocator.allocate(8 * K, K);
+	CHECK(reused.page == 0 && reused.offset == 8 * K);
+	CHECK(allocator.getPageCount() == 1);
+}
+
+static void mergesFreedRanges() {
+	HeapPageAllocator allocator(16 * K);
+
+	HeapAllocation a = allocator.allocate(4 * K, K);
+	HeapAllocation b = allocator.allocate(4 * K, K);
+	HeapAllocation c = allocator.allocate(4 * K, K);
+
+	allocator.free(a, 1);
+	allocator.free(c, 1);
+	allocator.releaseCompleted(1);
+	allocator.free(b, 2);
+	allocator.releaseCompleted(2);
+
+	HeapAllocation whole = allocator.allocate(16 * K, K);
+	CHECK(whole.page == 0 && whole.offset == 0);
+	CHECK(allocator.getPageCount() == 1);
+}
+
+static void rejectsInvalidFrees() {
+	HeapPageAllocator allocator(16 * K);
+	HeapAllocation a = allocator.allocate(4 * K, K);
+
+	HeapAllocation foreign = a;
+	foreign.page = 5;
+	CHECK_THROWS(allocator.free(foreign, 1));
+
+	HeapAllocation outside = a;
+	outside.offset = 15 * K;
+	CHECK_THROWS(allocator.free(outside, 1));
+
+	allocator.free(a, 1);
+	allocator.free(a, 1);
+	CHECK_THROWS(allocator.releaseCompleted(1));
+
+	// Freeing an invalid allocation does nothing
+	allocator.free(HeapAllocation(), 1);
+	CHECK_THROWS(HeapPageAllocator(0));
+}
+
+int main() {
+	RUN_TEST(fillsPagesFirstFit);
+	RUN_TEST(alignsOffsets);
+	RUN_TEST(oversizedRequestsGetTheirOwnPage);
+	RUN_TEST(holdsFreesUntilFence);
+	RUN_TEST(releasesOutOfOrderFences);
+	RUN_TEST(mergesFreedRanges);
+	RUN_TEST(rejectsInvalidFrees);
+	return checkResult();
+}
@@ -0,0 +1,104 @@
+#include "Check.h"
+#include "Memory/LinearRingAllocator.h"
+
+static void alignsAllocations() {
+	LinearRingAllocator ring(1024);
+
+	CHECK(ring.allocate(100) == 0);
+	CHECK(ring.allocate(100) == 256);
+	CHECK(ring.allocate(4, 4) == 356);
+	CHECK(ring.getUsedSize() == 360);
+	CHECK(ring.getFrameSize() == 360);
+
+	CHECK(LinearRingAllocator::alignUp(0, 256) == 0);
+	CHECK(LinearRingAllocator::alignUp(1, 256) == 256);
+	CHECK(LinearRingAllocator::alignUp(7, 1) == 7);
+}
+
+static void rejectsOversizedAllocations() {
+	LinearRingAllocator ring(1024);
+
+	CHECK(ring.allocate(0) == LinearRingAllocator::InvalidOffset);
+	CHECK(ring.allocate(1025) == LinearRingAllocator::InvalidOffset);
+	CHECK(ring.allocate(1024) == 0);
+	CHECK(ring.allocate(1) == LinearRingAllocator::InvalidOffset);
+
+	CHECK_THROWS(LinearRingAllocator(0));
+}
+
+static void retiresFramesByFence() {
+	LinearRingAllocator ring(1024);
+
+	ring.allocate(512);
+	ring.finishFrame(1);
+	ring.allocate(256);
+	ring.finishFrame(2);
+	CHECK(ring.getOldestFenceValue() == 1);
+	CHECK(ring.getFrameSize() == 0);
+
+	ring.releaseCompleted(0);
+	CHECK(ring.getUsedSize() == 768);
+
+	ring.releaseCompleted(1);
+	CHECK(ring.getUsedSize() == 256);
+	CHECK(ring.getOldestFenceValue() == 2);
+
+	ring.releaseCompleted(2);
+	CHECK(ring.getUsedSize() == 0);
+	CHECK(!ring.hasFramesInFlight());
+	CHECK(ring.getOldestFenceValue() == 0);
+
+	// An idle ring starts over at the front
+	CHECK(ring.allocate(1024) == 0);
+}
+
+static void emptyFramesAreNotTracked() {
+	LinearRingAllocator ring(1024);
+
+	ring.finishFrame(1);
+	CHECK(!ring.hasFramesInFlight());
+
+	ring.allocate(16);
+	ring.finishFrame(2);
+	ring.finishFrame(3);
+	CHECK(ring.getOldestFenceValue() == 2);
+	ring.releaseCompleted(2);
+	CHECK(!ring.hasFramesInFlight());
+}
+
+static void wrapsAroundWithoutStraddling() {
+	LinearRingAllocator ring(1024);
+
+	CHECK(ring.allocate(512) == 0);
+	ring.finishFrame(1);
+	CHECK(ring.allocate(384) == 512);
+	ring.finishFrame(2);
+
+	// 128 bytes are left at the end, which is too small, and the front is still in flight
+	CHECK(ring.allocate(256) == LinearRingAllocator::InvalidOffset);
+
+	// Once the first frame retires the allocation restarts at the front and the tail counts as padding
+	ring.releaseCompleted(1);
+	CHECK(ring.allocate(256) == 0);
+	CHECK(ring.getUsedSize() == 384 + 128 + 256);
+	ring.finishFrame(3);
+
+	CHECK(ring.allocate(256) == 256);
+	CHECK(ring.allocate(1) == LinearRingAllocator::InvalidOffset);
+	ring.finishFrame(4);
+
+	// The padding is returned with the frame that wasted it
+	ring.releaseCompleted(3);
+	CHECK(ring.getUsedSize() == 256);
+	ring.releaseCompleted(4);
+	CHECK(ring.getUsedSize() == 0);
+}
+
+int main() {
+	RUN_TEST(alignsAllocations);
+	RUN_TEST(rejectsOversizedAllocations);
+	RUN_TEST(retiresFramesByFence);
+	RUN_TEST(emptyFramesAreNotTracked);
+	RUN_TEST(wrapsAroundWithoutStraddling);
+	return checkResult();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+#include "Surface/SurfaceExtractor.h"
+
+// Helpers for the surface tests. Half-blocks don't share vertices, so meshes are compared and checked by position
+
+using Triangle = std::array<float, 9>;
+
+// Sorted so meshes can be compared whatever order their blocks were concatenated in
+inline std::vector<Triangle> getTriangles(const SurfaceMesh& mesh) {
+	std::vector<Triangle> triangles;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		Triangle triangle;
+		for (int k = 0; k < 3; k++) {
+			const Vec3& p = mesh.positions[mesh.indices[i + k]];
+			triangle[3 * k] = p.x;
+			triangle[3 * k + 1] = p.y;
+			triangle[3 * k + 2] = p.z;
+		}
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+struct MeshTopology {
+	size_t vertices = 0;
+	size_t edges = 0;
+	size_t faces = 0;
+	// Edges of only one triangle, and edges of more than two
+	size_t openEdges = 0;
+	size_t nonManifoldEdges = 0;
+
+	// 2 for each closed surface without handles
+	long long getEulerCharacteristic() const { return (long long)vertices - (long long)edges + (long long)faces; }
+};
+
+// Vertices at the same position are welded. Triangles that collapse to a line or a point have no area and are skipped
+inline MeshTopology getTopology(const SurfaceMesh& mesh) {
+	std::map<std::array<float, 3>, int> weldedIndices;
+	auto weld = [&](uint32_t index) {
+		const Vec3& p = mesh.positions[index];
+		return weldedIndices.emplace(std::array<float, 3>{ p.x, p.y, p.z }, (int)weldedIndices.size()).first->second;
+	};
+
+	MeshTopology topology;
+	std::map<std::pair<int, int>, int> edgeUses;
+	std::vector<int> faceVertices;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		int a = weld(mesh.indices[i]);
+		int b = weld(mesh.indices[i + 1]);
+		int c = weld(mesh.indices[i + 2]);
+		if (a == b || b == c || c == a) {
+			continue;
+		}
+
+		topology.faces++;
+		faceVertices.insert(faceVertices.end(), { a, b, c });
+		edgeUses[std::minmax(a, b)]++;
+		edgeUses[std::minmax(b, c)]++;
+		edgeUses[std::minmax(c, a)]++;
+	}
+
+	std::sort(faceVertices.begin(), faceVertices.end());
+	topology.vertices = std::unique(faceVertices.begin(), faceVertices.end()) - faceVertices.begin();
+	topology.edges = edgeUses.size();
+	for (const auto& [edge, uses] : edgeUses) {
+		topology.openEdges += uses == 1;
+		topology.nonManifoldEdges += uses > 2;
+	}
+	return topology;
+}
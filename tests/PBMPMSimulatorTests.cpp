@@ -0,0 +1,247 @@
+#include "Check.h"
+#include "Simulation/PBMPMSimulator.h"
+
+#include <cstring>
+#include <vector>
+
+static SimulationParams makeParams() {
+	SimulationParams params;
+	params.gridSize = { 32, 32, 32 };
+	return params;
+}
+
+// Two particles per cell along each axis in a box of cells starting at origin
+static void addBlock(PBMPMSimulator& simulator, int material, const Int3& origin, const Int3& size) {
+	for (int z = 0; z < size.z * 2; z++) {
+		for (int y = 0; y < size.y * 2; y++) {
+			for (int x = 0; x < size.x * 2; x++) {
+				Vec3 position = toVec3(origin) + Vec3{ x + 0.5f, y + 0.5f, z + 0.5f } * 0.5f;
+				simulator.addParticle(position, material, 0.125f);
+			}
+		}
+	}
+}
+
+static bool samePositions(const PBMPMSimulator& a, const PBMPMSimulator& b) {
+	return a.getParticleCount() == b.getParticleCount() &&
+		std::memcmp(a.getPositions().data(), b.getPositions().data(), a.getParticleCount() * sizeof(Vec4)) == 0;
+}
+
+// Iteration 0 only scatters, a single iteration has to run as two rather than leave the particles where they are
+static void singleIterationStillMoves() {
+	PBMPMSimulator one;
+	PBMPMSimulator two;
+	addBlock(one, SimMaterialElastic, { 12, 16, 12 }, { 4, 4, 4 });
+	addBlock(two, SimMaterialElastic, { 12, 16, 12 }, { 4, 4, 4 });
+	float startY = one.getPositions()[0].y;
+
+	SimulationParams params = makeParams();
+	for (int step = 0; step < 20; step++) {
+		params.iterationCount = 1;
+		one.step(params);
+		params.iterationCount = 2;
+		two.step(params);
+	}
+
+	CHECK(one.getPositions()[0].y < startY - 0.1f);
+	CHECK(samePositions(one, two));
+}
+
+// Room for the largest value to grow 8 times, and no more than twice that since the multiplier is a power of two
+static void checkHeadroom(const SimulationGridStats& stats) {
+	CHECK(stats.overflowCount == 0);
+	CHECK(stats.maxGridValue * stats.fixedPointMultiplier * 8.0 <= 2147483647.0);
+	CHECK(stats.maxGridValue * stats.fixedPointMultiplier * 32.0 > 2147483647.0);
+}
+
+// Far too large for a 32 bit grid, the sums are clamped. Each step the automatic multiplier is picked from the clamped
+// values, so it comes down a few powers of two at a time until they fit
+static void automaticMultiplierComesDownAfterOverflow() {
+	PBMPMSimulator simulator;
+	addBlock(simulator, SimMaterialLiquid, { 12, 4, 12 }, { 6, 6, 6 });
+	SimulationParams params = makeParams();
+	params.fixedPointMultiplier = 1e13;
+	simulator.step(params);
+	CHECK(simulator.getGridStats().overflowCount > 0);
+
+	params.autoFixedPoint = true;
+	double multiplier = params.fixedPointMultiplier;
+	for (int step = 0; step < 8 && simulator.getGridStats().overflowCount > 0; step++) {
+		simulator.step(params);
+		CHECK(simulator.getGridStats().fixedPointMultiplier < multiplier);
+		multiplier = simulator.getGridStats().fixedPointMultiplier;
+	}
+
+	simulator.step(params);
+	checkHeadroom(simulator.getGridStats());
+}
+
+// So small that every vertex's mass is under 2^10 units, the automatic multiplier goes up until they clear it
+static void automaticMultiplierGoesUpAfterUnderflow() {
+	PBMPMSimulator simulator;
+	addBlock(simulator, SimMaterialLiquid, { 12, 4, 12 }, { 6, 6, 6 });
+	SimulationParams params = makeParams();
+	params.fixedPointMultiplier = 1000.0;
+	simulator.step(params);
+	uint64_t underflows = simulator.getGridStats().underflowCount;
+	CHECK(underflows > 0);
+	CHECK(simulator.getGridStats().overflowCount == 0);
+
+	params.autoFixedPoint = true;
+	simulator.step(params);
+	CHECK(simulator.getGridStats().fixedPointMultiplier > params.fixedPointMultiplier);
+	CHECK(simulator.getGridStats().underflowCount < underflows / 4);
+
+	simulator.step(params);
+	checkHeadroom(simulator.getGridStats());
+}
+
+// A 64 bit grid takes multipliers a 32 bit one can't, and counts the sums that wrap past its own range
+static void wideGridCountsOverflow() {
+	PBMPMSimulator simulator;
+	addBlock(simulator, SimMaterialLiquid, { 12, 4, 12 }, { 6, 6, 6 });
+	SimulationParams params = makeParams();
+	params.wideFixedPoint = true;
+	params.fixedPointMultiplier = 1e13;
+	simulator.step(params);
+	CHECK(simulator.getGridStats().overflowCount == 0);
+
+	params.fixedPointMultiplier = 1e19;
+	simulator.step(params);
+	CHECK(simulator.getGridStats().overflowCount > 0);
+}
+
+// Every material falling through a drain near the floor and past a rotated collider. Particles are added back into
+// the drained slots as the run goes, so the free list order matters too
+static std::vector<uint64_t> runDrainingScene(WorkerPool* pool, SimStorageFormat storage) {
+	PBMPMSimulator simulator(pool);
+	simulator.setShapes({
+		{ SimShapeBox, SimShapeDrain, { 10.0f, 4.0f, 16.0f }, 0.0f, { 6.0f, 2.0f, 14.0f } },
+		{ SimShapeBox, SimShapeCollider, { 22.0f, 8.0f, 16.0f }, 30.0f, { 4.0f, 1.0f, 14.0f } },
+	});
+	addBlock(simulator, SimMaterialLiquid, { 4, 10, 6 }, { 8, 4, 8 });
+	addBlock(simulator, SimMaterialElastic, { 18, 14, 8 }, { 4, 4, 4 });
+	addBlock(simulator, SimMaterialSand, { 6, 18, 18 }, { 4, 3, 4 });
+	addBlock(simulator, SimMaterialVisco, { 20, 20, 18 }, { 3, 3, 3 });
+	addBlock(simulator, SimMaterialSnow, { 12, 22, 10 }, { 3, 3, 3 });
+	size_t initialCount = simulator.getParticleCount();
+
+	SimulationParams params = makeParams();
+	params.deterministic = true;
+	params.particleStorage = storage;
+	std::vector<uint64_t> hashes;
+	for (int step = 0; step < 60; step++) {
+		if (step % 10 == 9) {
+			addBlock(simulator, step % 20 == 9 ? SimMaterialLiquid : SimMaterialSand, { 8, 24, 12 }, { 2, 2, 2 });
+		}
+		simulator.step(params);
+		hashes.push_back(simulator.getStateHash());
+	}
+
+	// Some of the added particles went into drained slots, and more were drained since
+	CHECK(simulator.getParticleCount() < initialCount + 6 * 64);
+	CHECK(!simulator.getFreeIndices().empty());
+	return hashes;
+}
+
+// The hash covers every particle field and the free list, so equal hashes mean the same state bit for bit
+static void stateHashIsTheSameForEveryThreadCount() {
+	std::vector<uint64_t> serial = runDrainingScene(nullptr, SimStorageFloat);
+	for (unsigned int threads : { 2u, 4u, 8u }) {
+		WorkerPool pool(threads);
+		CHECK(runDrainingScene(&pool, SimStorageFloat) == serial);
+	}
+}
+
+// The packed formats hash their 16 bit arrays in place of the float ones, which are left empty
+static void stateHashIsTheSameForEveryStorageFormat() {
+	for (SimStorageFormat storage : { SimStorageHalf, SimStorageBFloat16 }) {
+		std::vector<uint64_t> serial = runDrainingScene(nullptr, storage);
+		WorkerPool pool(4);
+		CHECK(runDrainingScene(&pool, storage) == serial);
+		CHECK(serial != runDrainingScene(nullptr, SimStorageFloat));
+	}
+}
+
+// An elastic block settling on the floor, which unlike a scene with impacts doesn't amplify the rounding. Every step
+// runs the reference in float and the other in the given storage format
+static SimulationComparison compareSettlingBlock(SimStorageFormat storage, int steps, size_t& packedBytes, size_t& floatBytes) {
+	PBMPMSimulator reference;
+	PBMPMSimulator other;
+	addBlock(reference, SimMaterialElastic, { 10, 3, 10 }, { 8, 6, 8 });
+	addBlock(other, SimMaterialElastic, { 10, 3, 10 }, { 8, 6, 8 });
+
+	SimulationParams params = makeParams();
+	SimulationParams otherParams = params;
+	otherParams.particleStorage = storage;
+	for (int step = 0; step < steps; step++) {
+		reference.step(params);
+		other.step(otherParams);
+	}
+	packedBytes = other.getBytesPerParticle();
+	floatBytes = reference.getBytesPerParticle();
+	return compareSimulations(reference, other);
+}
+
+// Half keeps 11 significant bits and bfloat16 8, so bfloat16 drifts further, and both stay well inside a cell
+static void compareSimulationsMeasuresPackedDrift() {
+	size_t packedBytes = 0;
+	size_t floatBytes = 0;
+	SimulationComparison same = compareSettlingBlock(SimStorageFloat, 20, packedBytes, floatBytes);
+	CHECK(same.comparedCount == 16 * 12 * 16);
+	CHECK(same.maxPositionError == 0.0f && same.rmsPositionError == 0.0f);
+	CHECK(same.maxDeformationDisplacementError == 0.0f && same.maxColorError == 0.0f);
+	CHECK(packedBytes == floatBytes);
+
+	SimulationComparison half = compareSettlingBlock(SimStorageHalf, 100, packedBytes, floatBytes);
+	CHECK(half.comparedCount == same.comparedCount);
+	CHECK(half.maxPositionError > 0.0f && half.maxPositionError < 2e-3f);
+	CHECK(half.rmsPositionError > 0.0f && half.rmsPositionError <= half.maxPositionError);
+	CHECK(half.maxColorError <= 1.0f / 2048.0f);
+	// At least 30% smaller than float
+	CHECK(packedBytes * 10 <= floatBytes * 7);
+
+	SimulationComparison bfloat16 = compareSettlingBlock(SimStorageBFloat16, 100, packedBytes, floatBytes);
+	CHECK(bfloat16.rmsPositionError > half.rmsPositionError);
+	CHECK(bfloat16.maxPositionError < 2e-2f);
+	CHECK(bfloat16.maxColorError <= 1.0f / 256.0f);
+	CHECK(packedBytes * 10 <= floatBytes * 7);
+}
+
+// Particles drained in either run are left out, the rest are compared slot by slot
+static void compareSimulationsSkipsDrainedParticles() {
+	PBMPMSimulator reference;
+	PBMPMSimulator other;
+	for (PBMPMSimulator* simulator : { &reference, &other }) {
+		simulator->setShapes({ { SimShapeBox, SimShapeDrain, { 16.0f, 4.0f, 16.0f }, 0.0f, { 4.0f, 2.0f, 4.0f } } });
+		addBlock(*simulator, SimMaterialLiquid, { 10, 8, 10 }, { 12, 4, 12 });
+	}
+
+	SimulationParams params = makeParams();
+	SimulationParams otherParams = params;
+	otherParams.particleStorage = SimStorageHalf;
+	for (int step = 0; step < 40; step++) {
+		reference.step(params);
+		other.step(otherParams);
+	}
+
+	size_t bothEnabled = 0;
+	for (size_t i = 0; i < reference.getParticleCount(); i++) {
+		bothEnabled += reference.getMaterial(i).w != SIM_MATERIAL_DRAINED && other.getMaterial(i).w != SIM_MATERIAL_DRAINED;
+	}
+	CHECK(!reference.getFreeIndices().empty() && !other.getFreeIndices().empty());
+	CHECK(bothEnabled > 0 && bothEnabled < reference.getParticleCount());
+	CHECK(compareSimulations(reference, other).comparedCount == bothEnabled);
+}
+
+int main() {
+	RUN_TEST(singleIterationStillMoves);
+	RUN_TEST(automaticMultiplierComesDownAfterOverflow);
+	RUN_TEST(automaticMultiplierGoesUpAfterUnderflow);
+	RUN_TEST(wideGridCountsOverflow);
+	RUN_TEST(stateHashIsTheSameForEveryThreadCount);
+	RUN_TEST(stateHashIsTheSameForEveryStorageFormat);
+	RUN_TEST(compareSimulationsMeasuresPackedDrift);
+	RUN_TEST(compareSimulationsSkipsDrainedParticles);
+	return checkResult();
+}
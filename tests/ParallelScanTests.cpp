@@ -0,0 +1,75 @@
+#include "Check.h"
+#include "Support/ParallelScan.h"
+
+#include <memory>
+#include <vector>
+
+static const int SENTINEL = -12345;
+
+// Small values with runs of zeros, so some partitions sum to nothing
+static int getValue(size_t i) {
+	uint32_t hash = (uint32_t)i * 2654435761u;
+	return (hash >> 28) < 4 ? 0 : (int)((hash >> 24) & 15);
+}
+
+static std::vector<size_t> getSizes(size_t partitionSize) {
+	return { 0, 1, partitionSize - 1, partitionSize, partitionSize + 1, 2 * partitionSize, 5 * partitionSize + 3, 20000 };
+}
+
+// Every pool runs the same partitions through one ParallelScan, which has to grow and shrink its state between calls
+static void forEachScan(void (*test)(ParallelScan& scan, size_t partitionSize)) {
+	for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+		std::unique_ptr<WorkerPool> pool = threads > 1 ? std::make_unique<WorkerPool>(threads) : nullptr;
+		for (size_t partitionSize : { 1, 2, 7, 64, 4096 }) {
+			ParallelScan scan(pool.get(), partitionSize);
+			test(scan, partitionSize);
+		}
+	}
+}
+
+static void exclusiveScanMatchesSerial() {
+	forEachScan([](ParallelScan& scan, size_t partitionSize) {
+		for (size_t count : getSizes(partitionSize)) {
+			std::vector<int> expected(count);
+			int total = 0;
+			for (size_t i = 0; i < count; i++) {
+				expected[i] = total;
+				total += getValue(i);
+			}
+
+			std::vector<int> out(count + 1, SENTINEL);
+			int sum = scan.exclusiveScan(count, getValue, out.data());
+			CHECK(sum == total);
+			CHECK(std::equal(expected.begin(), expected.end(), out.begin()));
+			CHECK(out[count] == SENTINEL);
+		}
+	});
+}
+
+static void compactMatchesSerial() {
+	forEachScan([](ParallelScan& scan, size_t partitionSize) {
+		for (size_t count : getSizes(partitionSize)) {
+			for (int keepEvery : { 1, 3, 1000000 }) {
+				auto keep = [&](size_t i) { return getValue(i) % keepEvery == 0; };
+				std::vector<int> expected;
+				for (size_t i = 0; i < count; i++) {
+					if (keep(i)) {
+						expected.push_back((int)i);
+					}
+				}
+
+				std::vector<int> out(count + 1, SENTINEL);
+				int kept = scan.compact(count, keep, out.data());
+				CHECK(kept == (int)expected.size());
+				CHECK(std::equal(expected.begin(), expected.end(), out.begin()));
+				CHECK(out[expected.size()] == SENTINEL);
+			}
+		}
+	});
+}
+
+int main() {
+	RUN_TEST(exclusiveScanMatchesSerial);
+	RUN_TEST(compactMatchesSerial);
+	return checkResult();
+}
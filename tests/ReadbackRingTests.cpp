@@ -0,0 +1,105 @@
+#include "Check.h"
+#include "Memory/ReadbackRing.h"
+
+static void handsOutSlotsRoundRobin() {
+	ReadbackRing ring(3);
+
+	CHECK(ring.beginFrame() == 0);
+	ring.submit(0, 1);
+	CHECK(ring.beginFrame() == 1);
+	ring.submit(1, 2);
+	CHECK(ring.beginFrame() == 2);
+	ring.submit(2, 3);
+	CHECK(ring.getInFlightCount() == 3);
+}
+
+static void skipsFramesWhenFull() {
+	ReadbackRing ring(2);
+
+	ring.submit(ring.beginFrame(), 1);
+	ring.submit(ring.beginFrame(), 2);
+	CHECK(ring.beginFrame() == ReadbackRing::InvalidSlot);
+	CHECK(ring.beginFrame() == ReadbackRing::InvalidSlot);
+	CHECK(ring.getSkippedFrameCount() == 2);
+
+	// Nothing completed yet, the CPU keeps going without a result
+	CHECK(ring.poll(0) == ReadbackRing::InvalidSlot);
+	CHECK(ring.beginFrame() == ReadbackRing::InvalidSlot);
+	CHECK(ring.getSkippedFrameCount() == 3);
+}
+
+static void pollReturnsNewestCompletedSlot() {
+	ReadbackRing ring(3);
+	uint64_t fence = 0;
+
+	uint32_t first = ring.beginFrame();
+	ring.submit(first, ++fence);
+	uint32_t second = ring.beginFrame();
+	ring.submit(second, ++fence);
+	uint32_t third = ring.beginFrame();
+	ring.submit(third, ++fence);
+
+	// Both completed slots are released, only the newest is worth reading
+	CHECK(ring.poll(2) == second);
+	CHECK(ring.getInFlightCount() == 1);
+	CHECK(ring.poll(2) == ReadbackRing::InvalidSlot);
+
+	// The released slots are reused in order while the third is still in flight
+	uint32_t fourth = ring.beginFrame();
+	CHECK(fourth == first);
+	ring.submit(fourth, ++fence);
+	uint32_t fifth = ring.beginFrame();
+	CHECK(fifth == second);
+	ring.submit(fifth, ++fence);
+	CHECK(ring.beginFrame() == ReadbackRing::InvalidSlot);
+
+	CHECK(ring.poll(fence) == fifth);
+	CHECK(ring.getInFlightCount() == 0);
+	CHECK(ring.getSkippedFrameCount() == 1);
+}
+
+static void followsTheStatsFrameLoop() {
+	// StatsReadback polls before opening each frame's slot, with the GPU running two frames behind
+	const uint32_t slotCount = 3;
+	ReadbackRing ring(slotCount);
+	uint32_t slotValues[slotCount] = {};
+	uint32_t latestValue = 0;
+
+	for (uint32_t frame = 1; frame <= 20; frame++) {
+		uint64_t completedFence = frame > 2 ? frame - 2 : 0;
+		uint32_t completed = ring.poll(completedFence);
+		if (completed != ReadbackRing::InvalidSlot) {
+			latestValue = slotValues[completed];
+			CHECK(latestValue == completedFence);
+		}
+
+		uint32_t slot = ring.beginFrame();
+		CHECK(slot != ReadbackRing::InvalidSlot);
+		slotValues[slot] = frame;
+		ring.submit(slot, frame);
+	}
+
+	CHECK(latestValue == 18);
+	CHECK(ring.getSkippedFrameCount() == 0);
+}
+
+static void rejectsInvalidSubmissions() {
+	ReadbackRing ring(2);
+
+	CHECK_THROWS(ring.submit(0, 1));
+	CHECK_THROWS(ring.submit(5, 1));
+
+	ring.submit(ring.beginFrame(), 4);
+	CHECK_THROWS(ring.submit(ring.beginFrame(), 3));
+
+	CHECK_THROWS(ReadbackRing(0));
+}
+
+int main() {
+	RUN_TEST(handsOutSlotsRoundRobin);
+	RUN_TEST(skipsFramesWhenFull);
+	RUN_TEST(pollReturnsNewestCompletedSlot);
+	RUN_TEST(followsTheStatsFrameLoop);
+	RUN_TEST(rejectsInvalidSubmissions);
+	return checkResult();
+}
@@ -0,0 +1,119 @@
+#include "Check.h"
+#include "Simulation/SimulationMath.h"
+
+#include <algorithm>
+#include <random>
+
+static float maxDifference(const Mat3& a, const Mat3& b) {
+	float difference = 0.0f;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			difference = std::max(difference, std::abs(a.m[i][j] - b.m[i][j]));
+		}
+	}
+	return difference;
+}
+
+static bool isRotation(const Mat3& r) {
+	return maxDifference(mul(transpose(r), r), identity3()) < 1e-4f && std::abs(det(r) - 1.0f) < 1e-4f;
+}
+
+// From a random unit quaternion, so every orientation is as likely
+static Mat3 randomRotation(std::mt19937& rng) {
+	std::normal_distribution<float> normal;
+	float w = normal(rng), x = normal(rng), y = normal(rng), z = normal(rng);
+	float n = std::sqrt(w * w + x * x + y * y + z * z);
+	w /= n; x /= n; y /= n; z /= n;
+	return { { { 1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y) },
+		{ 2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x) },
+		{ 2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y) } } };
+}
+
+// U diag(sigma) V^T, so sigma are its singular values up to rounding
+static Mat3 withSingularValues(std::mt19937& rng, const Vec3& sigma) {
+	return mul(mul(randomRotation(rng), diag(sigma)), transpose(randomRotation(rng)));
+}
+
+static void polarRotationRecoversRotation() {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> stretch(0.6f, 3.0f);
+	for (int i = 0; i < 1000; i++) {
+		Mat3 R = randomRotation(rng);
+		Mat3 Q = randomRotation(rng);
+		// Symmetric positive definite
+		Mat3 S = mul(mul(Q, diag({ stretch(rng), stretch(rng), stretch(rng) })), transpose(Q));
+
+		Mat3 rotation = polarRotation(mul(R, S));
+		CHECK(maxDifference(rotation, R) < 1e-4f);
+		CHECK(isRotation(rotation));
+	}
+}
+
+// Newton's iteration would head for a reflection, svd() flips one axis to give the closest rotation instead
+static void polarRotationFallsBackToSvd() {
+	std::mt19937 rng(2);
+	for (int i = 0; i < 200; i++) {
+		Mat3 inverted = withSingularValues(rng, { 1.5f, 0.9f, -0.7f });
+		Mat3 flat = withSingularValues(rng, { 1.2f, 0.8f, 1e-7f });
+		Mat3 collapsed = withSingularValues(rng, { 1e-3f, 1e-3f, 1e-3f });
+
+		for (const Mat3& a : { inverted, flat, collapsed }) {
+			SvdResult decomposition = svd(a);
+			Mat3 rotation = polarRotation(a);
+			CHECK(isRotation(rotation));
+			CHECK(maxDifference(rotation, mul(decomposition.U, decomposition.Vt)) < 1e-5f);
+		}
+	}
+}
+
+// Singular values drawn across and right up to the bounds, and reflections. Anything accepted must have all of them
+// inside, both the ones it was built from and the ones svd() finds. Ones 5% inside must be accepted
+static void singularValuesWithinNeverAcceptsOutside() {
+	const float bounds[][2] = { { 0.5f, 1000.0f }, { 1.0f / 1.105f, 1.105f }, { 0.9f, 1.1f } };
+	std::mt19937 rng(3);
+	int accepted = 0;
+
+	for (const auto& bound : bounds) {
+		float lo = bound[0];
+		float hi = bound[1];
+		std::uniform_real_distribution<float> across(lo * 0.9f, std::min(hi * 1.1f, 2.0f * lo + 2.0f));
+		std::uniform_real_distribution<float> nearBound(-1e-3f, 1e-3f);
+
+		for (int i = 0; i < 20000; i++) {
+			Vec3 sigma = { across(rng), across(rng), across(rng) };
+			switch (i % 4) {
+			case 1:
+				sigma.x = lo * (1.0f + nearBound(rng));
+				break;
+			case 2:
+				sigma.y = hi * (1.0f + nearBound(rng));
+				break;
+			case 3:
+				sigma.z = -sigma.z;
+				break;
+			}
+
+			Mat3 a = withSingularValues(rng, sigma);
+			bool inside = std::min({ sigma.x, sigma.y, sigma.z }) >= lo && std::max({ sigma.x, sigma.y, sigma.z }) <= hi;
+			if (!singularValuesWithin(a, lo, hi)) {
+				bool wellInside = std::min({ sigma.x, sigma.y, sigma.z }) > lo * 1.05f && std::max({ sigma.x, sigma.y, sigma.z }) < hi / 1.05f;
+				CHECK(!wellInside);
+				continue;
+			}
+
+			accepted++;
+			CHECK(inside);
+			Vec3 found = svd(a).sigma;
+			CHECK(std::min({ found.x, found.y, found.z }) >= lo * (1.0f - 1e-5f));
+			CHECK(std::max({ found.x, found.y, found.z }) <= hi * (1.0f + 1e-5f));
+		}
+	}
+	CHECK(accepted > 1000);
+}
+
+int main() {
+	RUN_TEST(polarRotationRecoversRotation);
+	RUN_TEST(polarRotationFallsBackToSvd);
+	RUN_TEST(singularValuesWithinNeverAcceptsOutside);
+	return checkResult();
+}
@@ -0,0 +1,105 @@
+#include "Check.h"
+#include "MeshChecks.h"
+#include "ViewProj.h"
+#include "Surface/SurfaceExtractor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct Particles {
+	std::vector<Vec4> positions;
+	std::vector<Vec4> materials;
+};
+
+// A pool on a lattice dense enough that cells away from its wavy top are all full, so most cells of a block aren't
+// surface cells and the vertices they share with the next block are only marked from that side
+static Particles makeParticles() {
+	Particles particles;
+	for (float x = 4.0f; x < 20.0f; x += 0.25f) {
+		for (float z = 4.0f; z < 20.0f; z += 0.25f) {
+			float height = 5.0f + 1.5f * std::sin(x * 0.7f) * std::cos(z * 0.5f);
+			for (float y = 1.0f; y < height; y += 0.25f) {
+				particles.positions.push_back({ x, y, z, 0.0f });
+				particles.materials.push_back({ 0.2f, 0.4f, 0.9f, 0.0f });
+			}
+		}
+	}
+	return particles;
+}
+
+static SurfaceParams makeParams() {
+	SurfaceParams params{ { 48, 48, 48 }, { 0.0f, 0.0f, 0.0f }, 0.5f, 1.0f, 0.75f, 0.1f };
+	params.culling.enabled = true;
+	return params;
+}
+
+static BlockCulling makeCulling(float angle, float minScreenSize) {
+	BlockCulling culling;
+	culling.enabled = true;
+	culling.viewProj = makeViewProj({ 12.0f, 9.0f, 12.0f }, { std::cos(angle), -0.6f, std::sin(angle) }, 0.8f, 16.0f / 9.0f, 0.1f, 100.0f);
+	culling.minScreenSize = minScreenSize;
+	return culling;
+}
+
+// Blocks in view read the densities of vertices their culled neighbours' cells mark, those have to be there
+static void culledMeshIsPartOfFullMesh() {
+	Particles particles = makeParticles();
+	SurfaceParams fullParams = makeParams();
+	fullParams.culling.enabled = false;
+
+	SurfaceExtractor extractor;
+	SurfaceMesh fullMesh;
+	extractor.extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), fullParams, fullMesh);
+	std::vector<Triangle> fullTriangles = getTriangles(fullMesh);
+
+	for (int view = 0; view < 6; view++) {
+		SurfaceParams params = makeParams();
+		params.culling = makeCulling(view * 1.05f, view >= 3 ? 0.05f : 0.0f);
+
+		SurfaceMesh mesh;
+		extractor.extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), params, mesh);
+		std::vector<Triangle> triangles = getTriangles(mesh);
+
+		CHECK(extractor.getCulledBlockCount() > 0);
+		CHECK(!triangles.empty());
+		CHECK(triangles.size() < fullTriangles.size());
+		CHECK(std::includes(fullTriangles.begin(), fullTriangles.end(), triangles.begin(), triangles.end()));
+	}
+}
+
+// Cached blocks next to ones entering or leaving the view have to be rebuilt, the result can't depend on the history
+static void reusedMeshMatchesFreshMesh() {
+	Particles particles = makeParticles();
+	SurfaceExtractor reusing;
+	SurfaceExtractor fresh;
+	size_t rebuiltBlocks = 0;
+	size_t meshedBlocks = 0;
+
+	for (int frame = 0; frame < 12; frame++) {
+		SurfaceParams params = makeParams();
+		params.culling = makeCulling(frame * 0.3f, frame >= 8 ? 0.05f : 0.0f);
+
+		SurfaceMesh freshMesh;
+		fresh.extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), params, freshMesh);
+
+		params.reuseTolerance = 0.05f;
+		SurfaceMesh reusedMesh;
+		reusing.extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), params, reusedMesh);
+
+		CHECK(getTriangles(reusedMesh) == getTriangles(freshMesh));
+		if (frame > 0) {
+			rebuiltBlocks += reusing.getRebuiltBlockCount();
+			meshedBlocks += reusing.getMeshedBlockIndices().size();
+		}
+	}
+
+	// The particles never move, so only the blocks around the edges of the view should have been rebuilt
+	CHECK(rebuiltBlocks < meshedBlocks);
+}
+
+int main() {
+	RUN_TEST(culledMeshIsPartOfFullMesh);
+	RUN_TEST(reusedMeshMatchesFreshMesh);
+	return checkResult();
+}
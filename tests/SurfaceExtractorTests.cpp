@@ -0,0 +1,307 @@
+#include "Check.h"
+#include "MeshChecks.h"
+#include "Surface/SurfaceExtractor.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+static const Vec3 SPHERE_CENTER = { 6.0f, 6.0f, 6.0f };
+static const float SPHERE_RADIUS = 2.5f;
+static const float PARTICLE_SPACING = 0.1f;
+
+struct Particles {
+	std::vector<Vec4> positions;
+	std::vector<Vec4> materials;
+};
+
+// A jittered lattice filling the sphere, colored by height
+static Particles makeSphere(const Vec3& center = SPHERE_CENTER, float radius = SPHERE_RADIUS) {
+	Particles particles;
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> jitter(-0.3f * PARTICLE_SPACING, 0.3f * PARTICLE_SPACING);
+	int steps = (int)(2.0f * radius / PARTICLE_SPACING) + 1;
+	for (int z = 0; z < steps; z++) {
+		for (int y = 0; y < steps; y++) {
+			for (int x = 0; x < steps; x++) {
+				Vec3 p = center - Vec3{ radius, radius, radius } +
+					Vec3{ x + jitter(rng), y + jitter(rng), z + jitter(rng) } * PARTICLE_SPACING;
+				if (length(p - center) <= radius) {
+					particles.positions.push_back({ p.x, p.y, p.z, 0.0f });
+					particles.materials.push_back({ p.y / 12.0f, 0.5f, 1.0f, 0.0f });
+				}
+			}
+		}
+	}
+	return particles;
+}
+
+// The kernel reaches 4 cells, as far as the gather window, and integrates to 1, so half the particles per unit volume
+// puts the surface about where the particles end. Every cell of a surface block is within the reach of surface cell
+// detection, so no vertex a block triangulates is left at a density of 0
+static SurfaceParams makeParams() {
+	float particlesPerVolume = 1.0f / (PARTICLE_SPACING * PARTICLE_SPACING * PARTICLE_SPACING);
+	return SurfaceParams{ { 48, 48, 48 }, { 0.0f, 0.0f, 0.0f }, 0.25f, 1.0f, 1.0f, 0.5f * particlesPerVolume };
+}
+
+// Two overlapping slabs of their own material with a third scattered through both, interleaved in the particle order.
+// Material 4 has no particles and 7 has no surface
+static Particles makeMixedMaterials(float shift) {
+	Particles particles;
+	int index = 0;
+	for (float z = 3.0f; z < 9.0f; z += 0.2f) {
+		for (float y = 3.0f; y < 7.0f; y += 0.2f) {
+			for (float x = 2.0f; x < 10.0f; x += 0.2f, index++) {
+				float material = index % 5 == 0 ? 2.0f : index % 23 == 0 ? 7.0f : x + 0.5f * std::sin(y + shift) < 6.0f ? 0.0f : 1.0f;
+				particles.positions.push_back({ x + shift, y, z, 0.0f });
+				particles.materials.push_back({ 0.2f * material, 0.5f, 1.0f - 0.1f * material, material });
+			}
+		}
+	}
+	return particles;
+}
+
+static SurfaceMesh extract(WorkerPool* pool, const Particles& particles, const SurfaceParams& params) {
+	SurfaceExtractor extractor(pool);
+	SurfaceMesh mesh;
+	extractor.extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), params, mesh);
+	return mesh;
+}
+
+static bool sameVec3s(const std::vector<Vec3>& a, const std::vector<Vec3>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void sameMeshForEveryThreadCount() {
+	Particles particles = makeSphere();
+	SurfaceParams params = makeParams();
+	SurfaceMesh serial = extract(nullptr, particles, params);
+	CHECK(serial.getTriangleCount() > 0);
+
+	for (unsigned int threads : { 2u, 4u, 8u }) {
+		WorkerPool pool(threads);
+		for (DensityMode mode : { DensityMode::PerVertex, DensityMode::BlockTiled }) {
+			params.densityMode = mode;
+			SurfaceMesh reference = extract(nullptr, particles, params);
+			SurfaceMesh mesh = extract(&pool, particles, params);
+
+			// Blocks are concatenated in block order, so even the order of the vertices has to match
+			CHECK(mesh.indices == reference.indices);
+			CHECK(sameVec3s(mesh.positions, reference.positions));
+			CHECK(sameVec3s(mesh.normals, reference.normals));
+			CHECK(mesh.colors.size() == reference.colors.size());
+		}
+	}
+}
+
+static void sphereIsClosedAtItsRadius() {
+	Particles particles = makeSphere();
+	SurfaceMesh mesh = extract(nullptr, particles, makeParams());
+
+	MeshTopology topology = getTopology(mesh);
+	CHECK(topology.faces > 1000);
+	CHECK(topology.openEdges == 0);
+	CHECK(topology.nonManifoldEdges == 0);
+	CHECK(topology.getEulerCharacteristic() == 2);
+
+	// Within half a cell of the sphere, and covering its area
+	float area = 0.0f;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		Vec3 a = mesh.positions[mesh.indices[i]];
+		Vec3 b = mesh.positions[mesh.indices[i + 1]];
+		Vec3 c = mesh.positions[mesh.indices[i + 2]];
+		Vec3 u = b - a;
+		Vec3 v = c - a;
+		area += 0.5f * length(Vec3{ u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x });
+	}
+	for (const Vec3& p : mesh.positions) {
+		CHECK(std::fabs(length(p - SPHERE_CENTER) - SPHERE_RADIUS) < 0.125f);
+	}
+	float sphereArea = 4.0f * PI * SPHERE_RADIUS * SPHERE_RADIUS;
+	CHECK(std::fabs(area - sphereArea) < 0.05f * sphereArea);
+}
+
+// Both modes sum the same particles, only in a different order
+static void densityModesGiveSameMesh() {
+	Particles particles = makeSphere();
+	SurfaceParams params = makeParams();
+	params.densityMode = DensityMode::PerVertex;
+	SurfaceMesh perVertex = extract(nullptr, particles, params);
+	params.densityMode = DensityMode::BlockTiled;
+	SurfaceMesh tiled = extract(nullptr, particles, params);
+
+	CHECK(perVertex.indices == tiled.indices);
+	CHECK(perVertex.positions.size() == tiled.positions.size());
+	if (perVertex.positions.size() != tiled.positions.size()) {
+		return;
+	}
+
+	float largestOffset = 0.0f;
+	float smallestCosine = 1.0f;
+	for (size_t i = 0; i < perVertex.positions.size(); i++) {
+		largestOffset = std::max(largestOffset, length(perVertex.positions[i] - tiled.positions[i]));
+		smallestCosine = std::min(smallestCosine, dot(perVertex.normals[i], tiled.normals[i]));
+	}
+	CHECK(largestOffset < 1e-4f);
+	CHECK(smallestCosine > 0.9999f);
+}
+
+// Normals are the density gradient, which points into the fluid. A support of 3 reaches well past the 1 a vertex reads,
+// uncut the kernel is nearly flat over the cube of cells read and the normals bend toward its faces, 8 degrees on average.
+// Cut to the cells read it's the kernel of makeParams with its peak lowered 3^6 times
+static void normalsPointAtSphereCenter() {
+	Particles particles = makeSphere();
+	for (DensityKernel kernel : { DensityKernel::Poly6, DensityKernel::CubicSpline, DensityKernel::Wendland }) {
+		SurfaceParams params = makeParams();
+		params.kernelScale = 3.0f;
+		params.isovalue /= 729.0f;
+		params.kernel = kernel;
+		SurfaceMesh mesh = extract(nullptr, particles, params);
+		CHECK(mesh.getTriangleCount() > 1000);
+
+		float cosineSum = 0.0f;
+		float smallestCosine = 1.0f;
+		for (size_t i = 0; i < mesh.positions.size(); i++) {
+			float cosine = dot(mesh.normals[i], normalize(SPHERE_CENTER - mesh.positions[i]));
+			cosineSum += cosine;
+			smallestCosine = std::min(smallestCosine, cosine);
+		}
+		// Within 2 degrees on average and 6 at worst
+		CHECK(cosineSum / mesh.positions.size() > std::cos(2.0f * PI / 180.0f));
+		CHECK(smallestCosine > std::cos(6.0f * PI / 180.0f));
+	}
+}
+
+// Cameras along an axis, a diagonal and off to one side, each close enough to leave blocks at every level
+static void lodMeshIsClosed() {
+	Particles particles = makeSphere();
+	const Vec3 cameras[] = { { 6.0f, 6.0f, 0.0f }, { 1.0f, 2.0f, 3.0f }, { 10.0f, 10.0f, 10.0f } };
+	const float fullDetailDistances[] = { 4.0f, 4.5f, 4.6f };
+	SurfaceExtractor extractor;
+	for (int view = 0; view < 3; view++) {
+		SurfaceParams params = makeParams();
+		params.lod.enabled = true;
+		params.lod.cameraPosition = cameras[view];
+		params.lod.fullDetailDistance = fullDetailDistances[view];
+		SurfaceMesh mesh;
+		extractor.extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), params, mesh);
+
+		int levelCounts[MAX_SURFACE_LOD + 1] = {};
+		for (int block : extractor.getSurfaceBlockIndices()) {
+			levelCounts[extractor.getBlockLevels()[block]]++;
+		}
+		for (int level = 0; level <= MAX_SURFACE_LOD; level++) {
+			CHECK(levelCounts[level] > 0);
+		}
+
+		// Coarse and fine sides of a stitched face have to share every vertex on it
+		MeshTopology topology = getTopology(mesh);
+		CHECK(topology.faces > 0);
+		CHECK(topology.openEdges == 0);
+		CHECK(topology.nonManifoldEdges == 0);
+		CHECK(topology.getEulerCharacteristic() == 2);
+	}
+}
+
+// Every block is within the full detail distance, so stitching has nothing to do
+static void lodBeyondDomainMatchesFullDetail() {
+	Particles particles = makeSphere();
+	SurfaceParams params = makeParams();
+	SurfaceMesh fullDetail = extract(nullptr, particles, params);
+
+	params.lod.enabled = true;
+	params.lod.cameraPosition = { 0.0f, 0.0f, 0.0f };
+	params.lod.fullDetailDistance = 100.0f;
+	SurfaceMesh lod = extract(nullptr, particles, params);
+
+	CHECK(lod.getTriangleCount() == fullDetail.getTriangleCount());
+	CHECK(getTriangles(lod) == getTriangles(fullDetail));
+}
+
+// A ball moving further than the tolerance every frame, then gone for a frame and back, next to one that stays put.
+// The still ball's blocks are kept, the rest have to come out as a fresh extraction
+static void reusedMeshMatchesFreshMeshWithMovingParticles() {
+	Particles still = makeSphere({ 3.5f, 6.0f, 6.0f }, 1.5f);
+	SurfaceExtractor reusing;
+	size_t reusedBlocks = 0;
+
+	for (int frame = 0; frame < 8; frame++) {
+		Particles particles = still;
+		Particles moving = makeSphere({ 7.5f + 0.3f * frame, 6.0f, 6.0f + 0.1f * frame }, 1.5f);
+		if (frame != 5) {
+			particles.positions.insert(particles.positions.end(), moving.positions.begin(), moving.positions.end());
+			particles.materials.insert(particles.materials.end(), moving.materials.begin(), moving.materials.end());
+		}
+
+		SurfaceParams params = makeParams();
+		SurfaceMesh freshMesh = extract(nullptr, particles, params);
+
+		params.reuseTolerance = 0.05f;
+		SurfaceMesh reusedMesh;
+		reusing.extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), params, reusedMesh);
+
+		CHECK(!freshMesh.indices.empty());
+		CHECK(getTriangles(reusedMesh) == getTriangles(freshMesh));
+		if (frame > 0) {
+			reusedBlocks += reusing.getMeshedBlockIndices().size() - reusing.getRebuiltBlockCount();
+		}
+	}
+	CHECK(reusedBlocks > 0);
+}
+
+// Each entry keeps its own history, so it has to match an extractor that only ever sees that material, also when blocks
+// are reused across frames
+static void extractMaterialsMatchesExtractPerMaterial() {
+	std::vector<SurfaceParams> materialParams;
+	for (int material : { 0, 1, 2, 4, 7, -1 }) {
+		SurfaceParams params{ { 48, 48, 48 }, { 0.0f, 0.0f, 0.0f }, 0.25f, 0.6f, 1.0f, 20.0f, material };
+		params.reuseTolerance = 0.05f;
+		materialParams.push_back(params);
+	}
+
+	SurfaceExtractor extractor;
+	std::vector<SurfaceExtractor> perMaterial(materialParams.size());
+	for (int frame = 0; frame < 4; frame++) {
+		// The third frame stays put so its blocks are reused
+		Particles particles = makeMixedMaterials(frame == 2 ? 0.1f : 0.1f * frame);
+		std::vector<SurfaceMesh> meshes;
+		extractor.extractMaterials(particles.positions.data(), particles.materials.data(), particles.positions.size(), materialParams, meshes);
+		CHECK(meshes.size() == materialParams.size());
+
+		for (size_t i = 0; i < materialParams.size(); i++) {
+			SurfaceMesh mesh;
+			perMaterial[i].extract(particles.positions.data(), particles.materials.data(), particles.positions.size(), materialParams[i], mesh);
+
+			CHECK(meshes[i].indices == mesh.indices);
+			CHECK(sameVec3s(meshes[i].positions, mesh.positions));
+			CHECK(sameVec3s(meshes[i].normals, mesh.normals));
+			CHECK(meshes[i].colors.size() == mesh.colors.size());
+			for (size_t v = 0; v < mesh.colors.size() && v < meshes[i].colors.size(); v++) {
+				CHECK(meshes[i].colors[v].x == mesh.colors[v].x && meshes[i].colors[v].z == mesh.colors[v].z);
+			}
+
+			bool hasParticles = materialParams[i].material != 4 && materialParams[i].material != 7;
+			CHECK((mesh.getTriangleCount() > 0) == hasParticles);
+		}
+	}
+}
+
+int main() {
+	RUN_TEST(sameMeshForEveryThreadCount);
+	RUN_TEST(sphereIsClosedAtItsRadius);
+	RUN_TEST(densityModesGiveSameMesh);
+	RUN_TEST(normalsPointAtSphereCenter);
+	RUN_TEST(extractMaterialsMatchesExtractPerMaterial);
+	RUN_TEST(lodMeshIsClosed);
+	RUN_TEST(lodBeyondDomainMatchesFullDetail);
+	RUN_TEST(reusedMeshMatchesFreshMeshWithMovingParticles);
+	return checkResult();
+}
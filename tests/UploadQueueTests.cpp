@@ -0,0 +1,125 @@
+#include "Check.h"
+#include "Memory/UploadQueue.h"
+
+#include <cstdint>
+#include <vector>
+
+static void zeroDataBecomesClears() {
+	UploadQueue queue(1024);
+	int zeros[8] = {};
+
+	CHECK(queue.queue(0, nullptr, 4000).clear);
+	CHECK(queue.queue(1, zeros, sizeof(zeros)).clear);
+	CHECK(queue.getClearCount() == 2);
+
+	// Clears never take staging memory
+	CHECK(queue.getStagingPageCount() == 0);
+	CHECK(queue.getStagingSize() == 0);
+}
+
+static void partialWordsAreUploaded() {
+	UploadQueue queue(1024);
+	char zeros[3] = {};
+
+	// Devices clear whole words, so a 3 byte buffer is copied even though it is zero
+	const UploadRequest& request = queue.queue(0, zeros, sizeof(zeros));
+	CHECK(!request.clear);
+	CHECK(request.staging.isValid());
+
+	// A granularity of zero allows clearing any size
+	CHECK(queue.queue(1, zeros, sizeof(zeros), 0).clear);
+}
+
+static void packsStagingData() {
+	UploadQueue queue(1024);
+	int data[4] = { 0, 1, 0, 0 };
+	char bytes[3] = { 1, 2, 3 };
+
+	UploadRequest first = queue.queue(7, data, sizeof(data));
+	CHECK(!first.clear);
+	CHECK(first.destination == 7);
+	CHECK(first.size == sizeof(data));
+	CHECK(first.staging.page == 0);
+	CHECK(first.staging.offset == 0);
+
+	UploadRequest second = queue.queue(8, bytes, sizeof(bytes));
+	CHECK(second.staging.page == 0);
+	CHECK(second.staging.offset == UploadQueue::StagingAlignment);
+
+	// The next request starts at the following aligned offset
+	UploadRequest third = queue.queue(9, data, sizeof(data));
+	CHECK(third.staging.offset == 2 * UploadQueue::StagingAlignment);
+
+	CHECK(queue.getStagingPageCount() == 1);
+	CHECK(queue.getStagingSize() == sizeof(data) * 2 + sizeof(bytes));
+}
+
+static void oversizedDataGetsItsOwnPage() {
+	UploadQueue queue(1024);
+	std::vector<uint8_t> small(600, 1);
+	std::vector<uint8_t> large(2000, 1);
+
+	CHECK(queue.queue(0, small.data(), small.size()).staging.page == 0);
+	UploadRequest request = queue.queue(1, large.data(), large.size());
+	CHECK(request.staging.page == 1);
+	CHECK(request.staging.offset == 0);
+	CHECK(queue.getStagingPageSize(1) == 2000);
+
+	// Doesn't fit after the first request, so it opens another regular page
+	CHECK(queue.queue(2, small.data(), small.size()).staging.page == 2);
+	CHECK(queue.getStagingPageSize(2) == 1024);
+}
+
+static void keepsRequestsInOrder() {
+	UploadQueue queue(1024);
+	int data[2] = { 1, 2 };
+
+	queue.queue(3, nullptr, 16);
+	queue.queue(1, data, sizeof(data));
+	queue.queue(2, nullptr, 16);
+
+	const std::vector<UploadRequest>& requests = queue.getRequests();
+	CHECK(requests.size() == 3);
+	CHECK(requests[0].destination == 3 && requests[0].clear);
+	CHECK(requests[1].destination == 1 && !requests[1].clear);
+	CHECK(requests[2].destination == 2 && requests[2].clear);
+}
+
+static void resetStartsOver() {
+	UploadQueue queue(1024);
+	int data[2] = { 1, 2 };
+
+	queue.queue(0, data, sizeof(data));
+	queue.queue(1, nullptr, 16);
+	queue.reset();
+
+	CHECK(queue.empty());
+	CHECK(queue.getClearCount() == 0);
+	CHECK(queue.getStagingPageCount() == 0);
+	CHECK(queue.queue(2, data, sizeof(data)).staging.offset == 0);
+}
+
+static void detectsZeroBytes() {
+	uint8_t bytes[19] = {};
+	CHECK(UploadQueue::isZero(bytes, sizeof(bytes)));
+	CHECK(UploadQueue::isZero(bytes, 0));
+
+	// Non-zero bytes in the word part and in the leftover tail
+	bytes[3] = 1;
+	CHECK(!UploadQueue::isZero(bytes, sizeof(bytes)));
+	bytes[3] = 0;
+	bytes[18] = 1;
+	CHECK(!UploadQueue::isZero(bytes, sizeof(bytes)));
+	CHECK(UploadQueue::isZero(bytes, 18));
+}
+
+int main() {
+	RUN_TEST(zeroDataBecomesClears);
+	RUN_TEST(partialWordsAreUploaded);
+	RUN_TEST(packsStagingData);
+	RUN_TEST(oversizedDataGetsItsOwnPage);
+	RUN_TEST(keepsRequestsInOrder);
+	RUN_TEST(resetStartsOver);
+	RUN_TEST(detectsZeroBytes);
+	return checkResult();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cmath>
+#include "Surface/BlockCulling.h"
+
+// What XMMatrixLookToLH(eye, forward, +y) * XMMatrixPerspectiveFovLH gives, row vectors on the left like Camera::getViewProjMat
+inline Mat4 makeViewProj(const Vec3& eye, const Vec3& forward, float fovY, float aspect, float nearZ, float farZ) {
+	Vec3 f = normalize(forward);
+	Vec3 up = { 0.0f, 1.0f, 0.0f };
+	auto cross = [](const Vec3& a, const Vec3& b) { return Vec3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; };
+	Vec3 r = normalize(cross(up, f));
+	Vec3 u = cross(f, r);
+
+	float view[4][4] = {
+		{ r.x, u.x, f.x, 0.0f },
+		{ r.y, u.y, f.y, 0.0f },
+		{ r.z, u.z, f.z, 0.0f },
+		{ -dot(r, eye), -dot(u, eye), -dot(f, eye), 1.0f }
+	};
+	float yScale = 1.0f / std::tan(fovY * 0.5f);
+	float xScale = yScale / aspect;
+	float zScale = farZ / (farZ - nearZ);
+	float projection[4][4] = {
+		{ xScale, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, yScale, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, zScale, 1.0f },
+		{ 0.0f, 0.0f, -zScale * nearZ, 0.0f }
+	};
+
+	Mat4 viewProj{};
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			for (int k = 0; k < 4; k++) {
+				viewProj.m[i][j] += view[i][k] * projection[k][j];
+			}
+		}
+	}
+	return viewProj;
+}